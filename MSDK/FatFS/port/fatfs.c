@@ -66,19 +66,51 @@ static FATFS *fs = NULL;     /* Filesystem object */
 static os_mutex_t fs_mutex = NULL;
 #endif
 
+#if FATFS_CACHE_SECTORS
+#define FATFS_CACHE_SETS        (FATFS_CACHE_SECTORS / FATFS_CACHE_WAYS)
+
+/* sector cache between the disk I/O functions and the flash */
+typedef struct fs_cache_line {
+    LBA_t sector;
+    uint32_t stamp;     /* last use, for LRU replacement in the set */
+    uint8_t valid;
+    uint8_t dirty;
+    BYTE *buf;
+} fs_cache_line_t;
+
+static struct {
+    fs_cache_line_t line[FATFS_CACHE_SECTORS];
+    os_mutex_t lock;
+    os_timer_t timer;
+    uint32_t tick;
+    uint32_t dirty_cnt;
+    uint32_t dirty_time;    /* time the first of the dirty sectors was written */
+    uint8_t enabled;
+} fs_cache;
+#endif
+
 static void fresult_analyse(int8_t res);
+#if FATFS_CACHE_SECTORS
+static void fs_cache_init(void);
+#endif
+#if defined(USE_WL) && FATFS_GC_TASK_STACK_SIZE
+static void fs_gc_kick(void);
+#else
+#define fs_gc_kick()
+#endif
 
 #ifdef USE_WL
 #include "wear_levelling_flash.c"
 #endif
 
 /*!
-    \brief      fatfs: create a fatfs volume and mount a logical drive
-    \param[in]  none
+    \brief      fatfs: mount the logical drive, create a fatfs volume if needed
+    \param[in]  opt: format options, NULL for the default
+    \param[in]  format: 1 to erase the flash and create a new volume whatever it holds
     \param[out] none
     \retval     true: success
 */
-bool fatfs_mk_mount(const MKFS_PARM* opt)
+static bool fatfs_volume_mount(const MKFS_PARM* opt, uint8_t format)
 {
     int res = FR_OK;
     BYTE *work = NULL;
@@ -92,12 +124,13 @@ bool fatfs_mk_mount(const MKFS_PARM* opt)
     sys_memset(&wl_config_global, 0, sizeof(wl_config_global));
     wl_config_global.cfg.start_addr = FATFS_FLASH_START_ADDR;
     wl_config_global.cfg.full_mem_size = FATFS_FULL_MEM_SIZE;
-    wl_config_global.cfg.page_size = FATFS_SECTOR_SIZE;
     wl_config_global.cfg.sector_size = FATFS_SECTOR_SIZE;
-    wl_config_global.cfg.wr_size = 0x00000008; //bits
-    wl_config_global.cfg.version = 0x00000001;
+    wl_config_global.cfg.version = 0x00000002;
     wl_config_global.cfg.temp_buff_size = FATFS_SECTOR_SIZE;
+    wl_config_global.cfg.format = format;
 
+    /* a volume of the previous layout is mounted in that layout with FATFS_WL_LEGACY,
+       left untouched until "fatfs format" otherwise */
     if (wl_flash_config(&wl_config_global)) {
 #ifdef USE_QSPI_FLASH
         sys_mutex_free(&fs_mutex);
@@ -106,6 +139,13 @@ bool fatfs_mk_mount(const MKFS_PARM* opt)
     }
 #endif
 
+#if FATFS_CACHE_SECTORS
+    fs_cache_init();
+#endif
+    /* drop the sectors cached from the erased volume */
+    if (format)
+        fs_flash_trim(0, fs_flash_size() / FATFS_SECTOR_SIZE - 1);
+
     fs = (FATFS *)sys_malloc(sizeof(FATFS));
     if (fs == NULL) {
 #ifdef USE_QSPI_FLASH
@@ -114,15 +154,19 @@ bool fatfs_mk_mount(const MKFS_PARM* opt)
         return false;
     }
 
-    res = f_mount(fs, "0", 1);  /*check if has made an volum in flash before*/
-    if (res == FR_OK) {
-        app_print("FATFS: mount succeed\r\n");
-        return true;
+    if (!format) {
+        res = f_mount(fs, "0", 1);  /*check if has made an volum in flash before*/
+        if (res == FR_OK) {
+            app_print("FATFS: mount succeed\r\n");
+            return true;
+        }
     }
 
     work = (BYTE *)sys_malloc(FF_MAX_SS);
     if (work == NULL) {
+        f_mount(NULL, "0", 0);
         sys_mfree(fs);
+        fs = NULL;
 #ifdef USE_QSPI_FLASH
         sys_mutex_free(&fs_mutex);
 #endif
@@ -133,7 +177,9 @@ bool fatfs_mk_mount(const MKFS_PARM* opt)
     if (res != FR_OK) {
         app_print("FATFS: mkfs failed\r\n");
         fresult_analyse(res);
+        f_mount(NULL, "0", 0);
         sys_mfree(fs);
+        fs = NULL;
         sys_mfree(work);
 #ifdef USE_QSPI_FLASH
         sys_mutex_free(&fs_mutex);
@@ -148,13 +194,57 @@ bool fatfs_mk_mount(const MKFS_PARM* opt)
         app_print("FATFS: mount succeed\r\n");
         return true;
     }
+    sys_mfree(work);
+    f_mount(NULL, "0", 0);
     sys_mfree(fs); /* if mount succeed, do not free fs */
+    fs = NULL;
 #ifdef USE_QSPI_FLASH
     sys_mutex_free(&fs_mutex);
 #endif
     return false;
 }
 
+/*!
+    \brief      fatfs: create a fatfs volume and mount a logical drive
+    \param[in]  opt: format options, NULL for the default
+    \param[out] none
+    \retval     true: success
+*/
+bool fatfs_mk_mount(const MKFS_PARM* opt)
+{
+    return fatfs_volume_mount(opt, 0);
+}
+
+/*!
+    \brief      fatfs: erase the flash, create a new fatfs volume and mount it,
+                e.g. to move a volume of the previous wear levelling layout to the sector map
+    \param[in]  opt: format options, NULL for the default
+    \param[out] none
+    \retval     true: success
+*/
+bool fatfs_format(const MKFS_PARM* opt)
+{
+    if (fs != NULL) {
+#if defined(USE_WL) && FATFS_WL_LEGACY
+        /* a volume of the previous layout is moved to the sector map, the gc task does not use it */
+        if (wl_config_global.legacy) {
+            f_mount(NULL, "0", 0);
+            sys_mfree(fs);
+            fs = NULL;
+            wl_flash_release(&wl_config_global);
+#ifdef USE_QSPI_FLASH
+            sys_mutex_free(&fs_mutex);
+#endif
+            return fatfs_volume_mount(opt, 1);
+        }
+#endif
+        app_print("FATFS: volume is mounted, not formatted\r\n");
+        return false;
+    }
+
+    return fatfs_volume_mount(opt, 1);
+}
+
 /*!
     \brief      get file size from a existed file and print it
     \param[in]  path:pointer to file path
@@ -699,6 +789,12 @@ uint32_t cmd_fatfs_exec(int argc, char **argv)
             fresult_analyse(res);
             return 0;
         }
+    } else if (strcmp(argv[1], "format") == 0) {
+        if (argc == 2) {
+            if (!fatfs_format(NULL))
+                app_print("FATFS: format failed\r\n");
+            return 0;
+        }
     } else if (strcmp(argv[1], "show") == 0) {
         if (argc == 2) {
             res = fatfs_show(NULL, 1);
@@ -815,25 +911,24 @@ static int fs_normal_flash_write(uint32_t address, const uint8_t* pdata, uint16_
 #endif
 
 /*!
-    \brief      write data to flash
+    \brief      write data to flash, bypassing the sector cache
     \param[in]  sector:	Start sector in LBA
     \param[in]  buff: Data buffer to store write data
     \param[in]  count: Number of sectors to write
     \retval     result: 0 for success, -1 for fail
 */
-int fs_flash_write(LBA_t sector, const BYTE *buff, UINT count)
+static int fs_flash_write_direct(LBA_t sector, const BYTE *buff, UINT count)
 {
 #ifdef USE_WL
-    if ((sector * FATFS_SECTOR_SIZE) > wl_config_global.flash_size) {
+    if ((sector + count) > wl_config_global.log_cnt) {
         app_print("FATFS_ERROR: write out of range\r\n");
         return RES_ERROR;
     }
 
-    if (wl_flash_erase_range(&wl_config_global, (sector * FATFS_SECTOR_SIZE), (count * FATFS_SECTOR_SIZE)))
-        return RES_ERROR;
-
-    if (wl_flash_write(&wl_config_global, (sector * FATFS_SECTOR_SIZE), buff, (count * FATFS_SECTOR_SIZE)))
+    /* no erase here, the sector goes to an erased page of the translation layer */
+    if (wl_flash_write(&wl_config_global, sector, buff, count))
         return RES_ERROR;
+    fs_gc_kick();
 #else
     if ((sector * FATFS_SECTOR_SIZE) > FATFS_FLASH_TOTAL_SIZE) {
         app_print("FATFS_ERROR: write out of range\r\n");
@@ -869,13 +964,13 @@ int fs_flash_write(LBA_t sector, const BYTE *buff, UINT count)
 }
 
 /*!
-    \brief      read data from flash
+    \brief      read data from flash, bypassing the sector cache
     \param[in]  sector:	Start sector in LBA
     \param[out] buff: Data buffer to store read data
     \param[in]  count: Number of sectors to read
     \retval     result: 0 for success, -1 for fail
 */
-int fs_flash_read(LBA_t sector, BYTE *buff, UINT count)
+static int fs_flash_read_direct(LBA_t sector, BYTE *buff, UINT count)
 {
     if ((sector * FATFS_SECTOR_SIZE) > FATFS_FLASH_TOTAL_SIZE) {
         app_print("FATFS_ERROR: read out of range\r\n");
@@ -883,7 +978,7 @@ int fs_flash_read(LBA_t sector, BYTE *buff, UINT count)
     }
 
 #ifdef USE_WL
-    if (wl_flash_read(&wl_config_global, (sector * FATFS_SECTOR_SIZE), buff, (count * FATFS_SECTOR_SIZE)))
+    if (wl_flash_read(&wl_config_global, sector, buff, count))
     {
         app_print("FATFS_ERROR: read from flash error!\r\n");
         return RES_ERROR;
@@ -912,9 +1007,446 @@ int fs_flash_read(LBA_t sector, BYTE *buff, UINT count)
     return RES_OK;
 }
 
+#if FATFS_CACHE_SECTORS
+/*!
+    \brief      find the cache line holding a sector
+    \param[in]  sector: sector in LBA
+    \param[out] none
+    \retval     cache line, NULL if the sector is not cached
+*/
+static fs_cache_line_t *fs_cache_find(LBA_t sector)
+{
+    fs_cache_line_t *line = &fs_cache.line[(sector % FATFS_CACHE_SETS) * FATFS_CACHE_WAYS];
+    uint32_t way;
+
+    for (way = 0; way < FATFS_CACHE_WAYS; way++, line++) {
+        if (line->valid && (line->sector == sector))
+            return line;
+    }
+    return NULL;
+}
+
+/*!
+    \brief      write a dirty cache line back to flash
+    \param[in]  line: cache line
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int fs_cache_line_flush(fs_cache_line_t *line)
+{
+    if (!line->dirty)
+        return RES_OK;
+
+    if (fs_flash_write_direct(line->sector, line->buf, 1))
+        return RES_ERROR;
+
+    line->dirty = 0;
+    fs_cache.dirty_cnt--;
+    return RES_OK;
+}
+
+/*!
+    \brief      get a cache line for a sector not cached, the least recently used of its set
+    \param[in]  sector: sector in LBA
+    \param[out] none
+    \retval     cache line, NULL if the dirty line to evict could not be written
+*/
+static fs_cache_line_t *fs_cache_alloc(LBA_t sector)
+{
+    fs_cache_line_t *line = &fs_cache.line[(sector % FATFS_CACHE_SETS) * FATFS_CACHE_WAYS];
+    fs_cache_line_t *victim = line;
+    uint32_t way;
+
+    for (way = 0; way < FATFS_CACHE_WAYS; way++, line++) {
+        if (!line->valid) {
+            victim = line;
+            break;
+        }
+        if ((int32_t)(line->stamp - victim->stamp) < 0)
+            victim = line;
+    }
+
+    if (victim->valid && fs_cache_line_flush(victim))
+        return NULL;
+
+    victim->valid = 0;
+    victim->sector = sector;
+    return victim;
+}
+
+/*!
+    \brief      write all dirty cache lines back to flash, in sector order
+    \param[in]  none
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int fs_cache_flush_all(void)
+{
+    fs_cache_line_t *line;
+    uint32_t i;
+    int res = RES_OK;
+
+    while (fs_cache.dirty_cnt) {
+        line = NULL;
+        for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+            if (fs_cache.line[i].dirty && (!line || (fs_cache.line[i].sector < line->sector)))
+                line = &fs_cache.line[i];
+        }
+        if (!line || fs_cache_line_flush(line)) {
+            res = RES_ERROR;
+            break;
+        }
+    }
+
+    return res;
+}
+
+/*!
+    \brief      flush timer, writes the dirty sectors if the disk is idle
+    \param[in]  p_tmr: timer
+    \param[in]  p_arg: not used
+    \param[out] none
+    \retval     none
+*/
+static void fs_cache_timer_cb(void *p_tmr, void *p_arg)
+{
+    /* a running access flushes the aged sectors itself, do not block the timer task */
+    if (sys_mutex_try_get(&fs_cache.lock, 0) != OS_OK) {
+        sys_timer_start(&fs_cache.timer, false);
+        return;
+    }
+
+    /* retry later if the flash failed, the sectors are still dirty */
+    if (fs_cache_flush_all())
+        sys_timer_start(&fs_cache.timer, false);
+    sys_mutex_put(&fs_cache.lock);
+}
+
+/*!
+    \brief      mark a cache line dirty
+    \param[in]  line: cache line
+    \param[out] none
+    \retval     none
+*/
+static void fs_cache_line_dirty(fs_cache_line_t *line)
+{
+    if (line->dirty)
+        return;
+
+    line->dirty = 1;
+    if (fs_cache.dirty_cnt++ == 0) {
+        fs_cache.dirty_time = sys_current_time_get();
+        if (FATFS_CACHE_FLUSH_MS)
+            sys_timer_start(&fs_cache.timer, false);
+    }
+}
+
+/*!
+    \brief      allocate the sector cache
+    \param[in]  none
+    \param[out] none
+    \retval     none, the disk is used without cache if the memory is not available
+*/
+static void fs_cache_init(void)
+{
+    uint32_t i;
+
+    if (fs_cache.enabled)
+        return;
+
+    sys_memset(&fs_cache, 0, sizeof(fs_cache));
+    for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+        fs_cache.line[i].buf = (BYTE *)sys_malloc(FATFS_SECTOR_SIZE);
+        if (fs_cache.line[i].buf == NULL)
+            goto error;
+    }
+
+    if (sys_mutex_init(&fs_cache.lock) != OS_OK)
+        goto error;
+
+    if (FATFS_CACHE_FLUSH_MS)
+        sys_timer_init(&fs_cache.timer, (const uint8_t *)"fs_cache", FATFS_CACHE_FLUSH_MS, 0, fs_cache_timer_cb, NULL);
+
+    fs_cache.enabled = 1;
+    return;
+
+error:
+    app_print("FATFS: no memory for sector cache, disabled\r\n");
+    for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+        if (fs_cache.line[i].buf)
+            sys_mfree(fs_cache.line[i].buf);
+        fs_cache.line[i].buf = NULL;
+    }
+}
+#endif /* FATFS_CACHE_SECTORS */
+
+/*!
+    \brief      write data to flash through the sector cache
+    \param[in]  sector:	Start sector in LBA
+    \param[in]  buff: Data buffer to store write data
+    \param[in]  count: Number of sectors to write
+    \retval     result: 0 for success, -1 for fail
+*/
+int fs_flash_write(LBA_t sector, const BYTE *buff, UINT count)
+{
+#if FATFS_CACHE_SECTORS
+    fs_cache_line_t *line;
+    UINT i;
+    int res = RES_OK;
+
+    if (!fs_cache.enabled)
+        return fs_flash_write_direct(sector, buff, count);
+
+    sys_mutex_get(&fs_cache.lock);
+    if (count == 1) {
+        /* FAT, directory and partial data sectors, rewrites are merged in the cache */
+        line = fs_cache_find(sector);
+        if (line == NULL)
+            line = fs_cache_alloc(sector);
+        if (line == NULL) {
+            res = RES_ERROR;
+        } else {
+            sys_memcpy(line->buf, buff, FATFS_SECTOR_SIZE);
+            line->valid = 1;
+            line->stamp = ++fs_cache.tick;
+            fs_cache_line_dirty(line);
+        }
+    } else {
+        /* whole clusters of file data go straight to flash */
+        res = fs_flash_write_direct(sector, buff, count);
+        for (i = 0; (i < count) && (res == RES_OK); i++) {
+            line = fs_cache_find(sector + i);
+            if (line) {
+                sys_memcpy(line->buf, &buff[i * FATFS_SECTOR_SIZE], FATFS_SECTOR_SIZE);
+                if (line->dirty) {
+                    line->dirty = 0;
+                    fs_cache.dirty_cnt--;
+                }
+            }
+        }
+    }
+
+    if ((res == RES_OK) && fs_cache.dirty_cnt &&
+        ((sys_current_time_get() - fs_cache.dirty_time) >= FATFS_CACHE_FLUSH_MS))
+        res = fs_cache_flush_all();
+    sys_mutex_put(&fs_cache.lock);
+
+    return res;
+#else
+    return fs_flash_write_direct(sector, buff, count);
+#endif
+}
+
+/*!
+    \brief      read data from flash through the sector cache
+    \param[in]  sector:	Start sector in LBA
+    \param[out] buff: Data buffer to store read data
+    \param[in]  count: Number of sectors to read
+    \retval     result: 0 for success, -1 for fail
+*/
+int fs_flash_read(LBA_t sector, BYTE *buff, UINT count)
+{
+#if FATFS_CACHE_SECTORS
+    fs_cache_line_t *line;
+    UINT i, run;
+    int res = RES_OK;
+
+    if (!fs_cache.enabled)
+        return fs_flash_read_direct(sector, buff, count);
+
+    sys_mutex_get(&fs_cache.lock);
+    for (i = 0; (i < count) && (res == RES_OK); i += run) {
+        run = 1;
+        line = fs_cache_find(sector + i);
+        if (line) {
+            line->stamp = ++fs_cache.tick;
+            sys_memcpy(&buff[i * FATFS_SECTOR_SIZE], line->buf, FATFS_SECTOR_SIZE);
+        } else if (count == 1) {
+            /* single sectors are the FAT and directories, keep them for the next update */
+            line = fs_cache_alloc(sector);
+            if ((line == NULL) || fs_flash_read_direct(sector, line->buf, 1)) {
+                res = RES_ERROR;
+            } else {
+                line->valid = 1;
+                line->stamp = ++fs_cache.tick;
+                sys_memcpy(buff, line->buf, FATFS_SECTOR_SIZE);
+            }
+        } else {
+            /* read the sectors not cached in one go */
+            while (((i + run) < count) && (fs_cache_find(sector + i + run) == NULL))
+                run++;
+            res = fs_flash_read_direct(sector + i, &buff[i * FATFS_SECTOR_SIZE], run);
+        }
+    }
+    sys_mutex_put(&fs_cache.lock);
+
+    return res;
+#else
+    return fs_flash_read_direct(sector, buff, count);
+#endif
+}
+
+/*!
+    \brief      complete pending writes, called on CTRL_SYNC
+    \param[in]  none
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+int fs_flash_sync(void)
+{
+#if FATFS_CACHE_SECTORS
+    int res = RES_OK;
+
+    if (!fs_cache.enabled)
+        return RES_OK;
+
+    /* f_sync() and f_close() commit the file, whatever the age of its sectors */
+    sys_mutex_get(&fs_cache.lock);
+    res = fs_cache_flush_all();
+    sys_mutex_put(&fs_cache.lock);
+
+    return res;
+#else
+    return RES_OK;
+#endif
+}
+
+/*!
+    \brief      write all the sectors kept in the cache to flash, e.g. before a reset
+    \param[in]  none
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+int fatfs_cache_flush(void)
+{
+#if FATFS_CACHE_SECTORS
+    int res;
+
+    if (!fs_cache.enabled)
+        return RES_OK;
+
+    sys_mutex_get(&fs_cache.lock);
+    res = fs_cache_flush_all();
+    sys_mutex_put(&fs_cache.lock);
+
+    return res;
+#else
+    return RES_OK;
+#endif
+}
+
 uint32_t fs_flash_size(void)
 {
+#ifdef USE_WL
+    return wl_flash_size(&wl_config_global);
+#else
     return FATFS_FLASH_TOTAL_SIZE;
+#endif
+}
+
+/*!
+    \brief      inform the flash layer that sectors are no longer used
+    \param[in]  start: first sector in LBA
+    \param[in]  end: last sector in LBA, included
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+int fs_flash_trim(LBA_t start, LBA_t end)
+{
+#if FATFS_CACHE_SECTORS
+    fs_cache_line_t *line;
+    uint32_t i;
+
+    /* trimmed sectors are not used any more, drop them without writing */
+    if (fs_cache.enabled) {
+        sys_mutex_get(&fs_cache.lock);
+        for (i = 0, line = fs_cache.line; i < FATFS_CACHE_SECTORS; i++, line++) {
+            if (line->valid && (line->sector >= start) && (line->sector <= end)) {
+                if (line->dirty)
+                    fs_cache.dirty_cnt--;
+                line->valid = 0;
+                line->dirty = 0;
+            }
+        }
+        sys_mutex_put(&fs_cache.lock);
+    }
+#endif
+#ifdef USE_WL
+    if (wl_flash_trim(&wl_config_global, start, end))
+        return RES_ERROR;
+    fs_gc_kick();
+#endif
+    return RES_OK;
+}
+
+/*!
+    \brief      run one step of the flash garbage collection, erase free pages ahead of writes,
+                run by the background task, or by the application if FATFS_GC_TASK_STACK_SIZE is 0
+    \param[in]  max_erase: maximum flash erases in this step
+    \param[out] more: set to 1 if more steps are needed, can be NULL
+    \retval     result: 0 for success, -1 for fail
+*/
+int fatfs_gc_step(uint32_t max_erase, uint8_t *more)
+{
+#ifdef USE_WL
+    if (fs == NULL)
+        return FATFS_OTHER_ERROR;
+
+    return wl_flash_gc_step(&wl_config_global, max_erase, more);
+#else
+    if (more)
+        *more = 0;
+    return 0;
+#endif
 }
 
+#if defined(USE_WL) && FATFS_GC_TASK_STACK_SIZE
+static os_sema_t fs_gc_sema = NULL;
+
+/*!
+    \brief      background gc task, erases free pages at idle priority between writes
+    \param[in]  param: not used
+    \param[out] none
+    \retval     none
+*/
+static void fs_gc_task(void *param)
+{
+    uint8_t more;
+
+    for (;;) {
+        sys_sema_down(&fs_gc_sema, 0);
+
+        /* the lock is released between steps so that writers are not held for long */
+        do {
+            if (fatfs_gc_step(FATFS_GC_STEP_ERASES, &more)) {
+                app_print("FATFS_ERROR: background gc fail\r\n");
+                break;
+            }
+        } while (more);
+    }
+}
+
+/*!
+    \brief      wake up the background gc task after pages were used or freed
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void fs_gc_kick(void)
+{
+    if (!fs_gc_sema) {
+        if (sys_sema_init_ext(&fs_gc_sema, 1, 0) != OS_OK)
+            return;
+        if (sys_task_create_dynamic((const uint8_t *)"fatfs_gc", FATFS_GC_TASK_STACK_SIZE,
+                                    (OS_TASK_PRIO_IDLE + TASK_PRIO_HIGHER(1)), fs_gc_task, NULL) == NULL) {
+            sys_sema_free(&fs_gc_sema);
+            fs_gc_sema = NULL;
+            return;
+        }
+    }
+
+    sys_sema_up(&fs_gc_sema);
+}
+#endif
+
 #endif /* CONFIG_FATFS_SUPPORT */
@@ -41,6 +41,7 @@ OF SUCH DAMAGE.
 #ifdef CONFIG_FATFS_SUPPORT
 
 bool fatfs_mk_mount(const MKFS_PARM* opt);
+bool fatfs_format(const MKFS_PARM* opt);
 uint32_t cmd_fatfs_exec(int srgc, char** argv);
 int fatfs_append(char *path, uint8_t *data, int len);
 int fatfs_delete(const char* path);
@@ -51,6 +52,10 @@ int fatfs_rename(char *path, char *new_path);
 int fs_flash_write(LBA_t sector,const BYTE *buff, UINT count);
 int fs_flash_read(LBA_t sector, BYTE *buff, UINT count);
 uint32_t fs_flash_size(void);
+int fs_flash_trim(LBA_t start, LBA_t end);
+int fs_flash_sync(void);
+int fatfs_gc_step(uint32_t max_erase, uint8_t *more);
+int fatfs_cache_flush(void);
 #endif /* CONFIG_FATFS_SUPPORT */
 
 #endif /* _FATFS_H_ */
@@ -38,16 +38,13 @@ OF SUCH DAMAGE.
                 return result; \
         }
 
+#define WL_BIT_GET(map, n)      (((map)[(n) >> 5] >> ((n) & 0x1F)) & 1)
+#define WL_BIT_SET(map, n)      ((map)[(n) >> 5] |= (1UL << ((n) & 0x1F)))
+#define WL_BIT_CLR(map, n)      ((map)[(n) >> 5] &= ~(1UL << ((n) & 0x1F)))
+
 wl_flash_t wl_config_global;
 
 static uint32_t wl_calculate_crc(uint8_t *pbuf, uint32_t buffer_size);
-static uint32_t wl_flash_calc_addr(wl_flash_t *wl_flash, uint32_t addr);
-static int wl_flash_erase_raw(wl_flash_t *wl_flash, uint32_t start_address, uint32_t size);
-static int wl_flash_recover_pos(wl_flash_t *wl_flash);
-static int wl_flash_init_sections(wl_flash_t *wl_flash);
-static int wl_flash_erase_sector(wl_flash_t *wl_flash, uint32_t sector);
-static int wl_flash_updatewl(wl_flash_t *wl_flash);
-
 
 static int wl_flash_write_int(uint32_t offset, uint8_t *data, int len)
 {
@@ -91,426 +88,828 @@ static int wl_flash_read_int(uint32_t offset, uint8_t *data, int len)
 }
 
 /*!
-    \brief      from virtual address calculating physical address
+    \brief      erase flash sector by physical address
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  address: virtual flash address
+    \param[in]  start_address: start erase address
+    \param[in]  size: size of flash to erase
     \param[out] none
-    \retval     physical flash address
+    \retval     result: 0 for success, -1 for fail
 */
-static uint32_t wl_flash_calc_addr(wl_flash_t *wl_flash, uint32_t addr)
+static int wl_flash_erase_raw(wl_flash_t *wl_flash, uint32_t start_address, uint32_t size)
 {
-    uint32_t pa = 0, dummy_addr = 0;
+    uint32_t i = 0, sector_count = 0;
+    int result = 0;
 
-    pa = (wl_flash->flash_size - wl_flash->state.move_count * wl_flash->cfg.page_size + addr) % wl_flash->flash_size;
-    dummy_addr = wl_flash->state.pos * wl_flash->cfg.page_size;
-    if (pa >= dummy_addr) {
-        pa += wl_flash->cfg.page_size;
+    sector_count = size / wl_flash->cfg.sector_size;
+    for (i = 0; i < sector_count; i++) {
+#ifdef USE_QSPI_FLASH
+        if (sys_mutex_try_get(&fs_mutex, 60000) != OS_OK) {
+            app_print("wl flash: erase can't get mutex in one minute\r\n");
+            return -1;
+        }
+
+        result = qspi_flash_erase((start_address + (i * wl_flash->cfg.sector_size)), wl_flash->cfg.sector_size);
+        if (result) {
+            sys_mutex_put(&fs_mutex);
+            return result;
+        }
+        sys_mutex_put(&fs_mutex);
+#else
+        ERR_CHECK(raw_flash_erase((start_address + (i * wl_flash->cfg.sector_size)), wl_flash->cfg.sector_size))
+#endif
     }
+    return result;
+}
 
-    return pa;
+/*!
+    \brief      get flash address of a data page
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  ppn: physical page number
+    \param[out] none
+    \retval     flash address of the page
+*/
+static uint32_t wl_flash_page_addr(wl_flash_t *wl_flash, uint32_t ppn)
+{
+    return wl_flash->cfg.start_addr + ppn * wl_flash->cfg.sector_size;
 }
 
 /*!
-    \brief      initialize wear levelling related parameter
+    \brief      erase a free data page before its use, a page reading blank is erased as well
+                as it may be left by an erase cut by a reset and not hold programmed bits
     \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  ppn: physical page number
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-static int wl_flash_init_sections(wl_flash_t *wl_flash)
+static int wl_flash_page_prepare(wl_flash_t *wl_flash, uint32_t ppn)
 {
     int result = 0;
 
-    wl_flash->state.pos = 0;
-    wl_flash->state.move_count = 0;
-    wl_flash->state.version = wl_flash->cfg.version;
-    wl_flash->state.block_size = wl_flash->cfg.page_size;
-    wl_flash->state.max_pos = 1 + wl_flash->flash_size / wl_flash->cfg.page_size;
-    wl_flash->state.crc = wl_calculate_crc((uint8_t *)&wl_flash->state, sizeof(wl_state_t) - sizeof(uint32_t));
-    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_state1, wl_flash->state_size))
-    ERR_CHECK(wl_flash_write_int(wl_flash->addr_state1, (uint8_t *)&wl_flash->state, sizeof(wl_state_t)))
-
-    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_state2, wl_flash->state_size))
-    ERR_CHECK(wl_flash_write_int(wl_flash->addr_state2, (uint8_t *)&wl_flash->state, sizeof(wl_state_t)))
-
-    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_cfg, wl_flash->cfg_size))
-    ERR_CHECK(wl_flash_write_int(wl_flash->addr_cfg, (uint8_t *)&wl_flash->cfg, sizeof(wl_config_t)))
+    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash_page_addr(wl_flash, ppn), wl_flash->cfg.sector_size))
 
+    WL_BIT_SET(wl_flash->clean, ppn);
     return result;
 }
 
 /*!
-    \brief      recover pos that in use
+    \brief      allocate the next free data page, in round robin order to spread erases
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[out] none
+    \param[out] ppn: allocated physical page number, erased
     \retval     result: 0 for success, -1 for fail
 */
-static int wl_flash_recover_pos(wl_flash_t *wl_flash)
+static int wl_flash_page_alloc(wl_flash_t *wl_flash, uint16_t *ppn)
 {
-    uint8_t pos_bits = 0;
+    uint32_t n, p;
     int result = 0;
 
-    for (uint32_t i = 0; i < wl_flash->state.max_pos; i++) {
-        ERR_CHECK(wl_flash_read_int(wl_flash->addr_state1 + sizeof(wl_state_t) + i * wl_flash->cfg.wr_size / 8, &pos_bits, 1))
+    for (n = 0; n < wl_flash->phys_cnt; n++) {
+        p = wl_flash->alloc_pos;
+        if (++wl_flash->alloc_pos >= wl_flash->phys_cnt)
+            wl_flash->alloc_pos = 0;
 
-        if (pos_bits == 0xff) {
-            wl_flash->state.pos = i;
-            break;
-        }
-    }
-    if (wl_flash->state.pos == wl_flash->state.max_pos) {
-        wl_flash->state.pos--;
+        if (WL_BIT_GET(wl_flash->valid, p))
+            continue;
+
+        if (!WL_BIT_GET(wl_flash->clean, p))
+            ERR_CHECK(wl_flash_page_prepare(wl_flash, p))
+
+        WL_BIT_CLR(wl_flash->clean, p);
+        *ppn = p;
+        return 0;
     }
-    return result;
+
+    app_print("wl flash: no free page\r\n");
+    return -1;
 }
 
 /*!
-    \brief      erase flash sector by physical address
+    \brief      save the sector map to the next checkpoint slot and restart the journal
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  start_address: start erase address
-    \param[in]  size: size of flash to erase
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-static int wl_flash_erase_raw(wl_flash_t *wl_flash, uint32_t start_address, uint32_t size)
+static int wl_flash_checkpoint(wl_flash_t *wl_flash)
 {
-    uint32_t i = 0, sector_count = 0;
+    wl_ckpt_t ckpt;
+    uint32_t addr;
     int result = 0;
 
-    sector_count = size / wl_flash->cfg.sector_size;
-    for (i = 0; i < sector_count; i++) {
-#ifdef USE_QSPI_FLASH
-        if (sys_mutex_try_get(&fs_mutex, 60000) != OS_OK) {
-            app_print("wl flash: erase can't get mutex in one minute\r\n");
-            return -1;
-        }
+    ckpt.magic = WL_FLASH_MAGIC;
+    ckpt.version = wl_flash->cfg.version;
+    ckpt.gen = wl_flash->gen + 1;
+    ckpt.log_cnt = wl_flash->log_cnt;
+    ckpt.phys_cnt = wl_flash->phys_cnt;
+    ckpt.map_crc = wl_calculate_crc((uint8_t *)wl_flash->map, ((wl_flash->log_cnt + 1) & ~1) * sizeof(uint16_t));
+    ckpt.crc = wl_calculate_crc((uint8_t *)&ckpt, sizeof(wl_ckpt_t) - sizeof(uint32_t));
+
+    /* header is programmed last, the slot is only valid once the map is complete */
+    addr = wl_flash->addr_ckpt[ckpt.gen & 1];
+    ERR_CHECK(wl_flash_erase_raw(wl_flash, addr, wl_flash->ckpt_size))
+    ERR_CHECK(wl_flash_write_int(addr + sizeof(wl_ckpt_t), (uint8_t *)wl_flash->map, wl_flash->log_cnt * sizeof(uint16_t)))
+    ERR_CHECK(wl_flash_write_int(addr, (uint8_t *)&ckpt, sizeof(wl_ckpt_t)))
+    wl_flash->gen = ckpt.gen;
+
+    /* records left from the previous generation are ignored if this erase is cut */
+    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_journal, WL_JOURNAL_PAGES * wl_flash->cfg.sector_size))
+    wl_flash->jr_pos = 0;
 
-        result = qspi_flash_erase((start_address + (i * wl_flash->cfg.sector_size)), wl_flash->cfg.sector_size);
-        if (result) {
-            sys_mutex_put(&fs_mutex);
-            return result;
-        }
-        sys_mutex_put(&fs_mutex);
-#else
-        ERR_CHECK(raw_flash_erase((start_address + (i * wl_flash->cfg.sector_size)), wl_flash->cfg.sector_size))
-#endif
-    }
     return result;
 }
 
 /*!
-    \brief      update wear levelling table
+    \brief      append a sector mapping to the journal
     \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  lba: logical sector
+    \param[in]  ppn: physical page now holding the sector, WL_PAGE_NONE for trim
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-static int wl_flash_updatewl(wl_flash_t *wl_flash)
+static int wl_flash_journal_append(wl_flash_t *wl_flash, uint16_t lba, uint16_t ppn)
 {
-    const uint8_t used_bits = 1;
+    wl_record_t rec;
     int result = 0;
-    uint32_t byte_pos = 0, copy_count = 0, i = 0;
-    uint32_t data_addr = wl_flash->state.pos + 1;
 
-    if (data_addr >= wl_flash->state.max_pos) {
-        data_addr = 0;
-    }
+    if (wl_flash->jr_pos >= wl_flash->jr_max)
+        ERR_CHECK(wl_flash_checkpoint(wl_flash))
 
-    copy_count = wl_flash->cfg.page_size / wl_flash->cfg.temp_buff_size;
-    data_addr = wl_flash->cfg.start_addr + data_addr * wl_flash->cfg.page_size;
-    wl_flash->dummy_addr = wl_flash->cfg.start_addr + wl_flash->state.pos * wl_flash->cfg.page_size;
-    ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->dummy_addr, wl_flash->cfg.page_size))
-    for (i = 0; i < copy_count; i++) {
-        ERR_CHECK(wl_flash_read_int(data_addr + i * wl_flash->cfg.temp_buff_size, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
-        ERR_CHECK(wl_flash_write_int(wl_flash->dummy_addr + i * wl_flash->cfg.temp_buff_size, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
-    }
+    rec.lba = lba;
+    rec.ppn = ppn;
+    rec.gen = (uint16_t)wl_flash->gen;
+    rec.check = ~(rec.lba ^ rec.ppn ^ rec.gen);
 
-    byte_pos = wl_flash->state.pos * wl_flash->cfg.wr_size / 8;
-    ERR_CHECK(wl_flash_write_int(wl_flash->addr_state1 + sizeof(wl_state_t) + byte_pos, (uint8_t *)&used_bits, 1))
-    ERR_CHECK(wl_flash_write_int(wl_flash->addr_state2 + sizeof(wl_state_t) + byte_pos, (uint8_t *)&used_bits, 1))
-
-    wl_flash->state.pos++;
-    if (wl_flash->state.pos >= wl_flash->state.max_pos) {
-        wl_flash->state.pos = 0;
-        wl_flash->state.move_count++;
-        if (wl_flash->state.move_count >= (wl_flash->state.max_pos - 1)) {
-            wl_flash->state.move_count = 0;
-        }
-        wl_flash->state.crc = wl_calculate_crc((uint8_t *)&wl_flash->state, sizeof(wl_state_t) - sizeof(uint32_t));
-        ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_state1, wl_flash->state_size))
-        ERR_CHECK(wl_flash_write_int(wl_flash->addr_state1, (uint8_t *)&wl_flash->state, sizeof(wl_state_t)))
-        ERR_CHECK(wl_flash_erase_raw(wl_flash, wl_flash->addr_state2, wl_flash->state_size))
-        ERR_CHECK(wl_flash_write_int(wl_flash->addr_state2, (uint8_t *)&wl_flash->state, sizeof(wl_state_t)))
-    }
+    result = wl_flash_write_int(wl_flash->addr_journal + wl_flash->jr_pos * sizeof(wl_record_t), (uint8_t *)&rec, sizeof(wl_record_t));
+    wl_flash->jr_pos++;
 
     return result;
 }
 
 /*!
-    \brief      erase flash sector by virtual address
+    \brief      point a logical sector to a physical page once the journal record is written
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  sector: sector number to erase
+    \param[in]  lba: logical sector
+    \param[in]  ppn: physical page, WL_PAGE_NONE for trim
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-static int wl_flash_erase_sector(wl_flash_t *wl_flash, uint32_t sector)
+static int wl_flash_map_update(wl_flash_t *wl_flash, uint16_t lba, uint16_t ppn)
 {
-    uint32_t virt_addr;
+    uint16_t old = wl_flash->map[lba];
     int result = 0;
 
-    ERR_CHECK(wl_flash_updatewl(wl_flash))
-    virt_addr = wl_flash_calc_addr(wl_flash, sector * wl_flash->cfg.sector_size);
-#ifdef USE_QSPI_FLASH
-    if (sys_mutex_try_get(&fs_mutex, 60000) != OS_OK) {
-        app_print("wl flash: erase can't get mutex in one minute\r\n");
-        return -1;
-    }
-
-    result = qspi_flash_erase(wl_flash->cfg.start_addr + virt_addr, wl_flash->cfg.sector_size);
+    ERR_CHECK(wl_flash_journal_append(wl_flash, lba, ppn))
 
-    sys_mutex_put(&fs_mutex);
-#else
-    ERR_CHECK(raw_flash_erase(wl_flash->cfg.start_addr + virt_addr, wl_flash->cfg.sector_size))
-#endif
+    /* the previous copy becomes a free page, it is erased before its next use */
+    if (old != WL_PAGE_NONE)
+        WL_BIT_CLR(wl_flash->valid, old);
+    if (ppn != WL_PAGE_NONE)
+        WL_BIT_SET(wl_flash->valid, ppn);
+    wl_flash->map[lba] = ppn;
 
     return result;
 }
 
 /*!
-    \brief      erase a range of flash
+    \brief      move one sector that is not rewritten, so that its page joins the free pages
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  size: size of flash to erase
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-int wl_flash_erase_range(wl_flash_t *wl_flash, uint32_t start_address, uint32_t size)
+static int wl_flash_static_move(wl_flash_t *wl_flash)
 {
-    uint32_t i = 0, erase_count = 0, start_sector = 0;
+    uint32_t n, lba = 0, offset;
+    uint16_t from, to;
     int result = 0;
 
-    erase_count = (size + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size;
-    start_sector = start_address / wl_flash->cfg.sector_size;
-    for (i = 0; i < erase_count; i++) {
-        ERR_CHECK(wl_flash_erase_sector(wl_flash, start_sector + i))
+    for (n = 0; n < wl_flash->log_cnt; n++) {
+        lba = wl_flash->static_pos;
+        if (++wl_flash->static_pos >= wl_flash->log_cnt)
+            wl_flash->static_pos = 0;
+        if (wl_flash->map[lba] != WL_PAGE_NONE)
+            break;
     }
-    return result;
+    if (n == wl_flash->log_cnt)
+        return 0;
+
+    from = wl_flash->map[lba];
+    ERR_CHECK(wl_flash_page_alloc(wl_flash, &to))
+    for (offset = 0; offset < wl_flash->cfg.sector_size; offset += wl_flash->cfg.temp_buff_size) {
+        ERR_CHECK(wl_flash_read_int(wl_flash_page_addr(wl_flash, from) + offset, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
+        ERR_CHECK(wl_flash_write_int(wl_flash_page_addr(wl_flash, to) + offset, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
+    }
+
+    return wl_flash_map_update(wl_flash, lba, to);
 }
 
 /*!
-    \brief      recover or initialize wear levelling table
+    \brief      rebuild the sector map from the newest checkpoint and the journal
     \param[in]  wl_flash: pointer to wl_flash_t
     \param[out] none
-    \retval     result: 0 for success, -1 for fail
+    \retval     result: 0 for success, -1 for fail, 1 if no valid checkpoint is found
 */
-int wl_flash_config(wl_flash_t *wl_flash)
+static int wl_flash_load(wl_flash_t *wl_flash)
 {
-    wl_state_t sa_copy;
-    uint32_t check_size = 0;
-    uint32_t i = 0;
-    uint32_t crc1;
-    uint32_t crc2;
-    int result = -1;
+    wl_ckpt_t ckpt[2];
+    wl_record_t *rec;
+    uint32_t recs_per_buf = wl_flash->cfg.temp_buff_size / sizeof(wl_record_t);
+    uint32_t i, j, slot = 2;
+    uint32_t stale = 0;
+    int result = 0;
 
-    wl_flash->cfg.crc = wl_calculate_crc((uint8_t *)(&wl_flash->cfg), sizeof(wl_config_t) - sizeof(wl_flash->cfg.crc));
-    if (((&wl_flash->cfg)->sector_size % (&wl_flash->cfg)->temp_buff_size) != 0) {
-        app_print("ERROR_FATFS: wl_flash->cfg->sector_size remainder wl_flash->cfg->temp_buff_size is 0\r\n");
-        goto error;
+    for (i = 0; i < 2; i++) {
+        ERR_CHECK(wl_flash_read_int(wl_flash->addr_ckpt[i], (uint8_t *)&ckpt[i], sizeof(wl_ckpt_t)))
+        if ((ckpt[i].magic != WL_FLASH_MAGIC) || (ckpt[i].version != wl_flash->cfg.version) ||
+            (ckpt[i].log_cnt != wl_flash->log_cnt) || (ckpt[i].phys_cnt != wl_flash->phys_cnt) ||
+            (ckpt[i].crc != wl_calculate_crc((uint8_t *)&ckpt[i], sizeof(wl_ckpt_t) - sizeof(uint32_t))))
+            continue;
+
+        ERR_CHECK(wl_flash_read_int(wl_flash->addr_ckpt[i] + sizeof(wl_ckpt_t), (uint8_t *)wl_flash->map, wl_flash->log_cnt * sizeof(uint16_t)))
+        if (ckpt[i].map_crc != wl_calculate_crc((uint8_t *)wl_flash->map, ((wl_flash->log_cnt + 1) & ~1) * sizeof(uint16_t)))
+            continue;
+
+        if ((slot == 2) || ((int32_t)(ckpt[i].gen - ckpt[slot].gen) > 0))
+            slot = i;
     }
-    if (((&wl_flash->cfg)->page_size < (&wl_flash->cfg)->sector_size)) {
-        app_print("ERROR_FATFS: wl_flash->cfg->page_size < wl_flash->cfg->sector_size\r\n");
-        goto error;
+    if (slot == 2)
+        return 1;
+
+    ERR_CHECK(wl_flash_read_int(wl_flash->addr_ckpt[slot] + sizeof(wl_ckpt_t), (uint8_t *)wl_flash->map, wl_flash->log_cnt * sizeof(uint16_t)))
+    wl_flash->gen = ckpt[slot].gen;
+
+    /* replay the records of this generation, in order */
+    wl_flash->jr_pos = 0;
+    for (i = 0; i < wl_flash->jr_max; i += recs_per_buf) {
+        ERR_CHECK(wl_flash_read_int(wl_flash->addr_journal + i * sizeof(wl_record_t), wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
+        rec = (wl_record_t *)wl_flash->temp_buff;
+        for (j = 0; j < recs_per_buf; j++, rec++) {
+            if ((rec->lba == 0xFFFF) && (rec->ppn == 0xFFFF) && (rec->gen == 0xFFFF) && (rec->check == 0xFFFF))
+                continue;
+
+            wl_flash->jr_pos = i + j + 1;
+            if ((rec->gen != (uint16_t)wl_flash->gen) || (rec->check != (uint16_t)~(rec->lba ^ rec->ppn ^ rec->gen)) ||
+                (rec->lba >= wl_flash->log_cnt) ||
+                ((rec->ppn >= wl_flash->phys_cnt) && (rec->ppn != WL_PAGE_NONE))) {
+                stale++;
+                continue;
+            }
+            wl_flash->map[rec->lba] = rec->ppn;
+            /* carry on allocating after the last written page */
+            if (rec->ppn != WL_PAGE_NONE)
+                wl_flash->alloc_pos = (rec->ppn + 1) % wl_flash->phys_cnt;
+        }
     }
 
-    wl_flash->temp_buff = (uint8_t *)sys_malloc(wl_flash->cfg.temp_buff_size);
-    if(wl_flash->temp_buff == NULL) {
-        app_print("ERROR_FATFS: wl_flash_config, malloc wl_flash->temp_buff failed\r\n");
-        goto error;
+    for (i = 0; i < wl_flash->log_cnt; i++) {
+        if (wl_flash->map[i] == WL_PAGE_NONE)
+            continue;
+        if ((wl_flash->map[i] >= wl_flash->phys_cnt) || WL_BIT_GET(wl_flash->valid, wl_flash->map[i])) {
+            wl_flash->map[i] = WL_PAGE_NONE;
+            continue;
+        }
+        WL_BIT_SET(wl_flash->valid, wl_flash->map[i]);
     }
 
-    wl_flash->state_size = wl_flash->cfg.sector_size;
-    if (wl_flash->state_size < (sizeof(wl_state_t) + (wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size) * wl_flash->cfg.wr_size / 8)) {
-        /* calculate the size of wl state with one byte for each sector*/
-        wl_flash->state_size = ((sizeof(wl_state_t) + (wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size) * wl_flash->cfg.wr_size / 8) + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size;
-        /* sector number to use = ((sizeof wl_state_t + sector number * write size(1 byte) + 1 sector size - 1) / sector size) */
-        wl_flash->state_size = wl_flash->state_size * wl_flash->cfg.sector_size;
-        /* multiply sector size to get total size */
+    /* an interrupted checkpoint left old records, start a clean journal */
+    if (stale)
+        ERR_CHECK(wl_flash_checkpoint(wl_flash))
+
+    return result;
+}
+
+#if !FATFS_WL_LEGACY
+/*!
+    \brief      look for the state of the previous wear levelling layout, a volume in this
+                layout can not be translated in place as it exposes more sectors
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     1 if a valid state is found, 0 otherwise
+*/
+static int wl_flash_old_probe(wl_flash_t *wl_flash)
+{
+    wl_state_old_t state;
+    uint32_t state_size, addr, i;
+
+    /* state header and one byte per sector, then one config sector */
+    state_size = sizeof(wl_state_old_t) + wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size;
+    state_size = ((state_size + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size) * wl_flash->cfg.sector_size;
+    addr = wl_flash->cfg.start_addr + wl_flash->cfg.full_mem_size - wl_flash->cfg.sector_size - 2 * state_size;
+
+    for (i = 0; i < 2; i++, addr += state_size) {
+        if (wl_flash_read_int(addr, (uint8_t *)&state, sizeof(wl_state_old_t)))
+            return 0;
+        if ((state.block_size == wl_flash->cfg.sector_size) && (state.version == WL_OLD_VERSION) &&
+            (state.crc == wl_calculate_crc((uint8_t *)&state, sizeof(wl_state_old_t) - sizeof(uint32_t))))
+            return 1;
     }
 
-    wl_flash->cfg_size = (sizeof(wl_config_t) + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size;
-    wl_flash->cfg_size = wl_flash->cfg_size * wl_flash->cfg.sector_size;
-    /* calculate wl cfg size with same way above */
-    wl_flash->addr_cfg = wl_flash->cfg.start_addr + wl_flash->cfg.full_mem_size - wl_flash->cfg_size;
-    wl_flash->addr_state1 = wl_flash->cfg.start_addr + wl_flash->cfg.full_mem_size - wl_flash->state_size * 2 - wl_flash->cfg_size;
-    wl_flash->addr_state2 = wl_flash->cfg.start_addr + wl_flash->cfg.full_mem_size - wl_flash->state_size * 1 - wl_flash->cfg_size;
-    /* calculate start address of wl state1、state2 and cfg */
-    wl_flash->flash_size = ((wl_flash->cfg.full_mem_size - wl_flash->state_size * 2 - wl_flash->cfg_size) / wl_flash->cfg.page_size - 1) * wl_flash->cfg.page_size;
-    /* flash size remained to use */
+    return 0;
+}
+#endif
 
-    result = wl_flash_read_int(wl_flash->addr_state1, (uint8_t *)&wl_flash->state, sizeof(wl_state_t));
-    if (result) goto error;
+#if FATFS_WL_LEGACY
+/*!
+    \brief      previous layout: from logical address calculating physical offset in the area
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  addr: logical flash address
+    \param[out] none
+    \retval     physical offset
+*/
+static uint32_t wl_old_calc_addr(wl_flash_t *wl_flash, uint32_t addr)
+{
+    wl_old_t *old = &wl_flash->old;
+    uint32_t pa;
 
+    pa = (old->flash_size - old->state.move_count * wl_flash->cfg.sector_size + addr) % old->flash_size;
+    if (pa >= old->state.pos * wl_flash->cfg.sector_size)
+        pa += wl_flash->cfg.sector_size;
 
-    result = wl_flash_read_int(wl_flash->addr_state2, (uint8_t *)&sa_copy, sizeof(wl_state_t));
-    if (result) goto error;
+    return pa;
+}
 
-    check_size = sizeof(wl_state_t) - sizeof(uint32_t);
-    crc1 = wl_calculate_crc((uint8_t *)&wl_flash->state, check_size);
-    crc2 = wl_calculate_crc((uint8_t *)&sa_copy, check_size);
+/*!
+    \brief      previous layout: find the dummy page position from the bytes programmed in state 1
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int wl_old_recover_pos(wl_flash_t *wl_flash)
+{
+    wl_old_t *old = &wl_flash->old;
+    uint8_t pos_bits = 0;
+    uint32_t i;
+    int result = 0;
 
-    if ((crc1 == wl_flash->state.crc) && (crc2 == sa_copy.crc)) {
-        if (wl_flash->state.version != wl_flash->cfg.version) {
-            result = wl_flash_init_sections(wl_flash);
-            if (result) goto error;
+    for (i = 0; i < old->state.max_pos; i++) {
+        ERR_CHECK(wl_flash_read_int(old->addr_state[0] + sizeof(wl_state_old_t) + i, &pos_bits, 1))
+        if (pos_bits == 0xFF) {
+            old->state.pos = i;
+            break;
+        }
+    }
+    if (old->state.pos == old->state.max_pos)
+        old->state.pos--;
 
-            result = wl_flash_recover_pos(wl_flash);
-            if (result) goto error;
+    return result;
+}
 
-        } else {
-            if (crc1 != crc2) {
-                result = wl_flash_erase_raw(wl_flash, wl_flash->addr_state2, wl_flash->state_size);
-                if (result) goto error;
+/*!
+    \brief      previous layout: rewrite one copy of the state and its position bytes from the other
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  from: copy to read, 0 or 1
+    \param[in]  state: state to write
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int wl_old_state_copy(wl_flash_t *wl_flash, uint32_t from, wl_state_old_t *state)
+{
+    wl_old_t *old = &wl_flash->old;
+    uint32_t to = from ^ 1;
+    uint8_t pos_bits = 0;
+    uint32_t i;
+    int result = 0;
 
-                result = wl_flash_write_int(wl_flash->addr_state2, (uint8_t *)&wl_flash->state, sizeof(wl_state_t));
-                if (result) goto error;
+    ERR_CHECK(wl_flash_erase_raw(wl_flash, old->addr_state[to], old->state_size))
+    ERR_CHECK(wl_flash_write_int(old->addr_state[to], (uint8_t *)state, sizeof(wl_state_old_t)))
+    for (i = 0; i < state->max_pos; i++) {
+        ERR_CHECK(wl_flash_read_int(old->addr_state[from] + sizeof(wl_state_old_t) + i, &pos_bits, 1))
+        if (pos_bits != 0xFF)
+            ERR_CHECK(wl_flash_write_int(old->addr_state[to] + sizeof(wl_state_old_t) + i, &pos_bits, 1))
+    }
 
-                for (i = 0; i < ((wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size)*wl_flash->cfg.wr_size / 8); i++) {
-                    uint8_t pos_bits = 0;
-                    result = wl_flash_read_int(wl_flash->addr_state1 + sizeof(wl_state_t) + i, &pos_bits, 1);
-                    if (result) goto error;
+    return result;
+}
 
-                    if (pos_bits != 0xff) {
-                        result = wl_flash_write_int(wl_flash->addr_state2 + sizeof(wl_state_t) + i, &pos_bits, 1);
-                        if (result) goto error;
-                    }
-                }
-            }
-            result = wl_flash_recover_pos(wl_flash);
+/*!
+    \brief      previous layout: move the dummy page one page forward, before a sector erase
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int wl_old_update(wl_flash_t *wl_flash)
+{
+    wl_old_t *old = &wl_flash->old;
+    const uint8_t used_bits = 1;
+    uint32_t data_addr, dummy_addr, offset, i;
+    int result = 0;
+
+    data_addr = old->state.pos + 1;
+    if (data_addr >= old->state.max_pos)
+        data_addr = 0;
+    data_addr = wl_flash_page_addr(wl_flash, data_addr);
+    dummy_addr = wl_flash_page_addr(wl_flash, old->state.pos);
+
+    ERR_CHECK(wl_flash_erase_raw(wl_flash, dummy_addr, wl_flash->cfg.sector_size))
+    for (offset = 0; offset < wl_flash->cfg.sector_size; offset += wl_flash->cfg.temp_buff_size) {
+        ERR_CHECK(wl_flash_read_int(data_addr + offset, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
+        ERR_CHECK(wl_flash_write_int(dummy_addr + offset, wl_flash->temp_buff, wl_flash->cfg.temp_buff_size))
+    }
+
+    for (i = 0; i < 2; i++)
+        ERR_CHECK(wl_flash_write_int(old->addr_state[i] + sizeof(wl_state_old_t) + old->state.pos, (uint8_t *)&used_bits, 1))
+
+    old->state.pos++;
+    if (old->state.pos >= old->state.max_pos) {
+        old->state.pos = 0;
+        old->state.move_count++;
+        if (old->state.move_count >= (old->state.max_pos - 1))
+            old->state.move_count = 0;
+        old->state.crc = wl_calculate_crc((uint8_t *)&old->state, sizeof(wl_state_old_t) - sizeof(uint32_t));
+        for (i = 0; i < 2; i++) {
+            ERR_CHECK(wl_flash_erase_raw(wl_flash, old->addr_state[i], old->state_size))
+            ERR_CHECK(wl_flash_write_int(old->addr_state[i], (uint8_t *)&old->state, sizeof(wl_state_old_t)))
         }
-    } else if ((crc1 != wl_flash->state.crc) && (crc2 != sa_copy.crc)) {
-        result = wl_flash_init_sections(wl_flash);
-        if (result) goto error;
+    }
 
-        result = wl_flash_recover_pos(wl_flash);
-        if (result) goto error;
+    return result;
+}
 
+/*!
+    \brief      previous layout: recover the state of a volume, as the previous layer did at mount
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail, 1 if the flash holds no state of this layout
+*/
+static int wl_old_mount(wl_flash_t *wl_flash)
+{
+    wl_old_t *old = &wl_flash->old;
+    wl_state_old_t state[2];
+    uint32_t cfg_size = wl_flash->cfg.sector_size;
+    uint8_t ok[2];
+    uint32_t i;
+    int result = 0;
+
+    /* state header and one byte per sector, then one config sector */
+    old->state_size = sizeof(wl_state_old_t) + wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size;
+    old->state_size = ((old->state_size + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size) * wl_flash->cfg.sector_size;
+    old->addr_state[0] = wl_flash->cfg.start_addr + wl_flash->cfg.full_mem_size - cfg_size - 2 * old->state_size;
+    old->addr_state[1] = old->addr_state[0] + old->state_size;
+    old->flash_size = ((wl_flash->cfg.full_mem_size - 2 * old->state_size - cfg_size) / wl_flash->cfg.sector_size - 1) * wl_flash->cfg.sector_size;
+
+    for (i = 0; i < 2; i++) {
+        ERR_CHECK(wl_flash_read_int(old->addr_state[i], (uint8_t *)&state[i], sizeof(wl_state_old_t)))
+        ok[i] = (state[i].block_size == wl_flash->cfg.sector_size) && (state[i].version == WL_OLD_VERSION) &&
+                (state[i].max_pos == 1 + old->flash_size / wl_flash->cfg.sector_size) &&
+                (state[i].crc == wl_calculate_crc((uint8_t *)&state[i], sizeof(wl_state_old_t) - sizeof(uint32_t)));
+    }
+    if (!ok[0] && !ok[1])
+        return 1;
+
+    if (ok[0]) {
+        /* state 2 is rewritten if a reset cut its update */
+        old->state = state[0];
+        if (!ok[1] || (state[0].crc != state[1].crc))
+            ERR_CHECK(wl_old_state_copy(wl_flash, 0, &old->state))
+        ERR_CHECK(wl_old_recover_pos(wl_flash))
     } else {
-        if (crc1 == wl_flash->state.crc) {
-            result = wl_flash_erase_raw(wl_flash, wl_flash->addr_state2, wl_flash->state_size);
-            if (result) goto error;
+        /* the update of state 1 was cut as the dummy page wrapped, the next erase moves it again */
+        old->state = state[1];
+        ERR_CHECK(wl_old_state_copy(wl_flash, 1, &old->state))
+        old->state.pos = old->state.max_pos - 1;
+    }
 
-            result = wl_flash_write_int(wl_flash->addr_state2, (uint8_t *)&wl_flash->state, sizeof(wl_state_t));
-            if (result) goto error;
+    wl_flash->log_cnt = old->flash_size / wl_flash->cfg.sector_size;
+    wl_flash->legacy = 1;
+    return result;
+}
 
-            for (i = 0; i < ((wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size) * wl_flash->cfg.wr_size / 8); i++) {
-                uint8_t pos_bits = 0;
+/*!
+    \brief      previous layout: write sectors, each one erased in place after the dummy page moved
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  sector: first logical sector
+    \param[in]  src: pointer to data write to flash
+    \param[in]  count: number of sectors
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int wl_old_write(wl_flash_t *wl_flash, uint32_t sector, const uint8_t *src, uint32_t count)
+{
+    uint32_t addr, i;
+    int result = 0;
 
-                result = wl_flash_read_int(wl_flash->addr_state1 + sizeof(wl_state_t) + i, &pos_bits, 1);
-                if (result) goto error;
+    for (i = 0; i < count; i++) {
+        ERR_CHECK(wl_old_update(wl_flash))
+        addr = wl_flash->cfg.start_addr + wl_old_calc_addr(wl_flash, (sector + i) * wl_flash->cfg.sector_size);
+        ERR_CHECK(wl_flash_erase_raw(wl_flash, addr, wl_flash->cfg.sector_size))
+        ERR_CHECK(wl_flash_write_int(addr, (uint8_t *)&src[i * wl_flash->cfg.sector_size], wl_flash->cfg.sector_size))
+    }
 
-                if (pos_bits != 0xff)
-                {
-                    result = wl_flash_write_int(wl_flash->addr_state2 + sizeof(wl_state_t) + i, &pos_bits, 1);
+    return result;
+}
 
-                    if (result) goto error;
-                }
-            }
+/*!
+    \brief      previous layout: read sectors
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  sector: first logical sector
+    \param[in]  dest: pointer to buffer to store data read from flash
+    \param[in]  count: number of sectors
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+static int wl_old_read(wl_flash_t *wl_flash, uint32_t sector, uint8_t *dest, uint32_t count)
+{
+    uint32_t addr, i;
+    int result = 0;
 
-            result = wl_flash_read_int(wl_flash->addr_state2, (uint8_t *)&wl_flash->state, sizeof(wl_state_t));
-            if (result) goto error;
+    for (i = 0; i < count; i++) {
+        addr = wl_flash->cfg.start_addr + wl_old_calc_addr(wl_flash, (sector + i) * wl_flash->cfg.sector_size);
+        ERR_CHECK(wl_flash_read_int(addr, &dest[i * wl_flash->cfg.sector_size], wl_flash->cfg.sector_size))
+    }
 
-        } else {
-            result = wl_flash_erase_raw(wl_flash, wl_flash->addr_state1, wl_flash->state_size);
-            if (result) goto error;
+    return result;
+}
+#endif /* FATFS_WL_LEGACY */
 
-            result = wl_flash_write_int(wl_flash->addr_state1, (uint8_t *)&sa_copy, sizeof(wl_state_t));
-            if (result) goto error;
+/*!
+    \brief      recover or initialize the sector map
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail, WL_FLASH_OLD_LAYOUT if the flash holds a volume
+                of the previous layout, cfg.format is not set and FATFS_WL_LEGACY is 0
+*/
+int wl_flash_config(wl_flash_t *wl_flash)
+{
+    uint32_t total, ckpt_pages;
+    uint32_t bitmap_size;
+    int result = -1;
 
-            for (i = 0; i < ((wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size) * wl_flash->cfg.wr_size / 8); i++) {
-                uint8_t pos_bits = 0;
+    if ((wl_flash->cfg.sector_size % wl_flash->cfg.temp_buff_size) != 0 ||
+        (wl_flash->cfg.temp_buff_size % sizeof(wl_record_t)) != 0) {
+        app_print("ERROR_FATFS: wl_flash->cfg->sector_size remainder wl_flash->cfg->temp_buff_size is not 0\r\n");
+        return -1;
+    }
 
-                result = wl_flash_read_int(wl_flash->addr_state2 + sizeof(wl_state_t) + i, &pos_bits, 1);
-                if (result) goto error;
+    /* checkpoint slot holds the header and 2 bytes per data page, an upper bound of the map */
+    total = wl_flash->cfg.full_mem_size / wl_flash->cfg.sector_size;
+    ckpt_pages = (sizeof(wl_ckpt_t) + total * sizeof(uint16_t) + wl_flash->cfg.sector_size - 1) / wl_flash->cfg.sector_size;
+    if ((total <= 2 * ckpt_pages + WL_JOURNAL_PAGES + WL_SPARE_PAGES) || (total >= WL_PAGE_NONE)) {
+        app_print("ERROR_FATFS: wl flash size 0x%x is not supported\r\n", wl_flash->cfg.full_mem_size);
+        return -1;
+    }
 
-                if (pos_bits != 0xff) {
-                    result = wl_flash_write_int(wl_flash->addr_state1 + sizeof(wl_state_t) + i, &pos_bits, 1);
-                    if (result) goto error;
-                }
-            }
+    wl_flash->phys_cnt = total - 2 * ckpt_pages - WL_JOURNAL_PAGES;
+    wl_flash->log_cnt = wl_flash->phys_cnt - WL_SPARE_PAGES;
+    wl_flash->ckpt_size = ckpt_pages * wl_flash->cfg.sector_size;
+    wl_flash->addr_ckpt[0] = wl_flash_page_addr(wl_flash, wl_flash->phys_cnt);
+    wl_flash->addr_ckpt[1] = wl_flash->addr_ckpt[0] + wl_flash->ckpt_size;
+    wl_flash->addr_journal = wl_flash->addr_ckpt[1] + wl_flash->ckpt_size;
+    wl_flash->jr_max = WL_JOURNAL_PAGES * wl_flash->cfg.sector_size / sizeof(wl_record_t);
 
-            result = wl_flash_read_int(wl_flash->addr_state1, (uint8_t *)&wl_flash->state, sizeof(wl_state_t));
-            if (result) goto error;
+    bitmap_size = ((wl_flash->phys_cnt + 31) / 32) * sizeof(uint32_t);
+    wl_flash->temp_buff = (uint8_t *)sys_malloc(wl_flash->cfg.temp_buff_size);
+    wl_flash->map = (uint16_t *)sys_malloc(((wl_flash->log_cnt + 1) & ~1) * sizeof(uint16_t));
+    wl_flash->valid = (uint32_t *)sys_zalloc(bitmap_size);
+    wl_flash->clean = (uint32_t *)sys_zalloc(bitmap_size);
+    if ((wl_flash->temp_buff == NULL) || (wl_flash->map == NULL) ||
+        (wl_flash->valid == NULL) || (wl_flash->clean == NULL)) {
+        app_print("ERROR_FATFS: wl_flash_config, malloc failed\r\n");
+        goto error;
+    }
+    /* padding entry of an odd map is covered by the crc */
+    if (wl_flash->log_cnt & 1)
+        wl_flash->map[wl_flash->log_cnt] = WL_PAGE_NONE;
 
-            wl_flash->state.pos = wl_flash->state.max_pos - 1;
-        }
-        if (wl_flash->state.version != wl_flash->cfg.version) {
-            result = wl_flash_init_sections(wl_flash);
-            if (result) goto error;
+    if (sys_mutex_init(&wl_flash->lock) != OS_OK) {
+        app_print("ERROR_FATFS: wl_flash_config, mutex init failed\r\n");
+        goto error;
+    }
+
+    result = wl_flash_load(wl_flash);
+#if FATFS_WL_LEGACY
+    if ((result > 0) && !wl_flash->cfg.format) {
+        /* keep using a volume of the previous layout, "fatfs format" moves to the sector map */
+        result = wl_old_mount(wl_flash);
+        if (result == 0) {
+            app_print("FATFS: wl flash holds a volume of the previous layout, mounted in that layout\r\n");
+            sys_mfree(wl_flash->map);
+            sys_mfree(wl_flash->valid);
+            sys_mfree(wl_flash->clean);
+            wl_flash->map = NULL;
+            wl_flash->valid = NULL;
+            wl_flash->clean = NULL;
+            return 0;
         }
     }
+#else
+    if ((result > 0) && !wl_flash->cfg.format && wl_flash_old_probe(wl_flash)) {
+        /* do not wipe the files silently, the volume is only erased on request */
+        app_print("FATFS: wl flash holds a volume of the previous layout, run \"fatfs format\" to erase it\r\n");
+        result = WL_FLASH_OLD_LAYOUT;
+        goto error;
+    }
+#endif
+    if ((result > 0) || ((result == 0) && wl_flash->cfg.format)) {
+        /* blank or format requested, start an empty map, data pages are erased on first use */
+        app_print("FATFS: wl flash format\r\n");
+        sys_memset(wl_flash->map, 0xFF, ((wl_flash->log_cnt + 1) & ~1) * sizeof(uint16_t));
+        sys_memset(wl_flash->valid, 0, bitmap_size);
+        wl_flash->gen = 0;
+        result = wl_flash_checkpoint(wl_flash);
+    }
+    if (result)
+        goto error;
+
     return 0;
+
 error:
+    wl_flash_release(wl_flash);
+    return (result == WL_FLASH_OLD_LAYOUT) ? WL_FLASH_OLD_LAYOUT : -1;
+}
+
+/*!
+    \brief      free the memory and the lock taken by wl_flash_config()
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     none
+*/
+void wl_flash_release(wl_flash_t *wl_flash)
+{
+    if (wl_flash->lock != NULL)
+        sys_mutex_free(&wl_flash->lock);
     if (wl_flash->temp_buff != NULL)
         sys_mfree(wl_flash->temp_buff);
-    return result;
+    if (wl_flash->map != NULL)
+        sys_mfree(wl_flash->map);
+    if (wl_flash->valid != NULL)
+        sys_mfree(wl_flash->valid);
+    if (wl_flash->clean != NULL)
+        sys_mfree(wl_flash->clean);
+    wl_flash->lock = NULL;
+    wl_flash->temp_buff = NULL;
+    wl_flash->map = NULL;
+    wl_flash->valid = NULL;
+    wl_flash->clean = NULL;
 }
 
 /*!
-    \brief      write data to flash
+    \brief      write sectors, each one to a free erased page
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  dest_addr: destination address of flash to write
+    \param[in]  sector: first logical sector
     \param[in]  src: pointer to data write to flash
-    \param[in]  size: size of data write to flash
+    \param[in]  count: number of sectors
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-int wl_flash_write(wl_flash_t *wl_flash, uint32_t dest_addr, const uint8_t *src, size_t size)
+int wl_flash_write(wl_flash_t *wl_flash, uint32_t sector, const uint8_t *src, uint32_t count)
 {
-    uint32_t count = 0, virt_addr = 0, virt_addr_last = 0;
+    uint16_t ppn;
+    uint32_t i;
     int result = 0;
 
-    count = (size - 1) / wl_flash->cfg.page_size;
+    if ((sector + count) > wl_flash->log_cnt)
+        return -1;
 
-    for (uint32_t i = 0; i < count; i++) {
-        virt_addr = wl_flash_calc_addr(wl_flash, dest_addr + i * wl_flash->cfg.page_size);
-        ERR_CHECK(wl_flash_write_int(wl_flash->cfg.start_addr + virt_addr, &((uint8_t *)src)[i * wl_flash->cfg.page_size], wl_flash->cfg.page_size))
+    sys_mutex_get(&wl_flash->lock);
+#if FATFS_WL_LEGACY
+    if (wl_flash->legacy) {
+        result = wl_old_write(wl_flash, sector, src, count);
+        sys_mutex_put(&wl_flash->lock);
+        return result;
+    }
+#endif
+    for (i = 0; (i < count) && !result; i++) {
+        result = wl_flash_page_alloc(wl_flash, &ppn);
+        if (!result)
+            result = wl_flash_write_int(wl_flash_page_addr(wl_flash, ppn), (uint8_t *)&src[i * wl_flash->cfg.sector_size], wl_flash->cfg.sector_size);
+        if (!result)
+            result = wl_flash_map_update(wl_flash, sector + i, ppn);
+        if (!result && ((++wl_flash->write_cnt % WL_STATIC_PERIOD) == 0))
+            result = wl_flash_static_move(wl_flash);
     }
+    sys_mutex_put(&wl_flash->lock);
 
-    virt_addr_last = wl_flash_calc_addr(wl_flash, dest_addr + count * wl_flash->cfg.page_size);
-    ERR_CHECK(wl_flash_write_int(wl_flash->cfg.start_addr + virt_addr_last, &((uint8_t *)src)[count * wl_flash->cfg.page_size], size - count * wl_flash->cfg.page_size))
+    return result;
+}
+
+/*!
+    \brief      read sectors, a sector never written reads as erased flash
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  sector: first logical sector
+    \param[in]  dest: pointer to buffer to store data read from flash
+    \param[in]  count: number of sectors
+    \param[out] none
+    \retval     result: 0 for success, -1 for fail
+*/
+int wl_flash_read(wl_flash_t *wl_flash, uint32_t sector, uint8_t *dest, uint32_t count)
+{
+    uint16_t ppn;
+    uint32_t i;
+    int result = 0;
+
+    if ((count == 0) || ((sector + count) > wl_flash->log_cnt)) {
+        app_print("wl_flash_read: sector %d count %d out of range\r\n", sector, count);
+        return -1;
+    }
+
+    sys_mutex_get(&wl_flash->lock);
+#if FATFS_WL_LEGACY
+    if (wl_flash->legacy) {
+        result = wl_old_read(wl_flash, sector, dest, count);
+        sys_mutex_put(&wl_flash->lock);
+        return result;
+    }
+#endif
+    for (i = 0; (i < count) && !result; i++) {
+        ppn = wl_flash->map[sector + i];
+        if (ppn == WL_PAGE_NONE)
+            sys_memset(&dest[i * wl_flash->cfg.sector_size], 0xFF, wl_flash->cfg.sector_size);
+        else
+            result = wl_flash_read_int(wl_flash_page_addr(wl_flash, ppn), &dest[i * wl_flash->cfg.sector_size], wl_flash->cfg.sector_size);
+    }
+    sys_mutex_put(&wl_flash->lock);
 
     return result;
 }
 
 /*!
-    \brief      read data from flash
+    \brief      release sectors no longer used by the file system
     \param[in]  wl_flash: pointer to wl_flash_t
-    \param[in]  dest_addr: source address of flash to read
-    \param[in]  src: pointer to buffer to store data read from flash
-    \param[in]  size: size of data to read from flash
+    \param[in]  start_sector: first logical sector
+    \param[in]  end_sector: last logical sector, included
     \param[out] none
     \retval     result: 0 for success, -1 for fail
 */
-int wl_flash_read(wl_flash_t *wl_flash, uint32_t src_addr, uint8_t *dest, size_t size)
+int wl_flash_trim(wl_flash_t *wl_flash, uint32_t start_sector, uint32_t end_sector)
 {
-    uint32_t count = 0;
+    uint32_t lba;
     int result = 0;
 
-    if (size >= 1){
-        count = (size - 1) / wl_flash->cfg.page_size;
-    } else {
-        app_print("wl_flash_read: flash read len is 0\r\n");
+    if ((start_sector > end_sector) || (end_sector >= wl_flash->log_cnt))
         return -1;
+#if FATFS_WL_LEGACY
+    /* the previous layout maps every sector in place */
+    if (wl_flash->legacy)
+        return 0;
+#endif
+
+    sys_mutex_get(&wl_flash->lock);
+    for (lba = start_sector; (lba <= end_sector) && !result; lba++) {
+        if (wl_flash->map[lba] != WL_PAGE_NONE)
+            result = wl_flash_map_update(wl_flash, lba, WL_PAGE_NONE);
     }
+    sys_mutex_put(&wl_flash->lock);
+
+    return result;
+}
+
+/*!
+    \brief      erase free pages ahead of the allocation, and save the map when the journal is nearly full,
+                intended to be called from an idle or low priority task
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[in]  max_erase: maximum flash erases in this step
+    \param[out] more: set to 1 if more steps are needed, can be NULL
+    \retval     result: 0 for success, -1 for fail
+*/
+int wl_flash_gc_step(wl_flash_t *wl_flash, uint32_t max_erase, uint8_t *more)
+{
+    uint32_t n, p, ready = 0;
+    int result = 0;
 
-    for (uint32_t i = 0; i < count; i++) {
-        uint32_t virt_addr = wl_flash_calc_addr(wl_flash, src_addr + i * wl_flash->cfg.page_size);
-        ERR_CHECK(wl_flash_read_int(wl_flash->cfg.start_addr + virt_addr, &((uint8_t *)dest)[i * wl_flash->cfg.page_size],  wl_flash->cfg.page_size))
+    if (more)
+        *more = 0;
+#if FATFS_WL_LEGACY
+    /* the previous layout erases in the write path */
+    if (wl_flash->legacy)
+        return 0;
+#endif
+
+    sys_mutex_get(&wl_flash->lock);
+    if (wl_flash->jr_pos >= wl_flash->jr_max - wl_flash->jr_max / 8) {
+        result = wl_flash_checkpoint(wl_flash);
+        max_erase = 0;
     }
 
-    uint32_t virt_addr_last = wl_flash_calc_addr(wl_flash, src_addr + count * wl_flash->cfg.page_size);
-    ERR_CHECK(wl_flash_read_int(wl_flash->cfg.start_addr + virt_addr_last, &((uint8_t *)dest)[count * wl_flash->cfg.page_size], size - count * wl_flash->cfg.page_size))
+    p = wl_flash->alloc_pos;
+    for (n = 0; (n < wl_flash->phys_cnt) && (ready < WL_GC_CLEAN_PAGES) && !result; n++) {
+        if (!WL_BIT_GET(wl_flash->valid, p)) {
+            if (!WL_BIT_GET(wl_flash->clean, p)) {
+                if (max_erase == 0) {
+                    if (more)
+                        *more = 1;
+                    break;
+                }
+                result = wl_flash_page_prepare(wl_flash, p);
+                max_erase--;
+            }
+            ready++;
+        }
+        if (++p >= wl_flash->phys_cnt)
+            p = 0;
+    }
+    sys_mutex_put(&wl_flash->lock);
 
     return result;
 }
 
+/*!
+    \brief      get size of flash exposed to the file system
+    \param[in]  wl_flash: pointer to wl_flash_t
+    \param[out] none
+    \retval     size in bytes
+*/
+uint32_t wl_flash_size(wl_flash_t *wl_flash)
+{
+    return wl_flash->log_cnt * wl_flash->cfg.sector_size;
+}
+
 /*!
     \brief      calculate crc
     \param[in]  pbuf: pointer to data need to be calculated crc
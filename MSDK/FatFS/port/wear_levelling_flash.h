@@ -35,7 +35,33 @@ OF SUCH DAMAGE.
 #ifndef _WL_Flash_H_
 #define _WL_Flash_H_
 
-typedef struct wl_state_s
+/*
+ * Log-structured translation of the FatFS sectors. A sector write is programmed
+ * into a free erased page and a (sector, page) record is appended to a journal,
+ * the page holding the previous copy is only erased later. The sector map is
+ * kept in RAM, saved to one of two checkpoint slots when the journal is full
+ * and rebuilt at mount from the newest checkpoint and the journal.
+ *
+ * Flash layout, in units of sector_size (the flash erase size):
+ *   data pages | checkpoint slot 0 | checkpoint slot 1 | journal
+ */
+#define WL_FLASH_MAGIC          0x4C465457      /* checkpoint header magic */
+#define WL_PAGE_NONE            0xFFFF          /* sector not written or trimmed */
+#define WL_JOURNAL_PAGES        2               /* pages of journal records */
+#define WL_SPARE_PAGES          4               /* pages not exposed to FatFS */
+#define WL_GC_CLEAN_PAGES       4               /* erased pages kept ready by wl_flash_gc_step() */
+#define WL_STATIC_PERIOD        64              /* sector writes between two moves of cold data */
+#define WL_FLASH_OLD_LAYOUT     2               /* wl_flash_config(): volume of the previous layout found */
+#define WL_OLD_VERSION          0x00000001      /* version of the previous layout */
+
+/*
+ * State of the previous layout, two copies ahead of a config sector at the end of the area.
+ * The data pages rotate through one dummy page, moved by one page on every sector erase;
+ * each copy of the state is followed by one byte per position, programmed as the dummy moves.
+ *
+ * Flash layout: data pages | dummy page | state 1 | state 2 | config
+ */
+typedef struct wl_state_old_s
 {
     uint32_t pos;
     uint32_t max_pos;
@@ -43,38 +69,79 @@ typedef struct wl_state_s
     uint32_t block_size;
     uint32_t version;
     uint32_t crc;
-} wl_state_t;
+} wl_state_old_t;
+
+#if FATFS_WL_LEGACY
+typedef struct wl_old_s
+{
+    wl_state_old_t state;
+    uint32_t addr_state[2];
+    uint32_t state_size;
+    uint32_t flash_size;    /* bytes exposed to the file system */
+} wl_old_t;
+#endif
+
+typedef struct wl_ckpt_s
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t gen;
+    uint16_t log_cnt;
+    uint16_t phys_cnt;
+    uint32_t map_crc;
+    uint32_t crc;
+} wl_ckpt_t;
+
+typedef struct wl_record_s
+{
+    uint16_t lba;
+    uint16_t ppn;
+    uint16_t gen;
+    uint16_t check;
+} wl_record_t;
 
 typedef struct wl_config_s
 {
     uint32_t start_addr;
     uint32_t full_mem_size;
-    uint32_t page_size;
     uint32_t sector_size;
-    uint32_t wr_size;
     uint32_t version;
     uint32_t temp_buff_size;
-    uint32_t crc;
+    uint32_t format;        /* 1: start an empty map whatever the flash holds */
 } wl_config_t;
 
 typedef struct wl_flash
 {
-    wl_state_t state;
     wl_config_t cfg;
-    uint32_t addr_cfg;
-    uint32_t addr_state1;
-    uint32_t addr_state2;
-    uint32_t flash_size;
-    uint32_t state_size;
-    uint32_t cfg_size;
+    uint32_t addr_ckpt[2];
+    uint32_t addr_journal;
+    uint32_t ckpt_size;
+    uint32_t gen;
+    uint32_t jr_pos;
+    uint32_t jr_max;
+    uint32_t write_cnt;
+    uint16_t phys_cnt;
+    uint16_t log_cnt;
+    uint16_t alloc_pos;
+    uint16_t static_pos;
+    uint16_t *map;
+    uint32_t *valid;
+    uint32_t *clean;
     uint8_t *temp_buff;
-    uint32_t dummy_addr;
+    os_mutex_t lock;
+#if FATFS_WL_LEGACY
+    uint8_t legacy;         /* 1: volume of the previous layout, used in that layout */
+    wl_old_t old;
+#endif
 } wl_flash_t;
 
 extern wl_flash_t wl_config_global;
 
 int wl_flash_config(wl_flash_t *wl_flash);
-int wl_flash_erase_range(wl_flash_t *wl_flash, uint32_t start_address, uint32_t size);
-int wl_flash_write(wl_flash_t *wl_flash, uint32_t dest_addr, const uint8_t *src, size_t size);
-int wl_flash_read(wl_flash_t *wl_flash, uint32_t src_addr, uint8_t *dest, size_t size);
+void wl_flash_release(wl_flash_t *wl_flash);
+int wl_flash_write(wl_flash_t *wl_flash, uint32_t sector, const uint8_t *src, uint32_t count);
+int wl_flash_read(wl_flash_t *wl_flash, uint32_t sector, uint8_t *dest, uint32_t count);
+int wl_flash_trim(wl_flash_t *wl_flash, uint32_t start_sector, uint32_t end_sector);
+int wl_flash_gc_step(wl_flash_t *wl_flash, uint32_t max_erase, uint8_t *more);
+uint32_t wl_flash_size(wl_flash_t *wl_flash);
 #endif
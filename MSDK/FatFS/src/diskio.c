@@ -273,8 +273,16 @@ DRESULT disk_ioctl (
     case GET_SECTOR_SIZE:
         *(WORD *)buff = FATFS_SECTOR_SIZE;
         break;
+    case CTRL_SYNC:
+        if (fs_flash_sync())
+            return RES_ERROR;
+        break;
     case GET_BLOCK_SIZE:
         break;
+    case CTRL_TRIM:
+        if (fs_flash_trim(((LBA_t *)buff)[0], ((LBA_t *)buff)[1]))
+            return RES_ERROR;
+        break;
     }
 
     return RES_OK;
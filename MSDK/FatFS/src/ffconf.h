@@ -47,6 +47,24 @@ OF SUCH DAMAGE.
 #define FATFS_FULL_MEM_SIZE         (0xC0000)  // The mininum size is 0xc0000
 #endif
 #define FATFS_SECTOR_SIZE           (0x1000)
+/* Write-back sector cache of the disk I/O layer, RAM used is FATFS_CACHE_SECTORS * FATFS_SECTOR_SIZE.
+   0 disables the cache. FATFS_CACHE_SECTORS must be a multiple of FATFS_CACHE_WAYS. */
+#define FATFS_CACHE_SECTORS         4
+#define FATFS_CACHE_WAYS            2
+/* The cache is write-back: dirty sectors are written when evicted, on f_sync()/f_close() and at
+   most this time after their first update (ms), so repeated updates of the FAT and directory
+   sectors by successive appends are merged. Data written without f_sync() is lost by a reset
+   before the delay, call fatfs_cache_flush() before a reset. 0 writes every sector through. */
+#define FATFS_CACHE_FLUSH_MS        1000
+/* Stack size of the idle priority task erasing the free pages of the wear levelling ahead of the
+   writes, 0 leaves calling fatfs_gc_step() to the application. */
+#define FATFS_GC_TASK_STACK_SIZE    512
+/* Max flash erases of the background task before it releases the wear levelling lock */
+#define FATFS_GC_STEP_ERASES        1
+/* 1: a volume created by the previous wear levelling layout (SDK before the sector map) is mounted
+   and used in that layout, its files are kept. 0 saves the code, such a volume is then not mounted
+   until "fatfs format". A blank flash or a formatted volume always uses the sector map. */
+#define FATFS_WL_LEGACY             1
 #define FFCONF_DEF	5380	/* Revision ID */
 
 /*---------------------------------------------------------------------------/
@@ -258,7 +276,7 @@ OF SUCH DAMAGE.
 /  f_fdisk(). 2^32 sectors maximum. This option has no effect when FF_LBA64 == 0. */
 
 
-#define FF_USE_TRIM		0
+#define FF_USE_TRIM		1
 /* This option switches support for ATA-TRIM. (0:Disable or 1:Enable)
 /  To enable this feature, also CTRL_TRIM command should be implemented to
 /  the disk_ioctl(). */
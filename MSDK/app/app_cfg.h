@@ -50,6 +50,8 @@ OF SUCH DAMAGE.
 #ifdef CONFIG_OTA_DEMO_SUPPORT
 #define OTA_DEMO_STACK_SIZE         512
 #define OTA_DEMO_TASK_PRIO          1
+#define OTA_WRITER_STACK_SIZE       512
+#define OTA_WRITER_TASK_PRIO        1
 #endif
 
 #define CONFIG_IPERF_TEST
@@ -101,6 +101,10 @@ static char at_hw_rx_buf[AT_HW_RX_BUF_SIZE];
 static volatile uint16_t at_hw_rx_buf_idx = 0;
 static os_sema_t at_hw_tx_sema = NULL;
 static os_sema_t at_hw_dma_sema = NULL;
+/* Called in the DMA receive interrupt before at_hw_dma_sema is released */
+static void (*at_hw_dma_rx_cb)(void) = NULL;
+/* Also release at_hw_dma_sema when half of a DMA reception is done */
+static uint8_t at_hw_dma_rx_half = 0;
 static os_sema_t at_ble_async_sema = NULL;
 static volatile uint8_t at_cmd_received = 0;
 static uint8_t at_task_exit = 0;
@@ -1128,7 +1132,8 @@ static void at_uart_dma_receive_config(void)
 {
     uart_tx_idle_wait(at_uart_conf.usart_periph);
 
-    uart_config(at_uart_conf.usart_periph, at_uart_conf.baudrate, false, true, false);
+    /* with flow control the RTS line holds the host while the DMA has no free buffer */
+    uart_config(at_uart_conf.usart_periph, at_uart_conf.baudrate, (at_uart_conf.flow_ctrl != 0), true, false);
 
     switch (at_uart_conf.usart_periph) {
     case USART0:
@@ -1190,6 +1195,8 @@ static void at_uart_dma_receive_start(uint32_t address, uint32_t num)
 
     dma_memory_address_config(dma_channel, DMA_MEMORY_0, address);
     dma_transfer_number_config(dma_channel, num);
+    if (at_hw_dma_rx_half)
+        dma_interrupt_enable(dma_channel, DMA_INT_HTF);
     dma_channel_enable(dma_channel);
 }
 
@@ -1210,8 +1217,8 @@ static void at_uart_dma_receive_stop(void)
         break;
     }
 
-    dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF);
-    dma_interrupt_disable(dma_channel, DMA_INT_FTF);
+    dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF | DMA_INT_FLAG_HTF);
+    dma_interrupt_disable(dma_channel, DMA_INT_FTF | DMA_INT_HTF);
     dma_channel_disable(dma_channel);
 }
 #endif
@@ -1220,6 +1227,12 @@ void at_uart_rx_dma_irq_hdl(uint32_t dma_channel)
 {
     if(RESET != dma_interrupt_flag_get(dma_channel, DMA_INT_FLAG_FTF)){
         dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF);
+        if (at_hw_dma_rx_cb)
+            at_hw_dma_rx_cb();
+        sys_sema_up_from_isr(&at_hw_dma_sema);
+    }
+    if (RESET != dma_interrupt_flag_get(dma_channel, DMA_INT_FLAG_HTF)) {
+        dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_HTF);
         sys_sema_up_from_isr(&at_hw_dma_sema);
     }
 }
@@ -33,34 +33,56 @@ OF SUCH DAMAGE.
 */
 
 #include "slist.h"
+#include "lwip/api.h"
 
 static cip_info_t cip_info;
 static int cip_task_started = 0;
-static int cip_task_terminate = 0;
+static volatile int cip_task_terminate = 0;
+
+/* Events of the receive task: send requests and wakeups by the socket event hook */
+static os_queue_t cip_evt_queue = NULL;
+
+#if MEMP_NUM_NETCONN > 32
+#error "one bit of cip_sock_watch per socket"
+#endif
+#define CIP_SOCK_BIT(fd)            (1UL << ((fd) - LWIP_SOCKET_OFFSET))
+#define CIP_SEND_POST_TIMEOUT       200 //ms
+#define CIP_RX_BURST                4   /* records received from a link before serving the others */
+
+/* Sockets of the links and of the server, and the ones with an event not handled yet */
+static volatile uint32_t cip_sock_watch = 0;
+static volatile uint32_t cip_sock_ready = 0;
+/* Time of the first event not handled yet of each socket, ms */
+static uint16_t cip_sock_evt_stamp[MEMP_NUM_NETCONN];
+
+static void cip_recv_task_stop(void);
 
 #ifndef MIN
 #define MIN(A, B) ((A) < (B) ? (A) : (B))
 #endif
 
+#ifndef MAX
+#define MAX(A, B) ((A) > (B) ? (A) : (B))
+#endif
+
+/* Ring of PASSTH_TX_BLK_NUM blocks filled one after the other by the DMA */
 typedef struct _passth_tx_buf {
     char *buf;
     uint32_t size;
-    uint32_t writeptr;
-    uint32_t readptr;
+    volatile uint32_t wr_blk;       /* blocks filled by the DMA, free running */
+    volatile uint32_t rd_blk;       /* blocks sent, free running */
+    volatile uint32_t rd_off;       /* bytes of block rd_blk sent */
+    volatile uint8_t dma_stalled;   /* no free block for the DMA */
 } passth_tx_buf_t;
 
 typedef struct _cip_passth_info {
     int passth_fd_idx;
     passth_tx_buf_t passth_buf;
 
-    os_timer_t passth_timer;
-    volatile uint8_t at_tx_passth_timeout;
     volatile uint8_t terminate_send_passth;
 } cip_passth_info_t;
 static cip_passth_info_t cip_passth_info;
 
-int local_sock_send = -1;
-
 #ifdef CONFIG_ATCMD_SPI
 typedef struct _cip_file_transfer_info {
     int fd_idx;
@@ -77,6 +99,273 @@ const char *ack = "ACK";
 const char *nak = "NAK";
 #endif
 
+/*!
+    \brief      wake up the receive task
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void cip_recv_task_wakeup(void)
+{
+    union at_local_event evt;
+
+    evt.event_id = AT_LOCAL_WAKEUP_EVENT;
+    sys_enter_critical();
+    /* a full queue wakes up the task anyway */
+    if (cip_evt_queue != NULL)
+        sys_queue_write(&cip_evt_queue, &evt, 0, false);
+    sys_exit_critical();
+}
+
+/*!
+    \brief      mark a watched socket ready and wake up the receive task if it is idle
+    \param[in]  fd: the socket
+    \param[out] none
+    \retval     none
+*/
+static void cip_sock_set_ready(int fd)
+{
+    uint32_t bit = CIP_SOCK_BIT(fd);
+
+    sys_enter_critical();
+    if ((cip_sock_watch & bit) && !(cip_sock_ready & bit)) {
+        if (cip_sock_ready == 0)
+            cip_recv_task_wakeup();
+        cip_sock_ready |= bit;
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      start or stop watching the events of a socket
+    \param[in]  fd: the socket
+    \param[in]  watch: 1 to start, 0 to stop
+    \param[out] none
+    \retval     none
+*/
+static void cip_sock_watch_set(int fd, int watch)
+{
+    uint32_t bit = CIP_SOCK_BIT(fd);
+
+    sys_enter_critical();
+    if (watch) {
+        cip_sock_watch |= bit;
+        cip_sock_evt_stamp[fd - LWIP_SOCKET_OFFSET] = (uint16_t)sys_current_time_get();
+    } else {
+        cip_sock_watch &= ~bit;
+        cip_sock_ready &= ~bit;
+    }
+    sys_exit_critical();
+    /* data may have been received before the socket was watched */
+    if (watch)
+        cip_sock_set_ready(fd);
+}
+
+/*!
+    \brief      socket event hook of lwIP, runs in the tcpip thread
+    \param[in]  s: the socket
+    \param[in]  evt: netconn event of the socket
+    \param[in]  len: length of the data of the event
+    \param[out] none
+    \retval     none
+*/
+void at_sock_event_hook(int s, int evt, u16_t len)
+{
+    if ((evt != NETCONN_EVT_RCVPLUS) && (evt != NETCONN_EVT_ERROR))
+        return;
+    if ((s < LWIP_SOCKET_OFFSET) || (s >= LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN))
+        return;
+
+    sys_enter_critical();
+    if ((cip_sock_watch & CIP_SOCK_BIT(s)) && !(cip_sock_ready & CIP_SOCK_BIT(s))) {
+        cip_sock_evt_stamp[s - LWIP_SOCKET_OFFSET] = (uint16_t)sys_current_time_get();
+        cip_sock_set_ready(s);
+    }
+    sys_exit_critical();
+}
+
+/*!
+    \brief      allocate the receive ring of a link
+    \param[in]  ring: the receive ring
+    \param[out] none
+    \retval     0 on success, -1 otherwise
+*/
+static int cip_rx_ring_init(cip_rx_ring_t *ring)
+{
+    sys_memset(ring, 0, sizeof(*ring));
+    ring->buf = sys_malloc(CIP_RX_RING_SIZE);
+    if (ring->buf == NULL)
+        return -1;
+    ring->size = CIP_RX_RING_SIZE;
+    return 0;
+}
+
+/*!
+    \brief      free the receive ring of a link
+    \param[in]  ring: the receive ring
+    \param[out] none
+    \retval     none
+*/
+static void cip_rx_ring_deinit(cip_rx_ring_t *ring)
+{
+    if (ring->buf)
+        sys_mfree(ring->buf);
+    sys_memset(ring, 0, sizeof(*ring));
+}
+
+static int cip_rx_ring_is_empty(cip_rx_ring_t *ring)
+{
+    return (ring->buf == NULL) || (ring->rd == ring->wr);
+}
+
+/*!
+    \brief      reserve room for a new record of a receive ring
+    \param[in]  ring: the receive ring
+    \param[in]  min_len: the smallest payload worth receiving
+    \param[out] room: the payload room reserved
+    \retval     where to receive the payload, NULL if the ring is full
+*/
+static uint8_t *cip_rx_ring_reserve(cip_rx_ring_t *ring, uint32_t min_len, uint32_t *room)
+{
+    uint32_t rd, wr, end;
+
+    sys_enter_critical();
+    if (ring->rd == ring->wr) {
+        /* empty, restart at the beginning to get the largest room */
+        ring->rd = 0;
+        ring->wr = 0;
+        ring->rec_off = 0;
+    }
+    rd = ring->rd;
+    wr = ring->wr;
+    sys_exit_critical();
+
+    min_len += CIP_RX_REC_HDR_LEN;
+    if (wr >= rd) {
+        /* keep one byte free when the reader is at the beginning, a full ring must not look empty */
+        end = (rd == 0) ? (ring->size - 1) : ring->size;
+        if (end - wr >= min_len) {
+            ring->rsv = wr;
+            *room = end - wr - CIP_RX_REC_HDR_LEN;
+            return ring->buf + wr + CIP_RX_REC_HDR_LEN;
+        }
+        /* wrap */
+        if (rd < min_len + 1)
+            return NULL;
+        ring->rsv = 0;
+        *room = rd - 1 - CIP_RX_REC_HDR_LEN;
+        return ring->buf + CIP_RX_REC_HDR_LEN;
+    }
+
+    if (rd - wr - 1 < min_len)
+        return NULL;
+    ring->rsv = wr;
+    *room = rd - wr - 1 - CIP_RX_REC_HDR_LEN;
+    return ring->buf + wr + CIP_RX_REC_HDR_LEN;
+}
+
+/*!
+    \brief      add the record reserved by cip_rx_ring_reserve() to a receive ring
+    \param[in]  ring: the receive ring
+    \param[in]  len: length of the payload received
+    \param[in]  stamp: time of the socket event the payload comes from
+    \param[out] none
+    \retval     none
+*/
+static void cip_rx_ring_commit(cip_rx_ring_t *ring, uint32_t len, uint16_t stamp)
+{
+    uint16_t hdr[2];
+    uint32_t wr;
+
+    hdr[0] = (uint16_t)len;
+    hdr[1] = stamp;
+    sys_memcpy(ring->buf + ring->rsv, hdr, CIP_RX_REC_HDR_LEN);
+    /* the reader skips the end of the ring if it is too short for a record header */
+    if ((ring->rsv == 0) && (ring->wr != 0) && (ring->size - ring->wr >= CIP_RX_REC_HDR_LEN)) {
+        hdr[0] = CIP_RX_REC_WRAP;
+        sys_memcpy(ring->buf + ring->wr, hdr, CIP_RX_REC_HDR_LEN);
+    }
+
+    wr = ring->rsv + CIP_RX_REC_HDR_LEN + len;
+    if (wr == ring->size)
+        wr = 0;
+    sys_enter_critical();
+    ring->wr = wr;
+    sys_exit_critical();
+}
+
+/*!
+    \brief      get the first record of a receive ring
+    \param[in]  ring: the receive ring
+    \param[out] len: length of the payload of the record
+    \param[out] stamp: time of the socket event the payload comes from
+    \retval     the payload, NULL if the ring is empty
+*/
+static uint8_t *cip_rx_ring_peek(cip_rx_ring_t *ring, uint32_t *len, uint16_t *stamp)
+{
+    uint16_t hdr[2] = {CIP_RX_REC_WRAP, 0};
+    uint32_t rd;
+
+    if (cip_rx_ring_is_empty(ring))
+        return NULL;
+
+    rd = ring->rd;
+    if (ring->size - rd >= CIP_RX_REC_HDR_LEN)
+        sys_memcpy(hdr, ring->buf + rd, CIP_RX_REC_HDR_LEN);
+    if (hdr[0] == CIP_RX_REC_WRAP) {
+        rd = 0;
+        sys_memcpy(hdr, ring->buf, CIP_RX_REC_HDR_LEN);
+        sys_enter_critical();
+        ring->rd = 0;
+        sys_exit_critical();
+    }
+    *len = hdr[0];
+    *stamp = hdr[1];
+    return ring->buf + rd + CIP_RX_REC_HDR_LEN;
+}
+
+/*!
+    \brief      consume the payload of the first record of a receive ring
+    \param[in]  ring: the receive ring
+    \param[in]  len: length of the payload of the record
+    \param[in]  consumed: bytes of the payload read
+    \param[out] none
+    \retval     none
+*/
+static void cip_rx_ring_consume(cip_rx_ring_t *ring, uint32_t len, uint32_t consumed)
+{
+    uint32_t rd;
+
+    ring->rec_off += consumed;
+    if (ring->rec_off < len)
+        return;
+
+    rd = ring->rd + CIP_RX_REC_HDR_LEN + len;
+    if (rd == ring->size)
+        rd = 0;
+    sys_enter_critical();
+    ring->rec_off = 0;
+    ring->rd = rd;
+    sys_exit_critical();
+}
+
+/*!
+    \brief      account a receive record handed to the host
+    \param[in]  stat: receive statistics of the link
+    \param[in]  stamp: time of the socket event the record comes from
+    \param[out] none
+    \retval     none
+*/
+static void cip_rx_stat_record(cip_rx_stat_t *stat, uint16_t stamp)
+{
+    uint32_t latency = (uint16_t)((uint16_t)sys_current_time_get() - stamp);
+
+    stat->records++;
+    stat->lat_sum += latency;
+    if (latency > stat->lat_max)
+        stat->lat_max = latency;
+}
+
 /*!
     \brief      initialize structure of tcpip information
     \param[in]  none
@@ -137,6 +426,13 @@ static int cip_info_cli_store(int fd, char *type, uint8_t role,
 
     if ((idx < 0) || (fd < 0))
         return -1;
+    if (cip_rx_ring_init(&cip_info.cli[idx].rx_ring) < 0) {
+        AT_TRACE("Allocate receive ring failed (len = %u).\r\n", CIP_RX_RING_SIZE);
+        return -1;
+    }
+#ifdef CONFIG_ATCMD_SPI
+    sys_mutex_init(&cip_info.cli[idx].rx_lock);
+#endif
     cip_info.cli[idx].fd = fd;
     if (strncmp(type, "TCP", 3) == 0)
         cip_info.cli[idx].type = CIP_TYPE_TCP;
@@ -147,8 +443,12 @@ static int cip_info_cli_store(int fd, char *type, uint8_t role,
     cip_info.cli[idx].remote_ip = remote_ip;
     cip_info.cli[idx].remote_port = remote_port;
     cip_info.cli[idx].local_port = local_port;
+    cip_info.cli[idx].rx_throttled = 0;
+    sys_memset(&cip_info.cli[idx].rx_stat, 0, sizeof(cip_info.cli[idx].rx_stat));
+    cip_info.cli[idx].rx_stat.start_time = sys_current_time_get();
 
     cip_info.cli_num++;
+    cip_sock_watch_set(fd, 1);
 
     return idx;
 }
@@ -163,24 +463,21 @@ static void cip_info_cli_free(int index)
 {
     if ((index >= 0) && (index < MAX_CLIENT_NUM)) {
         if (cip_info.cli[index].fd != -1) {
+            cip_sock_watch_set(cip_info.cli[index].fd, 0);
 #ifdef CONFIG_ATCMD_SPI
-            struct recv_data_node *p_item;
-            sys_mutex_get(&cip_info.cli[index].list_lock);
-            p_item = (struct recv_data_node *)list_pick(&cip_info.cli[index].recv_data_list);
-
-            while (p_item != NULL) {
-                if (p_item->data && (p_item->data_len > 0)) {
-                    sys_mfree(p_item->data);
-                    sys_mfree(p_item);
-                }
-                list_remove(&cip_info.cli[index].recv_data_list, NULL, (struct list_hdr *)p_item);
-                p_item = (struct recv_data_node *)list_pick(&cip_info.cli[index].recv_data_list);
-            }
-            sys_mutex_free(&cip_info.cli[index].list_lock);
+            sys_mutex_get(&cip_info.cli[index].rx_lock);
+            cip_rx_ring_deinit(&cip_info.cli[index].rx_ring);
+            sys_mutex_put(&cip_info.cli[index].rx_lock);
+            sys_mutex_free(&cip_info.cli[index].rx_lock);
+#else
+            cip_rx_ring_deinit(&cip_info.cli[index].rx_ring);
 #endif
             sys_memset(&cip_info.cli[index], 0, sizeof(cip_info.cli[index]));
             cip_info.cli[index].fd = -1;
             cip_info.cli_num--;
+            /* a pending connection can be accepted now */
+            if (cip_info.local_srv_fd >= 0)
+                cip_sock_set_ready(cip_info.local_srv_fd);
         }
     }
 }
@@ -236,6 +533,10 @@ void cip_info_reset(void)
 {
     int i, fd;
 
+    /* the receive task closes the links it serves */
+    if (cip_task_started)
+        cip_recv_task_stop();
+
     for (i = 0; i < MAX_CLIENT_NUM; i++) {
         if (cip_info.cli[i].fd >= 0) {
             fd = cip_info.cli[i].fd;
@@ -247,9 +548,9 @@ void cip_info_reset(void)
         fd = cip_info.local_srv_fd;
         cip_info.local_srv_fd = -1;
         cip_info.local_srv_port = 0;
+        cip_sock_watch_set(fd, 0);
         close(fd);
     }
-    cip_task_terminate = 1;
 }
 
 
@@ -332,9 +633,7 @@ Exit:
 static int at_tcp_send(int fd, uint32_t tx_len)
 {
     char *tx_buf = NULL;
-    int cnt = 0;
-    int retry_cnt = 10;
-    struct at_local_tcp_send send_data;
+    union at_local_event send_data;
 
     tx_buf = sys_zalloc(tx_len);
     if (NULL == tx_buf) {
@@ -346,27 +645,22 @@ static int at_tcp_send(int fd, uint32_t tx_len)
 
     // Block here to wait dma receive done
     at_hw_dma_receive((uint32_t)tx_buf, tx_len);
-    send_data.event_id = AT_LOCAL_TCP_SNED_EVENT;
-    send_data.sock_fd = fd;
-    send_data.send_data_addr = (uint32_t)tx_buf;
-    send_data.send_data_len = tx_len;
+    send_data.tcp_send.event_id = AT_LOCAL_TCP_SNED_EVENT;
+    send_data.tcp_send.sock_fd = fd;
+    send_data.tcp_send.send_data_addr = (uint32_t)tx_buf;
+    send_data.tcp_send.send_data_len = tx_len;
 
-Retry:
-    cnt = sendto(local_sock_send, (void *)&send_data, sizeof(send_data), 0, NULL, 0);
-    if (cnt <= 0) {
-        if ((errno == EAGAIN || errno == ENOMEM) && retry_cnt > 0) {
-            sys_ms_sleep(20);
-            retry_cnt--;
-            goto Retry;
-        }
+    if ((cip_evt_queue == NULL) ||
+        sys_queue_write(&cip_evt_queue, &send_data, CIP_SEND_POST_TIMEOUT, false)) {
         sys_mfree(tx_buf);
-        AT_TRACE("local socket send tcp fail. %d!\r\n", errno);
+        AT_TRACE("post tcp send event fail.\r\n");
         AT_RSP_START(10);
         AT_RSP("SEND FAIL\r\n");
         AT_RSP_IMMEDIATE();
         AT_RSP_FREE();
+        return -1;
     }
-    return cnt;
+    return tx_len;
 }
 
 #ifndef CONFIG_ATCMD_SPI
@@ -375,11 +669,7 @@ static void cip_passth_tx_buf_deinit()
     if (cip_passth_info.passth_buf.buf)
         sys_mfree(cip_passth_info.passth_buf.buf);
 
-    cip_passth_info.passth_buf.buf= NULL;
-    cip_passth_info.passth_buf.size = 0;
-
-    cip_passth_info.passth_buf.writeptr = 0;
-    cip_passth_info.passth_buf.readptr = 0;
+    sys_memset(&cip_passth_info.passth_buf, 0, sizeof(cip_passth_info.passth_buf));
 }
 
 static int cip_passth_tx_buf_init()
@@ -391,20 +681,17 @@ static int cip_passth_tx_buf_init()
     }
 
     cip_passth_info.passth_buf.size = PASSTH_TX_BUF_LEN;
-    cip_passth_info.passth_buf.writeptr = 0;
-    cip_passth_info.passth_buf.readptr = 0;
+    cip_passth_info.passth_buf.wr_blk = 0;
+    cip_passth_info.passth_buf.rd_blk = 0;
+    cip_passth_info.passth_buf.rd_off = 0;
+    cip_passth_info.passth_buf.dma_stalled = 0;
 
     return 0;
 }
 
 static void cip_passth_info_deinit(void)
 {
-    if (cip_passth_info.passth_timer) {
-        sys_timer_delete(&(cip_passth_info.passth_timer));
-    }
-
     cip_passth_info.terminate_send_passth = 0;
-    cip_passth_info.at_tx_passth_timeout = 0;
 
     cip_passth_tx_buf_deinit();
 }
@@ -412,7 +699,6 @@ static void cip_passth_info_deinit(void)
 static int cip_passth_info_init(void)
 {
     cip_passth_info.terminate_send_passth = 0;
-    cip_passth_info.at_tx_passth_timeout = 0;
 
     if (cip_passth_tx_buf_init() < 0) {
         goto fail;
@@ -425,21 +711,82 @@ fail:
     return -1;
 }
 
-static int at_passth_send_data(int fd, uint8_t flush, uint8_t type)
+/*!
+    \brief      start the DMA in the next free block of the passthrough buffer,
+                called with the interrupts disabled
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void at_passth_dma_arm(void)
+{
+    passth_tx_buf_t *passth_tx_buf = &(cip_passth_info.passth_buf);
+
+    if (passth_tx_buf->wr_blk - passth_tx_buf->rd_blk >= PASSTH_TX_BLK_NUM) {
+        /* all blocks wait to be sent, the UART keeps the data and the RTS line holds the host */
+        passth_tx_buf->dma_stalled = 1;
+        return;
+    }
+    passth_tx_buf->dma_stalled = 0;
+    at_hw_dma_receive_start((uint32_t)(passth_tx_buf->buf +
+                            (passth_tx_buf->wr_blk % PASSTH_TX_BLK_NUM) * PASSTH_TX_BLK_LEN),
+                            PASSTH_TX_BLK_LEN);
+}
+
+/*!
+    \brief      a block of the passthrough buffer is full, runs in the DMA interrupt
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void at_passth_dma_block_done(void)
+{
+    cip_passth_info.passth_buf.wr_blk++;
+    at_passth_dma_arm();
+}
+
+/*!
+    \brief      release the data sent from the passthrough buffer
+    \param[in]  len: number of bytes sent
+    \param[out] none
+    \retval     none
+*/
+static void at_passth_tx_consume(uint32_t len)
 {
     passth_tx_buf_t *passth_tx_buf = &(cip_passth_info.passth_buf);
-    char *start_addr = passth_tx_buf->buf + passth_tx_buf->readptr;
-    int ret = 0, sent_cnt = 0, idx = 0;
-    int retry_cnt = 0;
+
+    sys_enter_critical();
+    passth_tx_buf->rd_off += len;
+    passth_tx_buf->rd_blk += passth_tx_buf->rd_off / PASSTH_TX_BLK_LEN;
+    passth_tx_buf->rd_off %= PASSTH_TX_BLK_LEN;
+    /* a block is free again, restart the reception */
+    if (passth_tx_buf->dma_stalled)
+        at_passth_dma_arm();
+    sys_exit_critical();
+}
+
+/*!
+    \brief      send data of the passthrough buffer, the blocks are gathered in one sendmsg()
+    \param[in]  fd: the socket of the link
+    \param[in]  len: number of bytes to send
+    \param[in]  type: the type of the link
+    \param[out] none
+    \retval     0 on success, -1 if the link failed
+*/
+static int at_passth_send_data(int fd, uint32_t len, uint8_t type)
+{
+    passth_tx_buf_t *passth_tx_buf = &(cip_passth_info.passth_buf);
+    struct iovec iov[PASSTH_TX_BLK_NUM + 1];
+    struct msghdr msg;
     struct sockaddr_in saddr;
-    int remaining_cnt = passth_tx_buf->writeptr - passth_tx_buf->readptr;
+    uint32_t blk, off, max_len, seg_len, chunk;
+    int ret, idx, waited = 0;
+    char *addr;
 
     if (fd < 0 || ((type != CIP_TYPE_TCP) && (type != CIP_TYPE_UDP)))
         return -1;
 
-    if (remaining_cnt == 0)
-        return 0;
-
+    sys_memset(&msg, 0, sizeof(msg));
     if (type == CIP_TYPE_UDP) {
         idx = cip_info_cli_find(fd);
         if (idx == -1)
@@ -448,47 +795,48 @@ static int at_passth_send_data(int fd, uint8_t flush, uint8_t type)
         saddr.sin_family = AF_INET;
         saddr.sin_port = htons(cip_info.cli[idx].remote_port);
         saddr.sin_addr.s_addr = cip_info.cli[idx].remote_ip;
+        msg.msg_name = &saddr;
+        msg.msg_namelen = sizeof(struct sockaddr_in);
     }
 
-    if ((remaining_cnt == strlen(PASSTH_TERMINATE_STR) &&
-            strncmp(passth_tx_buf->buf, PASSTH_TERMINATE_STR, strlen(PASSTH_TERMINATE_STR)) == 0)
-        //|| (remaining_cnt == 5 && strncmp(passth_tx_buf->buf, PASSTH_TERMINATE_STR"\r\n", 5) == 0)
-        ) {
-        cip_passth_info.terminate_send_passth = 1;
-        return 0;
-    }
-
-    while (remaining_cnt > 0) {
-        if (remaining_cnt >= PASSTH_START_TRANSFER_LEN) {
-            sent_cnt = PASSTH_START_TRANSFER_LEN;
-        } else {
-            if (flush == 1)
-                sent_cnt = remaining_cnt;
-            else
-                return 0;
+    while (len > 0) {
+        /* tcp takes all the data at once, udp sends datagrams of limited size */
+        max_len = (type == CIP_TYPE_UDP) ? MIN(len, PASSTH_START_TRANSFER_LEN) : len;
+        blk = passth_tx_buf->rd_blk;
+        off = passth_tx_buf->rd_off;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 0;
+        for (seg_len = 0; seg_len < max_len; seg_len += chunk) {
+            addr = passth_tx_buf->buf + (blk % PASSTH_TX_BLK_NUM) * PASSTH_TX_BLK_LEN + off;
+            chunk = MIN(PASSTH_TX_BLK_LEN - off, max_len - seg_len);
+            /* blocks following each other in memory share an entry */
+            if (msg.msg_iovlen > 0 &&
+                (char *)iov[msg.msg_iovlen - 1].iov_base + iov[msg.msg_iovlen - 1].iov_len == addr) {
+                iov[msg.msg_iovlen - 1].iov_len += chunk;
+            } else {
+                iov[msg.msg_iovlen].iov_base = addr;
+                iov[msg.msg_iovlen].iov_len = chunk;
+                msg.msg_iovlen++;
+            }
+            blk++;
+            off = 0;
         }
 
-Retry:
-        if (type == CIP_TYPE_TCP)
-            ret = send(fd, (void *)start_addr, sent_cnt, 0);
-        else
-            ret = sendto(fd, (void *)start_addr, sent_cnt, 0, (struct sockaddr *)&saddr, sizeof(struct sockaddr_in));
-
+        ret = sendmsg(fd, &msg, 0);
         if (ret <= 0) {
-            if (errno == EAGAIN || errno == ENOMEM) {
-                if (retry_cnt > 0) {
-                    retry_cnt--;
-                    goto Retry;
-                }
+            /* out of buffers: wait for the stack to drain, the reception stalls meanwhile */
+            if ((errno == EAGAIN || errno == ENOMEM) && (waited < PASSTH_SEND_TIMEOUT) &&
+                (cip_passth_info.terminate_send_passth == 0)) {
+                sys_ms_sleep(PASSTH_SEND_RETRY_MS);
+                waited += PASSTH_SEND_RETRY_MS;
+                continue;
             }
             AT_TRACE("send error:%d\r\n", errno);
             goto exit;
         }
-
-        passth_tx_buf->readptr += sent_cnt;
-        // AT_TRACE("Sendout: %d OK,w:%d,r:%d,s:%d,f=%d,t=%d\r\n", ret, passth_tx_buf->writeptr, passth_tx_buf->readptr, sent_cnt, flush, cip_passth_info.at_tx_passth_timeout);
-        start_addr += sent_cnt;
-        remaining_cnt = remaining_cnt - sent_cnt;
+        waited = 0;
+        at_passth_tx_consume(ret);
+        len -= ret;
     }
 
     return 0;
@@ -498,17 +846,44 @@ exit:
     return -1;
 }
 
-static void at_tx_passth_timeout_cb( void *ptmr, void *p_arg )
+/*!
+    \brief      check if the data not sent of the passthrough buffer is the terminate string
+    \param[in]  len: number of bytes not sent
+    \param[out] none
+    \retval     1 if it is, 0 otherwise
+*/
+static int at_passth_is_terminate(uint32_t len)
 {
-    cip_passth_info.at_tx_passth_timeout = 1;
+    passth_tx_buf_t *passth_tx_buf = &(cip_passth_info.passth_buf);
+    uint32_t i, pos;
+
+    if (len != strlen(PASSTH_TERMINATE_STR))
+        return 0;
+
+    for (i = 0; i < len; i++) {
+        pos = (passth_tx_buf->rd_blk % PASSTH_TX_BLK_NUM) * PASSTH_TX_BLK_LEN + passth_tx_buf->rd_off + i;
+        if (passth_tx_buf->buf[pos % passth_tx_buf->size] != PASSTH_TERMINATE_STR[i])
+            return 0;
+    }
+    return 1;
 }
 
+/*!
+    \brief      passthrough send loop: the DMA fills the blocks of the passthrough buffer and
+                wakes the loop at the half and at the end of each block. The data is sent when
+                enough is pending for the current input rate or when the oldest byte waited for
+                the transfer interval, smaller inputs are seen at the latest one interval later.
+    \param[in]  fd: the socket of the link
+    \param[in]  type: the type of the link
+    \param[out] none
+    \retval     0
+*/
 static int at_hw_passth_send(int fd, uint8_t type)
 {
-    char *tx_buf = NULL;
     passth_tx_buf_t *passth_tx_buf;
-    int passth_timeout = 0, ret;
-    uint32_t last_cnt = 0, cur_cnt = 0;
+    uint32_t in_cnt, last_in_cnt = 0, sent_cnt, pending = 0, cur_cnt;
+    uint32_t now, last_time, in_time, pend_time = 0, intvl, thresh, wait;
+    int32_t rate = 0;   /* host input rate, bytes per ms, Q8 */
 
     if (cip_passth_info_init()) {
         AT_RSP_DIRECT("ERROR\r\n", 7);
@@ -518,63 +893,76 @@ static int at_hw_passth_send(int fd, uint8_t type)
     passth_tx_buf = &(cip_passth_info.passth_buf);
 
     if (cip_info.trans_intvl == 0)
-        passth_timeout = 1;
+        intvl = 1;
     else
-        passth_timeout = cip_info.trans_intvl;
-
-    sys_timer_init(&(cip_passth_info.passth_timer), (const uint8_t *)("passth_intvl_timer"),
-            passth_timeout, 0, at_tx_passth_timeout_cb, NULL);
+        intvl = cip_info.trans_intvl;
 
     at_hw_dma_receive_config();
-
-Loop:
-    tx_buf = passth_tx_buf->buf;
-    passth_tx_buf->writeptr = 0;
-    passth_tx_buf->readptr = 0;
-
-    last_cnt = 0;
-    cur_cnt = 0;
-    cip_passth_info.at_tx_passth_timeout = 0;
-
-    at_hw_dma_receive_start((uint32_t)tx_buf, passth_tx_buf->size);
-    sys_timer_start(&(cip_passth_info.passth_timer), 0);
+    sys_enter_critical();
+    at_hw_dma_rx_cb = at_passth_dma_block_done;
+    at_hw_dma_rx_half = 1;
+    at_passth_dma_arm();
+    sys_exit_critical();
+    last_time = sys_current_time_get();
+    in_time = last_time;
+    wait = intvl;
 
     while (cip_passth_info.terminate_send_passth != 1) {
-        ret = sys_sema_down(&at_hw_dma_sema, 1); // wait 1ms
-        cur_cnt = at_dma_get_cur_received_num(cip_passth_info.passth_buf.size);
-        if (ret == OS_OK) {  //8192 received
-            // clear timer
-            sys_timer_stop(&(cip_passth_info.passth_timer), 0);
-            passth_tx_buf->writeptr = passth_tx_buf->size;
-            //AT_TRACE("MAX, w:%d, r:%d, c=%d\r\n", passth_tx_buf->writeptr, passth_tx_buf->readptr, cur_cnt);
-            at_passth_send_data(fd, 1, type);
-            goto Loop;
-        } else if (ret == OS_TIMEOUT && cip_passth_info.at_tx_passth_timeout != 1) {
-            passth_tx_buf->writeptr = cur_cnt;
-            //AT_TRACE("Wait, w:%d, r:%d, c=%d\r\n", passth_tx_buf->writeptr, passth_tx_buf->readptr, cur_cnt);
-            if (passth_tx_buf->writeptr - passth_tx_buf->readptr >= PASSTH_START_TRANSFER_LEN) {
-                at_passth_send_data(fd, 0, type);
-            }
+        sys_sema_down(&at_hw_dma_sema, wait);
+
+        /* bytes received: the full blocks and the beginning of the block being filled, its
+           last byte is counted once the interrupt has handed the block over */
+        sys_enter_critical();
+        cur_cnt = passth_tx_buf->dma_stalled ? 0 : at_dma_get_cur_received_num(PASSTH_TX_BLK_LEN);
+        in_cnt = passth_tx_buf->wr_blk * PASSTH_TX_BLK_LEN + MIN(cur_cnt, PASSTH_TX_BLK_LEN - 1);
+        sys_exit_critical();
+        sent_cnt = passth_tx_buf->rd_blk * PASSTH_TX_BLK_LEN + passth_tx_buf->rd_off;
+
+        now = sys_current_time_get();
+        if (now != last_time) {
+            rate += ((int32_t)(((in_cnt - last_in_cnt) << 8) / (now - last_time)) - rate) / 8;
+        }
+        if (in_cnt != last_in_cnt) {
+            /* the input came after the previous wake up, the data waits since then */
+            if (pending == 0)
+                pend_time = last_time;
+            in_time = now;
+        }
+        last_time = now;
+        last_in_cnt = in_cnt;
+        pending = in_cnt - sent_cnt;
+        wait = intvl;
+
+        if (pending == 0)
             continue;
-        }
 
-        if (cip_passth_info.at_tx_passth_timeout == 1 && cur_cnt > 0) {
-            at_hw_dma_receive_stop();
-            //AT_TRACE("Timeout, w:%d, r:%d, c=%d\r\n", passth_tx_buf->writeptr, passth_tx_buf->readptr, cur_cnt);
-            passth_tx_buf->writeptr = cur_cnt;
-            if (passth_tx_buf->writeptr > passth_tx_buf->readptr)
-                at_passth_send_data(fd, 1, type);
-            goto Loop;
+        /* a lone "+++" followed by a pause ends the passthrough mode */
+        if (at_passth_is_terminate(pending)) {
+            if ((now - in_time) < PASSTH_GUARD_MS) {
+                wait = PASSTH_GUARD_MS - (now - in_time);
+                continue;
+            }
+            cip_passth_info.terminate_send_passth = 1;
+            break;
         }
 
-        cip_passth_info.at_tx_passth_timeout = 0;
-        sys_timer_start(&(cip_passth_info.passth_timer), 0); // Restart timer
-
-        //AT_TRACE("end, l:%d, c=%d, ret=%d\r\n", last_cnt, cur_cnt, ret);
-        last_cnt = cur_cnt;
+        /* coalesce what the host sends in one transfer interval, up to the largest send */
+        thresh = ((uint32_t)rate * intvl) >> 8;
+        thresh = MIN(MAX(thresh, PASSTH_FLUSH_MIN_LEN), PASSTH_START_TRANSFER_LEN);
+        if (pending < thresh && (now - pend_time) < intvl &&
+            (passth_tx_buf->wr_blk - passth_tx_buf->rd_blk) < PASSTH_TX_BLK_NUM / 2) {
+            wait = intvl - (now - pend_time);
+            continue;
+        }
+        at_passth_send_data(fd, pending, type);
+        pending = 0;
     }
 
 //    AT_TRACE("PassThrough mode exit...\r\n");
+    sys_enter_critical();
+    at_hw_dma_rx_cb = NULL;
+    at_hw_dma_rx_half = 0;
+    sys_exit_critical();
     at_hw_dma_receive_stop();
     at_hw_irq_receive_config();
     cip_passth_info_deinit();
@@ -798,10 +1186,8 @@ static int at_udp_send(int fd, uint32_t tx_len, char *srv_ip, uint16_t srv_port)
 {
     char *tx_buf = NULL;
 //    char ch;
-    int cnt = 0;
-    int retry_cnt = 10;
     struct sockaddr_in saddr;
-    struct at_local_udp_send send_data;
+    union at_local_event send_data;
 
     tx_buf = sys_malloc(tx_len);
     if (NULL == tx_buf) {
@@ -830,10 +1216,10 @@ static int at_udp_send(int fd, uint32_t tx_len, char *srv_ip, uint16_t srv_port)
 #else
     // Block here to wait dma receive done
     at_hw_dma_receive((uint32_t)tx_buf, tx_len);
-    send_data.event_id = AT_LOCAL_UDP_SNED_EVENT;
-    send_data.sock_fd = fd;
-    send_data.send_data_addr = (uint32_t)tx_buf;
-    send_data.send_data_len = tx_len;
+    send_data.udp_send.event_id = AT_LOCAL_UDP_SNED_EVENT;
+    send_data.udp_send.sock_fd = fd;
+    send_data.udp_send.send_data_addr = (uint32_t)tx_buf;
+    send_data.udp_send.send_data_len = tx_len;
 
     // debug_print_dump_data("TX:", (char *)tx_buf, tx_len);
 #endif
@@ -843,25 +1229,20 @@ static int at_udp_send(int fd, uint32_t tx_len, char *srv_ip, uint16_t srv_port)
     saddr.sin_port = htons(srv_port);
     saddr.sin_addr.s_addr = inet_addr(srv_ip);
 
-    sys_memcpy(&(send_data.to), &saddr, sizeof(struct sockaddr_in));
-    send_data.tolen = sizeof(struct sockaddr_in);
+    sys_memcpy(&(send_data.udp_send.to), &saddr, sizeof(struct sockaddr_in));
+    send_data.udp_send.tolen = sizeof(struct sockaddr_in);
 
-Retry:
-    cnt = sendto(local_sock_send, (void *)&send_data, sizeof(send_data), 0, NULL, 0);
-    if (cnt <= 0) {
-        if ((errno == EAGAIN || errno == ENOMEM) && retry_cnt > 0) {
-            sys_ms_sleep(20);
-            retry_cnt--;
-            goto Retry;
-        }
+    if ((cip_evt_queue == NULL) ||
+        sys_queue_write(&cip_evt_queue, &send_data, CIP_SEND_POST_TIMEOUT, false)) {
         sys_mfree(tx_buf);
-        AT_TRACE("local socket send udp fail. %d!\r\n", errno);
+        AT_TRACE("post udp send event fail.\r\n");
         AT_RSP_START(10);
         AT_RSP("SEND FAIL\r\n");
         AT_RSP_IMMEDIATE();
         AT_RSP_FREE();
+        return -1;
     }
-    return cnt;
+    return tx_len;
 }
 
 /*!
@@ -906,9 +1287,12 @@ static int tcp_server_start(uint16_t srv_port)
         AT_TRACE("Listen tcp server socket fd error!\r\n");
         goto Exit;
     }
+    /* the receive task accepts until there is no pending connection left */
+    fcntl(srv_fd, F_SETFL, O_NONBLOCK);
     cip_info.local_srv_fd = srv_fd;
     cip_info.local_srv_port = srv_port;
     cip_info.local_srv_stop = 0;
+    cip_sock_watch_set(srv_fd, 1);
     AT_TRACE("TCP listen port %d\r\n", srv_port);
 
     return 0;
@@ -942,171 +1326,290 @@ static void tcp_server_stop(void)
     if (cip_info.local_srv_fd >= 0) {
         if (active_sock_num) {
             cip_info.local_srv_stop = 1;
+            cip_recv_task_wakeup();
         } else {
-            cip_task_terminate = 1;
-            while (sys_task_exist((const uint8_t *)"Cip Rcv")) {
-                sys_ms_sleep(1);
-            }
-            cip_task_started = 0;
+            cip_recv_task_stop();
         }
     }
 }
 
-#ifdef CONFIG_ATCMD_SPI
+#ifndef CONFIG_ATCMD_SPI
 /*!
-    \brief      process recieved data from socket server and
-                list the data in the client_info_t.
-    \param[in]  idx:    index of which client in cip_info
-    \param[in]  rx_buf: buffer that stored recieved data
-    \param[in]  recv_sz: recieved data length
+    \brief      hand the data received by a link to the host as a +IPD message
+    \param[in]  fd: the socket of the link
+    \param[in]  data: the data, in the receive ring of the link
+    \param[in]  len: length of the data
     \param[out] none
     \retval     none
 */
-static void at_spi_recv_data_process(int idx, uint8_t *rx_buf, int recv_sz)
+static void cip_ipd_send(int fd, char *data, int len)
 {
-    int recv_processed = 0, currentdatasize = 0;
-    struct recv_data_node *recv_data_node = NULL;
-    uint8_t *data_recv = NULL;
-
-    if (recv_sz > AT_SPI_MAX_DATA_LEN) {
-        AT_TRACE("recv_sz:%d large than 2048.\r\n", recv_sz);
-    }
-
-    recv_processed = 0;
-    do {
-        recv_data_node = sys_malloc(sizeof(struct recv_data_node));
-        currentdatasize = (recv_sz - recv_processed) > AT_SPI_MAX_DATA_LEN ? AT_SPI_MAX_DATA_LEN : (recv_sz - recv_processed);
+    AT_RSP_START(32);
+    AT_RSP("+IPD,%d,%d: ", fd, len);
+    AT_RSP_IMMEDIATE();
+    AT_RSP_DIRECT(data, len);
+    AT_RSP("\r\n");
+    AT_RSP_OK();
+}
+#endif /* CONFIG_ATCMD_SPI */
 
-        if (recv_data_node == NULL) {
-            AT_TRACE("Allocate recv_data_node failed (len = %u).\r\n", sizeof(struct recv_data_node));
-            break;
-        }
+/*!
+    \brief      process a send request posted to the receive task
+    \param[in]  evt: the request
+    \param[out] none
+    \retval     none
+*/
+static void cip_local_event_process(union at_local_event *evt)
+{
+    int send_cnt;
 
-        data_recv = sys_malloc(currentdatasize);// for data
-        if (data_recv == NULL) {
-            AT_TRACE("Allocate data_recv failed (len = %u).\r\n", currentdatasize);
-            break;
+    if (evt->event_id == AT_LOCAL_TCP_SNED_EVENT) {
+        struct at_local_tcp_send *send_data_local = &evt->tcp_send;
+        AT_RSP_START(128);
+TCP_RETRY_SEND:
+        send_cnt = send(send_data_local->sock_fd, (void *)(send_data_local->send_data_addr), send_data_local->send_data_len, 0);
+        if (send_cnt <= 0) {
+            AT_TRACE("send data error. %d!\r\n", errno);
+            if (errno == EAGAIN || errno == ENOMEM) {
+                goto TCP_RETRY_SEND;
+            }
+            int idx = cip_info_cli_find(send_data_local->sock_fd);
+            if ((idx != -1) && (cip_info.cli[idx].role == CIP_ROLE_CLIENT)) {
+                cip_info_cli_free(idx);
+                close(send_data_local->sock_fd);
+                AT_TRACE("close tcp client. %d!\r\n", send_data_local->sock_fd);
+            }
+            AT_RSP("SEND FAIL\r\n");
+            AT_RSP_ERR();
+        } else {
+            AT_RSP("SEND OK\r\n");
+            AT_RSP_OK();
         }
-
-        sys_memcpy(data_recv, rx_buf + recv_processed, currentdatasize);// copy payload
-
-        recv_data_node->data = data_recv;
-        recv_data_node->data_len = currentdatasize;
-        // AT_TRACE("idx:%d, list add,len:%d, fd:%d\r\n", idx, currentdatasize, cip_info.cli[i].fd);
-        sys_mutex_get(&cip_info.cli[idx].list_lock);
-        // if data number in list is large than MAX_RECV_DATA_NUM_IN_LIST, delete the first one in the list
-        if (list_cnt(&cip_info.cli[idx].recv_data_list) > MAX_RECV_DATA_NUM_IN_LIST) {
-            struct recv_data_node *p_item;
-            AT_TRACE("data num in list is large than %d, delete the first one\r\n", MAX_RECV_DATA_NUM_IN_LIST);
-            p_item = (struct recv_data_node *)list_pop_front(&cip_info.cli[idx].recv_data_list);
-            sys_mfree(p_item->data);
-            sys_mfree(p_item);
+        sys_mfree((void *)(send_data_local->send_data_addr));
+    } else if (evt->event_id == AT_LOCAL_UDP_SNED_EVENT) {
+        struct at_local_udp_send *send_data_local = &evt->udp_send;
+        AT_RSP_START(128);
+UDP_RETRY_SEND:
+        send_cnt = sendto(send_data_local->sock_fd, (void *)(send_data_local->send_data_addr), send_data_local->send_data_len,
+                            0, (struct sockaddr *)&(send_data_local->to), send_data_local->tolen);
+        if (send_cnt <= 0) {
+            AT_TRACE("send data error. %d!\r\n", errno);
+            if (errno == EAGAIN || errno == ENOMEM) {
+                goto UDP_RETRY_SEND;
+            }
+            int idx = cip_info_cli_find(send_data_local->sock_fd);
+            cip_info_cli_free(idx);
+            close(send_data_local->sock_fd);
+            AT_TRACE("close udp client. %d!\r\n", send_data_local->sock_fd);
+            AT_RSP("SEND FAIL\r\n");
+            AT_RSP_ERR();
+        } else {
+            AT_RSP("SEND OK\r\n");
+            AT_RSP_OK();
         }
-        list_push_back(&cip_info.cli[idx].recv_data_list, &recv_data_node->list_hdr);
-        sys_mutex_put(&cip_info.cli[idx].list_lock);
-
-        recv_processed += currentdatasize;
-    } while (recv_processed < recv_sz);
-
-    return;
+        sys_mfree((void *)(send_data_local->send_data_addr));
+    } else if (evt->event_id != AT_LOCAL_WAKEUP_EVENT) {
+        AT_TRACE("unvalid loacl event.\r\n");
+    }
 }
-#endif /* CONFIG_ATCMD_SPI */
 
-extern int dhcpd_ipaddr_is_valid(uint32_t ipaddr);
 /*!
-    \brief      receive task
-    \param[in]  param: the pointer of user parameter
+    \brief      accept the pending connections of the tcp server
+    \param[in]  none
     \param[out] none
     \retval     none
 */
-static void cip_recv_task(void *param)
+static void cip_srv_accept(void)
 {
-    struct timeval timeout;
-    int max_fd_num = 0;
-    int cli_fd, i, j, recv_sz;
-    char *rx_buf;
-    uint32_t rx_len = PASSTH_START_TRANSFER_LEN;
     struct sockaddr_in saddr;
     int addr_sz = sizeof(saddr);
-    fd_set read_set, except_set;
-    int status;
+    int cli_fd, status;
     int keepalive = 1;
     int keepidle = 20; //in seconds
     int keepcnt = 3;
     int keepinval = 10; //in seconds
-    int vif_idx = WIFI_VIF_INDEX_DEFAULT;
     int send_timeout; // ms
-    int send_cnt;
     struct linger ling;
-    int close_fd = -1;
 
-    int local_sock_recv = -1;
-    int local_port = 1635;
-    struct sockaddr_in local_addr_recv;
-    struct sockaddr_in local_addr_send;
-    int local_recv_sz = 0;
-#define LOACL_RECV_BUF_SIZE 50 // in bytes
-    uint8_t local_recv_buf[LOACL_RECV_BUF_SIZE] = {0};
-
-    local_sock_recv = socket(AF_INET, SOCK_DGRAM, 0);
-    if (local_sock_recv < 0) {
-        AT_TRACE("Create local socket recv error!\r\n");
-        goto Exit;
-    }
-    sys_memset(&local_addr_recv, 0, sizeof(local_addr_recv));
-    local_addr_recv.sin_family = AF_INET;
-    local_addr_recv.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    local_addr_recv.sin_port = htons(local_port);
-    if (bind(local_sock_recv, (struct sockaddr *)&local_addr_recv, sizeof(local_addr_recv)) < 0) {
-        AT_TRACE("bind local socket fail. %d!\r\n", errno);
-        goto Exit;
-    }
-    local_sock_send = socket(AF_INET, SOCK_DGRAM, 0);
-    if (local_sock_send < 0) {
-        AT_TRACE("Create local socket send error!\r\n");
-        goto Exit;
-    }
-    sys_memset(&local_addr_send, 0, sizeof(local_addr_send));
-    local_addr_send.sin_family = AF_INET;
-    local_addr_send.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    local_addr_send.sin_port = htons(local_port);
-    if (connect(local_sock_send, (struct sockaddr *)&local_addr_send, sizeof(local_addr_send)) < 0) {
-        AT_TRACE("connect local socket fail. %d!\r\n", errno);
-        goto Exit;
+    while (1) {
+        /* the connections left pending are accepted once a link is freed */
+        if (cip_info.cli_num >= MAX_CLIENT_NUM) {
+            AT_TRACE("client full\r\n");
+            return;
+        }
+#ifndef CONFIG_ATCMD_SPI
+        if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
+                cip_info_valid_tcp_fd_cnt_get() >= 1) {
+            AT_TRACE("Only one TCP client is allowed in Passthrough mode\r\n");
+            return;
+        }
+#endif
+        /* the server socket is non-blocking, returns EWOULDBLOCK when no connection is pending */
+        cli_fd = accept(cip_info.local_srv_fd,
+                        (struct sockaddr *)&saddr,
+                        (socklen_t*)&addr_sz);
+        if (cli_fd < 0) {
+            if (errno != EWOULDBLOCK)
+                AT_TRACE("accept error %d!\r\n", errno);
+            return;
+        }
+
+        AT_TRACE("new client %d\r\n", cli_fd);
+        status = cip_info_cli_store(cli_fd, "TCP", CIP_ROLE_SERVER,
+                            saddr.sin_addr.s_addr, saddr.sin_port, cip_info.local_srv_port);
+        if (status < 0) {
+            AT_TRACE("Store client info error %d!\r\n", status);
+            close(cli_fd);
+        } else {
+            setsockopt(cli_fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(int));
+            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(int));
+            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPINTVL, &keepinval, sizeof(int));
+            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(int));
+
+            send_timeout = 3000;
+            setsockopt(cli_fd, SOL_SOCKET, SO_SNDTIMEO, (const void *)&send_timeout, sizeof(send_timeout));
+
+            ling.l_onoff = 1;  // enable
+            ling.l_linger = 3; // in seconds
+            setsockopt(cli_fd, SOL_SOCKET, SO_LINGER, &ling, sizeof(ling));
+        }
+
+        cip_passth_info.passth_fd_idx = status;
     }
+}
 
+/*!
+    \brief      receive the data of a link into its receive ring and hand it to the host
+    \param[in]  idx: index of the link in cip_info
+    \param[out] none
+    \retval     1 if data may be left in the socket, 0 if the socket is drained or
+                the receive ring is full, -1 if the link has been closed
+*/
+static int cip_link_recv(int idx)
+{
+    client_info_t *cli = &cip_info.cli[idx];
+    struct sockaddr_in saddr;
+    int addr_sz = sizeof(saddr);
+    int fd = cli->fd;
+    uint16_t stamp = cip_sock_evt_stamp[fd - LWIP_SOCKET_OFFSET];
+    uint32_t room, min_len;
+    uint8_t *data;
+    int recv_sz, cnt;
+
+    /* a datagram larger than the room would be truncated */
+    min_len = (cli->type == CIP_TYPE_UDP) ? CIP_RX_UDP_MIN_ROOM : 1;
+    for (cnt = 0; cnt < CIP_RX_BURST; cnt++) {
+        data = cip_rx_ring_reserve(&cli->rx_ring, min_len, &room);
+        if (data == NULL) {
+            /* leave the data in the socket until the host reads the ring, the tcp window closes */
+            cli->rx_throttled = 1;
+            return 0;
+        }
 #ifdef CONFIG_ATCMD_SPI
-        // init recv data list
-        for (i = 0; i < MAX_CLIENT_NUM; i++) {
-            if (cip_info.cli[i].fd >= 0) {
-                list_init(&cip_info.cli[i].recv_data_list);
-                sys_mutex_init(&cip_info.cli[i].list_lock);
-            }
+        if (room > AT_SPI_MAX_DATA_LEN)
+            room = AT_SPI_MAX_DATA_LEN;
+#endif
+        if (cli->type == CIP_TYPE_TCP) {
+            recv_sz = recv(fd, data, room, MSG_DONTWAIT);
+        } else {
+            recv_sz = recvfrom(fd, data, room, MSG_DONTWAIT,
+                                (struct sockaddr *)&saddr, (socklen_t*)&addr_sz);
         }
+        //AT_TRACE("RX:%d, %d\r\n", fd, recv_sz);
+        if (recv_sz < 0) {
+            if (errno == EWOULDBLOCK)
+                return 0;
+            /* Recv error */
+            AT_TRACE("rx error %d\r\n", recv_sz);
+            if (errno == ECONNABORTED) {
+                AT_TRACE("connection aborted, maybe remote close.\r\n");
+            }
+            cip_info_cli_free(idx);
+            close(fd);
+            return -1;
+        } else if (recv_sz == 0) {
+            if (cli->type == CIP_TYPE_UDP)
+                continue;
+            AT_TRACE("remote close %d\r\n", fd);
+            close(fd);
+#ifndef CONFIG_ATCMD_SPI
+            if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
+                    cip_passth_info.passth_fd_idx == idx) {
+                cip_passth_info.terminate_send_passth = 1;
+            }
+#else
+            if (cip_info.trans_mode == CIP_TRANS_MODE_FILE_TRANSFER &&
+                    cip_file_trans_info.fd_idx == idx) {
+                cip_file_trans_info.terminate = 1;
+            }
 #endif
+            cip_info_cli_free(idx);
+            return -1;
+        }
 
-    rx_buf = sys_zalloc(rx_len);
-    if(NULL == rx_buf){
-        AT_TRACE("Allocate client buffer failed (len = %u).\r\n", rx_len);
-        goto Exit;
+        /* the data is dropped unless the host takes it in the current mode */
+#ifdef CONFIG_ATCMD_SPI
+        if (cip_info.trans_mode == CIP_TRANS_MODE_NORMAL) {
+            /* read by the host with AT+CIPRECVDATA */
+            cip_rx_ring_commit(&cli->rx_ring, recv_sz, stamp);
+        }
+#else
+        if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
+                cip_passth_info.passth_fd_idx == idx) {
+            AT_RSP_DIRECT((char *)data, recv_sz);
+        } else if (cip_info.trans_mode == CIP_TRANS_MODE_NORMAL) {
+            cip_ipd_send(fd, (char *)data, recv_sz);
+        } else {
+            continue;
+        }
+        cli->rx_stat.bytes += recv_sz;
+        cip_rx_stat_record(&cli->rx_stat, stamp);
+#endif
     }
 
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 200000;
+    return 1;
+}
+
+extern int dhcpd_ipaddr_is_valid(uint32_t ipaddr);
+/*!
+    \brief      receive task
+    \param[in]  param: the pointer of user parameter
+    \param[out] none
+    \retval     none
+*/
+static void cip_recv_task(void *param)
+{
+    union at_local_event evt;
+    os_queue_t evt_queue;
+    uint32_t ready;
+    int timeout = 0;
+    int i, fd;
+    int vif_idx = WIFI_VIF_INDEX_DEFAULT;
+    int close_fd = -1;
+#ifdef CONFIG_ATCMD_SPI
+    int rx_pending;
+#endif
+
+    /* the sockets may have received data before the task started */
+    sys_enter_critical();
+    cip_sock_ready |= cip_sock_watch;
+    sys_exit_critical();
 
-    cip_task_terminate = 0;
     while (1) {
+        if (sys_queue_read(&cip_evt_queue, &evt, timeout, false) == OS_OK)
+            cip_local_event_process(&evt);
         if (cip_task_terminate)
             break;
 
-        FD_ZERO(&read_set);
-        FD_ZERO(&except_set);
+        sys_enter_critical();
+        ready = cip_sock_ready;
+        cip_sock_ready = 0;
+        sys_exit_critical();
+
         if (cip_info.local_srv_fd >= 0) {
             if (cip_info.local_srv_stop == 0) {
-                FD_SET(cip_info.local_srv_fd, &read_set);
-                FD_SET(cip_info.local_srv_fd, &except_set);
-                if (cip_info.local_srv_fd > max_fd_num)
-                    max_fd_num = cip_info.local_srv_fd;
+                if (ready & CIP_SOCK_BIT(cip_info.local_srv_fd))
+                    cip_srv_accept();
             } else {
                 for (i = 0; i < MAX_CLIENT_NUM; i++) {
                     if ((cip_info.cli[i].fd >= 0) && (cip_info.cli[i].role == CIP_ROLE_SERVER)) {
@@ -1118,203 +1621,38 @@ static void cip_recv_task(void *param)
                 close_fd = cip_info.local_srv_fd;
                 cip_info.local_srv_fd = -1;
                 cip_info.local_srv_port = 0;
+                cip_sock_watch_set(close_fd, 0);
                 close(close_fd);
             }
         }
-        for (i = 0; i < MAX_CLIENT_NUM; i++) {
-            //if ((cip_info.cli[i].fd >= 0) && (cip_info.cli[i].type == CIP_TYPE_TCP)) {
-            if (cip_info.cli[i].fd >= 0) {
-                FD_SET(cip_info.cli[i].fd, &read_set);
-                FD_SET(cip_info.cli[i].fd, &except_set);
-                if (cip_info.cli[i].fd > max_fd_num)
-                    max_fd_num = cip_info.cli[i].fd;
-            }
-        }
-        FD_SET(local_sock_recv, &read_set);
-        if (local_sock_recv > max_fd_num) {
-            max_fd_num = local_sock_recv;
-        }
-        status = select(max_fd_num + 1, &read_set, NULL, &except_set, &timeout);
-        if ((cip_info.local_srv_fd >= 0) && FD_ISSET(cip_info.local_srv_fd, &read_set)) {
-            if (cip_info.cli_num >= MAX_CLIENT_NUM) {
-                AT_TRACE("client full\r\n");
-            } else {
-#ifndef CONFIG_ATCMD_SPI
-                if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
-                        cip_info_valid_tcp_fd_cnt_get() >= 1) {
-                    AT_TRACE("Only one TCP client is allowed in Passthrough mode\r\n");
-                } else {
-#endif
-                    /* waiting for an incoming TCP connection */
-                    /* accepts a connection form a TCP client, if there is any. otherwise returns SL_EAGAIN */
-                    cli_fd = accept(cip_info.local_srv_fd,
-                                    (struct sockaddr *)&saddr,
-                                    (socklen_t*)&addr_sz);
-                    if (cli_fd >= 0) {
-                        AT_TRACE("new client %d\r\n", cli_fd);
-                        status = cip_info_cli_store(cli_fd, "TCP", CIP_ROLE_SERVER,
-                                            saddr.sin_addr.s_addr, saddr.sin_port, cip_info.local_srv_port);
-                        if (status < 0) {
-                            AT_TRACE("Store client info error %d!\r\n", status);
-                            close(cli_fd);
-                        } else {
-                            setsockopt(cli_fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(int));
-                            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(int));
-                            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPINTVL, &keepinval, sizeof(int));
-                            setsockopt(cli_fd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(int));
-
-                            send_timeout = 3000;
-                            setsockopt(cli_fd, SOL_SOCKET, SO_SNDTIMEO, (const void *)&send_timeout, sizeof(send_timeout));
-
-                            ling.l_onoff = 1;  // enable
-                            ling.l_linger = 3; // in seconds
-                            setsockopt(cli_fd, SOL_SOCKET, SO_LINGER, &ling, sizeof(ling));
-                        }
-
-                        cip_passth_info.passth_fd_idx = status;
-                    } else {
-                        AT_TRACE("accept error %d!\r\n", errno);
-                    }
-#ifndef CONFIG_ATCMD_SPI
-                }
-#endif
-            }
-        }
-
-        if (FD_ISSET(local_sock_recv, &read_set)) {
-            sys_memset(local_recv_buf, 0, LOACL_RECV_BUF_SIZE);
-            local_recv_sz = recvfrom(local_sock_recv, local_recv_buf, LOACL_RECV_BUF_SIZE, 0, NULL, NULL);
-            if (local_recv_sz <= 0) {
-                AT_TRACE("recv data from local fail, %d!\r\n", errno);
-            } else {
-                if (*((uint16_t *)local_recv_buf) == AT_LOCAL_TCP_SNED_EVENT) {
-                    struct at_local_tcp_send *send_data_local = (struct at_local_tcp_send *)local_recv_buf;
-                    AT_RSP_START(128);
-TCP_RETRY_SEND:
-                    send_cnt = send(send_data_local->sock_fd, (void *)(send_data_local->send_data_addr), send_data_local->send_data_len, 0);
-                    if (send_cnt <= 0) {
-                        AT_TRACE("send data error. %d!\r\n", errno);
-                        if (errno == EAGAIN || errno == ENOMEM) {
-                            goto TCP_RETRY_SEND;
-                        }
-                        int idx = cip_info_cli_find(send_data_local->sock_fd);
-                        if ((idx != -1) && (cip_info.cli[idx].role == CIP_ROLE_CLIENT)) {
-                            cip_info_cli_free(idx);
-                            close(send_data_local->sock_fd);
-                            AT_TRACE("close tcp client. %d!\r\n", send_data_local->sock_fd);
-                        }
-                        AT_RSP("SEND FAIL\r\n");
-                        AT_RSP_ERR();
-                    } else {
-                        AT_RSP("SEND OK\r\n");
-                        AT_RSP_OK();
-                    }
-                    sys_mfree((void *)(send_data_local->send_data_addr));
-                } else if (*((uint16_t *)local_recv_buf) == AT_LOCAL_UDP_SNED_EVENT) {
-                    struct at_local_udp_send *send_data_local = (struct at_local_udp_send *)local_recv_buf;
-                    AT_RSP_START(128);
-UDP_RETRY_SEND:
-                    send_cnt = sendto(send_data_local->sock_fd, (void *)(send_data_local->send_data_addr), send_data_local->send_data_len,
-                                        0, (struct sockaddr *)&(send_data_local->to), send_data_local->tolen);
-                    if (send_cnt <= 0) {
-                        AT_TRACE("send data error. %d!\r\n", errno);
-                        if (errno == EAGAIN || errno == ENOMEM) {
-                            goto UDP_RETRY_SEND;
-                        }
-                        int idx = cip_info_cli_find(send_data_local->sock_fd);
-                        cip_info_cli_free(idx);
-                        close(send_data_local->sock_fd);
-                        AT_TRACE("close udp client. %d!\r\n", send_data_local->sock_fd);
-                        AT_RSP("SEND FAIL\r\n");
-                        AT_RSP_ERR();
-                    } else {
-                        AT_RSP("SEND OK\r\n");
-                        AT_RSP_OK();
-                    }
-                    sys_mfree((void *)(send_data_local->send_data_addr));
-                } else {
-                    AT_TRACE("unvalid loacl event.\r\n");
-                }
-            }
-        }
-        /*if ((cip_info.local_srv_fd >= 0) && FD_ISSET(cip_info.local_srv_fd, &except_set)) {
-            tcp_server_stop();
-        }*/
-        for (i = 0; i < MAX_CLIENT_NUM; i++) {
-            if ((cip_info.cli[i].fd >= 0) && FD_ISSET(cip_info.cli[i].fd, &read_set)) {
-                sys_memset(rx_buf, 0, rx_len);
-                if (cip_info.cli[i].type == CIP_TYPE_TCP) {
-                    recv_sz = recv(cip_info.cli[i].fd, rx_buf, rx_len, 0);
-                } else {
-                    sys_memset(&saddr, 0, sizeof(saddr));
-                    recv_sz = recvfrom(cip_info.cli[i].fd, rx_buf, rx_len,
-                                        0, (struct sockaddr *)&saddr, (socklen_t*)&addr_sz);
-                }
-                //AT_TRACE("RX:%d, %d\r\n", cip_info.cli[i].fd, recv_sz);
-                if (recv_sz < 0) { /* Recv error */
-                    AT_TRACE("rx error %d\r\n", recv_sz);
-                    if (errno == ECONNABORTED) {
-                        AT_TRACE("connection aborted, maybe remote close.\r\n");
-                    }
-                    close_fd = cip_info.cli[i].fd;
-                    cip_info_cli_free(i);
-                    close(close_fd);
-                } else if (recv_sz == 0) {
-                    AT_TRACE("remote close %d\r\n", cip_info.cli[i].fd);
-                    close(cip_info.cli[i].fd);
-#ifndef CONFIG_ATCMD_SPI
-                    if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
-                            cip_passth_info.passth_fd_idx == i) {
-                        cip_passth_info.terminate_send_passth = 1;
-                    }
-#else
-                    if (cip_info.trans_mode == CIP_TRANS_MODE_FILE_TRANSFER &&
-                            cip_file_trans_info.fd_idx == i) {
-                        cip_file_trans_info.terminate = 1;
-                    }
-#endif
-                    cip_info_cli_free(i);
-                } else {
 #ifdef CONFIG_ATCMD_SPI
-                    // Discard packets during file transfer
-                    if (cip_info.trans_mode == CIP_TRANS_MODE_FILE_TRANSFER &&
-                        cip_file_trans_info.terminate == 1)
-                        break;
-#else
-                    if (cip_info.trans_mode == CIP_TRANS_MODE_PASSTHROUGH &&
-                            cip_passth_info.passth_fd_idx == i) {
-                        AT_RSP_DIRECT(rx_buf, recv_sz);
-                    }
+        rx_pending = 0;
 #endif
-                    if (cip_info.trans_mode == CIP_TRANS_MODE_NORMAL) {
-#ifdef CONFIG_ATCMD_SPI
-                        at_spi_recv_data_process(i, (uint8_t *)rx_buf, recv_sz);
-#else
-                        AT_RSP_START(64 + recv_sz);
-                        AT_RSP("+IPD,%d,%d: ", cip_info.cli[i].fd, recv_sz);
-                        for (j = 0; j < recv_sz; j++)
-                            AT_RSP("%c", rx_buf[j]);
-                        AT_RSP("\r\n");
-                        AT_RSP_OK();
-#endif
-                    }
-                }
+        for (i = 0; i < MAX_CLIENT_NUM; i++) {
+            fd = cip_info.cli[i].fd;
+            if ((fd >= 0) && (ready & CIP_SOCK_BIT(fd)) && !cip_info.cli[i].rx_throttled) {
+                /* serve the other links before coming back to this one */
+                if (cip_link_recv(i) > 0)
+                    cip_sock_set_ready(fd);
             }
-            if ((cip_info.cli[i].fd >= 0) && (FD_ISSET(cip_info.cli[i].fd, &except_set) ||
-                (wifi_vif_is_softap(vif_idx) && !dhcpd_ipaddr_is_valid(cip_info.cli[i].remote_ip)))) {
+            if ((cip_info.cli[i].fd >= 0) &&
+                (wifi_vif_is_softap(vif_idx) && !dhcpd_ipaddr_is_valid(cip_info.cli[i].remote_ip))) {
                 close_fd = cip_info.cli[i].fd;
                 AT_TRACE("error %d\r\n", cip_info.cli[i].fd);
                 cip_info_cli_free(i);
                 close(close_fd);
             }
 #ifdef CONFIG_ATCMD_SPI
-            sys_enter_critical();
-            if (!list_is_empty(&cip_info.cli[i].recv_data_list) && at_spi_hw_is_idle()) {
-                spi_handshake_rising_trigger();
-                if (spi_nss_status_get() == RESET)
-                    printf("nss corner case\r\n");
+            if (!cip_rx_ring_is_empty(&cip_info.cli[i].rx_ring)) {
+                rx_pending = 1;
+                sys_enter_critical();
+                if (at_spi_hw_is_idle()) {
+                    spi_handshake_rising_trigger();
+                    if (spi_nss_status_get() == RESET)
+                        printf("nss corner case\r\n");
+                }
+                sys_exit_critical();
             }
-            sys_exit_critical();
 #endif
             if ((cip_info.cli[i].fd >= 0) && (cip_info.cli[i].stop_flag == 1)) {
                 close_fd = cip_info.cli[i].fd;
@@ -1323,6 +1661,15 @@ UDP_RETRY_SEND:
                 AT_TRACE("close %d.\r\n", close_fd);
             }
         }
+
+        /* wait for the next socket event, or check the links from time to time */
+        timeout = CIP_RECV_IDLE_MS;
+#ifdef CONFIG_ATCMD_SPI
+        if (rx_pending)
+            timeout = CIP_RECV_SPI_PEND_MS;
+#endif
+        if (cip_sock_ready)
+            timeout = 0;
     }
 
     /* Exit */
@@ -1339,18 +1686,72 @@ UDP_RETRY_SEND:
     cip_info.local_srv_fd = -1;
     cip_info.local_srv_port = 0;
 
-    sys_mfree(rx_buf);
+    sys_enter_critical();
+    cip_sock_watch = 0;
+    cip_sock_ready = 0;
+    evt_queue = cip_evt_queue;
+    cip_evt_queue = NULL;
+    sys_exit_critical();
+    /* drop the send requests not processed */
+    while (sys_queue_read(&evt_queue, &evt, 0, false) == OS_OK) {
+        if (evt.event_id == AT_LOCAL_TCP_SNED_EVENT)
+            sys_mfree((void *)evt.tcp_send.send_data_addr);
+        else if (evt.event_id == AT_LOCAL_UDP_SNED_EVENT)
+            sys_mfree((void *)evt.udp_send.send_data_addr);
+    }
+    sys_queue_free(&evt_queue);
 
-Exit:
-    if (local_sock_send >= 0) {
-        shutdown(local_sock_send, SHUT_RD);
-        close(local_sock_send);
+    sys_task_delete(NULL);
+}
+
+/*!
+    \brief      start the receive task if it is not running
+    \param[in]  none
+    \param[out] none
+    \retval     0 on success, -1 otherwise
+*/
+static int cip_recv_task_start(void)
+{
+    os_queue_t evt_queue = NULL;
+
+    if (cip_task_started)
+        return 0;
+
+    if (sys_queue_init(&evt_queue, CIP_RECV_QUEUE_SIZE, sizeof(union at_local_event)) != OS_OK)
+        return -1;
+    sys_enter_critical();
+    cip_evt_queue = evt_queue;
+    sys_exit_critical();
+
+    cip_task_terminate = 0;
+    if (sys_task_create_dynamic((const uint8_t *)"Cip Rcv",
+                    CIP_RECV_STACK_SIZE, CIP_RECV_PRIO,
+                    (task_func_t)cip_recv_task, NULL) == NULL) {
+        sys_enter_critical();
+        cip_evt_queue = NULL;
+        sys_exit_critical();
+        sys_queue_free(&evt_queue);
+        return -1;
     }
-    if (local_sock_recv >= 0) {
-        shutdown(local_sock_recv, SHUT_RD);
-        close(local_sock_recv);
+    cip_task_started = 1;
+
+    return 0;
+}
+
+/*!
+    \brief      stop the receive task and wait for its end, the task closes all links
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void cip_recv_task_stop(void)
+{
+    cip_task_terminate = 1;
+    cip_recv_task_wakeup();
+    while (sys_task_exist((const uint8_t *)"Cip Rcv")) {
+        sys_ms_sleep(1);
     }
-    sys_task_delete(NULL);
+    cip_task_started = 0;
 }
 
 /*!
@@ -1491,13 +1892,8 @@ void at_cip_start(int argc, char **argv)
         } else {
             goto Error;
         }
-        if (cip_task_started == 0) {
-            if (sys_task_create_dynamic((const uint8_t *)"Cip Rcv",
-                            CIP_RECV_STACK_SIZE, CIP_RECV_PRIO,
-                            (task_func_t)cip_recv_task, NULL) == NULL)
-                goto Error;
-            cip_task_started = 1;
-        }
+        if (cip_recv_task_start() < 0)
+            goto Error;
     } else {
         goto Error;
     }
@@ -1814,8 +2210,10 @@ void at_cip_recvdata(int argc, char **argv)
 {
     int recv_len;
     int fd = -1, idx = -1;
-    struct recv_data_node *p_item;
-    uint8_t *data_remain = NULL;
+    client_info_t *cli;
+    uint8_t *data;
+    uint32_t rec_len, len;
+    uint16_t stamp;
 
     AT_RSP_START(AT_SPI_MAX_DATA_LEN + 30);
     if (argc == 2) {
@@ -1824,7 +2222,7 @@ void at_cip_recvdata(int argc, char **argv)
         } else {
             for (idx = 0; idx < MAX_CLIENT_NUM; idx++) {
                 if (cip_info.cli[idx].fd >= 0) {
-                    if (!list_is_empty(&cip_info.cli[idx].recv_data_list)) {
+                    if (!cip_rx_ring_is_empty(&cip_info.cli[idx].rx_ring)) {
                         fd = cip_info.cli[idx].fd; // when found the first fd's recv data is not none, break
                         break;
                     }
@@ -1838,44 +2236,31 @@ void at_cip_recvdata(int argc, char **argv)
                     goto Error;
                 }
 
-                sys_mutex_get(&cip_info.cli[idx].list_lock);
-                p_item = (struct recv_data_node *)list_pop_front(&cip_info.cli[idx].recv_data_list);
-
-                if ((p_item != NULL) && p_item->data && (p_item->data_len > 0)) {
-                    if (p_item->data_len <= recv_len) { // data length is smaller than request data length
-                        AT_RSP("+CIPRECVDATA:%d,%d,", fd, p_item->data_len);
-
-                        // copy data to AT_RSP
-                        sys_memcpy((rsp_buf + rsp_buf_idx), p_item->data, p_item->data_len);
-                        rsp_buf_idx += p_item->data_len;
-
-                        // AT_TRACE("CIPRECVDATA,len:%d\r\n", p_item->data_len);
-                        sys_mfree(p_item->data);
-                        sys_mfree(p_item);
-                    } else {                            // data length is larger than request data length
-                        AT_RSP("+CIPRECVDATA:%d,%d,", fd, recv_len);
-
-                        // copy data to AT_RSP
-                        sys_memcpy(rsp_buf + rsp_buf_idx, p_item->data, p_item->data_len);
-                        rsp_buf_idx += p_item->data_len;
-                        // AT_TRACE("CIPRECVDATA, len:%d\r\n", recv_len);
-
-                        // copy remain data to a new buff, and then add it to list header again.
-                        data_remain = sys_malloc(p_item->data_len - recv_len);
-                        if (data_remain == NULL) {
-                            AT_TRACE("data_remain malloc failed, len:%d\r\n", (p_item->data_len - recv_len));
-                            sys_mfree(p_item->data); // when malloc fail, drop this data
-                            sys_mfree(p_item);
-                            goto Error;
-                        }
-                        sys_memcpy(data_remain, (p_item->data + recv_len), (p_item->data_len - recv_len));
-                        sys_mfree(p_item->data);
-                        p_item->data = data_remain;
-                        p_item->data_len = (p_item->data_len - recv_len);
-                        list_push_front(&cip_info.cli[idx].recv_data_list, &p_item->list_hdr);
-                    }
+                cli = &cip_info.cli[idx];
+                sys_mutex_get(&cli->rx_lock);
+                data = cip_rx_ring_peek(&cli->rx_ring, &rec_len, &stamp);
+                if (data != NULL) {
+                    if (cli->rx_ring.rec_off == 0)
+                        cip_rx_stat_record(&cli->rx_stat, stamp);
+                    // a record larger than the request is read in several times
+                    len = MIN(rec_len - cli->rx_ring.rec_off, (uint32_t)recv_len);
+                    AT_RSP("+CIPRECVDATA:%d,%d,", fd, len);
+
+                    // copy data to AT_RSP
+                    sys_memcpy((rsp_buf + rsp_buf_idx), data + cli->rx_ring.rec_off, len);
+                    rsp_buf_idx += len;
+                    cli->rx_stat.bytes += len;
+                    cip_rx_ring_consume(&cli->rx_ring, rec_len, len);
+                }
+                sys_mutex_put(&cli->rx_lock);
+
+                // room is available again for the data left in the socket
+                if (cli->rx_throttled) {
+                    cli->rx_throttled = 0;
+                    cip_sock_set_ready(fd);
                 }
-                sys_mutex_put(&cip_info.cli[idx].list_lock);
+                // let the receive task signal the data still pending
+                cip_recv_task_wakeup();
             } else {
                 AT_RSP("+CIPRECVDATA:-1,0");
             }
@@ -1938,13 +2323,8 @@ void at_cip_server(int argc, char **argv)
                 if (tcp_server_start(port) < 0) {
                     goto Error;
                 }
-                if (cip_task_started == 0) {
-                    if (sys_task_create_dynamic((const uint8_t *)"Cip Rcv",
-                                    CIP_RECV_STACK_SIZE, CIP_RECV_PRIO,
-                                    (task_func_t)cip_recv_task, NULL) == NULL)
-                        goto Error;
-                    cip_task_started = 1;
-                }
+                if (cip_recv_task_start() < 0)
+                    goto Error;
             } else {
                 tcp_server_stop();
             }
@@ -2009,12 +2389,9 @@ void at_cip_close(int argc, char **argv)
             }
             if (active_sock_num > 1) {
                 cip_info.cli[found].stop_flag = 1;
+                cip_recv_task_wakeup();
             } else {
-                cip_task_terminate = 1;
-                while (sys_task_exist((const uint8_t *)"Cip Rcv")) {
-                    sys_ms_sleep(1);
-                }
-                cip_task_started = 0;
+                cip_recv_task_stop();
             }
         }
     } else {
@@ -2045,8 +2422,10 @@ void at_cip_status(int argc, char **argv)
     int i = 0;
     char type[4];
     int vif_idx = WIFI_VIF_INDEX_DEFAULT;
+    cip_rx_stat_t *stat;
+    uint32_t elapsed;
 
-    AT_RSP_START(512);
+    AT_RSP_START(64 + MAX_CLIENT_NUM * 128);
     if (argc == 1) {
         if (wifi_vif_is_sta_connected(vif_idx)) {
             if (cip_info.cli_num > 0) {
@@ -2069,6 +2448,14 @@ void at_cip_status(int argc, char **argv)
                 AT_RSP("+CIPSTATUS:%d,%s,"IP_FMT",%d,%d,%d\r\n",
                         cip_info.cli[i].fd, type, IP_ARG(cip_info.cli[i].remote_ip),
                         cip_info.cli[i].remote_port, cip_info.cli[i].local_port, cip_info.cli[i].role);
+                /* <fd>,<rx bytes>,<rx bytes/s>,<rx records>,<avg latency ms>,<max latency ms> */
+                stat = &cip_info.cli[i].rx_stat;
+                elapsed = sys_current_time_get() - stat->start_time;
+                AT_RSP("+CIPRXSTAT:%d,%u,%u,%u,%u,%u\r\n",
+                        cip_info.cli[i].fd, stat->bytes,
+                        elapsed ? (uint32_t)(((uint64_t)stat->bytes * 1000) / elapsed) : 0,
+                        stat->records, stat->records ? (stat->lat_sum / stat->records) : 0,
+                        stat->lat_max);
             }
         }
     } else {
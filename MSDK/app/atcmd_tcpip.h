@@ -43,13 +43,24 @@ OF SUCH DAMAGE.
 #define CIP_TYPE_UDP                 1
 #define CIP_ROLE_CLIENT              0
 #define CIP_ROLE_SERVER              1
-#define MAX_CLIENT_NUM               (MEMP_NUM_NETCONN - 1 - 2)  /* Reserved 1 netconn for tcp server, 2 for local socket */
+#define MAX_CLIENT_NUM               (MEMP_NUM_NETCONN - 1)  /* Reserved 1 netconn for tcp server */
 
 #define CIP_RECV_STACK_SIZE          512
 #define CIP_RECV_PRIO                OS_TASK_PRIORITY(1)
+#define CIP_RECV_QUEUE_SIZE          8
+#define CIP_RECV_IDLE_MS             1000 //ms, period of the link checks when no event is received
+#define CIP_RECV_SPI_PEND_MS         200  //ms, period of the SPI handshake retrigger while data is pending
 
 #define PASSTH_TX_BUF_LEN               8192
-#define PASSTH_START_TRANSFER_LEN       2920
+#define PASSTH_TX_BLK_LEN               1024    /* one DMA transfer */
+#define PASSTH_TX_BLK_NUM               (PASSTH_TX_BUF_LEN / PASSTH_TX_BLK_LEN)
+#define PASSTH_START_TRANSFER_LEN       2920    /* largest coalesced send, largest udp datagram */
+#define PASSTH_FLUSH_MIN_LEN            64
+#ifndef PASSTH_GUARD_MS
+#define PASSTH_GUARD_MS                 20      /* pause after a lone "+++" that ends the passthrough, ms */
+#endif
+#define PASSTH_SEND_RETRY_MS            2       //ms
+#define PASSTH_SEND_TIMEOUT             3000    //ms
 #define PASSTH_TERMINATE_STR            "+++"
 #define CIP_TRANSFER_INTERVAL_DEFAULT   20 //ms
 
@@ -71,7 +82,35 @@ typedef enum _mux_mode {
     CIP_MUX_MODE_MULTIPLE,
 } mux_mode_t;
 
-#define MAX_RECV_DATA_NUM_IN_LIST 20
+#ifdef CONFIG_ATCMD_SPI
+#define AT_SPI_MAX_DATA_LEN         2048
+#define CIP_RX_RING_SIZE            (4 * AT_SPI_MAX_DATA_LEN)
+#else
+#define CIP_RX_RING_SIZE            PASSTH_START_TRANSFER_LEN
+#endif
+#define CIP_RX_REC_HDR_LEN          4       /* length and event time stamp of a record */
+#define CIP_RX_REC_WRAP             0xFFFF  /* record length marking the end of the ring data */
+#define CIP_RX_UDP_MIN_ROOM         1500    /* room needed to receive a whole datagram */
+
+/* Receive ring of a link, a sequence of records {len, stamp, data} */
+typedef struct _cip_rx_ring {
+    uint8_t            *buf;
+    uint32_t            size;
+    volatile uint32_t   rd;
+    volatile uint32_t   wr;
+    uint32_t            rsv;        /* position of the record being received */
+    uint32_t            rec_off;    /* bytes of the first record already read by the host */
+} cip_rx_ring_t;
+
+/* Receive statistics of a link, reported by AT+CIPSTATUS */
+typedef struct _cip_rx_stat {
+    uint32_t    start_time;     /* ms */
+    uint32_t    bytes;          /* bytes handed to the host */
+    uint32_t    records;        /* receive records handed to the host */
+    uint32_t    lat_sum;        /* ms, socket event to host handoff */
+    uint32_t    lat_max;        /* ms */
+} cip_rx_stat_t;
+
 typedef struct _client_info {
     int         fd;
     uint8_t     type;
@@ -80,9 +119,11 @@ typedef struct _client_info {
     uint32_t    remote_ip;
     uint16_t    remote_port;
     uint16_t    local_port;
+    uint8_t     rx_throttled;
+    cip_rx_ring_t rx_ring;
+    cip_rx_stat_t rx_stat;
 #ifdef CONFIG_ATCMD_SPI
-    struct list recv_data_list;
-    os_mutex_t  list_lock;
+    os_mutex_t  rx_lock;
 #endif
 } client_info_t;
 
@@ -96,19 +137,11 @@ typedef struct _cip_info {
     uint32_t        cli_num;
 } cip_info_t;
 
-#ifdef CONFIG_ATCMD_SPI
-#define AT_SPI_MAX_DATA_LEN         2048
-struct recv_data_node {
-    struct list_hdr list_hdr;
-    uint8_t *data;
-    size_t  data_len;
-};
-#endif
-
 enum at_local_event_id
 {
     AT_LOCAL_TCP_SNED_EVENT = 1,
     AT_LOCAL_UDP_SNED_EVENT = 2,
+    AT_LOCAL_WAKEUP_EVENT = 3,
     AT_LOCAL_MAX_EVENT_IDX
 };
 
@@ -128,6 +161,12 @@ struct at_local_udp_send {
     socklen_t tolen;
 };
 
+union at_local_event {
+    uint16_t event_id;
+    struct at_local_tcp_send tcp_send;
+    struct at_local_udp_send udp_send;
+};
+
 void cip_info_init(void);
 void at_cip_ping(int argc, char **argv);
 void at_cip_sta_ip(int argc, char **argv);
@@ -56,6 +56,7 @@ OF SUCH DAMAGE.
 #include "log_uart.h"
 #include "wakelock.h"
 #include "trace_uart.h"
+#include "raw_flash_api.h"
 #ifdef CONFIG_OTA_DEMO_SUPPORT
 #include "ota_demo.h"
 #endif
@@ -467,6 +468,22 @@ static void cmd_cpu_stats(int argc, char **argv)
     sys_cpu_stats();
 }
 
+static void cmd_flash_stats(int argc, char **argv)
+{
+    uint32_t max_us, last_us;
+
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        raw_flash_irq_latency_reset();
+        return;
+    } else if (argc != 1) {
+        app_print("Usage: flash_stats [reset]\r\n");
+        return;
+    }
+
+    raw_flash_irq_latency_get(&max_us, &last_us);
+    app_print("flash irq masked: max %u us, last %u us\r\n", max_us, last_us);
+}
+
 static void cmd_read_memory(int argc, char **argv)
 {
     char *endptr = NULL;
@@ -1827,6 +1844,7 @@ void cmd_fatfs(int argc, char **argv)
     app_print("    fatfs rename <path/filename> <[path/]new filename>\r\n");
     app_print("    fatfs delete <path | path/filename>\r\n");
     app_print("    fatfs show   [dir]\r\n");
+    app_print("    fatfs format (erase all files)\r\n");
     app_print("    Example: fatfs creat a/b/c/d/ | fatfs creat a/b/c/d.txt\r\n");
 }
 #endif
@@ -1844,6 +1862,7 @@ static const struct cmd_entry cmd_table[] =
     {"sys_ps", cmd_sys_ps},
     {"cpu_stats", cmd_cpu_stats},
     {"rmem", cmd_read_memory},
+    {"flash_stats", cmd_flash_stats},
     {"ps_stats", cmd_ps_stats},
 #ifdef CFG_WLAN_SUPPORT
     {"ping", cmd_ping},
@@ -39,7 +39,9 @@ OF SUCH DAMAGE.
 #include "config_gdm32.h"
 
 #include "rom_export.h"
+#include "rom_export_mbedtls.h"
 #include "raw_flash_api.h"
+#include "nvds_flash.h"
 #include "app_cfg.h"
 #include "dbg_print.h"
 #include "ota_demo.h"
@@ -47,7 +49,13 @@ OF SUCH DAMAGE.
 #ifdef CONFIG_OTA_DEMO_SUPPORT
 
 #define HTTP_GET_MAX_LEN            1024
-#define RECBUFFER_LEN               1516
+#define OTA_BUF_LEN                 4096
+#define OTA_BUF_NUM                 3
+#define OTA_ERASE_AHEAD             (2 * FLASH_PAGE_SIZE)
+#define OTA_PROGRESS_INTERVAL       (64 * 1024)
+#define OTA_ETAG_MAX_LEN            64
+#define OTA_RETRY_MAX               5
+#define OTA_RETRY_DELAY             2000
 #define INVALID_SOCKET              (-1)
 #define OTA_SOCKET_RECV_TIMEOUT     60000
 
@@ -63,6 +71,25 @@ struct ota_srv_cfg {
 };
 static struct ota_srv_cfg ota_demo_cfg;
 
+/* Download progress kept in NVDS so that an interrupted OTA resumes with a Range request */
+#define OTA_NVDS_NAMESPACE          "ota"
+#define OTA_NVDS_KEY_PROGRESS       "progress"
+#define OTA_PROGRESS_MAGIC          0x4F544150
+
+struct ota_progress {
+    uint32_t magic;
+    char host[IP4ADDR_STRLEN_MAX];
+    char image_url[OTA_IMAGE_URL_MAX_LEN];
+    char etag[OTA_ETAG_MAX_LEN];
+    uint32_t img_addr;                  // flash offset of the slot being written
+    uint32_t img_len;                   // total length of the image
+    uint32_t committed;                 // bytes written and hashed, page aligned
+    uint32_t hash_len;
+    uint32_t tlv_len;
+    mbedtls_sha256_context sha256;      // hash state after the committed bytes
+};
+static struct ota_progress ota_prog;
+
 /**
  ****************************************************************************************
  * @brief Initialize the remote OTA server
@@ -228,6 +255,39 @@ static int32_t http_body_len(uint8_t *httpbuf)
     return bodylen;
 }
 
+/**
+ ****************************************************************************************
+ * @brief Get the value of a http responses header field
+ *
+ * @param[in]  httpbuf    Pointer to the http responses string
+ * @param[in]  name       Header field name, including the ':'
+ * @param[out] value      Buffer to store the value
+ * @param[in]  size       Size of the value buffer
+ * @return     Length of the value, -1 if not found or too long
+ ****************************************************************************************
+ */
+static int32_t http_hdr_field(uint8_t *httpbuf, const char *name, char *value, uint32_t size)
+{
+    char *p_start = NULL;
+    char *p_end = NULL;
+    int32_t hdr_len = http_hdr_len(httpbuf);
+
+    p_start = lwip_strnistr((char *)httpbuf, name, hdr_len);
+    if (p_start == NULL)
+        return -1;
+    p_start += strlen(name);
+    while (*p_start == ' ')
+        p_start++;
+    p_end = strstr(p_start, TERM);
+    if (p_end == NULL || (p_end - p_start) >= size)
+        return -1;
+
+    sys_memcpy(value, p_start, (p_end - p_start));
+    value[p_end - p_start] = '\0';
+
+    return (p_end - p_start);
+}
+
 /**
  ****************************************************************************************
  * @brief Send get http responses image information
@@ -235,13 +295,16 @@ static int32_t http_body_len(uint8_t *httpbuf)
  * @param[in] sid         Http socket id
  * @param[in] host        Pointer to the http host
  * @param[in] port        Pointer to the bin url
+ * @param[in] offset      Offset to resume the download from, 0 for the whole image
+ * @param[in] etag        ETag of the partially downloaded image, checked with If-Range
  * @return    Status code to know if processing is succeed or not
                -1         Malloc failed
                -2         Send failed
                 0         Run success
  ****************************************************************************************
  */
-static int32_t http_req_image(int32_t sid, char *host, uint16_t port, char *url)
+static int32_t http_req_image(int32_t sid, char *host, uint16_t port, char *url,
+                              uint32_t offset, char *etag)
 {
     char *getBuf = NULL;
     int32_t totalLen = 0;
@@ -251,9 +314,17 @@ static int32_t http_req_image(int32_t sid, char *host, uint16_t port, char *url)
     if (getBuf == NULL)
         return -1;
 
-    snprintf(getBuf, HTTP_GET_MAX_LEN, "%s /%s %s%s%s%s:%d%s%s%s",
+    totalLen = snprintf(getBuf, HTTP_GET_MAX_LEN, "%s /%s %s%s%s%s:%d%s",
                                         "GET", url, "HTTP/1.1", TERM,
-                                        "Host:", host, port, TERM,
+                                        "Host:", host, port, TERM);
+    if (offset) {
+        totalLen += snprintf(getBuf + totalLen, HTTP_GET_MAX_LEN - totalLen,
+                             "Range: bytes=%u-%s", offset, TERM);
+        if (etag[0])
+            totalLen += snprintf(getBuf + totalLen, HTTP_GET_MAX_LEN - totalLen,
+                                 "If-Range: %s%s", etag, TERM);
+    }
+    snprintf(getBuf + totalLen, HTTP_GET_MAX_LEN - totalLen, "%s%s",
                                         "Connection: keep-alive\r\n", ENDING);
 
     app_print("Send: %s", getBuf);
@@ -268,117 +339,482 @@ static int32_t http_req_image(int32_t sid, char *host, uint16_t port, char *url)
     return ret;
 }
 
+/*
+ * OTA download pipeline: the OTA task receives into OTA_BUF_NUM buffers
+ * while the writer task erases the slot ahead of the write pointer, writes
+ * the filled buffers and hashes the image on the fly.
+ */
+struct ota_buf {
+    uint8_t *data;
+    uint32_t len;
+};
+
+struct ota_pipe {
+    os_queue_t free_q;                  // empty buffers, to the OTA task
+    os_queue_t full_q;                  // filled buffers, to the writer task, NULL ends the stream
+    os_sema_t done;
+    struct ota_buf bufs[OTA_BUF_NUM];
+
+    uint32_t img_addr;                  // flash offset of the slot being written
+    uint32_t img_len;                   // length of the HTTP body
+    uint32_t write_off;                 // bytes written to the slot
+    uint32_t erase_off;                 // bytes erased in the slot
+    uint32_t saved_off;                 // bytes recorded in the NVDS progress
+    int32_t status;                     // first error of the writer task
+
+    mbedtls_sha256_context sha256;
+    uint32_t hash_len;                  // bytes covered by the image digest, whole body if no header
+    uint32_t tlv_len;                   // size of the image PTLVs, 0 if no image header
+
+    /* Time spent in each stage, in ms */
+    uint32_t t_recv;
+    uint32_t t_wait;
+    uint32_t t_erase;
+    uint32_t t_write;
+    uint32_t t_hash;
+};
+
+/**
+ ****************************************************************************************
+ * @brief Load the download progress of an interrupted OTA
+ *
+ * @param[in] img_addr    Flash offset of the slot to write
+ * @return    Offset to resume the download from, 0 if there is nothing to resume
+ ****************************************************************************************
+ */
+static uint32_t ota_progress_load(uint32_t img_addr)
+{
+    uint32_t len = sizeof(ota_prog);
+
+    if (nvds_data_get(NULL, OTA_NVDS_NAMESPACE, OTA_NVDS_KEY_PROGRESS, (uint8_t *)&ota_prog, &len)
+        || len != sizeof(ota_prog) || ota_prog.magic != OTA_PROGRESS_MAGIC
+        || ota_prog.img_addr != img_addr || ota_prog.committed >= ota_prog.img_len
+        || strcmp(ota_prog.host, ota_demo_cfg.host) || strcmp(ota_prog.image_url, ota_demo_cfg.image_url)) {
+        sys_memset(&ota_prog, 0, sizeof(ota_prog));
+        return 0;
+    }
+
+    return ota_prog.committed;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Record in NVDS the bytes written so far and the hash state after them
+ *
+ * @param[in] pipe        Pointer to the OTA pipeline
+ ****************************************************************************************
+ */
+static void ota_progress_save(struct ota_pipe *pipe)
+{
+    ota_prog.committed = pipe->write_off;
+    ota_prog.hash_len = pipe->hash_len;
+    ota_prog.tlv_len = pipe->tlv_len;
+    sys_memcpy(&ota_prog.sha256, &pipe->sha256, sizeof(ota_prog.sha256));
+
+    if (nvds_data_put(NULL, OTA_NVDS_NAMESPACE, OTA_NVDS_KEY_PROGRESS,
+                      (uint8_t *)&ota_prog, sizeof(ota_prog)) == NVDS_OK)
+        pipe->saved_off = pipe->write_off;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Erase the next flash page of the OTA slot
+ *
+ * @param[in] pipe        Pointer to the OTA pipeline
+ * @return    0 on success, -5 if the erase failed
+ ****************************************************************************************
+ */
+static int32_t ota_pipe_erase(struct ota_pipe *pipe)
+{
+    uint32_t start = sys_current_time_get();
+    int32_t ret;
+
+    ret = raw_flash_erase(pipe->img_addr + pipe->erase_off, FLASH_PAGE_SIZE);
+    pipe->t_erase += sys_current_time_get() - start;
+    if (ret != 0)
+        return -5;
+
+    pipe->erase_off += FLASH_PAGE_SIZE;
+    return 0;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Write one filled buffer to the OTA slot and add it to the image hash
+ *
+ * @param[in] pipe        Pointer to the OTA pipeline
+ * @param[in] buf         Buffer to write
+ * @return    0 on success, -5 if the flash erase or write failed
+ ****************************************************************************************
+ */
+static int32_t ota_pipe_write(struct ota_pipe *pipe, struct ota_buf *buf)
+{
+    uint32_t end = pipe->write_off + buf->len;
+    uint32_t start, hash_len;
+    struct image_header *hdr;
+    int32_t ret;
+
+    while (pipe->erase_off < end) {
+        ret = ota_pipe_erase(pipe);
+        if (ret != 0)
+            return ret;
+    }
+
+    start = sys_current_time_get();
+    ret = raw_flash_write_fast(pipe->img_addr + pipe->write_off, buf->data, buf->len);
+    pipe->t_write += sys_current_time_get() - start;
+    if (ret != 0)
+        return -5;
+
+    if (pipe->write_off == 0 && buf->len >= IMG_HEADER_SIZE) {
+        /* The digest TLV of a signed image covers its header and body */
+        hdr = (struct image_header *)buf->data;
+        if (hdr->magic_h == IMG_MAGIC_H && hdr->algo_hash == IMG_HASH_SHA256
+            && (hdr->hdr_sz + hdr->img_sz + hdr->ptlv_sz) <= pipe->img_len) {
+            pipe->hash_len = hdr->hdr_sz + hdr->img_sz;
+            pipe->tlv_len = hdr->ptlv_sz;
+        }
+    }
+
+    if (pipe->write_off < pipe->hash_len) {
+        hash_len = (end > pipe->hash_len) ? (pipe->hash_len - pipe->write_off) : buf->len;
+        start = sys_current_time_get();
+        mbedtls_sha256_update(&pipe->sha256, buf->data, hash_len);
+        pipe->t_hash += sys_current_time_get() - start;
+    }
+
+    pipe->write_off = end;
+    return 0;
+}
+
+/**
+ ****************************************************************************************
+ * @brief OTA writer task, pre-erases the slot while no buffer is pending
+ *
+ * @param[in] param       Pointer to the OTA pipeline
+ ****************************************************************************************
+ */
+static void ota_writer_task(void *param)
+{
+    struct ota_pipe *pipe = (struct ota_pipe *)param;
+    struct ota_buf *buf;
+    int32_t ret;
+
+    while (1) {
+        if (sys_queue_read(&pipe->full_q, &buf, 0, false)) {
+            if (pipe->status == 0 && pipe->erase_off < pipe->img_len
+                && pipe->erase_off < pipe->write_off + OTA_ERASE_AHEAD) {
+                ret = ota_pipe_erase(pipe);
+                if (ret != 0)
+                    pipe->status = ret;
+                continue;
+            }
+            sys_queue_read(&pipe->full_q, &buf, -1, false);
+        }
+
+        if (buf == NULL)
+            break;
+
+        if (pipe->status == 0) {
+            ret = ota_pipe_write(pipe, buf);
+            if (ret != 0)
+                pipe->status = ret;
+            else if ((pipe->write_off - pipe->saved_off) >= OTA_PROGRESS_INTERVAL
+                     && (pipe->write_off % FLASH_PAGE_SIZE) == 0)
+                ota_progress_save(pipe);
+        }
+        sys_queue_write(&pipe->free_q, &buf, -1, false);
+    }
+
+    sys_sema_up(&pipe->done);
+    sys_task_delete(NULL);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Check the streamed hash against the digest TLV of the image
+ *
+ * @param[in] pipe        Pointer to the OTA pipeline
+ * @param[in] digest      SHA-256 of the image header and body
+ * @return    0 if the digest matches, -8 otherwise
+ ****************************************************************************************
+ */
+static int32_t ota_pipe_verify(struct ota_pipe *pipe, uint8_t *digest)
+{
+    struct image_tlv_info info;
+    struct image_tlv tlv;
+    uint8_t img_digest[IMG_DIGEST_SHA256_LEN];
+    uint32_t addr = pipe->img_addr + pipe->hash_len;
+    uint32_t end;
+
+    /* Only the small TLV area is read back, the image itself was hashed while written */
+    if (raw_flash_read(addr, &info, sizeof(info)) || info.magic_tlv != IMG_MAGIC_PTLV)
+        return -8;
+
+    end = addr + info.tlv_sz;
+    addr += sizeof(info);
+    while (addr + sizeof(tlv) <= end) {
+        if (raw_flash_read(addr, &tlv, sizeof(tlv)))
+            return -8;
+        addr += sizeof(tlv);
+        if ((tlv.type & 0xFF) == IMG_TLV_DIGEST) {
+            if (tlv.len != IMG_DIGEST_SHA256_LEN
+                || raw_flash_read(addr, img_digest, IMG_DIGEST_SHA256_LEN))
+                return -8;
+            return sys_memcmp(img_digest, digest, IMG_DIGEST_SHA256_LEN) ? -8 : 0;
+        }
+        addr += tlv.len;
+    }
+
+    return -8;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Free the OTA pipeline
+ *
+ * @param[in] pipe        Pointer to the OTA pipeline
+ ****************************************************************************************
+ */
+static void ota_pipe_free(struct ota_pipe *pipe)
+{
+    int i;
+
+    for (i = 0; i < OTA_BUF_NUM; i++) {
+        if (pipe->bufs[i].data)
+            sys_mfree(pipe->bufs[i].data);
+    }
+    if (pipe->free_q)
+        sys_queue_free(&pipe->free_q);
+    if (pipe->full_q)
+        sys_queue_free(&pipe->full_q);
+    if (pipe->done)
+        sys_sema_free(&pipe->done);
+    mbedtls_sha256_free(&pipe->sha256);
+    sys_mfree(pipe);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Allocate the OTA pipeline and start the writer task
+ *
+ * @param[in] img_addr    Flash offset of the slot to write
+ * @return    Pointer to the OTA pipeline, NULL if out of memory
+ ****************************************************************************************
+ */
+static struct ota_pipe *ota_pipe_alloc(uint32_t img_addr)
+{
+    struct ota_pipe *pipe;
+    struct ota_buf *buf;
+    int i;
+
+    pipe = sys_zalloc(sizeof(struct ota_pipe));
+    if (pipe == NULL)
+        return NULL;
+
+    mbedtls_sha256_init(&pipe->sha256);
+    mbedtls_sha256_starts(&pipe->sha256, 0);
+    pipe->img_addr = img_addr;
+
+    if (sys_queue_init(&pipe->free_q, OTA_BUF_NUM, sizeof(struct ota_buf *))
+        || sys_queue_init(&pipe->full_q, OTA_BUF_NUM + 1, sizeof(struct ota_buf *))
+        || sys_sema_init(&pipe->done, 0))
+        goto err;
+
+    for (i = 0; i < OTA_BUF_NUM; i++) {
+        pipe->bufs[i].data = sys_malloc(OTA_BUF_LEN);
+        if (pipe->bufs[i].data == NULL)
+            goto err;
+        buf = &pipe->bufs[i];
+        sys_queue_write(&pipe->free_q, &buf, 0, false);
+    }
+
+    if (sys_task_create_dynamic((const uint8_t *)"ota_writer",
+                    OTA_WRITER_STACK_SIZE, OS_TASK_PRIORITY(OTA_WRITER_TASK_PRIO),
+                    (task_func_t)ota_writer_task, pipe) == NULL)
+        goto err;
+
+    return pipe;
+
+err:
+    ota_pipe_free(pipe);
+    return NULL;
+}
+
 /**
  ****************************************************************************************
  * @brief Get http responses of the OTA image
  *
  * @param[in] sid         Http socket id
- * @param[in] running_idx Running image idx
+ * @param[in] new_img_addr Flash offset of the slot to write
+ * @param[in] img_size    Size of the slot
+ * @param[in] offset      Offset requested with a Range header, 0 for the whole image
  * @return    Status code to know if ota succeed or not
  *             -1         Malloc space fail
  *             -2         Get nothing from http service
- *             -3         Get http responses code is not 200
+ *             -3         Get http responses code is not 200 (or 206 when resuming)
  *             -4         Received data length is unexpected
  *             -5         Write flash fail
  *             -6         Get data from http service fail
+ *             -8         Image digest mismatch
  *              0         Run success
  ****************************************************************************************
  */
-static int32_t http_rsp_image(int32_t sid, uint32_t running_idx)
+static int32_t http_rsp_image(int32_t sid, uint32_t new_img_addr, uint32_t img_size, uint32_t offset)
 {
-    uint8_t *recvbuf, *buf;
-    int32_t recv_len, hdr_len, body_len, offset;
-    uint32_t new_img_addr = 0xFFFFFFFF, erase_start_addr;
-    int32_t ret = 0;
-    uint32_t img_size;
-
-    recvbuf = sys_malloc(RECBUFFER_LEN);
-    if (recvbuf == NULL)
+    struct ota_pipe *pipe;
+    struct ota_buf *buf = NULL;
+    int32_t recv_len, hdr_len, body_len, received, code;
+    uint32_t begin, start, total_ms, total_len;
+    uint8_t digest[IMG_DIGEST_SHA256_LEN];
+    char range[48], *p;
+    int32_t ret = 0, i;
+
+    pipe = ota_pipe_alloc(new_img_addr);
+    if (pipe == NULL)
         return -1;
 
-    sys_memset(recvbuf, 0, RECBUFFER_LEN);
-
-    recv_len = recv(sid, recvbuf, RECBUFFER_LEN, 0);
+    /* The HTTP header is received in the first buffer, the body is moved to its start */
+    sys_queue_read(&pipe->free_q, &buf, -1, false);
+    begin = sys_current_time_get();
+    recv_len = recv(sid, buf->data, OTA_BUF_LEN - 1, 0);
     if (recv_len <= 0) {
         ret = -2;
         goto Exit;
     }
+    buf->data[recv_len] = '\0';
 
-    if (200 != http_rsp_code(recvbuf)) {
+    code = http_rsp_code(buf->data);
+    if (code != 200 && (code != 206 || offset == 0)) {
         ret = -3;
         goto Exit;
     }
 
-    if (running_idx == IMAGE_0) {
-        new_img_addr = RE_IMG_1_OFFSET;
-        img_size = RE_IMG_1_END - RE_IMG_1_OFFSET;
+    app_print("HTTP response %d ok\r\n", code);
+    hdr_len = http_hdr_len(buf->data);
+    body_len = http_body_len(buf->data);
+
+    if (code == 206) {
+        /* Content-Range: bytes <first>-<last>/<total> */
+        if (http_hdr_field(buf->data, "Content-Range:", range, sizeof(range)) < 0
+            || (p = strchr(range, '/')) == NULL) {
+            ret = -4;
+            goto Exit;
+        }
+        total_len = atoi(p + 1);
+        p = strchr(range, ' ');
+        if (p == NULL || atoi(p + 1) != offset || total_len != ota_prog.img_len
+            || offset + body_len != total_len) {
+            app_print("Unexpected content range: %s\r\n", range);
+            ret = -4;
+            goto Exit;
+        }
+        app_print("Resume from %u of %u\r\n", offset, total_len);
+
+        /* The pages before the offset are already written, restart from the saved hash state */
+        pipe->write_off = offset;
+        pipe->erase_off = offset;
+        pipe->saved_off = offset;
+        pipe->hash_len = ota_prog.hash_len;
+        pipe->tlv_len = ota_prog.tlv_len;
+        sys_memcpy(&pipe->sha256, &ota_prog.sha256, sizeof(pipe->sha256));
     } else {
-        new_img_addr = RE_IMG_0_OFFSET;
-        img_size = RE_IMG_1_OFFSET - RE_IMG_0_OFFSET;
+        total_len = body_len;
+        pipe->hash_len = body_len;
+
+        /* The slot is about to be overwritten, the old progress is no longer valid */
+        nvds_data_del(NULL, OTA_NVDS_NAMESPACE, OTA_NVDS_KEY_PROGRESS);
+        sys_memset(&ota_prog, 0, sizeof(ota_prog));
+        ota_prog.magic = OTA_PROGRESS_MAGIC;
+        sys_memcpy(ota_prog.host, ota_demo_cfg.host, sizeof(ota_prog.host));
+        sys_memcpy(ota_prog.image_url, ota_demo_cfg.image_url, sizeof(ota_prog.image_url));
+        http_hdr_field(buf->data, "ETag:", ota_prog.etag, sizeof(ota_prog.etag));
+        ota_prog.img_addr = new_img_addr;
+        ota_prog.img_len = total_len;
     }
 
-    app_print("HTTP response 200 ok\r\n");
-    hdr_len = http_hdr_len(recvbuf);
-    body_len = http_body_len(recvbuf);
-    if (body_len > img_size) {
-        app_print("Content too long: %d\r\n", body_len);
+    if (total_len > img_size) {
+        app_print("Content too long: %d\r\n", total_len);
         ret = -4;
         goto Exit;
     }
     app_print("Content length: %d\r\n", body_len);
 
-    offset = 0;
-    buf = recvbuf + hdr_len;
     recv_len -= hdr_len;
-    if (recv_len < 0) {
-        ret = -5;
+    if (recv_len < 0 || recv_len > body_len) {
+        ret = -4;
         goto Exit;
     }
-
-    erase_start_addr = new_img_addr;
-    do {
-        if (recv_len > 0) {
-            if (offset + recv_len > img_size) {   //flash security check
-                app_print("received too long: %d\r\n", offset + recv_len);
-                ret = -6;
-                goto Exit;
-            }
-
-            while(offset + new_img_addr + recv_len > erase_start_addr) {
-                ret = raw_flash_erase(erase_start_addr, 0x1000);
-                if (ret != 0) {
-                    goto Exit;
-                } else {
-                    erase_start_addr += 0x1000;
-                }
-            }
-            app_print("Write to 0x%x with len %d\r\n", offset + new_img_addr, recv_len);
-            ret = raw_flash_write((new_img_addr + offset), buf, recv_len);
-            if (ret != 0) {
-                goto Exit;
-            }
-
-            offset += recv_len;
+    sys_memmove(buf->data, buf->data + hdr_len, recv_len);
+    buf->len = recv_len;
+    received = recv_len;
+    pipe->img_len = total_len;
+
+    while (1) {
+        if (buf->len == OTA_BUF_LEN || received == body_len) {
+            sys_queue_write(&pipe->full_q, &buf, -1, false);
+            buf = NULL;
+            if (received == body_len || pipe->status != 0)
+                break;
+
+            start = sys_current_time_get();
+            sys_queue_read(&pipe->free_q, &buf, -1, false);
+            pipe->t_wait += sys_current_time_get() - start;
+            buf->len = 0;
+            continue;
         }
-        recv_len = body_len - offset;
-
-        if (0 == recv_len)
-            break;
 
-        if (recv_len > RECBUFFER_LEN)
-            recv_len = RECBUFFER_LEN;
+        recv_len = OTA_BUF_LEN - buf->len;
+        if (recv_len > body_len - received)
+            recv_len = body_len - received;
 
-        recv_len = recv(sid, recvbuf, recv_len, 0);
-        if (recv_len < 0 && (recv_len != -EAGAIN && recv_len != -EWOULDBLOCK)) {
+        start = sys_current_time_get();
+        recv_len = recv(sid, buf->data + buf->len, recv_len, 0);
+        pipe->t_recv += sys_current_time_get() - start;
+        if (recv_len <= 0) {
             app_print("Http socket recv error\r\n");
-            ret = -7;
-            goto Exit;
+            ret = -6;
+            break;
         }
-        buf = recvbuf;
-    } while (offset < body_len);
+        buf->len += recv_len;
+        received += recv_len;
+    }
 
 Exit:
-    sys_mfree(recvbuf);
+    if (buf)
+        sys_queue_write(&pipe->free_q, &buf, -1, false);
+    buf = NULL;
+    sys_queue_write(&pipe->full_q, &buf, -1, false);
+    sys_sema_down(&pipe->done, 0);
+    total_ms = sys_current_time_get() - begin;
+
+    if (ret == 0)
+        ret = pipe->status;
+    if (ret == 0 && pipe->write_off != pipe->img_len)
+        ret = -4;
+
+    if (ret == 0) {
+        mbedtls_sha256_finish(&pipe->sha256, digest);
+        if (pipe->tlv_len) {
+            ret = ota_pipe_verify(pipe, digest);
+            app_print("Image digest %s\r\n", ret ? "mismatch" : "ok");
+        } else {
+            app_print("Image without header, sha256 ");
+            for (i = 0; i < IMG_DIGEST_SHA256_LEN; i++)
+                app_print("%02x", digest[i]);
+            app_print("\r\n");
+        }
+
+        /* Finished or bad image, nothing to resume either way */
+        nvds_data_del(NULL, OTA_NVDS_NAMESPACE, OTA_NVDS_KEY_PROGRESS);
+
+        app_print("OTA %d bytes in %u ms, %u KB/s\r\n", body_len, total_ms,
+                  total_ms ? ((body_len * 125) / (total_ms * 128)) : 0);
+        app_print("OTA recv %u ms, wait %u ms, erase %u ms, write %u ms, hash %u ms\r\n",
+                  pipe->t_recv, pipe->t_wait, pipe->t_erase, pipe->t_write, pipe->t_hash);
+    }
+
+    ota_pipe_free(pipe);
     return ret;
 }
 
@@ -393,7 +829,8 @@ static void ota_demo_task(void)
     char *bin_name = ota_demo_cfg.image_url;
     uint32_t port = ota_demo_cfg.port;
     uint8_t running_idx = IMAGE_0;
-    int32_t res;
+    uint32_t new_img_addr, img_size, offset;
+    int32_t res, retry;
 
     app_print("Start OTA test...\r\n");
 
@@ -403,22 +840,48 @@ static void ota_demo_task(void)
         goto Exit;
     }
 
-    ota_demo_cfg.sockfd = http_socket_init(host, port);
-    if (ota_demo_cfg.sockfd < 0) {
-        app_print("Init socket failed! (sid = %d)\r\n", ota_demo_cfg.sockfd);
-        goto Exit;
+    if (running_idx == IMAGE_0) {
+        new_img_addr = RE_IMG_1_OFFSET;
+        img_size = RE_IMG_1_END - RE_IMG_1_OFFSET;
+    } else {
+        new_img_addr = RE_IMG_0_OFFSET;
+        img_size = RE_IMG_1_OFFSET - RE_IMG_0_OFFSET;
     }
 
-    res = http_req_image(ota_demo_cfg.sockfd, host, ota_demo_cfg.port, bin_name);
-    if (0 == res) {
-        res = http_rsp_image(ota_demo_cfg.sockfd, running_idx);
-        if (res < 0) {
-            app_print("Get Firmware Reponse failed! (res = %d)\r\n", res);
-            goto Exit;
+    for (retry = 0; ; retry++) {
+        if (retry) {
+            if (retry > OTA_RETRY_MAX)
+                goto Exit;
+            app_print("Retry OTA download (%d/%d)\r\n", retry, OTA_RETRY_MAX);
+            sys_ms_sleep(OTA_RETRY_DELAY);
         }
-    } else {
-        app_print("Request Firmware failed! (res = %d)\r\n", res);
-        goto Exit;
+
+        ota_demo_cfg.sockfd = http_socket_init(host, port);
+        if (ota_demo_cfg.sockfd < 0) {
+            app_print("Init socket failed! (sid = %d)\r\n", ota_demo_cfg.sockfd);
+            continue;
+        }
+
+        /* Resume an interrupted download of the same image */
+        offset = ota_progress_load(new_img_addr);
+        res = http_req_image(ota_demo_cfg.sockfd, host, ota_demo_cfg.port, bin_name,
+                             offset, ota_prog.etag);
+        if (0 == res) {
+            res = http_rsp_image(ota_demo_cfg.sockfd, new_img_addr, img_size, offset);
+            if (res < 0)
+                app_print("Get Firmware Reponse failed! (res = %d)\r\n", res);
+        } else {
+            app_print("Request Firmware failed! (res = %d)\r\n", res);
+        }
+
+        close(ota_demo_cfg.sockfd);
+        ota_demo_cfg.sockfd = -1;
+
+        if (res == 0)
+            break;
+        /* Only retry on link errors, the others would fail again */
+        if (res != -2 && res != -6)
+            goto Exit;
     }
 
     /* Set image status */
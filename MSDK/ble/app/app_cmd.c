@@ -286,6 +286,64 @@ static void cmd_list_scan_devs(int argc, char **argv)
     scan_mgr_list_scanned_devices();
 }
 
+static void cmd_scan_filter(int argc, char **argv)
+{
+    char *endptr = NULL;
+    scan_mgr_filter_t filter;
+    uint32_t value;
+    int i;
+
+    if (argc == 1) {
+        scan_mgr_filter_set(NULL);
+        return;
+    }
+
+    if ((argc % 2) == 0) {
+        goto usage;
+    }
+
+    memset(&filter, 0, sizeof(filter));
+    filter.dup_window = SCAN_MGR_DUP_WINDOW_MS;
+
+    for (i = 1; i < argc; i += 2) {
+        value = strtoul((const char *)argv[i + 1], &endptr, 0);
+        if (*endptr != '\0') {
+            goto usage;
+        }
+
+        if (!strcmp(argv[i], "rssi")) {
+            filter.match_bf |= SCAN_MGR_FILTER_RSSI_BIT;
+            filter.rssi_min = (int8_t)value;
+        } else if (!strcmp(argv[i], "type")) {
+            filter.match_bf |= SCAN_MGR_FILTER_AD_TYPE_BIT;
+            filter.ad_type = (uint8_t)value;
+        } else if (!strcmp(argv[i], "uuid")) {
+            filter.match_bf |= SCAN_MGR_FILTER_UUID_BIT;
+            filter.uuid.type = BLE_UUID_TYPE_16;
+            filter.uuid.data.uuid_16 = (uint16_t)value;
+        } else if (!strcmp(argv[i], "company")) {
+            filter.match_bf |= SCAN_MGR_FILTER_MANUF_BIT;
+            filter.company_id = (uint16_t)value;
+        } else if (!strcmp(argv[i], "dup")) {
+            filter.dup_window = (uint16_t)value;
+        } else {
+            goto usage;
+        }
+    }
+
+    scan_mgr_filter_set(&filter);
+    return;
+
+usage:
+    app_print("Usage: ble_scan_filter [rssi <min rssi>] [type <ad type>] [uuid <uuid>] [company <id>] [dup <ms>]\r\n");
+    app_print("<min rssi>: drop reports weaker than min rssi in dBm\r\n");
+    app_print("<ad type>: drop reports without this AD type\r\n");
+    app_print("<uuid>: drop reports without this 16-bit service UUID or service data\r\n");
+    app_print("<id>: drop reports without manufacturer specific data of this company\r\n");
+    app_print("<ms>: drop unchanged reports of a device for this time, 0 to disable\r\n");
+    app_print("no parameter to restore the default filter\r\n");
+}
+
 #if (BLE_APP_PER_ADV_SUPPORT)
 #ifndef CONFIG_INTERNAL_DEBUG
 static void cmd_sync(int argc, char **argv)
@@ -1056,6 +1114,7 @@ const struct cmd_entry ble_cmd_table[] = {
 #endif // #ifndef CONFIG_INTERNAL_DEBUG
     {"ble_scan_stop", cmd_scan_stop},
     {"ble_list_scan_devs", cmd_list_scan_devs},
+    {"ble_scan_filter", cmd_scan_filter},
 
 #if (BLE_APP_PER_ADV_SUPPORT)
 #ifndef CONFIG_INTERNAL_DEBUG
@@ -38,6 +38,7 @@ OF SUCH DAMAGE.
 #include "wrapper_os.h"
 #include "dbg_print.h"
 #include "app_dev_mgr.h"
+#include "ble_config.h"
 #include "cmd_shell.h"
 #include "uart.h"
 #include "gd32vw55x.h"
@@ -46,27 +47,89 @@ OF SUCH DAMAGE.
 
 #define PASSTH_TERMINATE_STR            "+++"
 
+/* Size of the circular UART receive ring, the DMA interrupts on each half of it */
+#define DATATRANS_RX_RING_SIZE          2048
+/* Number of notifications handed to the BLE stack and not yet reported sent */
+#define DATATRANS_TX_CREDITS            4
+/* Longest sleep of the bridge loop while the ring is not empty, in ms */
+#define DATATRANS_FLUSH_MS              1
+/* Ring fill level where UART DMA requests are stopped so that the USART drives RTS inactive */
+#define DATATRANS_RTS_HIGH              (DATATRANS_RX_RING_SIZE * 3 / 4)
+/* Ring fill level where UART DMA requests are enabled again */
+#define DATATRANS_RTS_LOW               (DATATRANS_RX_RING_SIZE / 4)
+/* L2CAP and ATT headers in front of the notification value */
+#define DATATRANS_NTF_HDR_LEN           7
+/* LE data length until the controller reports the negotiated one */
+#define DATATRANS_DFT_TX_OCTETS         27
+
+/* RTS/CTS on the log UART while datatrans runs, the two pins must be wired to the host */
+#ifndef DATATRANS_FLOW_CTRL
+#define DATATRANS_FLOW_CTRL             0
+#endif
+
+struct datatrans_env
+{
+    uint8_t *rx_ring;                   /*!< UART receive ring filled by the DMA */
+    os_sema_t evt_sema;                 /*!< given on ring half filled and on notification sent */
+    volatile uint32_t rx_half_cnt;      /*!< number of ring halves filled by the DMA */
+    volatile uint8_t tx_credits;        /*!< notifications that can still be queued */
+    uint8_t conidx;                     /*!< connection the UART data is sent to */
+    bool rx_hold;                       /*!< UART DMA requests stopped, RTS inactive */
+};
+
+struct datatrans_stats
+{
+    uint32_t rx_bytes;                  /*!< bytes received on the UART */
+    uint32_t tx_bytes;                  /*!< bytes queued as notifications */
+    uint32_t tx_ntf;                    /*!< notifications queued */
+    uint32_t tx_fail;                   /*!< notifications reported failed by the stack */
+    uint32_t rx_drop;                   /*!< bytes overwritten in the ring before being sent */
+    uint32_t uart_ovr;                  /*!< USART overrun errors */
+    uint32_t rx_hold;                   /*!< times the UART was stopped by RTS */
+    uint32_t start_time;                /*!< time of the first received byte, in ms */
+    uint32_t end_time;                  /*!< time of the last queued notification, in ms */
+};
+
 static bool disconn_flag;
+static struct datatrans_env dt_env;
+static struct datatrans_stats dt_stats;
+/* Max LE data channel payload in TX of each connection, 0 until reported */
+static uint16_t dt_tx_octets[BLE_MAX_CONN_NUM];
 
 void app_datatrans_uart_rx_dma_irq_hdl(uint32_t dma_channel)
 {
+    if (RESET != dma_interrupt_flag_get(dma_channel, DMA_INT_FLAG_HTF)) {
+        dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_HTF);
+        dt_env.rx_half_cnt++;
+    }
+
     if(RESET != dma_interrupt_flag_get(dma_channel, DMA_INT_FLAG_FTF)){
         dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF);
+        dt_env.rx_half_cnt++;
     }
+
+    if (dt_env.evt_sema)
+        sys_sema_up_from_isr(&dt_env.evt_sema);
 }
 
-bool app_datatrans_terminate_string_check(uint8_t *str)
+static uint32_t uart_rx_dma_channel(uint32_t usart_periph)
 {
-    if (strlen(PASSTH_TERMINATE_STR) == strlen((char *)str) && strncmp((char *)str, PASSTH_TERMINATE_STR, strlen(PASSTH_TERMINATE_STR)) == 0)
-        return true;
-    return false;
+    switch (usart_periph) {
+    case USART0:
+        return DMA_CH2;
+    case UART1:
+        return DMA_CH0;
+    case UART2:
+    default:
+        return DMA_CH5;
+    }
 }
 
 static void uart_dma_receive_config(uint32_t usart_periph, uint32_t baudrate)
 {
     uart_tx_idle_wait(usart_periph);
 
-    uart_config(usart_periph, baudrate, false, true, false);
+    uart_config(usart_periph, baudrate, DATATRANS_FLOW_CTRL, true, false);
     switch (usart_periph) {
     case USART0:
         eclic_irq_enable(DMA_Channel2_IRQn, 8, 0);
@@ -83,21 +146,16 @@ static void uart_dma_receive_config(uint32_t usart_periph, uint32_t baudrate)
 
 static void uart_irq_receive_config(uint32_t usart_periph, uint32_t baudrate)
 {
-    uint32_t dma_channel;
-
     switch (usart_periph) {
     case USART0:
         eclic_irq_disable(DMA_Channel2_IRQn);
-        dma_channel = DMA_CH2;
         break;
     case UART1:
         eclic_irq_disable(DMA_Channel0_IRQn);
-        dma_channel = DMA_CH0;
         break;
     case UART2:
     default:
         eclic_irq_disable(DMA_Channel5_IRQn);
-        dma_channel = DMA_CH5;
         break;
     }
 
@@ -107,22 +165,13 @@ static void uart_irq_receive_config(uint32_t usart_periph, uint32_t baudrate)
 
 static void uart_dma_receive_start(uint32_t usart_periph, uint32_t address, uint32_t num)
 {
-    uint32_t dma_channel;
+    uint32_t dma_channel = uart_rx_dma_channel(usart_periph);
 
     uart_dma_single_mode_config(usart_periph, DMA_PERIPH_TO_MEMORY);
 
-    switch (usart_periph) {
-    case USART0:
-        dma_channel = DMA_CH2;
-        break;
-    case UART1:
-        dma_channel = DMA_CH0;
-        break;
-    case UART2:
-    default:
-        dma_channel = DMA_CH5;
-        break;
-    }
+    /* The ring is never stopped while datatrans runs, so no byte is lost between two frames */
+    dma_circulation_enable(dma_channel);
+    dma_interrupt_enable(dma_channel, DMA_INT_HTF);
 
     dma_memory_address_config(dma_channel, DMA_MEMORY_0, address);
     dma_transfer_number_config(dma_channel, num);
@@ -131,44 +180,148 @@ static void uart_dma_receive_start(uint32_t usart_periph, uint32_t address, uint
 
 static void uart_dma_receive_stop(uint32_t usart_periph)
 {
-    uint32_t dma_channel;
+    uint32_t dma_channel = uart_rx_dma_channel(usart_periph);
 
-    switch (usart_periph) {
-    case USART0:
-        dma_channel = DMA_CH2;
-        break;
-    case UART1:
-        dma_channel = DMA_CH0;
-        break;
-    case UART2:
-    default:
-        dma_channel = DMA_CH5;
-        break;
+    dma_interrupt_disable(dma_channel, DMA_INT_FTF | DMA_INT_HTF);
+    dma_channel_disable(dma_channel);
+    dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF);
+    dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_HTF);
+}
+
+/*!
+    \brief      Get the number of bytes written to the ring since the DMA was started
+    \param[in]  usart_periph: UART the ring is attached to
+    \param[out] none
+    \retval     uint32_t: ring write position, it wraps at 2^32 and not at the ring size
+*/
+static uint32_t datatrans_rx_pos_get(uint32_t usart_periph)
+{
+    uint32_t dma_channel = uart_rx_dma_channel(usart_periph);
+    uint32_t half_cnt, idx;
+
+    do {
+        half_cnt = dt_env.rx_half_cnt;
+        idx = DATATRANS_RX_RING_SIZE - dma_transfer_number_get(dma_channel);
+    } while (half_cnt != dt_env.rx_half_cnt);
+
+    /* The counter may already be past a half whose interrupt has not run yet, the offset from
+       the last counted half is then above half the ring, but always below the ring size */
+    idx = (idx + DATATRANS_RX_RING_SIZE - (half_cnt & 1) * (DATATRANS_RX_RING_SIZE / 2)) % DATATRANS_RX_RING_SIZE;
+
+    return half_cnt * (DATATRANS_RX_RING_SIZE / 2) + idx;
+}
+
+/*!
+    \brief      Copy data out of the receive ring
+    \param[in]  pos: ring position of the first byte, as returned by datatrans_rx_pos_get()
+    \param[in]  len: number of bytes to copy
+    \param[out] p_buf: pointer to the destination buffer
+    \retval     none
+*/
+static void datatrans_rx_ring_read(uint32_t pos, uint8_t *p_buf, uint16_t len)
+{
+    uint32_t idx = pos % DATATRANS_RX_RING_SIZE;
+    uint32_t first = DATATRANS_RX_RING_SIZE - idx;
+
+    if (first >= len) {
+        sys_memcpy(p_buf, dt_env.rx_ring + idx, len);
+    } else {
+        sys_memcpy(p_buf, dt_env.rx_ring + idx, first);
+        sys_memcpy(p_buf + first, dt_env.rx_ring, len - first);
     }
+}
 
-    dma_interrupt_flag_clear(dma_channel, DMA_INT_FLAG_FTF);
-    dma_interrupt_disable(dma_channel, DMA_INT_FTF);
-    dma_channel_disable(dma_channel);
+static bool datatrans_terminate_check(uint32_t pos, uint32_t len)
+{
+    uint8_t str[sizeof(PASSTH_TERMINATE_STR) - 1];
+
+    if (len != sizeof(str))
+        return false;
+
+    datatrans_rx_ring_read(pos, str, sizeof(str));
+    return memcmp(str, PASSTH_TERMINATE_STR, sizeof(str)) == 0;
 }
 
-static uint32_t dma_get_cur_received_num(uint32_t usart_periph, uint32_t size)
+/*!
+    \brief      Get the notification length that fills whole LE data channel PDUs
+    \param[in]  att_mtu_size: ATT MTU of the connection
+    \param[in]  tx_octets: max LE data channel payload in TX
+    \param[out] none
+    \retval     uint16_t: notification value length
+*/
+static uint16_t datatrans_ntf_len_get(uint16_t att_mtu_size, uint16_t tx_octets)
 {
-    uint32_t dma_channel;
+    uint16_t max_len = att_mtu_size - 3;
+    uint16_t pdu_len;
 
-    switch (usart_periph) {
-    case USART0:
-        dma_channel = DMA_CH2;
-        break;
-    case UART1:
-        dma_channel = DMA_CH0;
-        break;
-    case UART2:
-    default:
-        dma_channel = DMA_CH5;
-        break;
+    if (tx_octets == 0)
+        tx_octets = DATATRANS_DFT_TX_OCTETS;
+
+    /* A value ending a few bytes into a PDU sends a nearly empty PDU, which costs as much
+       air time as a full one, round down to the last PDU boundary in that case */
+    pdu_len = ((max_len + DATATRANS_NTF_HDR_LEN) / tx_octets) * tx_octets;
+    if (pdu_len > DATATRANS_NTF_HDR_LEN && pdu_len - DATATRANS_NTF_HDR_LEN < max_len)
+        return pdu_len - DATATRANS_NTF_HDR_LEN;
+
+    return max_len;
+}
+
+/*!
+    \brief      Stop and restart the UART when the receive ring is nearly full or drained
+    \param[in]  pending: number of bytes in the ring not sent yet
+    \param[out] none
+    \retval     none
+*/
+static void datatrans_rx_flow_ctrl(uint32_t pending)
+{
+#if DATATRANS_FLOW_CTRL
+    /* Without DMA requests the USART FIFO fills up and the USART drives RTS inactive */
+    if (!dt_env.rx_hold && pending >= DATATRANS_RTS_HIGH) {
+        usart_dma_receive_config(LOG_UART, USART_RECEIVE_DMA_DISABLE);
+        dt_env.rx_hold = true;
+        dt_stats.rx_hold++;
+    } else if (dt_env.rx_hold && pending <= DATATRANS_RTS_LOW) {
+        usart_dma_receive_config(LOG_UART, USART_RECEIVE_DMA_ENABLE);
+        dt_env.rx_hold = false;
     }
+#endif
+}
+
+/*!
+    \brief      Callback of the notifications sent by the BLE stack, give the credit back
+    \param[in]  conn_idx: connection index
+    \param[in]  status: notification send status
+    \param[out] none
+    \retval     none
+*/
+static void datatrans_tx_cmpl_callback(uint8_t conn_idx, uint16_t status)
+{
+    if (conn_idx != dt_env.conidx)
+        return;
 
-    return (size - dma_transfer_number_get(dma_channel));
+    if (status != BLE_ERR_NO_ERROR)
+        dt_stats.tx_fail++;
+
+    sys_enter_critical();
+    if (dt_env.tx_credits < DATATRANS_TX_CREDITS)
+        dt_env.tx_credits++;
+    sys_exit_critical();
+
+    sys_sema_up(&dt_env.evt_sema);
+}
+
+static void datatrans_stats_print(void)
+{
+    uint32_t duration = dt_stats.end_time - dt_stats.start_time;
+    uint32_t bps = 0;
+
+    if (duration)
+        bps = (uint32_t)((uint64_t)dt_stats.tx_bytes * 8 * 1000 / duration);
+
+    dbg_print(NOTICE, "datatrans rx %u bytes, tx %u bytes in %u notifications, %u ms, %u bps\r\n",
+              dt_stats.rx_bytes, dt_stats.tx_bytes, dt_stats.tx_ntf, duration, bps);
+    dbg_print(NOTICE, "datatrans ring drop %u bytes, uart overrun %u, tx fail %u, rts hold %u\r\n",
+              dt_stats.rx_drop, dt_stats.uart_ovr, dt_stats.tx_fail, dt_stats.rx_hold);
 }
 
 /*!
@@ -206,6 +359,9 @@ void app_datatrans_conn_evt_handler(ble_conn_evt_t event, ble_conn_data_u *p_dat
             disconn_flag = true;
         else if (p_data->conn_state.state == BLE_CONN_STATE_CONNECTED)
             disconn_flag = false;
+    } else if (event == BLE_CONN_EVT_PKT_SIZE_INFO) {
+        if (p_data->pkt_size_info.conn_idx < BLE_MAX_CONN_NUM)
+            dt_tx_octets[p_data->pkt_size_info.conn_idx] = p_data->pkt_size_info.max_tx_octets;
     }
 }
 
@@ -218,63 +374,122 @@ void app_datatrans_conn_evt_handler(ble_conn_evt_t event, ble_conn_data_u *p_dat
 */
 void app_datatrans_start(uint8_t conidx, uint32_t baudrate)
 {
-    uint32_t cur_cnt = 0;
+    uint32_t rx_pos = 0, tx_pos = 0, idle_pos = 0;
     uint16_t att_mtu_size = 0;
-    uint16_t data_max_size = 0;
+    uint16_t len, ntf_len;
     uint8_t *tx_buf = NULL;
-    bool reset = true;
+    bool idle;
 
     if (!dm_check_connection_valid(conidx)) {
         dbg_print(NOTICE, "link has not been established\r\n");
         return;
     }
 
-    ble_gatts_mtu_get(0 , &att_mtu_size);
-    data_max_size = att_mtu_size - 3;
-    tx_buf = sys_malloc(data_max_size);
-    if (!tx_buf) {
+    ble_gatts_mtu_get(conidx, &att_mtu_size);
+    dt_env.rx_ring = sys_malloc(DATATRANS_RX_RING_SIZE + att_mtu_size - 3);
+    if (!dt_env.rx_ring) {
         dbg_print(NOTICE, "buffer alloc fail\r\n");
         return;
     }
+    tx_buf = dt_env.rx_ring + DATATRANS_RX_RING_SIZE;
 
-    while (1) {
-        if(reset) {
-            uart_dma_receive_config(LOG_UART, baudrate);   //have to reconfig uart here, or one byte left data will be transfered by dma
-            while(RESET == usart_flag_get(LOG_UART, USART_FLAG_IDLE));
-            usart_flag_clear(LOG_UART, USART_FLAG_IDLE);
-            reset = false;
-            sys_memset(tx_buf, 0, data_max_size);
-            uart_dma_receive_start(LOG_UART, (uint32_t)tx_buf, data_max_size);
-        }
+    if (sys_sema_init_ext(&dt_env.evt_sema, 1, 0) != OS_OK) {
+        dbg_print(NOTICE, "sema init fail\r\n");
+        sys_mfree(dt_env.rx_ring);
+        dt_env.rx_ring = NULL;
+        return;
+    }
+
+    sys_memset(&dt_stats, 0, sizeof(dt_stats));
+    dt_env.rx_half_cnt = 0;
+    dt_env.tx_credits = DATATRANS_TX_CREDITS;
+    dt_env.conidx = conidx;
+    dt_env.rx_hold = false;
+    ble_datatrans_srv_tx_cmpl_cb_reg(datatrans_tx_cmpl_callback);
 
-        sys_ms_sleep(1);
+    uart_dma_receive_config(LOG_UART, baudrate);   //have to reconfig uart here, or one byte left data will be transfered by dma
+    while(RESET == usart_flag_get(LOG_UART, USART_FLAG_IDLE));
+    usart_flag_clear(LOG_UART, USART_FLAG_IDLE);
+    uart_dma_receive_start(LOG_UART, (uint32_t)dt_env.rx_ring, DATATRANS_RX_RING_SIZE);
+
+    while (1) {
+        /* Woken up by each half of the ring and by each notification sent */
+        sys_sema_down(&dt_env.evt_sema, DATATRANS_FLUSH_MS);
 
         if (disconn_flag == true) {
             disconn_flag = false;
             break;
         }
 
-        if (RESET != usart_flag_get(LOG_UART, USART_FLAG_IDLE)) {
+        /* Sample IDLE first, all the data of the frame it ends is then in the ring */
+        idle = (RESET != usart_flag_get(LOG_UART, USART_FLAG_IDLE));
+        if (idle)
             usart_flag_clear(LOG_UART, USART_FLAG_IDLE);
-            cur_cnt = dma_get_cur_received_num(LOG_UART, data_max_size);
-            reset = true;
-            uart_dma_receive_stop(LOG_UART);
 
-            if (app_datatrans_terminate_string_check(tx_buf))
+        if (RESET != usart_flag_get(LOG_UART, USART_FLAG_ORERR)) {
+            usart_flag_clear(LOG_UART, USART_FLAG_ORERR);
+            dt_stats.uart_ovr++;
+        }
+
+        rx_pos = datatrans_rx_pos_get(LOG_UART);
+        if ((rx_pos != tx_pos) && (dt_stats.start_time == 0))
+            dt_stats.start_time = sys_current_time_get();
+
+        if (rx_pos - tx_pos > DATATRANS_RX_RING_SIZE) {
+            /* The DMA went round the ring over data not sent yet, keep the newest half */
+            dt_stats.rx_drop += rx_pos - tx_pos - DATATRANS_RX_RING_SIZE / 2;
+            tx_pos = rx_pos - DATATRANS_RX_RING_SIZE / 2;
+            if ((int32_t)(idle_pos - tx_pos) < 0)
+                idle_pos = tx_pos;
+        }
+
+        if (idle) {
+            /* A frame made of the terminate string only, nothing else waiting */
+            if ((tx_pos == idle_pos) && datatrans_terminate_check(idle_pos, rx_pos - idle_pos))
                 break;
+            idle_pos = rx_pos;
+        }
 
-            if (ble_datatrans_srv_tx(conidx, tx_buf, cur_cnt) != BLE_ERR_NO_ERROR) {
+        ntf_len = datatrans_ntf_len_get(att_mtu_size, dt_tx_octets[conidx % BLE_MAX_CONN_NUM]);
+        while (dt_env.tx_credits && (rx_pos != tx_pos)) {
+            /* Full notifications go at once, the tail of a frame when the line is idle */
+            if (rx_pos - tx_pos >= ntf_len)
+                len = ntf_len;
+            else if ((int32_t)(idle_pos - tx_pos) > 0)
+                len = idle_pos - tx_pos;
+            else
+                break;
+
+            datatrans_rx_ring_read(tx_pos, tx_buf, len);
+            if (ble_datatrans_srv_tx(conidx, tx_buf, len) != BLE_ERR_NO_ERROR) {
                 dbg_print(NOTICE, "data send fail\r\n");
-                if (tx_buf)
-                    sys_mfree(tx_buf);
-                return;
+                goto stop;
             }
+
+            sys_enter_critical();
+            dt_env.tx_credits--;
+            sys_exit_critical();
+
+            tx_pos += len;
+            dt_stats.tx_bytes += len;
+            dt_stats.tx_ntf++;
+            dt_stats.end_time = sys_current_time_get();
         }
+
+        datatrans_rx_flow_ctrl(rx_pos - tx_pos);
     }
 
+stop:
+    dt_stats.rx_bytes = rx_pos;
     uart_dma_receive_stop(LOG_UART);
     uart_irq_receive_config(LOG_UART, baudrate);
-    sys_mfree(tx_buf);
+    ble_datatrans_srv_tx_cmpl_cb_unreg();
+    datatrans_stats_print();
+
+    sys_sema_free(&dt_env.evt_sema);
+    dt_env.evt_sema = NULL;
+    sys_mfree(dt_env.rx_ring);
+    dt_env.rx_ring = NULL;
 }
 
 /*!
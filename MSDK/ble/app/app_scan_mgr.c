@@ -45,62 +45,223 @@ OF SUCH DAMAGE.
 #include "wrapper_os.h"
 #include "dbg_print.h"
 
+/* Size of the device address hash table, power of 2 to keep the probe sequences short */
+#define SCAN_MGR_HASH_SIZE      (2 * SCAN_MGR_DEV_NUM)
+#define SCAN_MGR_HASH_MASK      (SCAN_MGR_HASH_SIZE - 1)
+/* Value of a free hash table bucket, a used bucket stores the device index */
+#define SCAN_MGR_HASH_FREE      0xFF
+
+#if ((SCAN_MGR_DEV_NUM > 128) || (SCAN_MGR_HASH_SIZE & SCAN_MGR_HASH_MASK))
+#error "SCAN_MGR_DEV_NUM must be a power of 2 not greater than 128"
+#endif
+
 /* Application scan manager module structure */
 typedef struct scan_mgr_cb
 {
-    bool    update_with_rssi;       /*!< Updata scanned device list if RSSI changed */
-    dlist_t devs_list;              /*!< Scanned device list */
+    bool       update_with_rssi;                /*!< Updata scanned device list if RSSI changed */
+    uint8_t    dev_num;                         /*!< Number of scanned devices */
+    scan_mgr_filter_t filter;                   /*!< Advertising report filter */
+    uint8_t    hash[SCAN_MGR_HASH_SIZE];        /*!< Open addressed hash table of device address */
+    dev_info_t devs[SCAN_MGR_DEV_NUM];          /*!< Scanned devices, indexed by device index */
 } scan_mgr_cb_t;
 
 /* Application scan manager module data */
 static scan_mgr_cb_t ble_scan_mgr_cb;
 
+/* The reports are handled in the BLE task and the list is dumped from the CLI task,
+   the hash table and the device pool are only changed with this mutex held */
+static os_mutex_t scan_mgr_mutex;
+
 /*!
-    \brief      Find device information by address in the scanned device list
+    rief      Take the scan manager mutex
+    \param[in]  none
+    \param[out] none
+    
+etval     none
+*/
+static void scan_mgr_lock(void)
+{
+    if (scan_mgr_mutex != NULL) {
+        sys_mutex_get(&scan_mgr_mutex);
+    }
+}
+
+/*!
+    rief      Release the scan manager mutex
+    \param[in]  none
+    \param[out] none
+    
+etval     none
+*/
+static void scan_mgr_unlock(void)
+{
+    if (scan_mgr_mutex != NULL) {
+        sys_mutex_put(&scan_mgr_mutex);
+    }
+}
+
+/*!
+    \brief      Compute hash table bucket of a device address
     \param[in]  p_peer_addr: pointer to peer device address
     \param[out] none
-    \retval     dev_info_t *: pointer to the device information found
+    \retval     uint8_t: first bucket of the probe sequence
 */
-dev_info_t *scan_mgr_find_device(ble_gap_addr_t *p_peer_addr)
+static uint8_t scan_mgr_hash(ble_gap_addr_t *p_peer_addr)
 {
-    dlist_t *pos, *n;
-    dev_info_t *p_dev_info = NULL;
+    uint32_t hash = 2166136261U ^ p_peer_addr->addr_type;
+    uint8_t i;
 
-    if (list_empty(&ble_scan_mgr_cb.devs_list)) {
-        return NULL;
+    /* FNV-1a */
+    for (i = 0; i < BLE_GAP_ADDR_LEN; i++) {
+        hash = (hash ^ p_peer_addr->addr[i]) * 16777619U;
+    }
+
+    return (uint8_t)((hash ^ (hash >> 16)) & SCAN_MGR_HASH_MASK);
+}
+
+/*!
+    \brief      Compute hash of the data of an advertising report, to detect unchanged reports
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] none
+    \retval     uint16_t: data hash
+*/
+static uint16_t scan_mgr_data_hash(ble_gap_adv_report_info_t *p_info)
+{
+    uint32_t hash = 2166136261U ^ p_info->data.len;
+    uint16_t i;
+
+    for (i = 0; i < p_info->data.len; i++) {
+        hash = (hash ^ p_info->data.p_data[i]) * 16777619U;
     }
 
-    list_for_each_safe(pos, n, &ble_scan_mgr_cb.devs_list) {
-        p_dev_info = list_entry(pos, dev_info_t, list);
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+/*!
+    \brief      Find hash table bucket of a device address
+    \param[in]  p_peer_addr: pointer to peer device address
+    \param[out] none
+    \retval     uint8_t: bucket of the device if found, otherwise the free bucket ending the probe sequence
+*/
+static uint8_t scan_mgr_hash_lookup(ble_gap_addr_t *p_peer_addr)
+{
+    uint8_t pos = scan_mgr_hash(p_peer_addr);
+    dev_info_t *p_dev_info;
+
+    /* The table is never more than half full, a free bucket is always found */
+    while (ble_scan_mgr_cb.hash[pos] != SCAN_MGR_HASH_FREE) {
+        p_dev_info = &ble_scan_mgr_cb.devs[ble_scan_mgr_cb.hash[pos]];
         if (p_peer_addr->addr_type == p_dev_info->peer_addr.addr_type &&
             !memcmp(p_peer_addr->addr, p_dev_info->peer_addr.addr, BLE_GAP_ADDR_LEN)) {
-            return p_dev_info;
+            break;
         }
+        pos = (pos + 1) & SCAN_MGR_HASH_MASK;
     }
 
-    return NULL;
+    return pos;
+}
+
+/*!
+    \brief      Remove a device from the scanned device list
+    \param[in]  p_dev_info: pointer to the device information
+    \param[out] none
+    \retval     none
+*/
+static void scan_mgr_remove_device(dev_info_t *p_dev_info)
+{
+    uint8_t pos = scan_mgr_hash_lookup(&p_dev_info->peer_addr);
+    uint8_t next = pos, home;
+
+    /* Shift back the following entries of the probe sequence, no tombstone is needed */
+    while (1) {
+        ble_scan_mgr_cb.hash[pos] = SCAN_MGR_HASH_FREE;
+
+        do {
+            next = (next + 1) & SCAN_MGR_HASH_MASK;
+            if (ble_scan_mgr_cb.hash[next] == SCAN_MGR_HASH_FREE) {
+                goto done;
+            }
+            home = scan_mgr_hash(&ble_scan_mgr_cb.devs[ble_scan_mgr_cb.hash[next]].peer_addr);
+        } while (((next - home) & SCAN_MGR_HASH_MASK) < ((next - pos) & SCAN_MGR_HASH_MASK));
+
+        ble_scan_mgr_cb.hash[pos] = ble_scan_mgr_cb.hash[next];
+        pos = next;
+    }
+
+done:
+    memset(p_dev_info, 0, sizeof(dev_info_t));
+    ble_scan_mgr_cb.dev_num--;
+}
+
+/*!
+    \brief      Remove the devices not seen for SCAN_MGR_DEV_AGE_MS
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void scan_mgr_age_devices(void)
+{
+    uint32_t now = sys_current_time_get();
+    uint8_t i;
+
+    for (i = 0; i < SCAN_MGR_DEV_NUM; i++) {
+        if (ble_scan_mgr_cb.devs[i].in_use &&
+            (now - ble_scan_mgr_cb.devs[i].last_seen) >= SCAN_MGR_DEV_AGE_MS) {
+            scan_mgr_remove_device(&ble_scan_mgr_cb.devs[i]);
+        }
+    }
 }
 
 /*!
-    \brief      Get scanned device list size
+    \brief      Make room for a new device when the scanned device list is full
     \param[in]  none
     \param[out] none
-    \retval     uint8_t: scanned device list size
+    \retval     none
+*/
+static void scan_mgr_evict_device(void)
+{
+    dev_info_t *p_victim = NULL;
+    dev_info_t *p_dev_info;
+    uint8_t i;
+
+    scan_mgr_age_devices();
+    if (ble_scan_mgr_cb.dev_num < SCAN_MGR_DEV_NUM) {
+        return;
+    }
+
+    /* All devices are still active, drop the weakest one, the least recently seen on a tie */
+    for (i = 0; i < SCAN_MGR_DEV_NUM; i++) {
+        p_dev_info = &ble_scan_mgr_cb.devs[i];
+        if (p_victim == NULL || p_dev_info->rssi < p_victim->rssi ||
+            (p_dev_info->rssi == p_victim->rssi &&
+             (int32_t)(p_dev_info->last_seen - p_victim->last_seen) < 0)) {
+            p_victim = p_dev_info;
+        }
+    }
+
+    scan_mgr_remove_device(p_victim);
+}
+
+/*!
+    \brief      Find device information by address in the scanned device list
+    \param[in]  p_peer_addr: pointer to peer device address
+    \param[out] none
+    \retval     dev_info_t *: pointer to the device information found
 */
-static uint8_t scan_mgr_list_size(void)
+dev_info_t *scan_mgr_find_device(ble_gap_addr_t *p_peer_addr)
 {
-    uint8_t num = 0;
-    dlist_t *pos, *n;
+    uint8_t pos;
 
-    if (list_empty(&ble_scan_mgr_cb.devs_list)) {
-        return 0;
+    if (ble_scan_mgr_cb.dev_num == 0) {
+        return NULL;
     }
 
-    list_for_each_safe(pos, n, &ble_scan_mgr_cb.devs_list) {
-        num++;
+    pos = scan_mgr_hash_lookup(p_peer_addr);
+    if (ble_scan_mgr_cb.hash[pos] == SCAN_MGR_HASH_FREE) {
+        return NULL;
     }
 
-    return num;
+    return &ble_scan_mgr_cb.devs[ble_scan_mgr_cb.hash[pos]];
 }
 
 /*!
@@ -112,32 +273,305 @@ static uint8_t scan_mgr_list_size(void)
 uint8_t scan_mgr_add_device(ble_gap_addr_t *p_peer_addr)
 {
     dev_info_t *p_dev_info = NULL;
+    uint8_t pos, idx;
 
-    p_dev_info = (dev_info_t *)sys_malloc(sizeof(dev_info_t));
-    if (p_dev_info) {
-        memset(p_dev_info, 0, sizeof(dev_info_t));
+    pos = scan_mgr_hash_lookup(p_peer_addr);
+    if (ble_scan_mgr_cb.hash[pos] != SCAN_MGR_HASH_FREE) {
+        return ble_scan_mgr_cb.hash[pos];
+    }
 
-        INIT_DLIST_HEAD(&p_dev_info->list);
-        p_dev_info->peer_addr = *p_peer_addr;
+    if (ble_scan_mgr_cb.dev_num >= SCAN_MGR_DEV_NUM) {
+        scan_mgr_evict_device();
+        /* Removing devices may have moved the end of the probe sequence */
+        pos = scan_mgr_hash_lookup(p_peer_addr);
+    }
 
-        list_add_tail(&p_dev_info->list, &ble_scan_mgr_cb.devs_list);
-        return scan_mgr_list_size() - 1;
+    /* Lowest free index, devices keep the discovery order until the list is full */
+    for (idx = 0; idx < SCAN_MGR_DEV_NUM; idx++) {
+        if (!ble_scan_mgr_cb.devs[idx].in_use) {
+            break;
+        }
     }
-    return 0xFF;
+
+    if (idx == SCAN_MGR_DEV_NUM) {
+        return 0xFF;
+    }
+
+    p_dev_info = &ble_scan_mgr_cb.devs[idx];
+    memset(p_dev_info, 0, sizeof(dev_info_t));
+    p_dev_info->peer_addr = *p_peer_addr;
+    p_dev_info->idx = idx;
+    p_dev_info->in_use = 1;
+    p_dev_info->rssi = 127;
+    p_dev_info->last_seen = sys_current_time_get();
+
+    ble_scan_mgr_cb.hash[pos] = idx;
+    ble_scan_mgr_cb.dev_num++;
+
+    return idx;
 }
 
 /*!
-    \brief      Function to handle @ref BLE_SCAN_EVT_ADV_RPT event
+    \brief      Update device information when a report of the device is delivered
+    \param[in]  p_dev_info: pointer to the device information
     \param[in]  p_info: pointer to advertising report information
     \param[out] none
     \retval     none
 */
-static void scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
+void scan_mgr_refresh_device(dev_info_t *p_dev_info, ble_gap_adv_report_info_t *p_info)
+{
+    uint8_t rsp = p_info->type.scan_response;
+
+    p_dev_info->rssi = p_info->rssi;
+    p_dev_info->last_seen = sys_current_time_get();
+    p_dev_info->rpt_hash[rsp] = scan_mgr_data_hash(p_info);
+    p_dev_info->rpt_time[rsp] = p_dev_info->last_seen;
+}
+
+/*!
+    \brief      Index the AD structures of advertising data
+    \param[in]  p_data: pointer to advertising data
+    \param[in]  data_len: advertising data length
+    \param[out] p_ad_idx: pointer to the advertising data index
+    \retval     none
+*/
+void scan_mgr_ad_parse(uint8_t *p_data, uint16_t data_len, scan_mgr_ad_idx_t *p_ad_idx)
+{
+    uint16_t pos = 0;
+    uint8_t len;
+
+    p_ad_idx->p_data = p_data;
+    p_ad_idx->num = 0;
+
+    /* Structures beyond SCAN_MGR_AD_MAX are not indexed */
+    while (pos + AD_DATA_HDR_SIZE <= data_len && p_ad_idx->num < SCAN_MGR_AD_MAX) {
+        len = p_data[pos];
+        if (len == 0) {
+            /* Early termination of the significant part */
+            break;
+        }
+
+        if (pos + AD_LEN_SIZE + len > data_len) {
+            break;
+        }
+
+        p_ad_idx->ad[p_ad_idx->num].type = p_data[pos + AD_LEN_SIZE];
+        p_ad_idx->ad[p_ad_idx->num].len = len - AD_TYPE_SIZE;
+        p_ad_idx->ad[p_ad_idx->num].offset = pos + AD_DATA_HDR_SIZE;
+        p_ad_idx->num++;
+
+        pos += AD_LEN_SIZE + len;
+    }
+}
+
+/*!
+    \brief      Find specific AD type in indexed advertising data
+    \param[in]  p_ad_idx: pointer to the advertising data index
+    \param[in]  ad_type: AD type to find
+    \param[out] p_len: pointer to value length found in the advertising data
+    \retval     uint8_t *: NULL if no such AD type in the advertising data, otherwise pointer to the value address
+*/
+uint8_t *scan_mgr_ad_find(scan_mgr_ad_idx_t *p_ad_idx, uint8_t ad_type, uint8_t *p_len)
+{
+    uint8_t i;
+
+    for (i = 0; i < p_ad_idx->num; i++) {
+        if (p_ad_idx->ad[i].type == ad_type) {
+            *p_len = p_ad_idx->ad[i].len;
+            return p_ad_idx->p_data + p_ad_idx->ad[i].offset;
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+    \brief      Find complete, or else short, local name in indexed advertising data
+    \param[in]  p_ad_idx: pointer to the advertising data index
+    \param[out] p_len: pointer to name length found in the advertising data
+    \retval     uint8_t *: NULL if no name in the advertising data, otherwise pointer to the name
+*/
+uint8_t *scan_mgr_ad_name_find(scan_mgr_ad_idx_t *p_ad_idx, uint8_t *p_len)
+{
+    uint8_t *p_name = scan_mgr_ad_find(p_ad_idx, BLE_AD_TYPE_COMPLETE_LOCAL_NAME, p_len);
+
+    if (p_name == NULL) {
+        p_name = scan_mgr_ad_find(p_ad_idx, BLE_AD_TYPE_SHORT_LOCAL_NAME, p_len);
+    }
+
+    return p_name;
+}
+
+/*!
+    \brief      Check if indexed advertising data contains a service UUID
+    \param[in]  p_ad_idx: pointer to the advertising data index
+    \param[in]  p_uuid: pointer to the service UUID
+    \param[out] none
+    \retval     bool: true if the UUID is in a service UUID list or is the UUID of a service data
+*/
+static bool scan_mgr_ad_uuid_match(scan_mgr_ad_idx_t *p_ad_idx, ble_uuid_t *p_uuid)
+{
+    uint8_t uuid[AD_TYPE_DATA_UUID_128_SIZE];
+    uint8_t uuid_len, list_type_more, list_type_cmpl, srv_data_type;
+    uint8_t *p_val;
+    uint8_t i, j;
+
+    switch (p_uuid->type) {
+    case BLE_UUID_TYPE_16:
+        uuid_len = AD_TYPE_DATA_UUID_16_SIZE;
+        uuid[0] = (uint8_t)p_uuid->data.uuid_16;
+        uuid[1] = (uint8_t)(p_uuid->data.uuid_16 >> 8);
+        list_type_more = BLE_AD_TYPE_SERVICE_UUID_16_MORE;
+        list_type_cmpl = BLE_AD_TYPE_SERVICE_UUID_16_COMPLETE;
+        srv_data_type = BLE_AD_TYPE_SERVICE_DATA_UUID_16;
+        break;
+
+    case BLE_UUID_TYPE_32:
+        uuid_len = AD_TYPE_DATA_UUID_32_SIZE;
+        for (i = 0; i < AD_TYPE_DATA_UUID_32_SIZE; i++) {
+            uuid[i] = (uint8_t)(p_uuid->data.uuid_32 >> (8 * i));
+        }
+        list_type_more = BLE_AD_TYPE_SERVICE_UUID_32_MORE;
+        list_type_cmpl = BLE_AD_TYPE_SERVICE_UUID_32_COMPLETE;
+        srv_data_type = BLE_AD_TYPE_SERVICE_DATA_UUID_32;
+        break;
+
+    default:
+        uuid_len = AD_TYPE_DATA_UUID_128_SIZE;
+        memcpy(uuid, p_uuid->data.uuid_128, AD_TYPE_DATA_UUID_128_SIZE);
+        list_type_more = BLE_AD_TYPE_SERVICE_UUID_128_MORE;
+        list_type_cmpl = BLE_AD_TYPE_SERVICE_UUID_128_COMPLETE;
+        srv_data_type = BLE_AD_TYPE_SERVICE_DATA_UUID_128;
+        break;
+    }
+
+    for (i = 0; i < p_ad_idx->num; i++) {
+        p_val = p_ad_idx->p_data + p_ad_idx->ad[i].offset;
+
+        if (p_ad_idx->ad[i].type == list_type_more || p_ad_idx->ad[i].type == list_type_cmpl) {
+            for (j = 0; j + uuid_len <= p_ad_idx->ad[i].len; j += uuid_len) {
+                if (!memcmp(&p_val[j], uuid, uuid_len)) {
+                    return true;
+                }
+            }
+        } else if (p_ad_idx->ad[i].type == srv_data_type) {
+            if (p_ad_idx->ad[i].len >= uuid_len && !memcmp(p_val, uuid, uuid_len)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*!
+    \brief      Filter an advertising report before it is handled, the advertising data is indexed
+                once and the report is dropped if it does not match the filter or if it repeats the
+                last report of the device within the duplicate suppression window
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] p_ad_idx: pointer to the advertising data index
+    \param[out] pp_dev_info: pointer to the scanned device information, NULL for a new device
+    \retval     bool: true if the report should be handled, otherwise false
+*/
+bool scan_mgr_report_filter(ble_gap_adv_report_info_t *p_info, scan_mgr_ad_idx_t *p_ad_idx,
+                            dev_info_t **pp_dev_info)
+{
+    scan_mgr_filter_t *p_filter = &ble_scan_mgr_cb.filter;
+    dev_info_t *p_dev_info;
+    uint8_t rsp = p_info->type.scan_response;
+    uint8_t *p_val;
+    uint8_t len;
+
+    *pp_dev_info = NULL;
+
+    /* Cheapest checks first, the advertising data is not parsed for a weak report */
+    if ((p_filter->match_bf & SCAN_MGR_FILTER_RSSI_BIT) && p_info->rssi < p_filter->rssi_min) {
+        return false;
+    }
+
+    p_dev_info = scan_mgr_find_device(&p_info->peer_addr);
+    if (p_dev_info && p_filter->dup_window && !ble_scan_mgr_cb.update_with_rssi &&
+        p_dev_info->rpt_time[rsp] && p_dev_info->rpt_hash[rsp] == scan_mgr_data_hash(p_info) &&
+        (sys_current_time_get() - p_dev_info->rpt_time[rsp]) < p_filter->dup_window) {
+        /* Keep the device from aging */
+        p_dev_info->rssi = p_info->rssi;
+        p_dev_info->last_seen = sys_current_time_get();
+        return false;
+    }
+
+    scan_mgr_ad_parse(p_info->data.p_data, p_info->data.len, p_ad_idx);
+
+    if ((p_filter->match_bf & SCAN_MGR_FILTER_AD_TYPE_BIT) &&
+        scan_mgr_ad_find(p_ad_idx, p_filter->ad_type, &len) == NULL) {
+        return false;
+    }
+
+    if ((p_filter->match_bf & SCAN_MGR_FILTER_MANUF_BIT)) {
+        p_val = scan_mgr_ad_find(p_ad_idx, BLE_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &len);
+        if (p_val == NULL || len < AD_TYPE_MANUF_SPEC_DATA_ID_SIZE ||
+            (p_val[0] | (p_val[1] << 8)) != p_filter->company_id) {
+            return false;
+        }
+    }
+
+    if ((p_filter->match_bf & SCAN_MGR_FILTER_UUID_BIT) &&
+        !scan_mgr_ad_uuid_match(p_ad_idx, &p_filter->uuid)) {
+        return false;
+    }
+
+    *pp_dev_info = p_dev_info;
+    return true;
+}
+
+/*!
+    \brief      Set advertising report filter
+    \param[in]  p_filter: pointer to the filter, NULL to restore the default filter
+    \param[out] none
+    \retval     none
+*/
+void scan_mgr_filter_set(scan_mgr_filter_t *p_filter)
+{
+    if (p_filter == NULL) {
+        memset(&ble_scan_mgr_cb.filter, 0, sizeof(scan_mgr_filter_t));
+        ble_scan_mgr_cb.filter.dup_window = SCAN_MGR_DUP_WINDOW_MS;
+        return;
+    }
+
+    ble_scan_mgr_cb.filter = *p_filter;
+}
+
+/*!
+    \brief      Get advertising report filter
+    \param[in]  none
+    \param[out] p_filter: pointer to the filter
+    \retval     none
+*/
+void scan_mgr_filter_get(scan_mgr_filter_t *p_filter)
+{
+    *p_filter = ble_scan_mgr_cb.filter;
+}
+
+/*!
+    \brief      Filter an advertising report and update the scanned device list, the mutex is held
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] none
+    \retval     none
+*/
+static void scan_mgr_report_proc(ble_gap_adv_report_info_t *p_info)
 {
     uint8_t *p_name = NULL;
     uint8_t name_len;
     uint8_t name[31] = {'\0'};
-    dev_info_t *p_dev_info = scan_mgr_find_device(&p_info->peer_addr);
+    scan_mgr_ad_idx_t ad_idx;
+    dev_info_t *p_dev_info;
+
+    if (!scan_mgr_report_filter(p_info, &ad_idx, &p_dev_info)) {
+        return;
+    }
+
+    if (p_dev_info) {
+        scan_mgr_refresh_device(p_dev_info, p_info);
+    }
 
     if (p_info->period_adv_intv) {
         #if BLE_APP_PER_ADV_SUPPORT
@@ -146,12 +580,7 @@ static void scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
     }
 
     if (p_dev_info == NULL || ble_scan_mgr_cb.update_with_rssi || p_dev_info->recv_name_flag == 0) {
-        p_name = ble_adv_find(p_info->data.p_data, p_info->data.len, BLE_AD_TYPE_COMPLETE_LOCAL_NAME,
-                              &name_len);
-        if (p_name == NULL) {
-            p_name = ble_adv_find(p_info->data.p_data, p_info->data.len, BLE_AD_TYPE_SHORT_LOCAL_NAME,
-                                  &name_len);
-        }
+        p_name = scan_mgr_ad_name_find(&ad_idx, &name_len);
 
         if (p_name) {
             memcpy(name, p_name, name_len > 30 ? 30 : name_len);
@@ -160,8 +589,11 @@ static void scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
         if (p_dev_info == NULL) {
             uint8_t idx = scan_mgr_add_device(&p_info->peer_addr);
             p_dev_info = scan_mgr_find_dev_by_idx(idx);
+            if (p_dev_info == NULL) {
+                return;
+            }
             p_dev_info->adv_sid = p_info->adv_sid;
-            p_dev_info->idx = idx;
+            scan_mgr_refresh_device(p_dev_info, p_info);
             dbg_print(NOTICE, "new device addr %02X:%02X:%02X:%02X:%02X:%02X, addr type 0x%x, rssi %d, sid 0x%x, dev idx %u, peri_adv_int %u, name %s\r\n",
                    p_info->peer_addr.addr[5], p_info->peer_addr.addr[4], p_info->peer_addr.addr[3],
                    p_info->peer_addr.addr[2], p_info->peer_addr.addr[1], p_info->peer_addr.addr[0],
@@ -177,6 +609,19 @@ static void scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
     }
 }
 
+/*!
+    \brief      Function to handle @ref BLE_SCAN_EVT_ADV_RPT event
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] none
+    \retval     none
+*/
+static void scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
+{
+    scan_mgr_lock();
+    scan_mgr_report_proc(p_info);
+    scan_mgr_unlock();
+}
+
 /*!
     \brief      Callback function to handle BLE scan events
     \param[in]  event: BLE scan event type
@@ -227,21 +672,28 @@ void ble_app_scan_mgr_evt_handler(ble_scan_evt_t event, ble_scan_data_u *p_data)
 void scan_mgr_list_scanned_devices(void)
 {
     dev_info_t *p_dev_info = NULL;
-    dlist_t *pos, *n;
-    uint8_t elt_idx = 0;
+    uint8_t i;
 
-    if (list_empty(&ble_scan_mgr_cb.devs_list)) {
+    scan_mgr_lock();
+    scan_mgr_age_devices();
+
+    if (ble_scan_mgr_cb.dev_num == 0) {
+        scan_mgr_unlock();
         dbg_print(NOTICE, "======= scan list empty =========\r\n");
         return;
     }
 
-    list_for_each_safe(pos, n, &ble_scan_mgr_cb.devs_list) {
-        p_dev_info = list_entry(pos, dev_info_t, list);
-        dbg_print(NOTICE, "dev idx: %u, device addr: %02X:%02X:%02X:%02X:%02X:%02X\r\n", elt_idx,
+    for (i = 0; i < SCAN_MGR_DEV_NUM; i++) {
+        p_dev_info = &ble_scan_mgr_cb.devs[i];
+        if (!p_dev_info->in_use) {
+            continue;
+        }
+        dbg_print(NOTICE, "dev idx: %u, device addr: %02X:%02X:%02X:%02X:%02X:%02X, rssi %d\r\n", i,
                p_dev_info->peer_addr.addr[5], p_dev_info->peer_addr.addr[4], p_dev_info->peer_addr.addr[3],
-               p_dev_info->peer_addr.addr[2], p_dev_info->peer_addr.addr[1], p_dev_info->peer_addr.addr[0]);
-        elt_idx++;
+               p_dev_info->peer_addr.addr[2], p_dev_info->peer_addr.addr[1], p_dev_info->peer_addr.addr[0],
+               p_dev_info->rssi);
     }
+    scan_mgr_unlock();
 }
 
 /*!
@@ -252,23 +704,11 @@ void scan_mgr_list_scanned_devices(void)
 */
 dev_info_t *scan_mgr_find_dev_by_idx(uint8_t idx)
 {
-    dev_info_t *p_dev_info = NULL;
-    dlist_t *pos, *n;
-    uint8_t elt_idx = 0;
-
-    if (list_empty(&ble_scan_mgr_cb.devs_list)) {
+    if (idx >= SCAN_MGR_DEV_NUM || !ble_scan_mgr_cb.devs[idx].in_use) {
         return NULL;
     }
 
-    list_for_each_safe(pos, n, &ble_scan_mgr_cb.devs_list) {
-        p_dev_info = list_entry(pos, dev_info_t, list);
-        if (elt_idx == idx) {
-            return p_dev_info;
-        }
-
-        elt_idx++;
-    }
-    return NULL;
+    return &ble_scan_mgr_cb.devs[idx];
 }
 
 /*!
@@ -279,18 +719,11 @@ dev_info_t *scan_mgr_find_dev_by_idx(uint8_t idx)
 */
 void scan_mgr_clear_dev_list(void)
 {
-    dev_info_t *p_dev_info = NULL;
-    dlist_t *pos, *n;
-
-    if (list_empty(&ble_scan_mgr_cb.devs_list)) {
-        return;
-    }
-
-    list_for_each_safe(pos, n, &ble_scan_mgr_cb.devs_list) {
-        p_dev_info = list_entry(pos, dev_info_t, list);
-        list_del(&p_dev_info->list);
-        sys_mfree((void *)p_dev_info);
-    }
+    scan_mgr_lock();
+    memset(ble_scan_mgr_cb.devs, 0, sizeof(ble_scan_mgr_cb.devs));
+    memset(ble_scan_mgr_cb.hash, SCAN_MGR_HASH_FREE, sizeof(ble_scan_mgr_cb.hash));
+    ble_scan_mgr_cb.dev_num = 0;
+    scan_mgr_unlock();
 }
 
 /*!
@@ -345,8 +778,13 @@ void app_scan_mgr_reset(void)
 */
 void app_scan_mgr_init(void)
 {
+    /* Kept after a deinit, the CLI task may still be listing the devices */
+    if (scan_mgr_mutex == NULL) {
+        sys_mutex_init(&scan_mgr_mutex);
+    }
     memset(&ble_scan_mgr_cb, 0, sizeof(ble_scan_mgr_cb));
-    INIT_DLIST_HEAD(&ble_scan_mgr_cb.devs_list);
+    scan_mgr_clear_dev_list();
+    scan_mgr_filter_set(NULL);
     ble_scan_callback_register(ble_app_scan_mgr_evt_handler);
 }
 
@@ -358,9 +796,9 @@ void app_scan_mgr_init(void)
 */
 void app_scan_mgr_deinit(void)
 {
+    ble_scan_callback_unregister(ble_app_scan_mgr_evt_handler);
     scan_mgr_clear_dev_list();
     memset(&ble_scan_mgr_cb, 0, sizeof(ble_scan_mgr_cb));
-    ble_scan_callback_unregister(ble_app_scan_mgr_evt_handler);
 }
 
 #endif // (BLE_APP_SUPPORT && (BLE_CFG_ROLE & (BLE_CFG_ROLE_OBSERVER | BLE_CFG_ROLE_CENTRAL)))
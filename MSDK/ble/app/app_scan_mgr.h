@@ -35,17 +35,73 @@ OF SUCH DAMAGE.
 #ifndef APP_SCAN_MGR_H_
 #define APP_SCAN_MGR_H_
 
-#include "dlist.h"
 #include "ble_gap.h"
 
+/* Maximum number of devices in the scanned device list, a power of 2 not greater than 128 */
+#ifndef SCAN_MGR_DEV_NUM
+#define SCAN_MGR_DEV_NUM        64
+#endif
+
+/* Devices not seen for this time (in ms) are removed from the scanned device list */
+#ifndef SCAN_MGR_DEV_AGE_MS
+#define SCAN_MGR_DEV_AGE_MS     30000
+#endif
+
+/* Maximum number of AD structures indexed in an advertising report */
+#ifndef SCAN_MGR_AD_MAX
+#define SCAN_MGR_AD_MAX         16
+#endif
+
+/* Default time (in ms) an unchanged report of a device is suppressed for, 0 to deliver all reports */
+#ifndef SCAN_MGR_DUP_WINDOW_MS
+#define SCAN_MGR_DUP_WINDOW_MS  1000
+#endif
+
+/* Match conditions of the advertising report filter */
+#define SCAN_MGR_FILTER_RSSI_BIT    (1 << 0)    /*!< RSSI not lower than rssi_min */
+#define SCAN_MGR_FILTER_AD_TYPE_BIT (1 << 1)    /*!< AD type ad_type present */
+#define SCAN_MGR_FILTER_UUID_BIT    (1 << 2)    /*!< Service UUID or service data of uuid present */
+#define SCAN_MGR_FILTER_MANUF_BIT   (1 << 3)    /*!< Manufacturer specific data of company_id present */
+
+/* Structure of advertising report filter */
+typedef struct scan_mgr_filter
+{
+    uint8_t     match_bf;           /*!< Match conditions, all must be met, @ref SCAN_MGR_FILTER_RSSI_BIT */
+    int8_t      rssi_min;           /*!< Minimum RSSI */
+    uint8_t     ad_type;            /*!< AD type */
+    uint16_t    company_id;         /*!< Company identifier code */
+    ble_uuid_t  uuid;               /*!< Service UUID */
+    uint16_t    dup_window;         /*!< Time in ms an unchanged report is suppressed for, 0 to disable */
+} scan_mgr_filter_t;
+
+/* Structure of an AD structure position in the advertising data */
+typedef struct scan_mgr_ad
+{
+    uint8_t     type;               /*!< AD type */
+    uint8_t     len;                /*!< AD data length */
+    uint16_t    offset;             /*!< Offset of AD data in the advertising data */
+} scan_mgr_ad_t;
+
+/* Structure of advertising data index, built with a single pass over the advertising data */
+typedef struct scan_mgr_ad_idx
+{
+    uint8_t        *p_data;                 /*!< Pointer to advertising data */
+    uint8_t         num;                    /*!< Number of AD structures */
+    scan_mgr_ad_t   ad[SCAN_MGR_AD_MAX];    /*!< AD structures */
+} scan_mgr_ad_idx_t;
+
 /* Structure of scanned device information */
 typedef struct dev_info
 {
-    dlist_t        list;            /*!< Device list header */
     ble_gap_addr_t peer_addr;       /*!< Peer device address */
     uint8_t        adv_sid;         /*!< Advertising set ID */
     uint8_t        idx;             /*!< Device index */
     uint8_t        recv_name_flag;  /*!< Receive name flag */
+    uint8_t        in_use;          /*!< Entry used by a device */
+    int8_t         rssi;            /*!< RSSI of the last report */
+    uint32_t       last_seen;       /*!< Time of the last report in ms */
+    uint16_t       rpt_hash[2];     /*!< Hash of the last advertising and scan response data delivered */
+    uint32_t       rpt_time[2];     /*!< Time of the last advertising and scan response data delivered */
 } dev_info_t;
 
 /*!
@@ -56,6 +112,69 @@ typedef struct dev_info
 */
 dev_info_t *scan_mgr_find_device(ble_gap_addr_t *p_peer_addr);
 
+/*!
+    \brief      Update device information when a report of the device is delivered
+    \param[in]  p_dev_info: pointer to the device information
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] none
+    \retval     none
+*/
+void scan_mgr_refresh_device(dev_info_t *p_dev_info, ble_gap_adv_report_info_t *p_info);
+
+/*!
+    \brief      Index the AD structures of advertising data
+    \param[in]  p_data: pointer to advertising data
+    \param[in]  data_len: advertising data length
+    \param[out] p_ad_idx: pointer to the advertising data index
+    \retval     none
+*/
+void scan_mgr_ad_parse(uint8_t *p_data, uint16_t data_len, scan_mgr_ad_idx_t *p_ad_idx);
+
+/*!
+    \brief      Find specific AD type in indexed advertising data
+    \param[in]  p_ad_idx: pointer to the advertising data index
+    \param[in]  ad_type: AD type to find
+    \param[out] p_len: pointer to value length found in the advertising data
+    \retval     uint8_t *: NULL if no such AD type in the advertising data, otherwise pointer to the value address
+*/
+uint8_t *scan_mgr_ad_find(scan_mgr_ad_idx_t *p_ad_idx, uint8_t ad_type, uint8_t *p_len);
+
+/*!
+    \brief      Find complete, or else short, local name in indexed advertising data
+    \param[in]  p_ad_idx: pointer to the advertising data index
+    \param[out] p_len: pointer to name length found in the advertising data
+    \retval     uint8_t *: NULL if no name in the advertising data, otherwise pointer to the name
+*/
+uint8_t *scan_mgr_ad_name_find(scan_mgr_ad_idx_t *p_ad_idx, uint8_t *p_len);
+
+/*!
+    \brief      Filter an advertising report before it is handled, the advertising data is indexed
+                once and the report is dropped if it does not match the filter or if it repeats the
+                last report of the device within the duplicate suppression window
+    \param[in]  p_info: pointer to advertising report information
+    \param[out] p_ad_idx: pointer to the advertising data index
+    \param[out] pp_dev_info: pointer to the scanned device information, NULL for a new device
+    \retval     bool: true if the report should be handled, otherwise false
+*/
+bool scan_mgr_report_filter(ble_gap_adv_report_info_t *p_info, scan_mgr_ad_idx_t *p_ad_idx,
+                            dev_info_t **pp_dev_info);
+
+/*!
+    \brief      Set advertising report filter
+    \param[in]  p_filter: pointer to the filter, NULL to restore the default filter
+    \param[out] none
+    \retval     none
+*/
+void scan_mgr_filter_set(scan_mgr_filter_t *p_filter);
+
+/*!
+    \brief      Get advertising report filter
+    \param[in]  none
+    \param[out] p_filter: pointer to the filter
+    \retval     none
+*/
+void scan_mgr_filter_get(scan_mgr_filter_t *p_filter);
+
 /*!
     \brief      List all the scanned devices
     \param[in]  none
@@ -124,7 +243,8 @@ void app_scan_mgr_deinit(void);
     \brief      Add device into scanned device list
     \param[in]  p_peer_addr: pointer to peer device address
     \param[out] none
-    \retval     uint8_t: 0xFF if add device fail, otherwise index in the list
+    \retval     uint8_t: 0xFF if add device fail, otherwise index in the list. When the list is full
+                the device replaces the aged devices, or else the device with the weakest RSSI
 */
 uint8_t scan_mgr_add_device(ble_gap_addr_t *p_peer_addr);
 #endif // APP_SCAN_MGR_H_
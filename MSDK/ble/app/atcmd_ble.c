@@ -1434,7 +1434,16 @@ static void at_ble_scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
     uint8_t *p_name = NULL;
     uint8_t name_len;
     uint8_t name[31] = {'\0'};
-    dev_info_t *p_dev_info = scan_mgr_find_device(&p_info->peer_addr);
+    scan_mgr_ad_idx_t ad_idx;
+    dev_info_t *p_dev_info;
+
+    if (!scan_mgr_report_filter(p_info, &ad_idx, &p_dev_info)) {
+        return;
+    }
+
+    if (p_dev_info) {
+        scan_mgr_refresh_device(p_dev_info, p_info);
+    }
 
     if (p_info->period_adv_intv) {
         #if BLE_APP_PER_ADV_SUPPORT
@@ -1443,12 +1452,7 @@ static void at_ble_scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
     }
 
     if (p_dev_info == NULL || p_dev_info->recv_name_flag == 0) {
-        p_name = ble_adv_find(p_info->data.p_data, p_info->data.len, BLE_AD_TYPE_COMPLETE_LOCAL_NAME,
-                              &name_len);
-        if (p_name == NULL) {
-            p_name = ble_adv_find(p_info->data.p_data, p_info->data.len, BLE_AD_TYPE_SHORT_LOCAL_NAME,
-                                  &name_len);
-        }
+        p_name = scan_mgr_ad_name_find(&ad_idx, &name_len);
 
         if (p_name) {
             memcpy(name, p_name, name_len > 30 ? 30 : name_len);
@@ -1456,11 +1460,15 @@ static void at_ble_scan_mgr_report_hdlr(ble_gap_adv_report_info_t *p_info)
 
         if (p_dev_info == NULL) {
             uint8_t idx = scan_mgr_add_device(&p_info->peer_addr);
-            AT_RSP_START(256);
 
             p_dev_info = scan_mgr_find_dev_by_idx(idx);
+            if (p_dev_info == NULL) {
+                return;
+            }
             p_dev_info->adv_sid = p_info->adv_sid;
-            p_dev_info->idx = idx;
+            scan_mgr_refresh_device(p_dev_info, p_info);
+
+            AT_RSP_START(256);
 
             AT_RSP("+BLESCAN: %02X:%02X:%02X:%02X:%02X:%02X, addr type 0x%x, rssi %d, sid 0x%x, dev idx %u, peri_adv_int %u, name %s\r\n",
                    p_info->peer_addr.addr[5], p_info->peer_addr.addr[4], p_info->peer_addr.addr[3],
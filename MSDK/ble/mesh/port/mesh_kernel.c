@@ -6,6 +6,7 @@
 
 #include "mesh_cfg.h"
 #include "mesh_kernel.h"
+#include "sys/mesh_atomic.h"
 #include "wrapper_os.h"
 
 #if defined(PLATFORM_OS_FREERTOS)
@@ -165,58 +166,94 @@ void k_sem_free(struct k_sem *sem)
 
 int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout)
 {
-    int32_t status;
-    if (slab->sema_count == NULL) {
-        if (sys_sema_init_ext(&slab->sema_count, slab->num_blocks, slab->num_blocks) != OS_OK) {
-            return -EAGAIN;
+    atomic_val_t head, new_head, used, max;
+    uint32_t idx, next;
+
+    while (1) {
+        head = atomic_get(&slab->free_list);
+        idx = (uint32_t)head & 0xFFFF;
+        if (idx == K_MEM_SLAB_LIST_END) {
+            break;
+        }
+        /* The block may be taken by another context meanwhile, the tag makes the CAS fail then */
+        next = *(volatile uint32_t *)(slab->buffer + idx * slab->block_size);
+        if (next != K_MEM_SLAB_LIST_END && next >= slab->num_blocks) {
+            if (atomic_get(&slab->free_list) != head) {
+                continue;
+            }
+            /* Still the first free block, its link word was overwritten after the free */
+            LOG_ERR("slab %p: free block %u corrupted", slab, idx);
+            return -ENOMEM;
+        }
+        new_head = (atomic_val_t)((((uint32_t)head + 0x10000) & 0xFFFF0000) | next);
+        if (atomic_cas(&slab->free_list, head, new_head)) {
+            break;
         }
     }
 
-    if (sys_sema_get_count(&slab->sema_count) == 0) {
+    if (idx != K_MEM_SLAB_LIST_END && atomic_test_and_set_bit(slab->allocated, idx)) {
+        /* The block was on the free list while allocated, leave it to its owner */
+        LOG_ERR("slab %p: free block %u in use", slab, idx);
         return -ENOMEM;
     }
 
-    if (timeout.ticks == 0) {
-        timeout.ticks = MS_PER_TICKS;
-    }
-
-    if (timeout.ticks == -1) {
-        status = sys_sema_down(&slab->sema_count, 0);
-    } else {
-        status = sys_sema_down(&slab->sema_count, timeout.ticks / MS_PER_TICKS);
+    if (idx == K_MEM_SLAB_LIST_END) {
+        do {
+            idx = (uint32_t)atomic_get(&slab->num_carved);
+            if (idx >= slab->num_blocks) {
+                return -ENOMEM;
+            }
+        } while (!atomic_cas(&slab->num_carved, idx, idx + 1));
+        atomic_set_bit(slab->allocated, idx);
     }
 
-    if (status == OS_TIMEOUT || status != OS_OK) {
-        return -EAGAIN;
-    }
+    used = atomic_inc(&slab->num_used) + 1;
+    do {
+        max = atomic_get(&slab->max_used);
+    } while (used > max && !atomic_cas(&slab->max_used, max, used));
 
-    *mem = sys_malloc(slab->block_size);
+    *mem = slab->buffer + idx * slab->block_size;
     return 0;
 }
 
 void k_mem_slab_free(struct k_mem_slab *slab, void *mem)
 {
-    if (slab->sema_count == NULL) {
-        sys_sema_init_ext(&slab->sema_count, slab->num_blocks, slab->num_blocks);
+    atomic_val_t head, new_head;
+    size_t offset = (size_t)((char *)mem - slab->buffer);
+    uint32_t idx = offset / slab->block_size;
+
+    if (idx >= slab->num_blocks || offset % slab->block_size) {
+        LOG_ERR("slab %p: free of %p, not a block", slab, mem);
+        return;
+    }
+
+    if (!atomic_test_and_clear_bit(slab->allocated, idx)) {
+        LOG_ERR("slab %p: double free of block %u", slab, idx);
         return;
     }
 
-    sys_mfree(mem);
-    sys_sema_up(slab->sema_count);
-    return;
+    do {
+        head = atomic_get(&slab->free_list);
+        *(volatile uint32_t *)mem = (uint32_t)head & 0xFFFF;
+        new_head = (atomic_val_t)((((uint32_t)head + 0x10000) & 0xFFFF0000) | idx);
+    } while (!atomic_cas(&slab->free_list, head, new_head));
+
+    atomic_dec(&slab->num_used);
 }
 
 uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab)
 {
-    if (slab->sema_count == NULL) {
-        if (sys_sema_init_ext(&slab->sema_count, slab->num_blocks, slab->num_blocks) != OS_OK) {
-            return 0;
-        } else {
-            return slab->num_blocks;
-        }
-    }
+    return slab->num_blocks - (uint32_t)atomic_get(&slab->num_used);
+}
+
+uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab)
+{
+    return (uint32_t)atomic_get(&slab->num_used);
+}
 
-    return sys_sema_get_count(&slab->sema_count);
+uint32_t k_mem_slab_max_used_get(struct k_mem_slab *slab)
+{
+    return (uint32_t)atomic_get(&slab->max_used);
 }
 
 
@@ -13,6 +13,7 @@
 #include <limits.h>
 #include <sys/types.h>
 #include "sys/slist.h"
+#include "sys/atomic_types.h"
 #include "mesh_errno.h"
 
 
@@ -85,19 +86,81 @@ void k_sem_give(struct k_sem *sem);
 
 void k_sem_free(struct k_sem *sem);
 
+/* Index of the first free block in k_mem_slab::free_list when the list is empty */
+#define K_MEM_SLAB_LIST_END     0xFFFFU
+
+/* Block size rounded up so that the first word of a free block can link the free list */
+#define K_MEM_SLAB_BLOCK_SIZE(size)     (((size) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+
+/*
+ * Fixed-size block allocator over a static buffer.
+ *
+ * The free blocks are linked by index in a lock free stack, the index of
+ * the first free block is stored with a tag in the low 16 bits of
+ * free_list, the tag in the high 16 bits changes on every update so that
+ * a block popped and pushed again between the load and the CAS of another
+ * context is detected. Blocks never allocated are not on the list, they
+ * are carved in order from the buffer, so a slab needs no init.
+ *
+ * A bit per block records whether it is allocated: a double free or the
+ * free of a pointer outside the slab is refused, and a free block whose
+ * link word was overwritten is reported instead of handed out.
+ *
+ * Allocation and free are O(1) and can run in an ISR.
+ */
 struct k_mem_slab
 {
-    void  *sema_count;
-    uint32_t num_blocks;
+    char    *buffer;        /* num_blocks blocks of block_size bytes */
+    uint32_t num_blocks;    /* at most K_MEM_SLAB_LIST_END */
     size_t   block_size;
+    atomic_t free_list;     /* tag << 16 | index of the first free block */
+    atomic_t num_carved;    /* number of blocks taken from the buffer at least once */
+    atomic_t num_used;      /* number of blocks allocated */
+    atomic_t max_used;      /* high-water mark of num_used */
+    atomic_t *allocated;    /* bit set while the block is allocated */
 };
 
+/* Number of atomic_t words of the allocated bitmap of a slab */
+#define K_MEM_SLAB_BITMAP_SIZE(num_blocks)  \
+    (((num_blocks) + sizeof(atomic_t) * 8 - 1) / (sizeof(atomic_t) * 8))
+
+/**
+ * @brief Statically define and initialize a memory slab.
+ *
+ * @param name Name of the memory slab.
+ * @param slab_block_size Size of each block in bytes, a multiple of @p slab_align.
+ * @param slab_num_blocks Number of blocks.
+ * @param slab_align Alignment of the buffer in bytes, at least 4.
+ */
+#define K_MEM_SLAB_DEFINE_STATIC(name, slab_block_size, slab_num_blocks, slab_align)      \
+    static char __attribute__((aligned(slab_align)))                                    \
+        _k_mem_slab_buf_##name[(slab_num_blocks) * K_MEM_SLAB_BLOCK_SIZE(slab_block_size)]; \
+    static atomic_t _k_mem_slab_bits_##name[K_MEM_SLAB_BITMAP_SIZE(slab_num_blocks)];   \
+    static struct k_mem_slab name = {                                                   \
+        .buffer = _k_mem_slab_buf_##name,                                               \
+        .num_blocks = (slab_num_blocks),                                                \
+        .block_size = K_MEM_SLAB_BLOCK_SIZE(slab_block_size),                           \
+        .free_list = K_MEM_SLAB_LIST_END,                                               \
+        .num_carved = 0,                                                                \
+        .num_used = 0,                                                                  \
+        .max_used = 0,                                                                  \
+        .allocated = _k_mem_slab_bits_##name,                                           \
+    }
+
+/* Allocate a block, return -ENOMEM at once if none is free, timeout is not used */
 int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout);
 
+/* Free a block allocated from slab, can be called from an ISR. A pointer
+   that is not an allocated block of the slab is logged and ignored. */
 void k_mem_slab_free(struct k_mem_slab *slab, void *mem);
 
 uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab);
 
+uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab);
+
+/* Highest number of blocks allocated at the same time since boot */
+uint32_t k_mem_slab_max_used_get(struct k_mem_slab *slab);
+
 enum
 {
     /**
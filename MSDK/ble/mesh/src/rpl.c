@@ -41,6 +41,16 @@ static struct bt_mesh_rpl replay_list[CONFIG_BT_MESH_CRPL];
 //static ATOMIC_DEFINE(store, CONFIG_BT_MESH_CRPL);
 static atomic_t store[ATOMIC_BITMAP_SIZE(CONFIG_BT_MESH_CRPL)];
 
+/* Open addressing index of replay_list by source address. The index is
+ * twice the list size and stores list slot + 1, 0 is a free bucket. It is
+ * rebuilt whenever entries are moved or cleared in bulk.
+ */
+#define RPL_IDX_SIZE (2 * CONFIG_BT_MESH_CRPL)
+
+static uint16_t rpl_index[RPL_IDX_SIZE];
+/* No free slot in replay_list below this one */
+static uint16_t rpl_free_hint;
+
 
 enum {
 	PENDING_CLEAR,
@@ -56,6 +66,109 @@ static inline int rpl_idx(const struct bt_mesh_rpl *rpl)
 	return rpl - &replay_list[0];
 }
 
+static inline uint32_t rpl_hash(uint16_t src)
+{
+	return ((uint64_t)((uint32_t)src * 2654435761U) * RPL_IDX_SIZE) >> 32;
+}
+
+static inline uint32_t rpl_step(uint32_t pos)
+{
+	return (pos + 1 == RPL_IDX_SIZE) ? 0 : pos + 1;
+}
+
+static inline uint32_t rpl_dist(uint32_t from, uint32_t to)
+{
+	return (to >= from) ? to - from : to + RPL_IDX_SIZE - from;
+}
+
+static struct bt_mesh_rpl *bt_mesh_rpl_find(uint16_t src)
+{
+	uint32_t pos;
+
+	if (!src) {
+		return NULL;
+	}
+
+	for (pos = rpl_hash(src); rpl_index[pos]; pos = rpl_step(pos)) {
+		if (replay_list[rpl_index[pos] - 1].src == src) {
+			return &replay_list[rpl_index[pos] - 1];
+		}
+	}
+
+	return NULL;
+}
+
+static void rpl_index_add(struct bt_mesh_rpl *rpl)
+{
+	uint32_t pos;
+
+	for (pos = rpl_hash(rpl->src); rpl_index[pos]; pos = rpl_step(pos)) {
+	}
+
+	rpl_index[pos] = rpl_idx(rpl) + 1;
+}
+
+static void rpl_index_del(struct bt_mesh_rpl *rpl)
+{
+	uint32_t pos, next, home;
+
+	pos = rpl_hash(rpl->src);
+	while (rpl_index[pos] != rpl_idx(rpl) + 1) {
+		if (!rpl_index[pos]) {
+			return;
+		}
+		pos = rpl_step(pos);
+	}
+
+	/* Shift back the rest of the probe sequence, no tombstone is needed */
+	for (next = rpl_step(pos); rpl_index[next]; next = rpl_step(next)) {
+		home = rpl_hash(replay_list[rpl_index[next] - 1].src);
+		if (rpl_dist(home, next) >= rpl_dist(pos, next)) {
+			rpl_index[pos] = rpl_index[next];
+			pos = next;
+		}
+	}
+
+	rpl_index[pos] = 0;
+
+	if (rpl_idx(rpl) < rpl_free_hint) {
+		rpl_free_hint = rpl_idx(rpl);
+	}
+}
+
+static void rpl_index_rebuild(void)
+{
+	int i;
+
+	(void)memset(rpl_index, 0, sizeof(rpl_index));
+	rpl_free_hint = ARRAY_SIZE(replay_list);
+
+	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
+		if (!replay_list[i].src) {
+			if (i < rpl_free_hint) {
+				rpl_free_hint = i;
+			}
+			continue;
+		}
+
+		/* Lookups return the first entry of a source, as the linear scan did */
+		if (!bt_mesh_rpl_find(replay_list[i].src)) {
+			rpl_index_add(&replay_list[i]);
+		}
+	}
+}
+
+static struct bt_mesh_rpl *rpl_free_slot(void)
+{
+	for (; rpl_free_hint < ARRAY_SIZE(replay_list); rpl_free_hint++) {
+		if (!replay_list[rpl_free_hint].src) {
+			return &replay_list[rpl_free_hint];
+		}
+	}
+
+	return NULL;
+}
+
 static void clear_rpl(struct bt_mesh_rpl *rpl)
 {
 	int err;
@@ -99,7 +212,13 @@ void bt_mesh_rpl_update(struct bt_mesh_rpl *rpl,
 		rpl->seg = 0;
 	}
 
-	rpl->src = rx->ctx.addr;
+	if (rpl->src != rx->ctx.addr) {
+		if (rpl->src) {
+			rpl_index_del(rpl);
+		}
+		rpl->src = rx->ctx.addr;
+		rpl_index_add(rpl);
+	}
 	rpl->seq = rx->seq;
 	rpl->old_iv = rx->old_iv;
 
@@ -117,7 +236,6 @@ void bt_mesh_rpl_update(struct bt_mesh_rpl *rpl,
 bool bt_mesh_rpl_check(struct bt_mesh_net_rx *rx, struct bt_mesh_rpl **match, bool bridge)
 {
 	struct bt_mesh_rpl *rpl;
-	int i;
 
 	/* Don't bother checking messages from ourselves */
 	if (rx->net_if == BT_MESH_NET_IF_LOCAL) {
@@ -129,42 +247,40 @@ bool bt_mesh_rpl_check(struct bt_mesh_net_rx *rx, struct bt_mesh_rpl **match, bo
 		return false;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		rpl = &replay_list[i];
-
+	rpl = bt_mesh_rpl_find(rx->ctx.addr);
+	if (!rpl) {
 		/* Empty slot */
-		if (!rpl->src) {
-			goto match;
+		rpl = rpl_free_slot();
+		if (!rpl) {
+			LOG_ERR("RPL is full!");
+			return true;
 		}
 
-		/* Existing slot for given address */
-		if (rpl->src == rx->ctx.addr) {
-			if (!rpl->old_iv &&
-			    atomic_test_bit(rpl_flags, PENDING_RESET) &&
-			    !atomic_test_bit(store, i)) {
-				/* Until rpl reset is finished, entry with old_iv == false and
-				 * without "store" bit set will be removed, therefore it can be
-				 * reused. If such entry is reused, "store" bit will be set and
-				 * the entry won't be removed.
-				 */
-				goto match;
-			}
+		goto match;
+	}
 
-			if (rx->old_iv && !rpl->old_iv) {
-				return true;
-			}
+	/* Existing slot for given address */
+	if (!rpl->old_iv &&
+	    atomic_test_bit(rpl_flags, PENDING_RESET) &&
+	    !atomic_test_bit(store, rpl_idx(rpl))) {
+		/* Until rpl reset is finished, entry with old_iv == false and
+		 * without "store" bit set will be removed, therefore it can be
+		 * reused. If such entry is reused, "store" bit will be set and
+		 * the entry won't be removed.
+		 */
+		goto match;
+	}
 
-			if ((!rx->old_iv && rpl->old_iv) ||
-			    rpl->seq < rx->seq) {
-				goto match;
-			} else {
-				return true;
-			}
-		}
+	if (rx->old_iv && !rpl->old_iv) {
+		return true;
 	}
 
-	LOG_ERR("RPL is full!");
-	return true;
+	if ((!rx->old_iv && rpl->old_iv) ||
+	    rpl->seq < rx->seq) {
+		goto match;
+	} else {
+		return true;
+	}
 
 match:
 	if (match) {
@@ -182,6 +298,7 @@ void bt_mesh_rpl_clear(void)
 
 	if (!IS_ENABLED(CONFIG_BT_SETTINGS)) {
 		(void)memset(replay_list, 0, sizeof(replay_list));
+		rpl_index_rebuild();
 		return;
 	}
 
@@ -190,31 +307,16 @@ void bt_mesh_rpl_clear(void)
 	bt_mesh_settings_store_schedule(BT_MESH_SETTINGS_RPL_PENDING);
 }
 
-static struct bt_mesh_rpl *bt_mesh_rpl_find(uint16_t src)
-{
-	int i;
-
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		if (replay_list[i].src == src) {
-			return &replay_list[i];
-		}
-	}
-
-	return NULL;
-}
-
 static struct bt_mesh_rpl *bt_mesh_rpl_alloc(uint16_t src)
 {
-	int i;
+	struct bt_mesh_rpl *rpl = rpl_free_slot();
 
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		if (!replay_list[i].src) {
-			replay_list[i].src = src;
-			return &replay_list[i];
-		}
+	if (rpl) {
+		rpl->src = src;
+		rpl_index_add(rpl);
 	}
 
-	return NULL;
+	return rpl;
 }
 
 void bt_mesh_rpl_reset(void)
@@ -268,6 +370,7 @@ void bt_mesh_rpl_reset(void)
 		}
 
 		(void)memset(&replay_list[last - shift + 1], 0, sizeof(struct bt_mesh_rpl) * shift);
+		rpl_index_rebuild();
 	}
 }
 
@@ -290,6 +393,7 @@ static int rpl_set(const char *name, size_t len_rd,
 	if (len_rd == 0) {
 		LOG_DBG("val (null)");
 		if (entry) {
+			rpl_index_del(entry);
 			(void)memset(entry, 0, sizeof(*entry));
 		} else {
 			LOG_WRN("Unable to find RPL entry for 0x%04x", src);
@@ -430,6 +534,10 @@ void bt_mesh_rpl_pending_store(uint16_t addr)
 	if (addr == BT_MESH_ADDR_ALL_NODES) {
 		(void)memset(&replay_list[last - shift + 1], 0, sizeof(struct bt_mesh_rpl) * shift);
 	}
+
+	if (shift > 0) {
+		rpl_index_rebuild();
+	}
 }
 
 #if (CONFIG_MESH_CB_REGISTERED)
@@ -39,9 +39,11 @@
 
 struct settings_key_cb
 {
+    /* first member, cb_arg of the loaded key is also printed as its name */
     char key_name[16];
     uint16_t  val_len;
     struct settings_key_cb *next;
+    uint8_t val[];
 };
 
 #if (CONFIG_BT_SETTINGS)
@@ -58,6 +60,7 @@ struct mesh_settings_cb
     k_ticks_t timer_period;
 #endif
     struct settings_key_cb *key_list;
+    struct settings_key_cb *key_tail;
 };
 
 static struct mesh_settings_cb mesh_settings = {
@@ -69,6 +72,7 @@ static struct mesh_settings_cb mesh_settings = {
     .flags = 0,
 #endif
     .key_list = NULL,
+    .key_tail = NULL,
 };
 
 #if (!CONFIG_BT_MESH_SETTINGS_WORKQ)
@@ -78,6 +82,14 @@ static struct k_work_delayable pending_store;
 //static ATOMIC_DEFINE(pending_flags, BT_MESH_SETTINGS_FLAG_COUNT);
 static atomic_t pending_flags[ATOMIC_BITMAP_SIZE(BT_MESH_SETTINGS_FLAG_COUNT)];
 
+/* nvds transaction collecting the writes of one store_pending() pass, only the
+ * task running that pass stages into it, other callers write to nvds directly
+ */
+static void *store_txn;
+static os_task_t store_txn_owner;
+/* largest value an nvds transaction can stage */
+#define SETTINGS_TXN_VAL_MAX    256
+
 
 #ifdef CONFIG_BT_MESH_RPL_STORE_TIMEOUT
 #define RPL_STORE_TIMEOUT CONFIG_BT_MESH_RPL_STORE_TIMEOUT
@@ -273,8 +285,22 @@ void bt_mesh_settings_store_cancel(enum bt_mesh_settings_flag flag)
 
 static void store_pending(struct k_work *work)
 {
+    bool txn_owner = false;
+
     LOG_DBG("");
 
+    /* a pass already running in another task keeps its transaction, this one writes directly */
+    sys_enter_critical();
+    if (store_txn_owner == NULL) {
+        store_txn_owner = sys_current_task_handle_get();
+        txn_owner = true;
+    }
+    sys_exit_critical();
+
+    if (txn_owner) {
+        store_txn = nvds_txn_begin(NULL);
+    }
+
     if (atomic_test_and_clear_bit(pending_flags, BT_MESH_SETTINGS_RPL_PENDING)) {
         bt_mesh_rpl_pending_store(BT_MESH_ADDR_ALL_NODES);
     }
@@ -356,6 +382,13 @@ static void store_pending(struct k_work *work)
         bt_mesh_brg_cfg_pending_store();
     }
 
+    if (txn_owner) {
+        if (store_txn && (nvds_txn_commit(store_txn) != NVDS_OK)) {
+            LOG_ERR("Failed to commit pending settings");
+        }
+        store_txn = NULL;
+        store_txn_owner = NULL;
+    }
 }
 
 #if CONFIG_BT_MESH_SETTINGS_WORKQ
@@ -410,37 +443,60 @@ static void mesh_settings_work_timeout(void *p_tmr, void *p_arg)
 }
 #endif
 
-static void mesh_settings_found_keys_cb(const char *namespace, const char *key, uint16_t val_len)
+/* Value read back from the copy made by mesh_settings_load_key_cb() */
+static int32_t mesh_settings_loaded_read_cb(void *cb_arg, void *data, size_t len)
 {
-    struct settings_key_cb *alloc_key = sys_malloc(sizeof(struct settings_key_cb));
+    struct settings_key_cb *key = cb_arg;
 
-    if (alloc_key) {
-        strncpy(alloc_key->key_name, key, 16);
-        alloc_key->val_len = val_len;
-        alloc_key->next = NULL;
-        if (mesh_settings.key_list == NULL) {
-            mesh_settings.key_list = alloc_key;
+    if (len < key->val_len) {
+        LOG_ERR("settings Failed to read %s value, length %d", key->key_name, len);
+        return -EINVAL;
+    }
+
+    memcpy(data, key->val, key->val_len);
+
+    return key->val_len;
+}
+
+static int mesh_settings_load_key_cb(const char *key, const uint8_t *data, uint32_t length, void *arg)
+{
+    struct settings_key_cb *alloc_key = sys_malloc(sizeof(struct settings_key_cb) + length);
+
+    if (alloc_key == NULL) {
+        LOG_ERR("settings no memory to load %s", key);
+        return 0;
+    }
+
+    strncpy(alloc_key->key_name, key, sizeof(alloc_key->key_name));
+    alloc_key->val_len = length;
+    alloc_key->next = NULL;
+    memcpy(alloc_key->val, data, length);
+
+    // FIX TODO we shall have a rank for saved settings
+    if (strstr(alloc_key->key_name, "Va/")) {
+        alloc_key->next = mesh_settings.key_list;
+        mesh_settings.key_list = alloc_key;
+        if (mesh_settings.key_tail == NULL) {
+            mesh_settings.key_tail = alloc_key;
+        }
+    } else {
+        if (mesh_settings.key_tail) {
+            mesh_settings.key_tail->next = alloc_key;
         } else {
-            struct settings_key_cb *cur_key = mesh_settings.key_list;
-            // FIX TODO we shall have a rank for saved settings
-            if (strstr(alloc_key->key_name, "Va/")) {
-                alloc_key->next = mesh_settings.key_list;
-                mesh_settings.key_list = alloc_key;
-                return;
-            }
-            while (cur_key->next) {
-                cur_key = cur_key->next;
-            }
-            cur_key->next = alloc_key;
+            mesh_settings.key_list = alloc_key;
         }
+        mesh_settings.key_tail = alloc_key;
     }
+
+    return 0;
 }
 
 void mesh_settings_load(void)
 {
     struct settings_key_cb *cur_key;
 
-    nvds_find_keys_by_namespace(NULL, MESH_NAME_SPACE, mesh_settings_found_keys_cb);
+    /* keys and values are read in one pass, handlers are called once the nvds is released */
+    nvds_data_iterate(NULL, MESH_NAME_SPACE, mesh_settings_load_key_cb, NULL);
     cur_key = mesh_settings.key_list;
 
     while (cur_key) {
@@ -457,7 +513,7 @@ void mesh_settings_load(void)
                     const char *key_next = NULL;
                     settings_name_next(cur_key->key_name, &key_next);
 
-                    p_cur_settings_cb->h_set(key_next, cur_key->val_len, bt_mesh_settings_read_cb, cur_key->key_name);
+                    p_cur_settings_cb->h_set(key_next, cur_key->val_len, mesh_settings_loaded_read_cb, cur_key);
                 }
             }
             p_cur_settings_cb = p_cur_settings_cb->next;
@@ -473,7 +529,7 @@ void mesh_settings_load(void)
                     const char *key_next = NULL;
                     settings_name_next(cur_key->key_name, &key_next);
 
-                    p_cur_settings_cb->h_set(key_next, cur_key->val_len, bt_mesh_settings_read_cb, cur_key->key_name);
+                    p_cur_settings_cb->h_set(key_next, cur_key->val_len, mesh_settings_loaded_read_cb, cur_key);
                 }
             }
             p_cur_settings_cb++;
@@ -485,6 +541,7 @@ void mesh_settings_load(void)
     }
 
     mesh_settings.key_list = NULL;
+    mesh_settings.key_tail = NULL;
 }
 
 void bt_mesh_settings_init(void)
@@ -564,14 +621,59 @@ void bt_mesh_settings_store_pending(void)
 
 }
 
+static bool settings_txn_active(void)
+{
+    return store_txn && (store_txn_owner == sys_current_task_handle_get());
+}
+
+static int settings_txn_stage(const char *name, const void *value, size_t val_len)
+{
+    if (value) {
+        return nvds_txn_put(store_txn, MESH_NAME_SPACE, name, (uint8_t *)value, (uint32_t)val_len);
+    }
+
+    return nvds_txn_del(store_txn, MESH_NAME_SPACE, name);
+}
+
+static void settings_txn_flush(void)
+{
+    if (nvds_txn_commit(store_txn) != NVDS_OK) {
+        LOG_ERR("Failed to commit pending settings");
+    }
+    store_txn = nvds_txn_begin(NULL);
+}
+
 int settings_save_one(const char *name, const void *value, size_t val_len)
 {
+    if (settings_txn_active()) {
+        if ((val_len > 0) && (val_len <= SETTINGS_TXN_VAL_MAX) &&
+            (settings_txn_stage(name, value, val_len) == NVDS_OK)) {
+            return NVDS_OK;
+        }
+
+        /* keep write order: commit what was staged, then stage or write directly */
+        settings_txn_flush();
+        if (store_txn && (val_len > 0) && (val_len <= SETTINGS_TXN_VAL_MAX) &&
+            (settings_txn_stage(name, value, val_len) == NVDS_OK)) {
+            return NVDS_OK;
+        }
+    }
+
     return nvds_data_put(NULL, MESH_NAME_SPACE, name, (uint8_t *)value, (uint32_t)val_len);
 }
 
 int settings_delete(const char *name)
 {
-    int err = nvds_data_del(NULL, MESH_NAME_SPACE, name);
+    int err;
+
+    if (settings_txn_active()) {
+        if (settings_txn_stage(name, NULL, 0) == NVDS_OK) {
+            return NVDS_OK;
+        }
+        settings_txn_flush();
+    }
+
+    err = nvds_data_del(NULL, MESH_NAME_SPACE, name);
     if (err == NVDS_E_NOT_FOUND) {
         return NVDS_OK;
     }
@@ -112,12 +112,7 @@ static struct seg_rx {
 	struct k_work_delayable    discard;
 } seg_rx[CONFIG_BT_MESH_RX_SEG_MSG_COUNT];
 
-//K_MEM_SLAB_DEFINE(segs, BT_MESH_APP_SEG_SDU_MAX, CONFIG_BT_MESH_SEG_BUFS, 4);
-static struct k_mem_slab segs = {
-	.sema_count = NULL,
-	.num_blocks = CONFIG_BT_MESH_SEG_BUFS,
-	.block_size = BT_MESH_APP_SEG_SDU_MAX,
-};
+K_MEM_SLAB_DEFINE_STATIC(segs, BT_MESH_APP_SEG_SDU_MAX, CONFIG_BT_MESH_SEG_BUFS, 4);
 
 
 static int send_unseg(struct bt_mesh_net_tx *tx, struct net_buf_simple *sdu,
@@ -49,6 +49,9 @@ OF SUCH DAMAGE.
 /* BLE datatrans server data receive callback function */
 static ble_datatrans_srv_rx_cb datatrans_srv_rx_cb = NULL;
 
+/* BLE datatrans server notification sent callback function */
+static ble_datatrans_srv_tx_cmpl_cb datatrans_srv_tx_cmpl_cb = NULL;
+
 /* BLE datatrans server attribute database handle list */
 enum ble_datatrans_srv_att_idx
 {
@@ -112,7 +115,8 @@ ble_status_t ble_datatrans_srv_cb(ble_gatts_msg_info_t *p_srv_msg_info)
             ble_gatts_ntf_ind_send_rsp_t *p_rsp = &p_srv_msg_info->msg_data.gatts_op_info.gatts_op_data.ntf_ind_send_rsp;
 
             if (p_rsp->att_idx == BLE_DATATRANS_SRV_IDX_TX_HANDLE_VAL) {
-                //add user code here
+                if (datatrans_srv_tx_cmpl_cb)
+                    datatrans_srv_tx_cmpl_cb(conn_idx, p_rsp->status);
             }
         } else if (p_srv_msg_info->msg_data.gatts_op_info.gatts_op_sub_evt == BLE_SRV_EVT_WRITE_REQ) {
             ble_gatts_write_req_t *p_req = &p_srv_msg_info->msg_data.gatts_op_info.gatts_op_data.write_req;
@@ -168,6 +172,32 @@ ble_status_t ble_datatrans_srv_rx_cb_unreg(void)
     return BLE_ERR_NO_ERROR;
 }
 
+/*!
+    \brief      BLE datatrans server service tx complete callback register
+    \param[in]  callback: called once for each notification handed over to the link layer
+    \param[out] none
+    \retval     ble_status_t: BLE_ERR_NO_ERROR on success, otherwise an error code
+*/
+ble_status_t ble_datatrans_srv_tx_cmpl_cb_reg(ble_datatrans_srv_tx_cmpl_cb callback)
+{
+    datatrans_srv_tx_cmpl_cb = callback;
+
+    return BLE_ERR_NO_ERROR;
+}
+
+/*!
+    \brief      BLE datatrans server service tx complete callback unregister
+    \param[in]  none
+    \param[out] none
+    \retval     ble_status_t: BLE_ERR_NO_ERROR on success, otherwise an error code
+*/
+ble_status_t ble_datatrans_srv_tx_cmpl_cb_unreg(void)
+{
+    datatrans_srv_tx_cmpl_cb = NULL;
+
+    return BLE_ERR_NO_ERROR;
+}
+
 /*!
     \brief      Init BLE datatrans server service
     \param[in]  none
@@ -45,6 +45,9 @@ extern "C" {
 /* Prototype of BLE datatrans server data receive callback function */
 typedef void (*ble_datatrans_srv_rx_cb)(uint16_t data_len, uint8_t *p_data);
 
+/* Prototype of BLE datatrans server notification sent callback function */
+typedef void (*ble_datatrans_srv_tx_cmpl_cb)(uint8_t conn_idx, uint16_t status);
+
 /*!
     \brief      BLE datatrans server service rx callback register
     \param[in]  callback: datatrans server callback function
@@ -61,6 +64,22 @@ ble_status_t ble_datatrans_srv_rx_cb_reg(ble_datatrans_srv_rx_cb callback);
 */
 ble_status_t ble_datatrans_srv_rx_cb_unreg(void);
 
+/*!
+    \brief      BLE datatrans server service tx complete callback register
+    \param[in]  callback: called once for each notification handed over to the link layer
+    \param[out] none
+    \retval     ble_status_t: BLE_ERR_NO_ERROR on success, otherwise an error code
+*/
+ble_status_t ble_datatrans_srv_tx_cmpl_cb_reg(ble_datatrans_srv_tx_cmpl_cb callback);
+
+/*!
+    \brief      BLE datatrans server service tx complete callback unregister
+    \param[in]  none
+    \param[out] none
+    \retval     ble_status_t: BLE_ERR_NO_ERROR on success, otherwise an error code
+*/
+ble_status_t ble_datatrans_srv_tx_cmpl_cb_unreg(void);
+
 /*!
     \brief      Init BLE datatrans server service
     \param[in]  none
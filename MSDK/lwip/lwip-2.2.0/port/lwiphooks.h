@@ -20,4 +20,23 @@
  */
 err_t net_eth_receive(struct pbuf *pbuf, struct netif *netif);
 
+#ifdef CONFIG_ATCMD
+#define LWIP_HOOK_SOCKETS_EVENT(s, evt, len)  at_sock_event_hook(s, evt, len)
+
+/**
+ ****************************************************************************************
+ * @brief LWIP hook called by the socket layer for each netconn event of a socket.
+ *
+ * Lets the AT TCP/IP receive task be woken up by the socket that has data (or an
+ * error) pending instead of polling all its sockets with select().
+ * Called from the tcpip thread, must not block.
+ *
+ * @param[in] s   Socket the event is for
+ * @param[in] evt Netconn event (enum netconn_evt)
+ * @param[in] len Length of the data of the event
+ ****************************************************************************************
+ */
+void at_sock_event_hook(int s, int evt, u16_t len);
+#endif /* CONFIG_ATCMD */
+
 #endif /* _LWIPHOOKS_H_ */
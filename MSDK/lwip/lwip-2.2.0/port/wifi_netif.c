@@ -98,17 +98,16 @@ static uint8_t ap_ip6_server_started = 0;
 void p_buf_link_encapsulation_hlen_too_small(void);
 
 #if defined(NET_UDP_PBUF_REALLOC) && (NET_UDP_PBUF_REALLOC == 1)
-static int net_buf_need_realloc(struct pbuf *pbuf)
+// UDP frames copied before TX, and UDP frames given to the MAC by reference
+static uint32_t net_udp_tx_copy_cnt;
+static uint32_t net_udp_tx_zero_copy_cnt;
+
+static int net_buf_is_udp(struct pbuf *pbuf)
 {
     uint16_t eth_type;
     uint8_t proto;
-    uint16_t port;
-
-    if (pbuf->flags & PBUF_FLAG_IS_CUSTOM)
-        return 0;
 
     eth_type = ((struct eth_hdr *)pbuf->payload)->type;
-    // printf("eth_type = %x\r\n", eth_type);
 #if LWIP_IPV6
     if (eth_type != PP_HTONS(ETHTYPE_IP) && eth_type != PP_HTONS(ETHTYPE_IPV6))
 #else
@@ -122,21 +121,48 @@ static int net_buf_need_realloc(struct pbuf *pbuf)
     else
 #endif
         proto = IPH_PROTO((struct ip_hdr *)((uint8_t *)pbuf->payload + SIZEOF_ETH_HDR));
-    // printf("proto = %x\r\n", proto);
-    if (proto != IP_PROTO_UDP)
+
+    return (proto == IP_PROTO_UDP);
+}
+
+static int net_buf_need_realloc(struct pbuf *pbuf)
+{
+    struct pbuf *q;
+
+    if (pbuf->flags & PBUF_FLAG_IS_CUSTOM)
         return 0;
 
-#if LWIP_IPV6
-    if (eth_type == PP_HTONS(ETHTYPE_IPV6))
-        port = ((struct udp_hdr *)((uint8_t *)pbuf->payload + SIZEOF_ETH_HDR + IP6_HLEN))->src;
-    else
-#endif
-        port = ((struct udp_hdr *)((uint8_t *)pbuf->payload + SIZEOF_ETH_HDR + IP_HLEN))->src;
-    // printf("port = %x\r\n", lwip_ntohs(port));
-    if (lwip_ntohs(port) == 0x43 || lwip_ntohs(port) == 0x44)  /* DHCP */
+    if (!net_buf_is_udp(pbuf))
         return 0;
 
-    return 1;
+    // Memory allocated by the stack can be held by reference until TX confirm as TCP does.
+    // Data of PBUF_REF/PBUF_ROM segments belongs to the caller, e.g. the user buffer of
+    // sendto() which may be reused as soon as it returns, so such frames are copied.
+    for (q = pbuf; q != NULL; q = q->next)
+    {
+        if (pbuf_get_allocsrc(q) == PBUF_TYPE_ALLOC_SRC_MASK_STD_MEMP_PBUF)
+        {
+            net_udp_tx_copy_cnt++;
+            return 1;
+        }
+    }
+
+    net_udp_tx_zero_copy_cnt++;
+    return 0;
+}
+
+/*!
+    \brief      Get the number of UDP frames sent by copy and by reference
+    \param[out] copy_cnt: Pointer to the number of UDP frames copied before TX
+    \param[out] zero_copy_cnt: Pointer to the number of UDP frames held by reference until TX confirm
+    \retval     none
+*/
+void net_if_udp_tx_stats_get(uint32_t *copy_cnt, uint32_t *zero_copy_cnt)
+{
+    if (copy_cnt)
+        *copy_cnt = net_udp_tx_copy_cnt;
+    if (zero_copy_cnt)
+        *zero_copy_cnt = net_udp_tx_zero_copy_cnt;
 }
 #endif /* NET_UDP_REALLOC */
 
@@ -153,40 +179,21 @@ static err_t net_if_output(struct netif *net_if, struct pbuf *p_buf)
     err_t status = ERR_BUF;
 
 #if defined(NET_UDP_PBUF_REALLOC) && (NET_UDP_PBUF_REALLOC == 1)
-    struct pbuf *pbuf_head_new, *pbuf_new, *p;
+    struct pbuf *pbuf_new;
 
     if (net_buf_need_realloc(p_buf))
     {
         if (!netif_is_up(net_if))
             return (status);
 
-        // Allocation of the new pbufs
-        pbuf_head_new = pbuf_alloc(PBUF_RAW_TX, p_buf->len, PBUF_RAM);
-        if (pbuf_head_new != NULL)
-        {
-            sys_memcpy(pbuf_head_new->payload, (uint8_t *)(p_buf->payload), p_buf->len);
-            p = p_buf;
-            while (p->next != NULL)
-            {
-                p = p->next;
-                pbuf_new = pbuf_alloc(PBUF_RAW_TX, p->len, PBUF_RAM);
-                if (pbuf_new == NULL)
-                {
-                    pbuf_free(pbuf_head_new);
-                    return (status);
-                }
-                sys_memcpy(pbuf_new->payload, (uint8_t *)(p->payload), p->len);
-                pbuf_cat(pbuf_head_new, pbuf_new);
-            }
-        }
-        else
-        {
+        // Copy the whole frame in one contiguous buffer
+        pbuf_new = pbuf_clone(PBUF_RAW_TX, PBUF_RAM, p_buf);
+        if (pbuf_new == NULL)
             return (status);
-        }
 
-        if (macif_tx_start(net_if, pbuf_head_new, NULL, NULL) != 0)
+        if (macif_tx_start(net_if, pbuf_new, NULL, NULL) != 0)
         {
-            pbuf_free(pbuf_head_new);
+            pbuf_free(pbuf_new);
             return (status);
         }
         status = ERR_OK;
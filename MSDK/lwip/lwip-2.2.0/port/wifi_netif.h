@@ -113,6 +113,9 @@ int net_lpbk_socket_bind(int sock_recv, uint32_t port);
 int net_lpbk_socket_connect(int sock_send, uint32_t port);
 void net_if_use_static_ip(bool static_ip);
 bool net_if_is_static_ip(void);
+#if defined(NET_UDP_PBUF_REALLOC) && (NET_UDP_PBUF_REALLOC == 1)
+void net_if_udp_tx_stats_get(uint32_t *copy_cnt, uint32_t *zero_copy_cnt);
+#endif
 
 #ifdef __cplusplus
  }
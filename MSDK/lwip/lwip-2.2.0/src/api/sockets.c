@@ -2612,6 +2612,11 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
   } else {
     SYS_ARCH_UNPROTECT(lev);
   }
+/* GD modified */
+#ifdef LWIP_HOOK_SOCKETS_EVENT
+  LWIP_HOOK_SOCKETS_EVENT(s, evt, len);
+#endif
+/* GD modified end */
   done_socket(sock);
 }
 
@@ -47,6 +47,19 @@ typedef struct
 }
 mbedtls_aes_context;
 
+/* The CAU is shared by AES, DES, GCM and CCM. A user holds CAU_LOCK() from
+   the load of its key or saved context to the save of the CAU state, the
+   DMA path of GCM/CCM sleeps in between. The mutex is created by
+   cau_alt_lock_init() at boot, before any user of the CAU runs. */
+#define CAU_LOCK()            cau_alt_lock()
+#define CAU_UNLOCK()          cau_alt_unlock()
+
+/*create the CAU mutex, see CAU_LOCK()*/
+void cau_alt_lock_init(void);
+/*take/release the CAU, see CAU_LOCK()*/
+void cau_alt_lock(void);
+void cau_alt_unlock(void);
+
 void mbedtls_aes_init(mbedtls_aes_context *ctx);
 
 void mbedtls_aes_free(mbedtls_aes_context *ctx);
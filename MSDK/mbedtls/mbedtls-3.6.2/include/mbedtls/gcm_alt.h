@@ -0,0 +1,83 @@
+/*!
+    \file    gcm_alt.h
+    \brief   AES-GCM with the CAU for GD32VW55x SDK.
+
+    \version 2024-12-30, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef MBEDTLS_GCM_ALT_H
+#define MBEDTLS_GCM_ALT_H
+
+#if defined(MBEDTLS_GCM_ALT)
+
+/*
+ * AES keys with a 96-bit IV run on the CAU: the key is converted once in
+ * mbedtls_gcm_setkey() and stays loaded for the whole message, bulk data is
+ * moved by the DMA. Other ciphers and IV lengths use a software engine that
+ * follows the same block sequence as the CAU.
+ *
+ * Define CONFIG_CAU_SOFT_REF to build the software engine only, e.g. to run
+ * the known-answer tests of this file on a host.
+ */
+#if !defined(CONFIG_CAU_SOFT_REF)
+#include "gd32vw55x.h"
+#endif
+
+/**
+ * \brief          GCM ALT context structure
+ */
+typedef struct mbedtls_gcm_context
+{
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    mbedtls_block_cipher_context_t block_cipher_ctx; /*!< cipher of the software engine */
+#else
+    mbedtls_cipher_context_t cipher_ctx;            /*!< cipher of the software engine */
+#endif
+    uint64_t len;                                   /*!< total length of the input data */
+    uint64_t add_len;                               /*!< total length of the additional data */
+    unsigned char j0[16];                           /*!< pre-counter block */
+    unsigned char h[16];                            /*!< hash subkey, software engine */
+    unsigned char y[16];                            /*!< GHASH value, software engine */
+    unsigned char ctr[16];                          /*!< counter block, software engine */
+    unsigned char buf[16];                          /*!< partial block of AAD or input data */
+    unsigned char buf_len;                          /*!< number of bytes in buf */
+    unsigned char mode;                             /*!< MBEDTLS_GCM_ENCRYPT or MBEDTLS_GCM_DECRYPT */
+    unsigned char phase;                            /*!< AAD or data phase of the operation */
+    unsigned char hw;                               /*!< the operation runs on the CAU */
+#if !defined(CONFIG_CAU_SOFT_REF)
+    unsigned char hw_key;                           /*!< the key can be used by the CAU */
+    uint32_t cau_keysize;                           /*!< CAU key size */
+    cau_key_parameter_struct cau_key;               /*!< key in the CAU register layout */
+    cau_context_parameter_struct cau_ctx;           /*!< CAU state between two calls */
+#endif
+} mbedtls_gcm_context;
+
+#endif /* MBEDTLS_GCM_ALT */
+#endif /* MBEDTLS_GCM_ALT_H */
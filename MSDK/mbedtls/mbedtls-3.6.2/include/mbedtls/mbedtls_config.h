@@ -424,6 +424,10 @@ extern int mbedtls_hwpka_flag;
 #define MBEDTLS_AES_ALT
 #define MBEDTLS_DES_ALT
 #define MBEDTLS_SHA256_ALT
+#define MBEDTLS_GCM_ALT
+#define MBEDTLS_CCM_ALT
+/* GCM/CCM alt with the software engine only, for host known-answer tests */
+//#define CONFIG_CAU_SOFT_REF
 #endif
 
 //#define MBEDTLS_AES_ALT
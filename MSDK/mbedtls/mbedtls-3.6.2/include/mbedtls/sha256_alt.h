@@ -41,26 +41,68 @@ OF SUCH DAMAGE.
 
 #define SHAMD5_BSY_TIMEOUT    ((uint32_t)0x00010000U)
 #define SHA256_BLOCK_SIZE     ((uint32_t)64)        /*!< HAU BLOCK_SIZE 512 bits, ie 64 bytes */
+
+/* DMA request mapping of the HAU IN FIFO */
+#define SHA256_DMA_CH         DMA_CH7
+#define SHA256_DMA_SUBPERI    DMA_SUBPERI2
+/* Runs shorter than this are written to the IN FIFO by the CPU */
+#define SHA256_DMA_THRESHOLD  ((uint32_t)256)
+/* Largest run fed to the HAU in one locked window, the context is saved and
+   the other tasks are let in between two runs of a long update */
+#define SHA256_RUN_MAX        ((uint32_t)4096)
+/* Only the SRAM can be reached by the DMA, data in flash goes through the CPU */
+#define SHA256_DMA_ADDR_VALID(addr) (((uint32_t)(addr) >= SRAM_BASE) && \
+                                     ((uint32_t)(addr) < (SRAM_BASE + 0x00050000U)))
+
+/* The mbedtls users of the HAU queue on a mutex. The wpa_supplicant library
+   runs the HAU from its own task with the interrupts disabled and does not
+   know the mutex, so the task switches are also held off while the HAU holds
+   a context. Interrupts stay enabled during the runs of SHA256_RUN_MAX bytes.
+   The mutex is created by hau_sha256_lock_init() at boot. */
+#define HAU_LOCK()            hau_sha256_lock()
+#define HAU_UNLOCK()          hau_sha256_unlock()
+
+/* hau_sha256_hmac_start()/hau_sha256_hmac_finish() are available */
+#define MBEDTLS_SHA256_HMAC_ALT
+
 /**
  * \brief          SHA-256 context structure
+ *
+ * The HAU registers are only held during a call: each call restores the
+ * context, feeds the data and saves it back, so any number of contexts
+ * (hash or HMAC) can be used at the same time.
  */
 typedef struct mbedtls_sha256_context
 {
-    int is256;                                      /*!< 1 = use SHA256, 0 = use SHA224 */
     uint8_t buf[64];                               /*!< Buffer to store input data until SHA256_BLOCK_SIZE
                                                          is reached, or until last input data is reached */
+    uint8_t key[64];                               /*!< HMAC key, written again at the end of the HMAC */
+    int is256;                                      /*!< 1 = use SHA256, 0 = use SHA224 */
     uint8_t buf_len;                               /*!< Number of bytes stored in sbuf */
+    uint8_t hmac;                                  /*!< 1 = HMAC mode, 0 = HASH mode */
+    uint8_t key_len;                               /*!< Number of bytes of the HMAC key */
     hau_context_parameter_struct context_para;     /* structure for context switch */
 } mbedtls_sha256_context;
 
 
+/*create the HAU mutex, see HAU_LOCK()*/
+void hau_sha256_lock_init(void);
+/*take/release the HAU, see HAU_LOCK()*/
+void hau_sha256_lock(void);
+void hau_sha256_unlock(void);
 /*init mbedtls_sha256_context struct*/
 void hau_sha256_context_init(mbedtls_sha256_context *ct);
 /*interface function*/
 void hau_sha256_start(mbedtls_sha256_context *ct, int is256);
-ErrStatus hau_sha256_update(mbedtls_sha256_context *ct,uint8_t *input, uint32_t in_length);
+ErrStatus hau_sha256_update(mbedtls_sha256_context *ct, const uint8_t *input, uint32_t in_length);
 ErrStatus hau_sha256_finish(mbedtls_sha256_context *ct,uint8_t output[32]);
 /*process input data then read digest*/
 
+/*HMAC-SHA256 on the HAU, data is fed with hau_sha256_update()*/
+ErrStatus hau_sha256_hmac_start(mbedtls_sha256_context *ct, const uint8_t *key, uint32_t keylen);
+/*restart a HMAC with the key of the last hau_sha256_hmac_start()*/
+ErrStatus hau_sha256_hmac_reset(mbedtls_sha256_context *ct);
+ErrStatus hau_sha256_hmac_finish(mbedtls_sha256_context *ct, uint8_t output[32]);
+
 #endif //MBEDTLS_SHA256_ALT
 #endif //MBEDTLS_SHA256_ALT_H
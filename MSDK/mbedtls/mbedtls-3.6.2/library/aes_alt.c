@@ -52,6 +52,9 @@ OF SUCH DAMAGE.
 
 #if defined(MBEDTLS_AES_ALT)
 #include "gd32vw55x_cau.h"
+#include "wrapper_os.h"
+
+static os_mutex_t cau_mutex;
 
 /* Implementation that should never be optimized out by the compiler */
 static void mbedtls_zeroize(void *v, size_t n)
@@ -61,6 +64,24 @@ static void mbedtls_zeroize(void *v, size_t n)
         *p++ = 0;
 }
 
+void cau_alt_lock_init(void)
+{
+    if (cau_mutex == NULL)
+        sys_mutex_init(&cau_mutex);
+}
+
+void cau_alt_lock(void)
+{
+    if (cau_mutex != NULL)
+        sys_mutex_get(&cau_mutex);
+}
+
+void cau_alt_unlock(void)
+{
+    if (cau_mutex != NULL)
+        sys_mutex_put(&cau_mutex);
+}
+
 void mbedtls_aes_init(mbedtls_aes_context *ctx)
 {
     memset(ctx, 0, sizeof(mbedtls_aes_context));
@@ -124,9 +145,9 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
     cau_aes_parameter.input = (uint8_t *)input;
     cau_aes_parameter.in_length = 16;
 
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_aes_ecb(&cau_aes_parameter, output);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
     return (ret == ERROR) ? 1 : 0;
 }
 
@@ -166,13 +187,13 @@ int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
     cau_cbc_parameter.in_length = length;
 
     memcpy(temp, (input + length - 16), 16);
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_aes_cbc(&cau_cbc_parameter, output);
     if (mode == MBEDTLS_AES_DECRYPT)
         memcpy(iv, temp, 16);
     else
         memcpy(iv, (output + length - 16), 16);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
 
     return (ret == ERROR) ? 1 : 0;
 }
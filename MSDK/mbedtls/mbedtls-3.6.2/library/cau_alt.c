@@ -0,0 +1,399 @@
+/*!
+    \file    cau_alt.c
+    \brief   CAU AES-GCM/AES-CCM helpers for GD32VW55x SDK.
+
+    \version 2024-12-30, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/mbedtls_config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include <string.h>
+#include "cau_alt.h"
+#include "gd32vw55x_it.h"
+#include "wrapper_os.h"
+
+#if (defined(MBEDTLS_GCM_ALT) || defined(MBEDTLS_CCM_ALT)) && !defined(CONFIG_CAU_SOFT_REF)
+
+#define CAU_BUSY_TIMEOUT        ((uint32_t)0x00010000U)
+
+/* Wait until the CAU core is idle */
+static ErrStatus cau_alt_wait_idle(void)
+{
+    uint32_t counter = 0;
+
+    while (RESET != cau_flag_get(CAU_FLAG_BUSY)) {
+        if (++counter == CAU_BUSY_TIMEOUT)
+            return ERROR;
+    }
+    return SUCCESS;
+}
+
+/* Push one block in the IN FIFO and, if output is set, pop the result */
+static ErrStatus cau_alt_block(const unsigned char *input, unsigned char *output)
+{
+    uint32_t data[4];
+    uint32_t counter = 0;
+
+    memcpy(data, input, 16);
+
+    while (RESET == cau_flag_get(CAU_FLAG_INFIFO_EMPTY)) {
+        if (++counter == CAU_BUSY_TIMEOUT)
+            return ERROR;
+    }
+    cau_data_write(data[0]);
+    cau_data_write(data[1]);
+    cau_data_write(data[2]);
+    cau_data_write(data[3]);
+
+    if (output == NULL)
+        return SUCCESS;
+
+    counter = 0;
+    while (RESET == cau_flag_get(CAU_FLAG_OUTFIFO_NO_EMPTY)) {
+        if (++counter == CAU_BUSY_TIMEOUT)
+            return ERROR;
+    }
+    data[0] = cau_data_read();
+    data[1] = cau_data_read();
+    data[2] = cau_data_read();
+    data[3] = cau_data_read();
+    memcpy(output, data, 16);
+
+    return SUCCESS;
+}
+
+/* Configure one DMA channel between the memory and a CAU FIFO */
+static void cau_alt_dma_config(dma_channel_enum channel, uint32_t direction,
+                               uint32_t periph_addr, uint32_t memory_addr, size_t length)
+{
+    dma_multi_data_parameter_struct dma_init_parameter;
+
+    dma_deinit(channel);
+    dma_multi_data_para_struct_init(&dma_init_parameter);
+    dma_init_parameter.periph_addr = periph_addr;
+    dma_init_parameter.periph_width = DMA_PERIPH_WIDTH_32BIT;
+    dma_init_parameter.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+    dma_init_parameter.memory0_addr = memory_addr;
+    dma_init_parameter.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+    /* a 4-word burst matches the FIFO trigger level of the CAU */
+    if ((memory_addr & 0x3) == 0) {
+        dma_init_parameter.memory_width = DMA_MEMORY_WIDTH_32BIT;
+        dma_init_parameter.memory_burst_width = DMA_MEMORY_BURST_4_BEAT;
+    } else {
+        dma_init_parameter.memory_width = DMA_MEMORY_WIDTH_8BIT;
+        dma_init_parameter.memory_burst_width = DMA_MEMORY_BURST_SINGLE;
+    }
+    dma_init_parameter.periph_burst_width = DMA_PERIPH_BURST_4_BEAT;
+    dma_init_parameter.critical_value = DMA_FIFO_4_WORD;
+    dma_init_parameter.circular_mode = DMA_CIRCULAR_MODE_DISABLE;
+    dma_init_parameter.direction = direction;
+    dma_init_parameter.number = length >> 2;
+    dma_init_parameter.priority = DMA_PRIORITY_HIGH;
+    dma_multi_data_mode_init(channel, &dma_init_parameter);
+
+    dma_channel_subperipheral_select(channel, CAU_DMA_SUBPERI);
+    dma_flow_controller_config(channel, DMA_FLOW_CONTROLLER_DMA);
+}
+
+/* Set while a task sleeps on the output channel of a CAU transfer */
+static volatile uint8_t cau_dma_waiting;
+static os_sema_t cau_dma_sema;
+
+/*
+ * The DMA channels of the CAU are also mapped to the UART2 RX/TX requests
+ * (AT command passthrough, BLE datatrans, HCI) and no driver arbitrates
+ * them. The CAU only borrows the two channels when neither is running, the
+ * caller feeds the FIFO with the CPU otherwise. A UART enabled in the middle
+ * of a CAU transfer is still not detected.
+ */
+static int cau_alt_dma_free(void)
+{
+    return ((DMA_CHCTL(CAU_DMA_IN_CH) & DMA_CHXCTL_CHEN) == 0) &&
+           ((DMA_CHCTL(CAU_DMA_OUT_CH) & DMA_CHXCTL_CHEN) == 0);
+}
+
+/* Called from DMA_Channel5_IRQHandler, return 1 if the interrupt was for the CAU */
+int cau_alt_dma_irq_hdl(void)
+{
+    if (!cau_dma_waiting)
+        return 0;
+
+    if ((RESET == dma_interrupt_flag_get(CAU_DMA_OUT_CH, DMA_INT_FLAG_FTF)) &&
+        (RESET == dma_interrupt_flag_get(CAU_DMA_OUT_CH, DMA_INT_FLAG_TAE)))
+        return 0;
+
+    /* the flags are left set for cau_alt_dma_sleep() */
+    dma_interrupt_disable(CAU_DMA_OUT_CH, DMA_INT_FTF | DMA_INT_TAE);
+    cau_dma_waiting = 0;
+    sys_sema_up_from_isr(&cau_dma_sema);
+
+    return 1;
+}
+
+/* Sleep until the output channel is done, other tasks get the CPU meanwhile */
+static ErrStatus cau_alt_dma_sleep(void)
+{
+    uint32_t irq_en = ECLIC_GetEnableIRQ(DMA_Channel5_IRQn);
+    ErrStatus ret = SUCCESS;
+
+    cau_dma_waiting = 1;
+    dma_interrupt_enable(CAU_DMA_OUT_CH, DMA_INT_FTF | DMA_INT_TAE);
+    eclic_irq_enable(DMA_Channel5_IRQn, 8, 0);
+
+    /* a give left over by a timed out transfer only costs one more loop */
+    while ((RESET == dma_flag_get(CAU_DMA_OUT_CH, DMA_FLAG_FTF)) &&
+           (RESET == dma_flag_get(CAU_DMA_OUT_CH, DMA_FLAG_TAE))) {
+        if (sys_sema_down(&cau_dma_sema, CAU_DMA_TIMEOUT_MS) != OS_OK) {
+            ret = ERROR;
+            break;
+        }
+    }
+
+    sys_enter_critical();
+    dma_interrupt_disable(CAU_DMA_OUT_CH, DMA_INT_FTF | DMA_INT_TAE);
+    cau_dma_waiting = 0;
+    if (!irq_en)
+        ECLIC_DisableIRQ(DMA_Channel5_IRQn);
+    sys_exit_critical();
+
+    if (RESET != dma_flag_get(CAU_DMA_OUT_CH, DMA_FLAG_TAE))
+        ret = ERROR;
+
+    return ret;
+}
+
+/* Move length bytes (a multiple of 16) in and out of the CAU with the DMA */
+static ErrStatus cau_alt_dma(const unsigned char *input, unsigned char *output, size_t length)
+{
+    ErrStatus ret;
+
+    rcu_periph_clock_enable(RCU_DMA);
+
+    cau_alt_dma_config(CAU_DMA_OUT_CH, DMA_PERIPH_TO_MEMORY, (uint32_t)&CAU_DO,
+                       (uint32_t)output, length);
+    dma_channel_enable(CAU_DMA_OUT_CH);
+    cau_alt_dma_config(CAU_DMA_IN_CH, DMA_MEMORY_TO_PERIPH, (uint32_t)&CAU_DI,
+                       (uint32_t)input, length);
+    dma_channel_enable(CAU_DMA_IN_CH);
+
+    cau_dma_enable(CAU_DMA_INFIFO | CAU_DMA_OUTFIFO);
+
+    ret = cau_alt_dma_sleep();
+
+    cau_dma_disable(CAU_DMA_INFIFO | CAU_DMA_OUTFIFO);
+    dma_channel_disable(CAU_DMA_IN_CH);
+    dma_flag_clear(CAU_DMA_IN_CH, DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_TAE | DMA_FLAG_FEE);
+    dma_channel_disable(CAU_DMA_OUT_CH);
+    dma_flag_clear(CAU_DMA_OUT_CH, DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_TAE | DMA_FLAG_FEE);
+
+    if (ret == SUCCESS)
+        ret = cau_alt_wait_idle();
+
+    return ret;
+}
+
+/* The DMA path is only taken from a task that may sleep, with both channels free */
+static int cau_alt_dma_usable(const unsigned char *input, unsigned char *output, size_t length)
+{
+    if (length < CAU_DMA_THRESHOLD || output == NULL)
+        return 0;
+    if (!CAU_DMA_ADDR_VALID(input) || !CAU_DMA_ADDR_VALID(output))
+        return 0;
+    if (__get_CONTROL() != 0 || sys_in_critical())
+        return 0;
+    /* created on first use, CAU_LOCK() is held so only one task gets here */
+    if (cau_dma_sema == NULL && sys_sema_init_ext(&cau_dma_sema, 1, 0) != OS_OK)
+        return 0;
+
+    return cau_alt_dma_free();
+}
+
+uint32_t cau_alt_key_config(const unsigned char *key, unsigned int keybits,
+                            cau_key_parameter_struct *key_para)
+{
+    uint32_t word[8];
+    uint32_t reg[8] = {0};
+    uint32_t nwords = keybits / 32;
+    uint32_t i;
+
+    memcpy(word, key, keybits / 8);
+
+    /* the key is right aligned in KEY0H..KEY3L, most significant word first */
+    for (i = 0; i < nwords; i++)
+        reg[8 - nwords + i] = __REV(word[i]);
+
+    key_para->key_0_high = reg[0];
+    key_para->key_0_low = reg[1];
+    key_para->key_1_high = reg[2];
+    key_para->key_1_low = reg[3];
+    key_para->key_2_high = reg[4];
+    key_para->key_2_low = reg[5];
+    key_para->key_3_high = reg[6];
+    key_para->key_3_low = reg[7];
+
+    if (keybits == 256)
+        return CAU_KEYSIZE_256BIT;
+    if (keybits == 192)
+        return CAU_KEYSIZE_192BIT;
+    return CAU_KEYSIZE_128BIT;
+}
+
+ErrStatus cau_alt_start(uint32_t alg_dir, uint32_t algo_mode, uint32_t keysize,
+                        cau_key_parameter_struct *key_para,
+                        const unsigned char iv[16], const unsigned char *b0)
+{
+    cau_iv_parameter_struct iv_initpara;
+    uint32_t word[4];
+    uint32_t counter = 0;
+
+    cau_disable();
+    cau_fifo_flush();
+    cau_init(alg_dir, algo_mode, CAU_SWAPPING_8BIT);
+    cau_aes_keysize_config(keysize);
+    cau_key_init(key_para);
+
+    memcpy(word, iv, 16);
+    iv_initpara.iv_0_high = __REV(word[0]);
+    iv_initpara.iv_0_low = __REV(word[1]);
+    iv_initpara.iv_1_high = __REV(word[2]);
+    iv_initpara.iv_1_low = __REV(word[3]);
+    cau_iv_init(&iv_initpara);
+
+    cau_phase_config(CAU_PREPARE_PHASE);
+    cau_enable();
+
+    if (b0 != NULL) {
+        memcpy(word, b0, 16);
+        cau_data_write(word[0]);
+        cau_data_write(word[1]);
+        cau_data_write(word[2]);
+        cau_data_write(word[3]);
+    }
+
+    /* the CAU clears CAUEN at the end of the prepare phase */
+    while (ENABLE == cau_enable_state_get()) {
+        if (++counter == CAU_BUSY_TIMEOUT)
+            return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+void cau_alt_phase(uint32_t phase)
+{
+    cau_phase_config(phase);
+    cau_fifo_flush();
+    cau_enable();
+}
+
+ErrStatus cau_alt_process(const unsigned char *input, unsigned char *output, size_t length)
+{
+    size_t run;
+
+    if (cau_alt_dma_usable(input, output, length)) {
+        while (length > 0) {
+            run = (length > CAU_DMA_MAX_LEN) ? CAU_DMA_MAX_LEN : length;
+            if (cau_alt_dma(input, output, run) != SUCCESS)
+                return ERROR;
+            input += run;
+            output += run;
+            length -= run;
+        }
+        return SUCCESS;
+    }
+
+    while (length > 0) {
+        if (cau_alt_block(input, output) != SUCCESS)
+            return ERROR;
+        input += 16;
+        if (output != NULL)
+            output += 16;
+        length -= 16;
+    }
+
+    return (output == NULL) ? cau_alt_wait_idle() : SUCCESS;
+}
+
+ErrStatus cau_alt_process_last(const unsigned char *input, unsigned char *output, size_t length)
+{
+    unsigned char block[16] = {0};
+    uint32_t ctl = CAU_CTL & (CAU_CTL_ALGM | CAU_CTL_CAUDIR | CAU_CTL_GCM_CCMPH);
+    ErrStatus ret;
+
+    memcpy(block, input, length);
+
+    /* GCM encryption and CCM decryption must not authenticate the padding */
+    if ((ctl == (CAU_MODE_AES_GCM | CAU_ENCRYPT | CAU_ENCRYPT_DECRYPT_PHASE)) ||
+        (ctl == (CAU_MODE_AES_CCM | CAU_DECRYPT | CAU_ENCRYPT_DECRYPT_PHASE))) {
+        CAU_CTL |= CAU_PADDING_BYTES(16 - length);
+    }
+
+    ret = cau_alt_block(block, (output != NULL) ? block : NULL);
+    if (ret == SUCCESS && output != NULL)
+        memcpy(output, block, length);
+    else if (ret == SUCCESS)
+        ret = cau_alt_wait_idle();
+
+    return ret;
+}
+
+ErrStatus cau_alt_tag(const unsigned char final_block[16], unsigned char tag[16])
+{
+    ErrStatus ret;
+
+    cau_alt_phase(CAU_TAG_PHASE);
+    ret = cau_alt_block(final_block, tag);
+    cau_disable();
+
+    return ret;
+}
+
+void cau_alt_suspend(cau_context_parameter_struct *cau_ctx, cau_key_parameter_struct *key_para)
+{
+    cau_context_save(cau_ctx, key_para);
+}
+
+void cau_alt_resume(cau_context_parameter_struct *cau_ctx)
+{
+    cau_disable();
+    cau_fifo_flush();
+    cau_context_restore(cau_ctx);
+}
+
+void cau_alt_stop(void)
+{
+    cau_disable();
+}
+
+#endif /* (MBEDTLS_GCM_ALT || MBEDTLS_CCM_ALT) && !CONFIG_CAU_SOFT_REF */
@@ -0,0 +1,88 @@
+/*!
+    \file    cau_alt.h
+    \brief   CAU AES-GCM/AES-CCM helpers for GD32VW55x SDK.
+
+    \version 2024-12-30, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#ifndef MBEDTLS_CAU_ALT_H
+#define MBEDTLS_CAU_ALT_H
+
+#if (defined(MBEDTLS_GCM_ALT) || defined(MBEDTLS_CCM_ALT)) && !defined(CONFIG_CAU_SOFT_REF)
+
+#include "gd32vw55x.h"
+#include "mbedtls/aes.h"
+
+/* DMA request mapping of the CAU FIFOs, the channels are shared with UART2 */
+#define CAU_DMA_IN_CH           DMA_CH6
+#define CAU_DMA_OUT_CH          DMA_CH5
+#define CAU_DMA_SUBPERI         DMA_SUBPERI2
+
+/* Runs shorter than this are written to the FIFO by the CPU, setting up the
+   two DMA channels and sleeping on the transfer costs more than it saves.
+   The AAD phase has no output and always goes through the CPU. */
+#define CAU_DMA_THRESHOLD       512
+/* Longest sleep on one DMA transfer before giving up */
+#define CAU_DMA_TIMEOUT_MS      100
+/* Largest run moved by one DMA transfer, the channel counter is 16 bits wide */
+#define CAU_DMA_MAX_LEN         0x3FFF0
+
+/* Only the SRAM can be reached by the DMA, data in flash goes through the CPU */
+#define CAU_DMA_ADDR_VALID(addr) (((uint32_t)(addr) >= SRAM_BASE) && \
+                                  ((uint32_t)(addr) < (SRAM_BASE + 0x00050000U)))
+
+/* Map the status of the helpers below to an mbedtls error code */
+#define CAU_ALT_RET(status)     (((status) == SUCCESS) ? 0 : MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+
+/* Convert an AES key to the CAU key registers layout, return the CAU_KEYSIZE_xxx value */
+uint32_t cau_alt_key_config(const unsigned char *key, unsigned int keybits,
+                            cau_key_parameter_struct *key_para);
+/* Load key and IV, run the prepare phase (with block B0 for CCM) */
+ErrStatus cau_alt_start(uint32_t alg_dir, uint32_t algo_mode, uint32_t keysize,
+                        cau_key_parameter_struct *key_para,
+                        const unsigned char iv[16], const unsigned char *b0);
+/* Select a GCM/CCM phase and enable the CAU */
+void cau_alt_phase(uint32_t phase);
+/* Feed whole blocks in the current phase, output is NULL in the AAD phase */
+ErrStatus cau_alt_process(const unsigned char *input, unsigned char *output, size_t length);
+/* Feed the last, partial, block of the current phase */
+ErrStatus cau_alt_process_last(const unsigned char *input, unsigned char *output, size_t length);
+/* Run the tag phase with the final block (lengths for GCM, counter 0 for CCM) */
+ErrStatus cau_alt_tag(const unsigned char final_block[16], unsigned char tag[16]);
+/* Save the CAU state between two calls of a multi-part operation */
+void cau_alt_suspend(cau_context_parameter_struct *cau_ctx, cau_key_parameter_struct *key_para);
+/* Restore the CAU state saved by cau_alt_suspend() */
+void cau_alt_resume(cau_context_parameter_struct *cau_ctx);
+/* Stop the CAU once an operation is complete */
+void cau_alt_stop(void);
+
+#endif /* (MBEDTLS_GCM_ALT || MBEDTLS_CCM_ALT) && !CONFIG_CAU_SOFT_REF */
+
+#endif /* MBEDTLS_CAU_ALT_H */
@@ -0,0 +1,888 @@
+/*!
+    \file    ccm_alt.c
+    \brief   AES-CCM with the CAU for GD32VW55x SDK.
+
+    \version 2024-12-30, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "common.h"
+
+#if defined(MBEDTLS_CCM_C)
+
+#include "mbedtls/ccm.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+#include "mbedtls/constant_time.h"
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+#include "block_cipher_internal.h"
+#endif
+
+#include <string.h>
+
+#if defined(MBEDTLS_CCM_ALT)
+#include "cau_alt.h"
+
+#define CCM_STATE__CLEAR                0
+#define CCM_STATE__STARTED              (1 << 0)
+#define CCM_STATE__LENGTHS_SET          (1 << 1)
+#define CCM_STATE__AUTH_DATA_STARTED    (1 << 2)
+#define CCM_STATE__AUTH_DATA_FINISHED   (1 << 3)
+#define CCM_STATE__ERROR                (1 << 4)
+#define CCM_STATE__DATA_STARTED         (1 << 5)
+
+#define CCM_STATE__READY                (CCM_STATE__STARTED | CCM_STATE__LENGTHS_SET)
+
+void mbedtls_ccm_init(mbedtls_ccm_context *ctx)
+{
+    memset(ctx, 0, sizeof(mbedtls_ccm_context));
+}
+
+int mbedtls_ccm_setkey(mbedtls_ccm_context *ctx,
+                       mbedtls_cipher_id_t cipher,
+                       const unsigned char *key,
+                       unsigned int keybits)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    /* The software engine is kept for CCM* without tag */
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    mbedtls_block_cipher_free(&ctx->block_cipher_ctx);
+
+    if ((ret = mbedtls_block_cipher_setup(&ctx->block_cipher_ctx, cipher)) != 0)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if ((ret = mbedtls_block_cipher_setkey(&ctx->block_cipher_ctx, key, keybits)) != 0)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+#else
+    const mbedtls_cipher_info_t *cipher_info;
+
+    cipher_info = mbedtls_cipher_info_from_values(cipher, keybits, MBEDTLS_MODE_ECB);
+    if (cipher_info == NULL)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (mbedtls_cipher_info_get_block_size(cipher_info) != 16)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    mbedtls_cipher_free(&ctx->cipher_ctx);
+
+    if ((ret = mbedtls_cipher_setup(&ctx->cipher_ctx, cipher_info)) != 0)
+        return ret;
+
+    if ((ret = mbedtls_cipher_setkey(&ctx->cipher_ctx, key, keybits, MBEDTLS_ENCRYPT)) != 0)
+        return ret;
+#endif
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    ctx->hw_key = (cipher == MBEDTLS_CIPHER_ID_AES);
+    if (ctx->hw_key)
+        ctx->cau_keysize = cau_alt_key_config(key, keybits, &ctx->cau_key);
+#endif
+
+    return ret;
+}
+
+void mbedtls_ccm_free(mbedtls_ccm_context *ctx)
+{
+    if (ctx == NULL)
+        return;
+
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    mbedtls_block_cipher_free(&ctx->block_cipher_ctx);
+#else
+    mbedtls_cipher_free(&ctx->cipher_ctx);
+#endif
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_ccm_context));
+}
+
+static int ccm_is_encrypt(const mbedtls_ccm_context *ctx)
+{
+    return (ctx->mode == MBEDTLS_CCM_ENCRYPT || ctx->mode == MBEDTLS_CCM_STAR_ENCRYPT);
+}
+
+/*
+ * Software engine
+ */
+static int ccm_soft_encrypt_block(mbedtls_ccm_context *ctx, const unsigned char input[16],
+                                  unsigned char output[16])
+{
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    return mbedtls_block_cipher_encrypt(&ctx->block_cipher_ctx, input, output);
+#else
+    size_t olen = 0;
+
+    return mbedtls_cipher_update(&ctx->cipher_ctx, input, 16, output, &olen);
+#endif
+}
+
+/* CBC-MAC update, the last partial block is zero padded */
+static int ccm_soft_mac(mbedtls_ccm_context *ctx, const unsigned char *input, size_t length)
+{
+    size_t use_len;
+    int ret;
+
+    while (length > 0) {
+        use_len = (length < 16) ? length : 16;
+        mbedtls_xor(ctx->y, ctx->y, input, use_len);
+        if ((ret = ccm_soft_encrypt_block(ctx, ctx->y, ctx->y)) != 0)
+            return ret;
+        input += use_len;
+        length -= use_len;
+    }
+
+    return 0;
+}
+
+static void ccm_incr(mbedtls_ccm_context *ctx, unsigned char ctr[16])
+{
+    unsigned int i;
+
+    for (i = 0; i < ctx->q; i++) {
+        if (++ctr[15 - i] != 0)
+            break;
+    }
+}
+
+static int ccm_soft_crypt(mbedtls_ccm_context *ctx, const unsigned char *input,
+                          unsigned char *output, size_t length)
+{
+    unsigned char ectr[16];
+    unsigned char plain[16];
+    size_t use_len;
+    int ret;
+
+    while (length > 0) {
+        use_len = (length < 16) ? length : 16;
+        if ((ret = ccm_soft_encrypt_block(ctx, ctx->ctr, ectr)) != 0)
+            return ret;
+        ccm_incr(ctx, ctx->ctr);
+
+        /* The MAC is computed on the plaintext, input and output may overlap */
+        if (ccm_is_encrypt(ctx))
+            memcpy(plain, input, use_len);
+        else
+            mbedtls_xor(plain, ectr, input, use_len);
+        mbedtls_xor(output, ectr, input, use_len);
+        if ((ret = ccm_soft_mac(ctx, plain, use_len)) != 0)
+            return ret;
+
+        input += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+    mbedtls_platform_zeroize(ectr, sizeof(ectr));
+    mbedtls_platform_zeroize(plain, sizeof(plain));
+
+    return 0;
+}
+
+/*
+ * Engine operations, shared by the CAU and the software engine. Lengths are a
+ * multiple of the block size, or less than a block for the last call of a phase.
+ */
+static int ccm_engine_aad(mbedtls_ccm_context *ctx, const unsigned char *add, size_t length)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        if (length % 16)
+            return CAU_ALT_RET(cau_alt_process_last(add, NULL, length));
+        return CAU_ALT_RET(cau_alt_process(add, NULL, length));
+    }
+#endif
+    return ccm_soft_mac(ctx, add, length);
+}
+
+static int ccm_engine_crypt(mbedtls_ccm_context *ctx, const unsigned char *input,
+                            unsigned char *output, size_t length)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        if (length % 16)
+            return CAU_ALT_RET(cau_alt_process_last(input, output, length));
+        return CAU_ALT_RET(cau_alt_process(input, output, length));
+    }
+#endif
+    return ccm_soft_crypt(ctx, input, output, length);
+}
+
+/*
+ * Output of the partial block held in buf, without moving the engine state:
+ * the block is processed for good once complete or by mbedtls_ccm_finish().
+ */
+static int ccm_engine_peek(mbedtls_ccm_context *ctx, unsigned char output[16])
+{
+    unsigned char ectr[16];
+    int ret;
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        /* Save the state first, the next call restores it */
+        cau_alt_suspend(&ctx->cau_ctx, &ctx->cau_key);
+        cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+        ret = CAU_ALT_RET(cau_alt_process_last(ctx->buf, output, ctx->buf_len));
+        cau_alt_stop();
+        return ret;
+    }
+#endif
+    if ((ret = ccm_soft_encrypt_block(ctx, ctx->ctr, ectr)) != 0)
+        return ret;
+    mbedtls_xor(output, ectr, ctx->buf, ctx->buf_len);
+    mbedtls_platform_zeroize(ectr, sizeof(ectr));
+
+    return 0;
+}
+
+static int ccm_engine_tag(mbedtls_ccm_context *ctx, unsigned char tag[16])
+{
+    unsigned char ctr0[16];
+    int ret;
+
+    memcpy(ctr0, ctx->ctr, 16);
+    memset(ctr0 + 16 - ctx->q, 0, ctx->q);
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw)
+        return CAU_ALT_RET(cau_alt_tag(ctr0, tag));
+#endif
+    if ((ret = ccm_soft_encrypt_block(ctx, ctr0, tag)) != 0)
+        return ret;
+    mbedtls_xor(tag, tag, ctx->y, 16);
+
+    return 0;
+}
+
+/*
+ * The CAU state lives in the context between two calls of a multi-part
+ * operation, so that other users of the CAU can run in between. CAU_LOCK()
+ * is held from the start or the restore of the state until it is saved.
+ */
+static void ccm_lock(mbedtls_ccm_context *ctx)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw_key)
+        CAU_LOCK();
+#else
+    (void) ctx;
+#endif
+}
+
+static void ccm_unlock(mbedtls_ccm_context *ctx)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw_key)
+        CAU_UNLOCK();
+#else
+    (void) ctx;
+#endif
+}
+
+static void ccm_resume(mbedtls_ccm_context *ctx)
+{
+    ccm_lock(ctx);
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (!ctx->hw)
+        return;
+
+    cau_alt_resume(&ctx->cau_ctx);
+    if (ctx->state & CCM_STATE__DATA_STARTED)
+        cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+    else if ((ctx->state & CCM_STATE__AUTH_DATA_STARTED) &&
+             !(ctx->state & CCM_STATE__AUTH_DATA_FINISHED))
+        cau_alt_phase(CAU_AAD_PHASE);
+#else
+    (void) ctx;
+#endif
+}
+
+/* Save the CAU state when save is set and let the CAU go */
+static void ccm_suspend(mbedtls_ccm_context *ctx, int save)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw && save)
+        cau_alt_suspend(&ctx->cau_ctx, &ctx->cau_key);
+#else
+    (void) save;
+#endif
+    ccm_unlock(ctx);
+}
+
+/*
+ * Build the first block and start the engine, once both mbedtls_ccm_starts()
+ * and mbedtls_ccm_set_lengths() have been called.
+ */
+static int ccm_begin(mbedtls_ccm_context *ctx)
+{
+    unsigned char b0[16];
+    unsigned int i;
+    size_t len_left;
+    int ret;
+
+    if ((ctx->state & CCM_STATE__READY) != CCM_STATE__READY)
+        return 0;
+
+    /* CCM expects non-empty tag.
+     * CCM* allows empty tag. For CCM* without tag, ignore plaintext length.
+     */
+    if (ctx->tag_len == 0) {
+        if (ctx->mode == MBEDTLS_CCM_STAR_ENCRYPT || ctx->mode == MBEDTLS_CCM_STAR_DECRYPT)
+            ctx->plaintext_len = 0;
+        else
+            return MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+
+    /*
+     * First block:
+     * 0        .. 0        flags
+     * 1        .. 15 - q   nonce, from the counter block
+     * 16 - q   .. 15       length
+     *
+     * With flags as (bits):
+     * 7        0
+     * 6        add present?
+     * 5 .. 3   (t - 2) / 2
+     * 2 .. 0   q - 1
+     */
+    memcpy(b0, ctx->ctr, 16);
+    b0[0] = (unsigned char) (((ctx->add_len > 0) << 6) | (ctx->q - 1));
+    if (ctx->tag_len != 0)
+        b0[0] |= (unsigned char) (((ctx->tag_len - 2) / 2) << 3);
+    for (i = 0, len_left = ctx->plaintext_len; i < ctx->q; i++, len_left >>= 8)
+        b0[15 - i] = MBEDTLS_BYTE_0(len_left);
+
+    if (len_left > 0) {
+        ctx->state |= CCM_STATE__ERROR;
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+    }
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    /* Without tag the last block is not known in advance, the CAU needs it */
+    ctx->hw = (ctx->hw_key && ctx->tag_len != 0);
+    if (ctx->hw) {
+        ret = CAU_ALT_RET(cau_alt_start(ccm_is_encrypt(ctx) ? CAU_ENCRYPT : CAU_DECRYPT,
+                                        CAU_MODE_AES_CCM, ctx->cau_keysize, &ctx->cau_key,
+                                        ctx->ctr, b0));
+        if (ret != 0)
+            ctx->state |= CCM_STATE__ERROR;
+        return ret;
+    }
+#endif
+
+    /* Start CBC-MAC with first block */
+    if ((ret = ccm_soft_encrypt_block(ctx, b0, ctx->y)) != 0) {
+        ctx->state |= CCM_STATE__ERROR;
+        return ret;
+    }
+
+    return 0;
+}
+
+static int ccm_starts(mbedtls_ccm_context *ctx, int mode,
+                      const unsigned char *iv, size_t iv_len)
+{
+    /* Also implies q is within bounds */
+    if (iv_len < 7 || iv_len > 13)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    ctx->mode = mode;
+    ctx->q = 16 - 1 - (unsigned char) iv_len;
+    ctx->hw = 0;
+
+    /*
+     * Prepare counter block for encryption:
+     * 0        .. 0        flags
+     * 1        .. iv_len   nonce (aka iv)
+     * iv_len+1 .. 15       counter (initially 1)
+     *
+     * With flags as (bits):
+     * 7 .. 3   0
+     * 2 .. 0   q - 1
+     */
+    memset(ctx->ctr, 0, 16);
+    ctx->ctr[0] = ctx->q - 1;
+    memcpy(ctx->ctr + 1, iv, iv_len);
+    ctx->ctr[15] = 1;
+
+    ctx->state |= CCM_STATE__STARTED;
+
+    return ccm_begin(ctx);
+}
+
+static int ccm_set_lengths(mbedtls_ccm_context *ctx, size_t total_ad_len,
+                           size_t plaintext_len, size_t tag_len)
+{
+    /*
+     * Check length requirements: SP800-38C A.1
+     * Additional requirement: a < 2^16 - 2^8 to simplify the code.
+     * 'length' checked later (when writing it to the first block)
+     *
+     * Also, loosen the requirements to enable support for CCM* (IEEE 802.15.4).
+     */
+    if (tag_len == 2 || tag_len > 16 || tag_len % 2 != 0)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (total_ad_len >= 0xFF00)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    ctx->plaintext_len = plaintext_len;
+    ctx->add_len = total_ad_len;
+    ctx->tag_len = tag_len;
+    ctx->processed = 0;
+    ctx->buf_len = 0;
+    ctx->hw = 0;
+    ctx->state |= CCM_STATE__LENGTHS_SET;
+
+    return ccm_begin(ctx);
+}
+
+static int ccm_update_ad(mbedtls_ccm_context *ctx, const unsigned char *add, size_t add_len)
+{
+    size_t use_len;
+    int ret;
+
+    if (!(ctx->state & CCM_STATE__AUTH_DATA_STARTED)) {
+        /* The first block starts with the total length of the data */
+        ctx->buf[0] = (unsigned char) ((ctx->add_len >> 8) & 0xFF);
+        ctx->buf[1] = (unsigned char) ((ctx->add_len) & 0xFF);
+        ctx->buf_len = 2;
+        ctx->state |= CCM_STATE__AUTH_DATA_STARTED;
+#if !defined(CONFIG_CAU_SOFT_REF)
+        if (ctx->hw)
+            cau_alt_phase(CAU_AAD_PHASE);
+#endif
+    }
+    ctx->processed += add_len;
+
+    use_len = 16 - ctx->buf_len;
+    if (use_len > add_len)
+        use_len = add_len;
+    memcpy(ctx->buf + ctx->buf_len, add, use_len);
+    ctx->buf_len += use_len;
+    add += use_len;
+    add_len -= use_len;
+
+    if (ctx->buf_len == 16) {
+        if ((ret = ccm_engine_aad(ctx, ctx->buf, 16)) != 0)
+            goto error;
+        ctx->buf_len = 0;
+
+        use_len = add_len & ~(size_t) 15;
+        if (use_len != 0) {
+            if ((ret = ccm_engine_aad(ctx, add, use_len)) != 0)
+                goto error;
+            add += use_len;
+            add_len -= use_len;
+        }
+
+        memcpy(ctx->buf, add, add_len);
+        ctx->buf_len = (unsigned char) add_len;
+    }
+
+    if (ctx->processed == ctx->add_len) {
+        if (ctx->buf_len != 0 && (ret = ccm_engine_aad(ctx, ctx->buf, ctx->buf_len)) != 0)
+            goto error;
+        ctx->buf_len = 0;
+        ctx->state |= CCM_STATE__AUTH_DATA_FINISHED;
+        ctx->processed = 0; // prepare for mbedtls_ccm_update()
+    }
+
+    return 0;
+
+error:
+    ctx->state |= CCM_STATE__ERROR;
+    return ret;
+}
+
+/*
+ * Whole blocks are processed as they come, and so is the last block of the
+ * message. Another trailing partial block is kept in buf and its output given
+ * right away, as mbedtls_ccm_update() must return as many bytes as it got; the
+ * output of buf bytes given by an earlier call is not given again.
+ */
+static int ccm_update(mbedtls_ccm_context *ctx, const unsigned char *input,
+                      size_t length, unsigned char *output)
+{
+    unsigned char block[16];
+    size_t done = ctx->buf_len;
+    size_t use_len;
+    int last, ret;
+
+    if (!(ctx->state & CCM_STATE__DATA_STARTED)) {
+        ctx->state |= CCM_STATE__DATA_STARTED;
+#if !defined(CONFIG_CAU_SOFT_REF)
+        if (ctx->hw)
+            cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+#endif
+    }
+    ctx->processed += length;
+    last = (ctx->tag_len != 0 && ctx->processed == ctx->plaintext_len);
+
+    if (done != 0) {
+        use_len = 16 - done;
+        if (use_len > length)
+            use_len = length;
+        memcpy(ctx->buf + done, input, use_len);
+        ctx->buf_len += use_len;
+        input += use_len;
+        length -= use_len;
+
+        if (ctx->buf_len < 16 && !last)
+            ret = ccm_engine_peek(ctx, block);
+        else
+            ret = ccm_engine_crypt(ctx, ctx->buf, block, ctx->buf_len);
+        if (ret != 0)
+            goto error;
+        memcpy(output, block + done, use_len);
+        output += use_len;
+
+        if (ctx->buf_len < 16 && !last)
+            return 0;
+        ctx->buf_len = 0;
+    }
+
+    use_len = last ? length : (length & ~(size_t) 15);
+    if (use_len != 0) {
+        if ((ret = ccm_engine_crypt(ctx, input, output, use_len)) != 0)
+            goto error;
+        input += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+
+    if (length != 0) {
+        memcpy(ctx->buf, input, length);
+        ctx->buf_len = (unsigned char) length;
+        if ((ret = ccm_engine_peek(ctx, block)) != 0)
+            goto error;
+        memcpy(output, block, length);
+    }
+    mbedtls_platform_zeroize(block, sizeof(block));
+
+    return 0;
+
+error:
+    ctx->state |= CCM_STATE__ERROR;
+    return ret;
+}
+
+static int ccm_finish(mbedtls_ccm_context *ctx, unsigned char *tag, size_t tag_len)
+{
+    unsigned char block[16];
+    int ret;
+
+    /* Only CCM* without tag may end on a partial block */
+    if (ctx->buf_len != 0) {
+        if ((ret = ccm_engine_crypt(ctx, ctx->buf, block, ctx->buf_len)) != 0)
+            goto error;
+        ctx->buf_len = 0;
+    }
+
+    /*
+     * Authentication: crypt/mask internal tag with counter 0
+     */
+    if ((ret = ccm_engine_tag(ctx, block)) != 0)
+        goto error;
+
+    if (tag != NULL)
+        memcpy(tag, block, tag_len);
+    mbedtls_platform_zeroize(block, sizeof(block));
+
+    ctx->state = CCM_STATE__CLEAR;
+    memset(ctx->y, 0, 16);
+    memset(ctx->ctr, 0, 16);
+
+    return 0;
+
+error:
+    ctx->state |= CCM_STATE__ERROR;
+    return ret;
+}
+
+int mbedtls_ccm_starts(mbedtls_ccm_context *ctx,
+                       int mode,
+                       const unsigned char *iv,
+                       size_t iv_len)
+{
+    int ret;
+
+    ccm_lock(ctx);
+    ret = ccm_starts(ctx, mode, iv, iv_len);
+    ccm_suspend(ctx, ret == 0);
+
+    return ret;
+}
+
+int mbedtls_ccm_set_lengths(mbedtls_ccm_context *ctx,
+                            size_t total_ad_len,
+                            size_t plaintext_len,
+                            size_t tag_len)
+{
+    int ret;
+
+    ccm_lock(ctx);
+    ret = ccm_set_lengths(ctx, total_ad_len, plaintext_len, tag_len);
+    ccm_suspend(ctx, ret == 0);
+
+    return ret;
+}
+
+static int ccm_check_update_ad(mbedtls_ccm_context *ctx, size_t add_len)
+{
+    if (ctx->state & CCM_STATE__ERROR)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    /* The engine has to be started to take the data */
+    if ((ctx->state & CCM_STATE__READY) != CCM_STATE__READY)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (ctx->state & CCM_STATE__AUTH_DATA_FINISHED)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (ctx->processed + add_len > ctx->add_len)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    return 0;
+}
+
+int mbedtls_ccm_update_ad(mbedtls_ccm_context *ctx,
+                          const unsigned char *add,
+                          size_t add_len)
+{
+    int ret;
+
+    if (ctx->state & CCM_STATE__ERROR)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (add_len == 0)
+        return 0;
+
+    if ((ret = ccm_check_update_ad(ctx, add_len)) != 0)
+        return ret;
+
+    ccm_resume(ctx);
+    ret = ccm_update_ad(ctx, add, add_len);
+    ccm_suspend(ctx, ret == 0);
+
+    return ret;
+}
+
+static int ccm_check_update(mbedtls_ccm_context *ctx, size_t input_len, size_t output_size)
+{
+    if (ctx->state & CCM_STATE__ERROR)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    /* Check against plaintext length only if performing operation with
+     * authentication
+     */
+    if (ctx->tag_len != 0 && ctx->processed + input_len > ctx->plaintext_len)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (output_size < input_len)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    /* All the additional data comes before the input data */
+    if ((ctx->state & CCM_STATE__READY) != CCM_STATE__READY ||
+        (ctx->add_len > 0 && !(ctx->state & CCM_STATE__AUTH_DATA_FINISHED)))
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    return 0;
+}
+
+int mbedtls_ccm_update(mbedtls_ccm_context *ctx,
+                       const unsigned char *input, size_t input_len,
+                       unsigned char *output, size_t output_size,
+                       size_t *output_len)
+{
+    int ret;
+
+    if ((ret = ccm_check_update(ctx, input_len, output_size)) != 0)
+        return ret;
+
+    *output_len = input_len;
+    if (input_len == 0)
+        return 0;
+
+    ccm_resume(ctx);
+    ret = ccm_update(ctx, input, input_len, output);
+    /* After a peek the state has been saved already */
+    ccm_suspend(ctx, ret == 0 && ctx->buf_len == 0);
+
+    return ret;
+}
+
+static int ccm_check_finish(mbedtls_ccm_context *ctx)
+{
+    if (ctx->state & CCM_STATE__ERROR)
+        return MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if ((ctx->state & CCM_STATE__READY) != CCM_STATE__READY)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (ctx->add_len > 0 && !(ctx->state & CCM_STATE__AUTH_DATA_FINISHED))
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    if (ctx->plaintext_len > 0 && ctx->processed != ctx->plaintext_len)
+        return MBEDTLS_ERR_CCM_BAD_INPUT;
+
+    return 0;
+}
+
+int mbedtls_ccm_finish(mbedtls_ccm_context *ctx,
+                       unsigned char *tag, size_t tag_len)
+{
+    int ret;
+
+    if ((ret = ccm_check_finish(ctx)) != 0)
+        return ret;
+
+    ccm_resume(ctx);
+    ret = ccm_finish(ctx, tag, tag_len);
+    ccm_suspend(ctx, 0);
+
+    return ret;
+}
+
+/*
+ * Authenticated encryption or decryption, in one go: the CAU state does not
+ * need to be saved between the steps.
+ */
+static int ccm_auth_crypt(mbedtls_ccm_context *ctx, int mode, size_t length,
+                          const unsigned char *iv, size_t iv_len,
+                          const unsigned char *add, size_t add_len,
+                          const unsigned char *input, unsigned char *output,
+                          unsigned char *tag, size_t tag_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    ccm_lock(ctx);
+    if ((ret = ccm_starts(ctx, mode, iv, iv_len)) != 0) {
+        ccm_unlock(ctx);
+        return ret;
+    }
+
+    if ((ret = ccm_set_lengths(ctx, add_len, length, tag_len)) != 0)
+        goto exit;
+
+    if (add_len != 0) {
+        if ((ret = ccm_check_update_ad(ctx, add_len)) != 0 ||
+            (ret = ccm_update_ad(ctx, add, add_len)) != 0)
+            goto exit;
+    }
+
+    if (length != 0) {
+        if ((ret = ccm_check_update(ctx, length, length)) != 0 ||
+            (ret = ccm_update(ctx, input, length, output)) != 0)
+            goto exit;
+    }
+
+    if ((ret = ccm_check_finish(ctx)) != 0)
+        goto exit;
+    ret = ccm_finish(ctx, tag, tag_len);
+
+exit:
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ret != 0 && ctx->hw)
+        cau_alt_stop();
+#endif
+    ccm_unlock(ctx);
+    return ret;
+}
+
+/*
+ * Authenticated encryption
+ */
+int mbedtls_ccm_star_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length,
+                                     const unsigned char *iv, size_t iv_len,
+                                     const unsigned char *add, size_t add_len,
+                                     const unsigned char *input, unsigned char *output,
+                                     unsigned char *tag, size_t tag_len)
+{
+    return ccm_auth_crypt(ctx, MBEDTLS_CCM_STAR_ENCRYPT, length, iv, iv_len,
+                          add, add_len, input, output, tag, tag_len);
+}
+
+int mbedtls_ccm_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length,
+                                const unsigned char *iv, size_t iv_len,
+                                const unsigned char *add, size_t add_len,
+                                const unsigned char *input, unsigned char *output,
+                                unsigned char *tag, size_t tag_len)
+{
+    return ccm_auth_crypt(ctx, MBEDTLS_CCM_ENCRYPT, length, iv, iv_len,
+                          add, add_len, input, output, tag, tag_len);
+}
+
+/*
+ * Authenticated decryption
+ */
+static int ccm_auth_decrypt(mbedtls_ccm_context *ctx, int mode, size_t length,
+                            const unsigned char *iv, size_t iv_len,
+                            const unsigned char *add, size_t add_len,
+                            const unsigned char *input, unsigned char *output,
+                            const unsigned char *tag, size_t tag_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char check_tag[16];
+
+    if ((ret = ccm_auth_crypt(ctx, mode, length,
+                              iv, iv_len, add, add_len,
+                              input, output, check_tag, tag_len)) != 0)
+        return ret;
+
+    /* Check tag in "constant-time" */
+    if (mbedtls_ct_memcmp(tag, check_tag, tag_len) != 0) {
+        mbedtls_platform_zeroize(output, length);
+        return MBEDTLS_ERR_CCM_AUTH_FAILED;
+    }
+
+    return 0;
+}
+
+int mbedtls_ccm_star_auth_decrypt(mbedtls_ccm_context *ctx, size_t length,
+                                  const unsigned char *iv, size_t iv_len,
+                                  const unsigned char *add, size_t add_len,
+                                  const unsigned char *input, unsigned char *output,
+                                  const unsigned char *tag, size_t tag_len)
+{
+    return ccm_auth_decrypt(ctx, MBEDTLS_CCM_STAR_DECRYPT, length,
+                            iv, iv_len, add, add_len,
+                            input, output, tag, tag_len);
+}
+
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context *ctx, size_t length,
+                             const unsigned char *iv, size_t iv_len,
+                             const unsigned char *add, size_t add_len,
+                             const unsigned char *input, unsigned char *output,
+                             const unsigned char *tag, size_t tag_len)
+{
+    return ccm_auth_decrypt(ctx, MBEDTLS_CCM_DECRYPT, length,
+                            iv, iv_len, add, add_len,
+                            input, output, tag, tag_len);
+}
+
+#endif /* MBEDTLS_CCM_ALT */
+#endif /* MBEDTLS_CCM_C */
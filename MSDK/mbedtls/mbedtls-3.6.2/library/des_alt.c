@@ -45,6 +45,7 @@ OF SUCH DAMAGE.
 #include <string.h>
 
 #if defined(MBEDTLS_DES_ALT)
+#include "mbedtls/aes.h"
 #include "gd32vw55x_cau.h"
 
 /* Implementation that should never be optimized out by the compiler */
@@ -192,9 +193,9 @@ int mbedtls_des_crypt_ecb( mbedtls_des_context *ctx,
     cau_ecb_parameter.input = (uint8_t *)input;
     cau_ecb_parameter.in_length = 8;
 
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_des_ecb(&cau_ecb_parameter, output);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
 
     return (ret == ERROR) ? 1 : 0;
 }
@@ -232,13 +233,13 @@ int mbedtls_des_crypt_cbc( mbedtls_des_context *ctx,
     cau_cbc_parameter.in_length = length;
 
     memcpy(temp, (input + length - 8), 8);
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_des_cbc(&cau_cbc_parameter, output);
     if(mode == MBEDTLS_DES_DECRYPT)
         memcpy(iv, temp, 8);
     else
         memcpy(iv, (output + length - 8), 8);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
 
     return (ret == ERROR) ? 1 : 0;
 }
@@ -269,9 +270,9 @@ int mbedtls_des3_crypt_ecb( mbedtls_des3_context *ctx,
     cau_tdes_parameter.input = (uint8_t *)input;
     cau_tdes_parameter.in_length = 8;
 
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_tdes_ecb(&cau_tdes_parameter, output);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
 
     return (ret == ERROR) ? 1 : 0;
 }
@@ -309,13 +310,13 @@ int mbedtls_des3_crypt_cbc( mbedtls_des3_context *ctx,
     cau_des3_parameter.in_length = length;
 
     memcpy(temp, (input + length - 8), 8);
-    //GLOBAL_INT_DISABLE();
+    CAU_LOCK();
     ret = cau_tdes_cbc(&cau_des3_parameter, output);
     if(mode == MBEDTLS_DES_DECRYPT)
         memcpy(iv, temp, 8);
     else
         memcpy(iv, (output + length - 8), 8);
-    //GLOBAL_INT_RESTORE();
+    CAU_UNLOCK();
 
     return (ret == ERROR) ? 1 : 0;
 }
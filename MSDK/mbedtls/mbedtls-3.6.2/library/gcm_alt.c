@@ -0,0 +1,723 @@
+/*!
+    \file    gcm_alt.c
+    \brief   AES-GCM with the CAU for GD32VW55x SDK.
+
+    \version 2024-12-30, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include "common.h"
+
+#if defined(MBEDTLS_GCM_C)
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+#include "mbedtls/constant_time.h"
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+#include "block_cipher_internal.h"
+#endif
+
+#include <string.h>
+
+#if defined(MBEDTLS_GCM_ALT)
+#include "cau_alt.h"
+
+#define GCM_PHASE_START         0
+#define GCM_PHASE_AAD           1
+#define GCM_PHASE_DATA          2
+
+void mbedtls_gcm_init(mbedtls_gcm_context *ctx)
+{
+    memset(ctx, 0, sizeof(mbedtls_gcm_context));
+}
+
+/*
+ * Software engine
+ */
+static int gcm_soft_encrypt_block(mbedtls_gcm_context *ctx, const unsigned char input[16],
+                                  unsigned char output[16])
+{
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    return mbedtls_block_cipher_encrypt(&ctx->block_cipher_ctx, input, output);
+#else
+    size_t olen = 0;
+
+    return mbedtls_cipher_update(&ctx->cipher_ctx, input, 16, output, &olen);
+#endif
+}
+
+/* x = x * h in GF(2^128), bit by bit: the software engine is not the fast path */
+static void gcm_soft_mult(const unsigned char h[16], unsigned char x[16])
+{
+    unsigned char z[16] = {0};
+    unsigned char v[16];
+    unsigned char lsb;
+    int i, j;
+
+    memcpy(v, h, 16);
+    for (i = 0; i < 128; i++) {
+        if (x[i >> 3] & (0x80 >> (i & 7)))
+            mbedtls_xor(z, z, v, 16);
+
+        lsb = v[15] & 1;
+        for (j = 15; j > 0; j--)
+            v[j] = (unsigned char)((v[j] >> 1) | (v[j - 1] << 7));
+        v[0] >>= 1;
+        if (lsb)
+            v[0] ^= 0xE1;
+    }
+    memcpy(x, z, 16);
+}
+
+/* GHASH update, the last partial block is zero padded */
+static void gcm_soft_ghash(mbedtls_gcm_context *ctx, const unsigned char *input, size_t length)
+{
+    size_t use_len;
+
+    while (length > 0) {
+        use_len = (length < 16) ? length : 16;
+        mbedtls_xor(ctx->y, ctx->y, input, use_len);
+        gcm_soft_mult(ctx->h, ctx->y);
+        input += use_len;
+        length -= use_len;
+    }
+}
+
+static void gcm_incr(unsigned char y[16])
+{
+    uint32_t x = MBEDTLS_GET_UINT32_BE(y, 12);
+
+    x++;
+    MBEDTLS_PUT_UINT32_BE(x, y, 12);
+}
+
+static int gcm_soft_crypt(mbedtls_gcm_context *ctx, const unsigned char *input,
+                          unsigned char *output, size_t length)
+{
+    unsigned char ectr[16];
+    size_t use_len;
+    int ret;
+
+    while (length > 0) {
+        use_len = (length < 16) ? length : 16;
+        gcm_incr(ctx->ctr);
+        if ((ret = gcm_soft_encrypt_block(ctx, ctx->ctr, ectr)) != 0)
+            return ret;
+
+        /* GHASH is computed on the ciphertext, input and output may overlap */
+        if (ctx->mode == MBEDTLS_GCM_DECRYPT)
+            gcm_soft_ghash(ctx, input, use_len);
+        mbedtls_xor(output, ectr, input, use_len);
+        if (ctx->mode == MBEDTLS_GCM_ENCRYPT)
+            gcm_soft_ghash(ctx, output, use_len);
+
+        input += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+    mbedtls_platform_zeroize(ectr, sizeof(ectr));
+
+    return 0;
+}
+
+/*
+ * Engine operations, shared by the CAU and the software engine. Lengths are a
+ * multiple of the block size, or less than a block for the last call of a phase.
+ */
+static int gcm_engine_aad(mbedtls_gcm_context *ctx, const unsigned char *add, size_t length)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        if (length % 16)
+            return CAU_ALT_RET(cau_alt_process_last(add, NULL, length));
+        return CAU_ALT_RET(cau_alt_process(add, NULL, length));
+    }
+#endif
+    gcm_soft_ghash(ctx, add, length);
+
+    return 0;
+}
+
+static int gcm_engine_crypt(mbedtls_gcm_context *ctx, const unsigned char *input,
+                            unsigned char *output, size_t length)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        if (length % 16)
+            return CAU_ALT_RET(cau_alt_process_last(input, output, length));
+        return CAU_ALT_RET(cau_alt_process(input, output, length));
+    }
+#endif
+    return gcm_soft_crypt(ctx, input, output, length);
+}
+
+/*
+ * Output of the partial block held in buf, without moving the engine state:
+ * the block is processed for good once complete or by mbedtls_gcm_finish().
+ */
+static int gcm_engine_peek(mbedtls_gcm_context *ctx, unsigned char output[16])
+{
+    unsigned char ectr[16];
+    int ret;
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw) {
+        /* Save the state first, the next call restores it */
+        cau_alt_suspend(&ctx->cau_ctx, &ctx->cau_key);
+        cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+        ret = CAU_ALT_RET(cau_alt_process_last(ctx->buf, output, ctx->buf_len));
+        cau_alt_stop();
+        return ret;
+    }
+#endif
+    memcpy(ectr, ctx->ctr, 16);
+    gcm_incr(ectr);
+    if ((ret = gcm_soft_encrypt_block(ctx, ectr, ectr)) != 0)
+        return ret;
+    mbedtls_xor(output, ectr, ctx->buf, ctx->buf_len);
+    mbedtls_platform_zeroize(ectr, sizeof(ectr));
+
+    return 0;
+}
+
+static int gcm_engine_tag(mbedtls_gcm_context *ctx, unsigned char tag[16])
+{
+    unsigned char len_block[16];
+    int ret;
+
+    MBEDTLS_PUT_UINT64_BE(ctx->add_len * 8, len_block, 0);
+    MBEDTLS_PUT_UINT64_BE(ctx->len * 8, len_block, 8);
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw)
+        return CAU_ALT_RET(cau_alt_tag(len_block, tag));
+#endif
+    gcm_soft_ghash(ctx, len_block, 16);
+    if ((ret = gcm_soft_encrypt_block(ctx, ctx->j0, tag)) != 0)
+        return ret;
+    mbedtls_xor(tag, tag, ctx->y, 16);
+
+    return 0;
+}
+
+/*
+ * The CAU state lives in the context between two calls of a multi-part
+ * operation, so that other users of the CAU can run in between. CAU_LOCK()
+ * is held from the start or the restore of the state until it is saved.
+ */
+static void gcm_lock(mbedtls_gcm_context *ctx)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw_key)
+        CAU_LOCK();
+#else
+    (void) ctx;
+#endif
+}
+
+static void gcm_unlock(mbedtls_gcm_context *ctx)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw_key)
+        CAU_UNLOCK();
+#else
+    (void) ctx;
+#endif
+}
+
+static void gcm_resume(mbedtls_gcm_context *ctx)
+{
+    gcm_lock(ctx);
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (!ctx->hw)
+        return;
+
+    cau_alt_resume(&ctx->cau_ctx);
+    if (ctx->phase == GCM_PHASE_AAD)
+        cau_alt_phase(CAU_AAD_PHASE);
+    else if (ctx->phase == GCM_PHASE_DATA)
+        cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+#else
+    (void) ctx;
+#endif
+}
+
+/* Save the CAU state when save is set and let the CAU go */
+static void gcm_suspend(mbedtls_gcm_context *ctx, int save)
+{
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw && save)
+        cau_alt_suspend(&ctx->cau_ctx, &ctx->cau_key);
+#else
+    (void) save;
+#endif
+    gcm_unlock(ctx);
+}
+
+/* Authenticate the additional data still in buf and switch to the data phase */
+static int gcm_enter_data(mbedtls_gcm_context *ctx)
+{
+    int ret;
+
+    if (ctx->phase == GCM_PHASE_DATA)
+        return 0;
+
+    if (ctx->buf_len != 0) {
+        if ((ret = gcm_engine_aad(ctx, ctx->buf, ctx->buf_len)) != 0)
+            return ret;
+        ctx->buf_len = 0;
+    }
+    ctx->phase = GCM_PHASE_DATA;
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ctx->hw)
+        cau_alt_phase(CAU_ENCRYPT_DECRYPT_PHASE);
+#endif
+
+    return 0;
+}
+
+int mbedtls_gcm_setkey(mbedtls_gcm_context *ctx,
+                       mbedtls_cipher_id_t cipher,
+                       const unsigned char *key,
+                       unsigned int keybits)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (keybits != 128 && keybits != 192 && keybits != 256)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    /* The software engine is kept for the IV lengths the CAU does not take */
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    mbedtls_block_cipher_free(&ctx->block_cipher_ctx);
+
+    if ((ret = mbedtls_block_cipher_setup(&ctx->block_cipher_ctx, cipher)) != 0)
+        return ret;
+
+    if ((ret = mbedtls_block_cipher_setkey(&ctx->block_cipher_ctx, key, keybits)) != 0)
+        return ret;
+#else
+    const mbedtls_cipher_info_t *cipher_info;
+
+    cipher_info = mbedtls_cipher_info_from_values(cipher, keybits, MBEDTLS_MODE_ECB);
+    if (cipher_info == NULL)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    if (mbedtls_cipher_info_get_block_size(cipher_info) != 16)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    mbedtls_cipher_free(&ctx->cipher_ctx);
+
+    if ((ret = mbedtls_cipher_setup(&ctx->cipher_ctx, cipher_info)) != 0)
+        return ret;
+
+    if ((ret = mbedtls_cipher_setkey(&ctx->cipher_ctx, key, keybits, MBEDTLS_ENCRYPT)) != 0)
+        return ret;
+#endif
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    ctx->hw_key = (cipher == MBEDTLS_CIPHER_ID_AES);
+    if (ctx->hw_key)
+        ctx->cau_keysize = cau_alt_key_config(key, keybits, &ctx->cau_key);
+#endif
+
+    return 0;
+}
+
+static int gcm_starts(mbedtls_gcm_context *ctx, int mode,
+                      const unsigned char *iv, size_t iv_len)
+{
+    unsigned char len_block[16] = {0};
+    int ret;
+
+    /* IV is limited to 2^64 bits, so 2^61 bytes */
+    if (iv_len == 0 || ((uint64_t) iv_len) >> 61 != 0)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    ctx->mode = (unsigned char) mode;
+    ctx->len = 0;
+    ctx->add_len = 0;
+    ctx->buf_len = 0;
+    ctx->phase = GCM_PHASE_START;
+    memset(ctx->y, 0, 16);
+
+#if !defined(CONFIG_CAU_SOFT_REF)
+    ctx->hw = (ctx->hw_key && iv_len == 12);
+    if (ctx->hw) {
+        /* The CAU starts from the first counter block, J0 + 1 */
+        memcpy(ctx->ctr, iv, 12);
+        MBEDTLS_PUT_UINT32_BE(2, ctx->ctr, 12);
+        return CAU_ALT_RET(cau_alt_start((mode == MBEDTLS_GCM_ENCRYPT) ? CAU_ENCRYPT : CAU_DECRYPT,
+                                         CAU_MODE_AES_GCM, ctx->cau_keysize, &ctx->cau_key,
+                                         ctx->ctr, NULL));
+    }
+#endif
+
+    memset(ctx->h, 0, 16);
+    if ((ret = gcm_soft_encrypt_block(ctx, ctx->h, ctx->h)) != 0)
+        return ret;
+
+    if (iv_len == 12) {
+        memcpy(ctx->j0, iv, 12);
+        MBEDTLS_PUT_UINT32_BE(1, ctx->j0, 12);
+    } else {
+        MBEDTLS_PUT_UINT64_BE(((uint64_t) iv_len) * 8, len_block, 8);
+        gcm_soft_ghash(ctx, iv, iv_len);
+        gcm_soft_ghash(ctx, len_block, 16);
+        memcpy(ctx->j0, ctx->y, 16);
+        memset(ctx->y, 0, 16);
+    }
+    memcpy(ctx->ctr, ctx->j0, 16);
+
+    return 0;
+}
+
+static int gcm_update_ad(mbedtls_gcm_context *ctx, const unsigned char *add, size_t add_len)
+{
+    size_t use_len;
+    int ret;
+
+    ctx->add_len += add_len;
+    if (ctx->phase == GCM_PHASE_START) {
+        ctx->phase = GCM_PHASE_AAD;
+#if !defined(CONFIG_CAU_SOFT_REF)
+        if (ctx->hw)
+            cau_alt_phase(CAU_AAD_PHASE);
+#endif
+    }
+
+    if (ctx->buf_len != 0) {
+        use_len = 16 - ctx->buf_len;
+        if (use_len > add_len)
+            use_len = add_len;
+        memcpy(ctx->buf + ctx->buf_len, add, use_len);
+        ctx->buf_len += use_len;
+        add += use_len;
+        add_len -= use_len;
+
+        if (ctx->buf_len < 16)
+            return 0;
+        if ((ret = gcm_engine_aad(ctx, ctx->buf, 16)) != 0)
+            return ret;
+        ctx->buf_len = 0;
+    }
+
+    use_len = add_len & ~(size_t) 15;
+    if (use_len != 0) {
+        if ((ret = gcm_engine_aad(ctx, add, use_len)) != 0)
+            return ret;
+        add += use_len;
+        add_len -= use_len;
+    }
+
+    memcpy(ctx->buf, add, add_len);
+    ctx->buf_len = (unsigned char) add_len;
+
+    return 0;
+}
+
+/*
+ * Whole blocks are processed as they come, a trailing partial block is kept
+ * in buf. With peek set its output is given right away, as mbedtls_gcm_update()
+ * must return as many bytes as it got; the output of buf bytes given by an
+ * earlier call is not given again.
+ */
+static int gcm_update(mbedtls_gcm_context *ctx, const unsigned char *input,
+                      size_t length, unsigned char *output, int peek)
+{
+    unsigned char block[16];
+    size_t done, use_len;
+    int ret;
+
+    if ((ret = gcm_enter_data(ctx)) != 0)
+        return ret;
+    ctx->len += length;
+
+    done = ctx->buf_len;
+    if (done != 0) {
+        use_len = 16 - done;
+        if (use_len > length)
+            use_len = length;
+        memcpy(ctx->buf + done, input, use_len);
+        ctx->buf_len += use_len;
+        input += use_len;
+        length -= use_len;
+
+        if (ctx->buf_len < 16)
+            ret = gcm_engine_peek(ctx, block);
+        else
+            ret = gcm_engine_crypt(ctx, ctx->buf, block, 16);
+        if (ret != 0)
+            return ret;
+        memcpy(output, block + done, use_len);
+        output += use_len;
+
+        if (ctx->buf_len < 16)
+            return 0;
+        ctx->buf_len = 0;
+    }
+
+    use_len = length & ~(size_t) 15;
+    if (use_len != 0) {
+        if ((ret = gcm_engine_crypt(ctx, input, output, use_len)) != 0)
+            return ret;
+        input += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+
+    if (length != 0) {
+        memcpy(ctx->buf, input, length);
+        ctx->buf_len = (unsigned char) length;
+        if (peek) {
+            if ((ret = gcm_engine_peek(ctx, block)) != 0)
+                return ret;
+            memcpy(output, block, length);
+        }
+    }
+    mbedtls_platform_zeroize(block, sizeof(block));
+
+    return 0;
+}
+
+/* Process what is left in buf and compute the tag. The output of the last
+   partial block goes to output, when not already given by gcm_update() */
+static int gcm_finish(mbedtls_gcm_context *ctx, unsigned char *output,
+                      unsigned char *tag, size_t tag_len)
+{
+    unsigned char block[16];
+    int ret;
+
+    if (ctx->buf_len != 0) {
+        if (ctx->phase == GCM_PHASE_AAD) {
+            ret = gcm_engine_aad(ctx, ctx->buf, ctx->buf_len);
+        } else {
+            ret = gcm_engine_crypt(ctx, ctx->buf, block, ctx->buf_len);
+            if (ret == 0 && output != NULL)
+                memcpy(output, block, ctx->buf_len);
+        }
+        if (ret != 0)
+            return ret;
+        ctx->buf_len = 0;
+    }
+
+    if ((ret = gcm_engine_tag(ctx, block)) != 0)
+        return ret;
+    memcpy(tag, block, tag_len);
+    mbedtls_platform_zeroize(block, sizeof(block));
+
+    return 0;
+}
+
+int mbedtls_gcm_starts(mbedtls_gcm_context *ctx,
+                       int mode,
+                       const unsigned char *iv,
+                       size_t iv_len)
+{
+    int ret;
+
+    gcm_lock(ctx);
+    ret = gcm_starts(ctx, mode, iv, iv_len);
+    gcm_suspend(ctx, ret == 0);
+
+    return ret;
+}
+
+int mbedtls_gcm_update_ad(mbedtls_gcm_context *ctx,
+                          const unsigned char *add, size_t add_len)
+{
+    uint64_t new_add_len;
+    int ret;
+
+    /* AD is limited to 2^64 bits, ie 2^61 bytes
+     * Also check for possible overflow */
+    new_add_len = ctx->add_len + (uint64_t) add_len;
+    if (new_add_len < ctx->add_len || new_add_len >> 61 != 0)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    /* The CAU takes all the additional data before the input data */
+    if (ctx->phase == GCM_PHASE_DATA)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    if (add_len == 0)
+        return 0;
+
+    gcm_resume(ctx);
+    ret = gcm_update_ad(ctx, add, add_len);
+    gcm_suspend(ctx, ret == 0);
+
+    return ret;
+}
+
+int mbedtls_gcm_update(mbedtls_gcm_context *ctx,
+                       const unsigned char *input, size_t input_length,
+                       unsigned char *output, size_t output_size,
+                       size_t *output_length)
+{
+    int ret;
+
+    if (output_size < input_length)
+        return MBEDTLS_ERR_GCM_BUFFER_TOO_SMALL;
+    *output_length = input_length;
+
+    if (input_length == 0)
+        return 0;
+
+    if (output > input && (size_t) (output - input) < input_length)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    /* Total length is restricted to 2^39 - 256 bits, ie 2^36 - 2^5 bytes
+     * Also check for possible overflow */
+    if (ctx->len + input_length < ctx->len ||
+        (uint64_t) ctx->len + input_length > 0xFFFFFFFE0ull)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    gcm_resume(ctx);
+    ret = gcm_update(ctx, input, input_length, output, 1);
+    /* After a peek the state has been saved already */
+    gcm_suspend(ctx, ret == 0 && ctx->buf_len == 0);
+
+    return ret;
+}
+
+int mbedtls_gcm_finish(mbedtls_gcm_context *ctx,
+                       unsigned char *output, size_t output_size,
+                       size_t *output_length,
+                       unsigned char *tag, size_t tag_len)
+{
+    int ret;
+
+    /* All the output has been given by mbedtls_gcm_update() */
+    (void) output;
+    (void) output_size;
+    *output_length = 0;
+
+    if (tag_len > 16 || tag_len < 4)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    gcm_resume(ctx);
+    ret = gcm_finish(ctx, NULL, tag, tag_len);
+    gcm_suspend(ctx, 0);
+
+    return ret;
+}
+
+int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context *ctx,
+                              int mode,
+                              size_t length,
+                              const unsigned char *iv,
+                              size_t iv_len,
+                              const unsigned char *add,
+                              size_t add_len,
+                              const unsigned char *input,
+                              unsigned char *output,
+                              size_t tag_len,
+                              unsigned char *tag)
+{
+    int ret;
+
+    if (tag_len > 16 || tag_len < 4)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    if (((uint64_t) add_len) >> 61 != 0 || (uint64_t) length > 0xFFFFFFFE0ull)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    if (length != 0 && output > input && (size_t) (output - input) < length)
+        return MBEDTLS_ERR_GCM_BAD_INPUT;
+
+    /* One shot: the CAU state does not need to be saved between the steps */
+    gcm_lock(ctx);
+    if ((ret = gcm_starts(ctx, mode, iv, iv_len)) != 0) {
+        gcm_unlock(ctx);
+        return ret;
+    }
+
+    if (add_len != 0 && (ret = gcm_update_ad(ctx, add, add_len)) != 0)
+        goto exit;
+
+    if (length != 0 && (ret = gcm_update(ctx, input, length, output, 0)) != 0)
+        goto exit;
+
+    ret = gcm_finish(ctx, (length != 0) ? output + length - ctx->buf_len : NULL, tag, tag_len);
+
+exit:
+#if !defined(CONFIG_CAU_SOFT_REF)
+    if (ret != 0 && ctx->hw)
+        cau_alt_stop();
+#endif
+    gcm_unlock(ctx);
+    return ret;
+}
+
+int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context *ctx,
+                             size_t length,
+                             const unsigned char *iv,
+                             size_t iv_len,
+                             const unsigned char *add,
+                             size_t add_len,
+                             const unsigned char *tag,
+                             size_t tag_len,
+                             const unsigned char *input,
+                             unsigned char *output)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char check_tag[16];
+    int diff;
+
+    if ((ret = mbedtls_gcm_crypt_and_tag(ctx, MBEDTLS_GCM_DECRYPT, length,
+                                         iv, iv_len, add, add_len,
+                                         input, output, tag_len, check_tag)) != 0)
+        return ret;
+
+    /* Check tag in "constant-time" */
+    diff = mbedtls_ct_memcmp(tag, check_tag, tag_len);
+
+    if (diff != 0) {
+        mbedtls_platform_zeroize(output, length);
+        return MBEDTLS_ERR_GCM_AUTH_FAILED;
+    }
+
+    return 0;
+}
+
+void mbedtls_gcm_free(mbedtls_gcm_context *ctx)
+{
+    if (ctx == NULL)
+        return;
+
+#if defined(MBEDTLS_BLOCK_CIPHER_C)
+    mbedtls_block_cipher_free(&ctx->block_cipher_ctx);
+#else
+    mbedtls_cipher_free(&ctx->cipher_ctx);
+#endif
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_gcm_context));
+}
+
+#endif /* MBEDTLS_GCM_ALT */
+#endif /* MBEDTLS_GCM_C */
@@ -966,6 +966,24 @@ cleanup:
 }
 #endif /* MBEDTLS_FS_IO */
 
+/* GD modified */
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_HMAC_ALT)
+/* HMAC-SHA-256 runs on the hash accelerator, which keeps the key itself */
+static int md_hmac_sha256_alt(const mbedtls_md_context_t *ctx)
+{
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
+        return 0;
+    }
+#endif
+    return ctx->md_info->type == MBEDTLS_MD_SHA256;
+}
+
+#define MD_HMAC_ALT_RET(status) \
+    (((status) == SUCCESS) ? 0 : MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+#endif /* MBEDTLS_SHA256_C && MBEDTLS_SHA256_HMAC_ALT */
+/* GD modified end */
+
 int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
@@ -976,6 +994,14 @@ int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key,
         return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
     }
 
+/* GD modified */
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_HMAC_ALT)
+    if (md_hmac_sha256_alt(ctx)) {
+        return MD_HMAC_ALT_RET(hau_sha256_hmac_start(ctx->md_ctx, key, keylen));
+    }
+#endif
+/* GD modified end */
+
     if (keylen > (size_t) ctx->md_info->block_size) {
         if ((ret = mbedtls_md_starts(ctx)) != 0) {
             goto cleanup;
@@ -1033,6 +1059,14 @@ int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output)
         return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
     }
 
+/* GD modified */
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_HMAC_ALT)
+    if (md_hmac_sha256_alt(ctx)) {
+        return MD_HMAC_ALT_RET(hau_sha256_hmac_finish(ctx->md_ctx, output));
+    }
+#endif
+/* GD modified end */
+
     opad = (unsigned char *) ctx->hmac_ctx + ctx->md_info->block_size;
 
     if ((ret = mbedtls_md_finish(ctx, tmp)) != 0) {
@@ -1061,6 +1095,14 @@ int mbedtls_md_hmac_reset(mbedtls_md_context_t *ctx)
         return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
     }
 
+/* GD modified */
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_HMAC_ALT)
+    if (md_hmac_sha256_alt(ctx)) {
+        return MD_HMAC_ALT_RET(hau_sha256_hmac_reset(ctx->md_ctx));
+    }
+#endif
+/* GD modified end */
+
     ipad = (unsigned char *) ctx->hmac_ctx;
 
     if ((ret = mbedtls_md_starts(ctx)) != 0) {
@@ -51,9 +51,10 @@ OF SUCH DAMAGE.
 #include "mbedtls/sha256.h"
 
 #if defined(MBEDTLS_SHA256_ALT)
-static ErrStatus hau_hash_cal(int is256,uint8_t *input, uint32_t in_length);
-static ErrStatus hau_hash_cal_end(int is256, uint8_t *input, uint32_t in_length, uint8_t *output);
-static void hau_digest_get(uint32_t algo, uint8_t *output);
+
+#include "wrapper_os.h"
+
+static os_mutex_t hau_mutex;
 
 /* Implementation that should never be optimized out by the compiler */
 static void mbedtls_zeroize(void *v, size_t n)
@@ -63,259 +64,338 @@ static void mbedtls_zeroize(void *v, size_t n)
         *p++ = 0;
 }
 
-void hau_sha256_context_init(mbedtls_sha256_context *ctx)
+/* Wait until the HAU has processed all the words written to the IN FIFO */
+static ErrStatus hau_wait_idle(void)
 {
-    uint32_t i;
+    __IO uint32_t counter = 0U;
+    uint32_t busystatus = 0U;
 
-    ctx->buf_len = 0;
-    ctx->is256   = 0;
+    do {
+        busystatus = hau_flag_get(HAU_FLAG_BUSY);
+        counter++;
+    } while((SHAMD5_BSY_TIMEOUT != counter) && (RESET != busystatus));
+
+    return (RESET != busystatus) ? ERROR : SUCCESS;
+}
 
-    for (i = 0; i < SHA256_BLOCK_SIZE; i++) {
-        ctx->buf[i] = 0;
+/* Write length bytes to the IN FIFO with the CPU, the last word may be partial */
+static void hau_fifo_write(const uint8_t *input, uint32_t length)
+{
+    uint32_t word;
+
+    while (length > 0U) {
+        word = 0U;
+        memcpy(&word, input, (length < 4U) ? length : 4U);
+        hau_data_write(word);
+        input += 4U;
+        length = (length < 4U) ? 0U : (length - 4U);
     }
+}
+
+/* Write length bytes (a multiple of 4) to the IN FIFO with the DMA */
+static ErrStatus hau_dma_write(const uint8_t *input, uint32_t length)
+{
+    dma_multi_data_parameter_struct dma_init_parameter;
+    ErrStatus ret = SUCCESS;
+
+    rcu_periph_clock_enable(RCU_DMA);
+
+    dma_deinit(SHA256_DMA_CH);
+    dma_multi_data_para_struct_init(&dma_init_parameter);
+    dma_init_parameter.periph_addr = (uint32_t)(&HAU_DI);
+    dma_init_parameter.periph_width = DMA_PERIPH_WIDTH_32BIT;
+    dma_init_parameter.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+    dma_init_parameter.memory0_addr = (uint32_t)input;
+    dma_init_parameter.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+    if (((uint32_t)input & 3U) == 0U) {
+        dma_init_parameter.memory_width = DMA_MEMORY_WIDTH_32BIT;
+        dma_init_parameter.memory_burst_width = DMA_MEMORY_BURST_4_BEAT;
+    } else {
+        dma_init_parameter.memory_width = DMA_MEMORY_WIDTH_8BIT;
+        dma_init_parameter.memory_burst_width = DMA_MEMORY_BURST_SINGLE;
+    }
+    dma_init_parameter.periph_burst_width = DMA_PERIPH_BURST_4_BEAT;
+    dma_init_parameter.critical_value = DMA_FIFO_4_WORD;
+    dma_init_parameter.circular_mode = DMA_CIRCULAR_MODE_DISABLE;
+    dma_init_parameter.direction = DMA_MEMORY_TO_PERIPH;
+    dma_init_parameter.number = length >> 2;
+    dma_init_parameter.priority = DMA_PRIORITY_ULTRA_HIGH;
+    dma_multi_data_mode_init(SHA256_DMA_CH, &dma_init_parameter);
+    dma_channel_subperipheral_select(SHA256_DMA_CH, SHA256_DMA_SUBPERI);
+    dma_flow_controller_config(SHA256_DMA_CH, DMA_FLOW_CONTROLLER_DMA);
+
+    /* the digest is computed by hau_sha256_finish(), not at the end of the transfer */
+    hau_multiple_single_dma_config(MULTIPLE_DMA_NO_DIGEST);
+    dma_channel_enable(SHA256_DMA_CH);
+    hau_dma_enable();
+
+    while (RESET == dma_flag_get(SHA256_DMA_CH, DMA_FLAG_FTF)) {
+        if (RESET != dma_flag_get(SHA256_DMA_CH, DMA_FLAG_TAE)) {
+            ret = ERROR;
+            break;
+        }
+    }
+
+    hau_dma_disable();
+    dma_channel_disable(SHA256_DMA_CH);
+    dma_flag_clear(SHA256_DMA_CH, DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_TAE | DMA_FLAG_FEE);
+
+    return ret;
+}
+
+/*
+ * The DMA channel of the HAU is also mapped to the USART0 TX request (and
+ * to the trace output on some builds), the HAU only borrows it when it is
+ * not running.
+ */
+static int hau_dma_free(void)
+{
+    return (DMA_CHCTL(SHA256_DMA_CH) & DMA_CHXCTL_CHEN) == 0;
+}
+
+/* Feed whole blocks to the HAU, through the DMA when it is worth it */
+static ErrStatus hau_blocks_write(const uint8_t *input, uint32_t length)
+{
+    if (length >= SHA256_DMA_THRESHOLD && SHA256_DMA_ADDR_VALID(input) && hau_dma_free())
+        return hau_dma_write(input, length);
+
+    hau_fifo_write(input, length);
+    return SUCCESS;
+}
+
+/* Let the HAU go: wait for the last block and save the context */
+static ErrStatus hau_sha256_suspend(mbedtls_sha256_context *ctx)
+{
+    ErrStatus ret = hau_wait_idle();
+
+    hau_context_save(&(ctx->context_para));
+    return ret;
+}
+
+/* Write the HMAC key and start its processing */
+static ErrStatus hau_sha256_key_write(mbedtls_sha256_context *ctx)
+{
+    hau_last_word_validbits_num_config(8U * (ctx->key_len % 4U));
+    hau_fifo_write(ctx->key, ctx->key_len);
+    hau_digest_calculation_enable();
+
+    return hau_wait_idle();
+}
+
+void hau_sha256_lock_init(void)
+{
+    if (hau_mutex == NULL)
+        sys_mutex_init(&hau_mutex);
+}
+
+void hau_sha256_lock(void)
+{
+    if (hau_mutex != NULL)
+        sys_mutex_get(&hau_mutex);
+    sys_sched_lock();
+}
+
+void hau_sha256_unlock(void)
+{
+    sys_sched_unlock();
+    if (hau_mutex != NULL)
+        sys_mutex_put(&hau_mutex);
+}
+
+void hau_sha256_context_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(mbedtls_sha256_context));
     /*initialize the struct context*/
     hau_context_struct_para_init(&(ctx->context_para));
 }
 
-void hau_sha256_start(mbedtls_sha256_context *ctx, int is256)
+/* Reset the HAU in the mode of ctx and save the initial context, HAU_LOCK() is held */
+static ErrStatus hau_sha256_begin(mbedtls_sha256_context *ctx)
 {
     hau_init_parameter_struct init_para;
+    ErrStatus ret = SUCCESS;
 
     /* HAU peripheral initialization */
     hau_deinit();
-    /* init mbedtls_sha256_context struct */
-    hau_sha256_context_init(ctx);
 
     /* HAU configuration */
-    if (is256) {
+    if (ctx->is256) {
         init_para.algo = HAU_ALGO_SHA256;
     } else {
         init_para.algo = HAU_ALGO_SHA224;
     }
-    init_para.mode = HAU_MODE_HASH;
+    init_para.mode = ctx->hmac ? HAU_MODE_HMAC : HAU_MODE_HASH;
     init_para.datatype = HAU_SWAPPING_8BIT;
+    init_para.keytype = HAU_KEY_SHORTER_64;
     hau_init(&init_para);
 
-    ctx->is256 = is256;
+    /* the inner hash starts with the key */
+    if (ctx->hmac)
+        ret = hau_sha256_key_write(ctx);
 
     /* save HAU context */
     hau_context_save(&(ctx->context_para));
+
+    return ret;
+}
+
+void hau_sha256_start(mbedtls_sha256_context *ctx, int is256)
+{
+    /* init mbedtls_sha256_context struct */
+    hau_sha256_context_init(ctx);
+    ctx->is256 = is256;
+
+    HAU_LOCK();
+    hau_sha256_begin(ctx);
+    HAU_UNLOCK();
 }
 
-ErrStatus hau_sha256_update(mbedtls_sha256_context *ctx, uint8_t *input, uint32_t in_length)
+ErrStatus hau_sha256_update(mbedtls_sha256_context *ctx, const uint8_t *input, uint32_t in_length)
 {
-    uint32_t current_len = in_length;
-    uint32_t times = 0;
+    uint32_t fill, run;
+    ErrStatus ret = SUCCESS;
 
-    if (current_len < (SHA256_BLOCK_SIZE - ctx->buf_len)) {
+    if (in_length < (SHA256_BLOCK_SIZE - ctx->buf_len)) {
         /* only store input data in context buffer */
-        memcpy(ctx->buf + ctx->buf_len, input, current_len);
-        ctx->buf_len += current_len;
-    } else {
-        /* restore HAU context */
-        hau_context_restore(&(ctx->context_para));
+        memcpy(ctx->buf + ctx->buf_len, input, in_length);
+        ctx->buf_len += in_length;
+        return SUCCESS;
+    }
 
-        /* fill context buffer until 64 bytes, and process it */
-        memcpy(ctx->buf + ctx->buf_len, input, (SHA256_BLOCK_SIZE - ctx->buf_len));
-        current_len -= (SHA256_BLOCK_SIZE - ctx->buf_len);
-        if (SUCCESS != hau_hash_cal(ctx->is256, (uint8_t *)(ctx->buf), SHA256_BLOCK_SIZE)) {
-            return ERROR;
-        }
+    /* fill context buffer until 64 bytes */
+    fill = SHA256_BLOCK_SIZE - ctx->buf_len;
+    memcpy(ctx->buf + ctx->buf_len, input, fill);
+    input += fill;
+    in_length -= fill;
 
-        /* Process input data with size multiple of 64 bytes */
-        times = current_len / SHA256_BLOCK_SIZE;
-        if (times != 0) {
-            if (SUCCESS != hau_hash_cal(ctx->is256, (uint8_t *)(input + SHA256_BLOCK_SIZE - ctx->buf_len), (times * SHA256_BLOCK_SIZE))) {
+    HAU_LOCK();
+    /* restore HAU context */
+    hau_context_restore(&(ctx->context_para));
+    hau_fifo_write(ctx->buf, SHA256_BLOCK_SIZE);
+
+    /* Process input data with size multiple of 64 bytes, in bounded runs */
+    while (in_length >= SHA256_BLOCK_SIZE) {
+        run = in_length - (in_length % SHA256_BLOCK_SIZE);
+        if (run > SHA256_RUN_MAX)
+            run = SHA256_RUN_MAX;
+
+        ret = hau_blocks_write(input, run);
+        if (ret != SUCCESS)
+            break;
+        input += run;
+        in_length -= run;
+
+        if (in_length >= SHA256_BLOCK_SIZE) {
+            /* give the HAU and the other tasks a chance between two runs */
+            ret = hau_sha256_suspend(ctx);
+            HAU_UNLOCK();
+            if (ret != SUCCESS)
                 return ERROR;
-            }
-        }
-        /* save HAU context */
-        hau_context_save(&(ctx->context_para));
-
-        /*Store remaining input data to ctx->buf*/
-        ctx->buf_len = current_len % SHA256_BLOCK_SIZE;
-        if (ctx->buf_len != 0) {
-            memcpy(ctx->buf, input + in_length - ctx->buf_len, ctx->buf_len);
+            HAU_LOCK();
+            hau_context_restore(&(ctx->context_para));
         }
     }
 
-    return SUCCESS;
+    /* save HAU context */
+    if (ret == SUCCESS)
+        ret = hau_sha256_suspend(ctx);
+    HAU_UNLOCK();
+
+    /*Store remaining input data to ctx->buf*/
+    ctx->buf_len = in_length % SHA256_BLOCK_SIZE;
+    if (ctx->buf_len != 0)
+        memcpy(ctx->buf, input + in_length - ctx->buf_len, ctx->buf_len);
+
+    return ret;
 }
 
 ErrStatus hau_sha256_finish(mbedtls_sha256_context *ctx, uint8_t output[32])
 {
+    uint32_t digest[8];
+    ErrStatus ret;
+
+    HAU_LOCK();
     /* restore HAU context */
     hau_context_restore(&(ctx->context_para));
 
-    /*Last accumulation for bytes in buf_len,then trig processing and get digest*/
-    if (SUCCESS != hau_hash_cal_end(ctx->is256, ctx->buf, ctx->buf_len, output))
-        return ERROR;
+    /*Last accumulation for bytes in buf_len,then trig processing*/
+    hau_last_word_validbits_num_config(8U * (ctx->buf_len % 4U));
+    hau_fifo_write(ctx->buf, ctx->buf_len);
+    hau_digest_calculation_enable();
+    ret = hau_wait_idle();
+
+    /* the outer hash runs on the key again */
+    if (ret == SUCCESS && ctx->hmac)
+        ret = hau_sha256_key_write(ctx);
+
+    /* read the message digest */
+    if (ret == SUCCESS)
+        hau_sha_md5_digest_read(ctx->is256 ? HAU_ALGO_SHA256 : HAU_ALGO_SHA224, (uint8_t *)digest);
+    HAU_UNLOCK();
 
+    if (ret == SUCCESS)
+        memcpy(output, digest, ctx->is256 ? 32 : 28);
+    mbedtls_zeroize(digest, sizeof(digest));
     ctx->buf_len = 0;
 
-    return SUCCESS;
+    return ret;
 }
 
-static ErrStatus hau_hash_cal(int is256,uint8_t *input, uint32_t in_length)
+ErrStatus hau_sha256_hmac_start(mbedtls_sha256_context *ctx, const uint8_t *key, uint32_t keylen)
 {
-    uint32_t i = 0U;
-    uint32_t inputaddr  = (uint32_t)input;
-
-    if ((in_length == 0) || (input == NULL) ||(in_length % 4U != 0))
-        return ERROR;
-
-    /*config hau algorithm*/
-    if (is256)
-        HAU_CTL |= HAU_ALGO_SHA256;
-    else
-        HAU_CTL |= HAU_ALGO_SHA224;
+    hau_sha256_context_init(ctx);
 
-    /* write data to the IN FIFO */
-    for (i = 0U; i < in_length; i += 4U) {
-        hau_data_write(*(uint32_t*)inputaddr);
-        inputaddr += 4U;
+    /* keys longer than a block are replaced by their hash */
+    if (keylen > SHA256_BLOCK_SIZE) {
+        hau_sha256_start(ctx, 1);
+        if (SUCCESS != hau_sha256_update(ctx, key, keylen) ||
+            SUCCESS != hau_sha256_finish(ctx, ctx->key))
+            return ERROR;
+        keylen = 32;
+    } else {
+        memcpy(ctx->key, key, keylen);
     }
+    ctx->key_len = keylen;
 
-    return SUCCESS;
+    return hau_sha256_hmac_reset(ctx);
 }
 
-static ErrStatus hau_hash_cal_end(int is256, uint8_t *input, uint32_t in_length, uint8_t *output)
+ErrStatus hau_sha256_hmac_reset(mbedtls_sha256_context *ctx)
 {
-    __IO uint32_t num_last_valid = 0U;
-    uint32_t i = 0U;
-    uint32_t inputaddr  = (uint32_t)input;
-    __IO uint32_t counter = 0U;
-    uint32_t busystatus = 0U;
-    uint32_t algo;
-
-    if ((input == NULL) || (output == NULL))
-        return ERROR;
-
-    if (is256)
-        algo = HAU_ALGO_SHA256;
-    else
-        algo = HAU_ALGO_SHA224;
-
-    /*config hau algorithm*/
-    HAU_CTL |= algo;
-
-    /* number of valid bits in last word */
-    num_last_valid = 8U * (in_length % 4U);
-    /* configure the number of valid bits in last word of the message */
-    hau_last_word_validbits_num_config(num_last_valid);
+    ErrStatus ret;
 
-    /* write data to the IN FIFO */
-    for (i = 0U; i < in_length; i += 4U) {
-        hau_data_write(*(uint32_t*)inputaddr);
-        inputaddr += 4U;
-    }
-
-    /* enable digest calculation */
-    hau_digest_calculation_enable();
-
-    /* wait until the busy flag is reset */
-    do {
-        busystatus = hau_flag_get(HAU_FLAG_BUSY);
-        counter++;
-    } while((SHAMD5_BSY_TIMEOUT != counter) && (RESET != busystatus));
+    ctx->is256 = 1;
+    ctx->hmac = 1;
+    ctx->buf_len = 0;
 
-    if (RESET != busystatus)
-        return ERROR;
+    HAU_LOCK();
+    ret = hau_sha256_begin(ctx);
+    HAU_UNLOCK();
 
-    /* read the message digest */
-    hau_digest_get(algo, output);
-    return SUCCESS;
+    return ret;
 }
 
-/*!
-    \brief      HAU SHA/MD5 digest read
-    \param[in]  algo: algorithm selection
-    \param[out] output: the result digest
-    \retval     none
-*/
-static void hau_digest_get(uint32_t algo, uint8_t *output)
+ErrStatus hau_sha256_hmac_finish(mbedtls_sha256_context *ctx, uint8_t output[32])
 {
-    hau_digest_parameter_struct digest_para;
-    uint32_t outputaddr = (uint32_t)output;
-
-    switch(algo) {
-    case HAU_ALGO_SHA1:
-        hau_digest_read(&digest_para);
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[0]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[1]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[2]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[3]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[4]);
-        break;
-    case HAU_ALGO_SHA224:
-        hau_digest_read(&digest_para);
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[0]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[1]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[2]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[3]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[4]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[5]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[6]);
-        break;
-    case HAU_ALGO_SHA256:
-        hau_digest_read(&digest_para);
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[0]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[1]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[2]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[3]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[4]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[5]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[6]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[7]);
-        break;
-    case HAU_ALGO_MD5:
-        hau_digest_read(&digest_para);
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[0]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[1]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[2]);
-        outputaddr += 4U;
-        *(uint32_t*)(outputaddr)  = __REV(digest_para.out[3]);
-        break;
-    default:
-        break;
-    }
+    if (!ctx->hmac)
+        return ERROR;
+
+    return hau_sha256_finish(ctx, output);
 }
 
 int mbedtls_internal_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[SHA256_BLOCK_SIZE] )
 {
-    int ret = SUCCESS;
+    ErrStatus ret;
 
-    //GLOBAL_INT_DISABLE();
+    HAU_LOCK();
     /* restore HAU context */
     hau_context_restore(&(ctx->context_para));
-    if (SUCCESS != hau_hash_cal(ctx->is256, (uint8_t *)(data), SHA256_BLOCK_SIZE)) {
-        ret = ERROR;
-        goto Exit;
-    }
+    hau_fifo_write(data, SHA256_BLOCK_SIZE);
     /* save HAU context */
-    hau_context_save(&(ctx->context_para));
-Exit:
-    //GLOBAL_INT_RESTORE();
-    return ret;
+    ret = hau_sha256_suspend(ctx);
+    HAU_UNLOCK();
+
+    return (ret == ERROR) ? 1 : 0;
 }
 
 void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
@@ -347,9 +427,7 @@ int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
     if (!is224)
         is256 = 1;
 
-    // GLOBAL_INT_DISABLE();
     hau_sha256_start(ctx, is256);
-    // GLOBAL_INT_RESTORE();
 
     return 0;
 }
@@ -372,10 +450,8 @@ int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx,
 {
     ErrStatus ret = ERROR;
 
-    // GLOBAL_INT_DISABLE();
-    ret = hau_sha256_update(ctx, (uint8_t *)input, ilen);
+    ret = hau_sha256_update(ctx, input, ilen);
     return (ret == ERROR) ? 1 : 0;
-    // GLOBAL_INT_RESTORE();
 }
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
@@ -383,7 +459,7 @@ int mbedtls_sha256_update(mbedtls_sha256_context *ctx,
                             const unsigned char *input,
                             size_t ilen)
 {
-    return mbedtls_sha256_update_ret(ctx, (uint8_t *)input, ilen);
+    return mbedtls_sha256_update_ret(ctx, input, ilen);
 }
 #endif
 
@@ -395,12 +471,8 @@ int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx,
 {
     ErrStatus ret = ERROR;
 
-    // GLOBAL_INT_DISABLE();
     ret = hau_sha256_finish(ctx, (uint8_t *)output);
     return (ret == ERROR) ? 1 : 0;
-    // GLOBAL_INT_RESTORE();
-
-//    return(0);
 }
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
@@ -58,6 +58,10 @@ OF SUCH DAMAGE.
 #include "ble_uart.h"
 #endif
 
+#ifdef USE_QSPI_FLASH
+#include "qspi_flash_api.h"
+#endif
+
 #ifdef TUYAOS_SUPPORT
 #include "tkl_i2c.h"
 #include "tkl_pwm.h"
@@ -134,6 +138,34 @@ void DMA_Channel3_IRQHandler(void)
 }
 #endif
 
+#ifdef USE_QSPI_FLASH
+/*!
+    \brief      this function handles QSPI exception
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void QSPI_IRQHandler(void)
+{
+    sys_int_enter();
+    qspi_flash_irq_hdl();
+    sys_int_exit();
+}
+
+/*!
+    \brief      this function handles DMA channel4 exception, reads of the QSPI flash
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void DMA_Channel4_IRQHandler(void)
+{
+    sys_int_enter();
+    qspi_flash_dma_irq_hdl();
+    sys_int_exit();
+}
+#endif
+
 #ifdef TRACE_UART_DMA
 #ifdef CONFIG_PLATFORM_ASIC
 #ifdef CFG_BLE_HCI_MODE
@@ -204,10 +236,26 @@ __attribute__((weak)) void DMA_Channel0_IRQHandler(void)
     sys_int_exit();                             /* Tell the OS that we are leaving the ISR            */
 }
 
+/*!
+    \brief      DMA channel 5 handler of the CAU, overridden by the mbedtls CAU driver
+    \param[in]  none
+    \param[out] none
+    \retval     1 if the interrupt was for the CAU, 0 otherwise
+*/
+__attribute__((weak)) int cau_alt_dma_irq_hdl(void)
+{
+    return 0;
+}
+
 __attribute__((weak)) void DMA_Channel5_IRQHandler(void)
 {
     sys_int_enter();                            /* Tell the OS that we are starting an ISR            */
 
+    if (cau_alt_dma_irq_hdl()) {
+        sys_int_exit();
+        return;
+    }
+
     DEBUG_ASSERT(AT_UART != LOG_UART);
 
 #if defined CONFIG_ATCMD
@@ -68,6 +68,7 @@ void BLE_ERROR_IRQHandler(void);
 void BLE_FIFO_ACTIVITY_IRQHandler(void);
 
 void DMA_Channel1_IRQHandler(void);
+int cau_alt_dma_irq_hdl(void);
 void RTC_WKUP_IRQHandler(void);
 void EXTI5_9_IRQHandler(void);
 
@@ -37,6 +37,8 @@ OF SUCH DAMAGE.
 
 #include "mbedtls/platform_time.h"
 #include "mbedtls/platform.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
 #include "trng.h"
 
 #include "mbedtls/version.h"
@@ -78,6 +80,14 @@ static void mebdtls_platform_init(void)
     /* Others */
     mbedtls_ecp_curve_val_init();
 #endif
+
+    /* Mutexes of the crypto accelerators, created before any task uses them */
+#if defined(CAU_LOCK)
+    cau_alt_lock_init();
+#endif
+#if defined(HAU_LOCK)
+    hau_sha256_lock_init();
+#endif
 }
 
 /*!
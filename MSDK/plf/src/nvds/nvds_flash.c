@@ -309,7 +309,6 @@ static int entry_state_set(uint32_t *states, uint8_t idx, enum entry_state state
     return NVDS_ERR(NVDS_OK);
 }
 
-#if 0
 static int entry_state_range_set(uint32_t *states, uint8_t start, uint8_t end, enum entry_state state)
 {
     uint8_t idx;
@@ -328,7 +327,6 @@ static int entry_state_range_set(uint32_t *states, uint8_t start, uint8_t end, e
 
     return NVDS_ERR(NVDS_OK);
 }
-#endif
 
 static int entry_state_alter(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
                                 uint8_t entry_idx, enum entry_state state)
@@ -355,16 +353,17 @@ static int entry_state_alter(struct nvds_flash_env_tag *flash_env, struct page_e
 static int entry_state_range_alter(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
                                 uint8_t begin, uint8_t end, enum entry_state state)
 {
-    uint8_t idx;
     int ret;
 
-    if ((end < begin) || (end >= ENTRY_COUNT_PER_PAGE))
+    if (!flash_env || !page)
         return NVDS_ERR(NVDS_E_FAIL);
 
-    for (idx = begin; idx <= end; ++idx) {
-        ret = entry_state_alter(flash_env, page, idx, state);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
-    }
+    ret = entry_state_range_set(page->entry_states, begin, end, state);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    /* whole range is changed by one flash program */
+    ret = entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
 
     return NVDS_ERR(NVDS_OK);
 }
@@ -415,6 +414,18 @@ static int page_state_alter(struct nvds_flash_env_tag *flash_env, struct page_en
     return NVDS_ERR(NVDS_OK);
 }
 
+/**
+ ****************************************************************************************
+ * @brief Check if elements in page are valid, candidate page keeps its elements until
+ *        they are moved by garbage collection
+ ****************************************************************************************
+ */
+static bool page_elements_valid(struct page_env_tag *page)
+{
+    return ((page->header.state == PAGE_ACTIVE) || (page->header.state == PAGE_FULL)
+            || (page->header.state == PAGE_CANDIDATE));
+}
+
 /**
  ****************************************************************************************
  * @brief Read / Write entry (32bytes)
@@ -477,6 +488,24 @@ static int entry_read(struct nvds_flash_env_tag *flash_env, struct page_env_tag
     return NVDS_ERR(NVDS_OK);
 }
 
+static bool entry_blank_check(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
+                                uint8_t entry_idx)
+{
+    uint32_t raw[ENTRY_SIZE / sizeof(uint32_t)];
+    uint32_t i;
+
+    if (nvds_flash_read(flash_env, page->base_addr + PAGE_ENTRY_OFFSET + entry_idx * ENTRY_SIZE,
+                        ENTRY_SIZE, (uint8_t *)raw))
+        return false;
+
+    for (i = 0; i < ENTRY_SIZE / sizeof(uint32_t); i++) {
+        if (raw[i] != 0xFFFFFFFF)
+            return false;
+    }
+
+    return true;
+}
+
 static int entry_write(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page,
                             union entry_info* entry)
 {
@@ -626,6 +655,275 @@ static int page_print(struct nvds_flash_env_tag *flash_env, struct page_env_tag
 }
 #endif
 
+/**
+ ****************************************************************************************
+ * @brief Element index, (namespace, key) hash to element header entry location
+ ****************************************************************************************
+ */
+static uint32_t index_hash_calc(uint8_t ns_idx, const char *key)
+{
+    /* FNV-1a */
+    uint32_t hash = 0x811C9DC5;
+    int i;
+
+    hash = (hash ^ ns_idx) * 0x01000193;
+    for (i = 0; (i < KEY_NAME_MAX_SIZE) && key[i]; i++)
+        hash = (hash ^ (uint8_t)key[i]) * 0x01000193;
+
+    return hash;
+}
+
+static void index_deinit(struct nvds_flash_env_tag *flash_env)
+{
+    if (flash_env->index) {
+        sys_mfree(flash_env->index);
+        flash_env->index = NULL;
+    }
+    flash_env->index_cnt = 0;
+    flash_env->index_msk = 0;
+}
+
+static void index_init(struct nvds_flash_env_tag *flash_env)
+{
+    index_deinit(flash_env);
+    flash_env->index_lost = false;
+#if NVDS_INDEX_SLOT_NUM
+    /* lookup falls back to flash scan if no memory for index */
+    flash_env->index = sys_zalloc(NVDS_INDEX_SLOT_NUM * sizeof(struct nvds_index_slot));
+    if (flash_env->index)
+        flash_env->index_msk = NVDS_INDEX_SLOT_NUM - 1;
+#endif
+}
+
+static void index_slot_insert(struct nvds_index_slot *index, uint32_t msk, struct nvds_index_slot *slot)
+{
+    uint32_t pos = slot->hash & msk;
+
+    while (index[pos].page)
+        pos = (pos + 1) & msk;
+    index[pos] = *slot;
+}
+
+/**
+ ****************************************************************************************
+ * @brief Double the index slots, an index which can not grow is dropped and rebuilt after
+ *        the next page compaction
+ ****************************************************************************************
+ */
+static bool index_grow(struct nvds_flash_env_tag *flash_env)
+{
+    struct nvds_index_slot *index;
+    uint32_t msk = (flash_env->index_msk << 1) | 1;
+    uint32_t pos;
+
+    /* the slots keep 16 bits of the hash, enough to rehash up to 65536 slots */
+    index = (msk <= 0xFFFF) ? sys_zalloc((msk + 1) * sizeof(struct nvds_index_slot)) : NULL;
+    if (!index) {
+        dbg_print(WARNING, "nvds %s: index full, fall back to flash scan\r\n", flash_env->label);
+        index_deinit(flash_env);
+        flash_env->index_lost = true;
+        return false;
+    }
+
+    for (pos = 0; pos <= flash_env->index_msk; pos++) {
+        if (flash_env->index[pos].page)
+            index_slot_insert(index, msk, &flash_env->index[pos]);
+    }
+    sys_mfree(flash_env->index);
+    flash_env->index = index;
+    flash_env->index_msk = msk;
+
+    return true;
+}
+
+static void index_add(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char *key,
+                        struct page_env_tag *page, uint8_t entry_idx)
+{
+    struct nvds_index_slot slot;
+    uint32_t hash;
+
+    if (!flash_env->index)
+        return;
+
+    /* keep the load factor under 3/4 so that probe chains stay short */
+    if (((uint32_t)flash_env->index_cnt + 1) * 4 > (flash_env->index_msk + 1) * 3) {
+        if (!index_grow(flash_env))
+            return;
+    }
+
+    hash = index_hash_calc(ns_idx, key);
+    slot.page = page;
+    slot.hash = (uint16_t)hash;
+    slot.ns = ns_idx;
+    slot.entry_idx = entry_idx;
+    index_slot_insert(flash_env->index, flash_env->index_msk, &slot);
+    flash_env->index_cnt++;
+}
+
+static void index_slot_remove(struct nvds_flash_env_tag *flash_env, uint32_t hole)
+{
+    struct nvds_index_slot *index = flash_env->index;
+    uint32_t msk = flash_env->index_msk;
+    uint32_t pos, home;
+
+    /* shift following slots of the probe chain back, so no tombstone is needed */
+    pos = hole;
+    while (1) {
+        pos = (pos + 1) & msk;
+        if (!index[pos].page)
+            break;
+
+        /* slot can not move before its home position */
+        home = index[pos].hash & msk;
+        if ((hole <= pos) ? ((hole < home) && (home <= pos)) : ((hole < home) || (home <= pos)))
+            continue;
+
+        index[hole] = index[pos];
+        hole = pos;
+    }
+
+    sys_memset(&index[hole], 0, sizeof(struct nvds_index_slot));
+    flash_env->index_cnt--;
+}
+
+static void index_del(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char *key,
+                        struct page_env_tag *page, uint8_t entry_idx)
+{
+    struct nvds_index_slot *index = flash_env->index;
+    uint32_t hole;
+
+    if (!index)
+        return;
+
+    hole = index_hash_calc(ns_idx, key) & flash_env->index_msk;
+    while (index[hole].page) {
+        if ((index[hole].page == page) && (index[hole].entry_idx == entry_idx))
+            break;
+        hole = (hole + 1) & flash_env->index_msk;
+    }
+
+    if (index[hole].page)
+        index_slot_remove(flash_env, hole);
+}
+
+static void index_page_move(struct nvds_flash_env_tag *flash_env, struct page_env_tag *from,
+                            struct page_env_tag *to, uint8_t *entry_map)
+{
+    struct nvds_index_slot *slot;
+    uint32_t pos;
+
+    if (!flash_env->index)
+        return;
+
+    /* page is copied entry by entry, location changes but hash does not */
+    for (pos = 0; pos <= flash_env->index_msk;) {
+        slot = &flash_env->index[pos];
+        if (slot->page != from) {
+            pos++;
+            continue;
+        }
+
+        /* entry was not copied, the slot is stale, a following slot may shift into it */
+        if ((slot->entry_idx >= ENTRY_COUNT_PER_PAGE) || (entry_map[slot->entry_idx] == ENTRY_MAP_NONE)) {
+            index_slot_remove(flash_env, pos);
+            continue;
+        }
+
+        slot->page = to;
+        slot->entry_idx = entry_map[slot->entry_idx];
+        pos++;
+    }
+}
+
+/**
+ ****************************************************************************************
+ * @brief Index the element headers of the used pages again, after the index was dropped
+ *        for lack of memory and a compaction freed entries
+ ****************************************************************************************
+ */
+static void index_rebuild(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *page;
+    union entry_info entry;
+    enum entry_state state;
+    enum element_type type;
+    uint32_t entry_idx;
+
+    if (!flash_env->index_lost)
+        return;
+
+    index_init(flash_env);
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    for (; page && flash_env->index; page = (struct page_env_tag *)list_next(&page->list_hdr)) {
+        for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE; entry_idx++) {
+            entry_state_get(page->entry_states, entry_idx, &state);
+            if (state == ENTRY_FREE)
+                break;
+            if (state != ENTRY_USED)
+                continue;
+
+            if (entry_read(flash_env, page, entry_idx, &entry)
+                || (entry.crc32 != element_header_crc32_calc(&entry))) {
+                index_deinit(flash_env);
+                flash_env->index_lost = true;
+                return;
+            }
+
+            index_add(flash_env, tag_namespace_get(entry.tag), entry.key, page, entry_idx);
+            /* data entries of the element follow its header */
+            type = tag_element_type_get(entry.tag);
+            if ((ELEMENT_MIDDLE == type) || (ELEMENT_BULK == type))
+                entry_idx += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+        }
+    }
+}
+
+static int index_element_find(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
+                        const char* key, struct page_env_tag **page_find,
+                        uint8_t *entry_find, uint8_t entry_type)
+{
+    struct nvds_index_slot *slot;
+    union entry_info entry;
+    enum entry_state state;
+    enum element_type type;
+    uint32_t hash;
+    uint32_t pos;
+    uint32_t key_len = strlen(key);
+    int ret;
+
+    hash = index_hash_calc(ns_idx, key);
+    for (pos = hash & flash_env->index_msk; flash_env->index[pos].page;
+            pos = (pos + 1) & flash_env->index_msk) {
+        slot = &flash_env->index[pos];
+        if ((slot->hash != (uint16_t)hash) || (slot->ns != ns_idx))
+            continue;
+
+        if (!page_elements_valid(slot->page))
+            continue;
+
+        if ((slot->entry_idx >= ENTRY_COUNT_PER_PAGE)
+            || entry_state_get(slot->page->entry_states, slot->entry_idx, &state)
+            || (state != ENTRY_USED))
+            continue;
+
+        /* only one flash read to confirm the key */
+        ret = entry_read(flash_env, slot->page, slot->entry_idx, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        type = tag_element_type_get(entry.tag);
+        if ((tag_namespace_get(entry.tag) == ns_idx) && key_len == strlen(entry.key) &&
+            !sys_memcmp(key, entry.key, key_len) &&
+            ((entry_type == ELEMENT_ANY) || (type == entry_type)) &&
+            (entry.crc32 == element_header_crc32_calc(&entry))) {
+            *page_find = slot->page;
+            *entry_find = slot->entry_idx;
+            return NVDS_ERR(NVDS_OK);
+        }
+    }
+
+    return NVDS_ERR(NVDS_E_NOT_FOUND);
+}
+
 static int element_find(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
                         const char* key, struct page_env_tag **page_find,
                         uint8_t *entry_find, struct page_env_tag *page_start, uint8_t entry_type)
@@ -648,6 +946,10 @@ static int element_find(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
     if (!flash_env || !key)
         return NVDS_ERR(NVDS_E_FAIL);
 
+    /* bulk fragments are walked in page order, other lookups can use index */
+    if (flash_env->index && !page_start && (entry_start == 0) && (entry_type != ELEMENT_BULK))
+        return index_element_find(flash_env, ns_idx, key, page_find, entry_find, entry_type);
+
     /* from the specified used page start to find */
     if (page_start) {
         page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
@@ -664,7 +966,7 @@ static int element_find(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
         page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
 
     while (page) {
-        if ((page->header.state != PAGE_ACTIVE) && (page->header.state != PAGE_FULL)) {
+        if (!page_elements_valid(page)) {
             page = (struct page_env_tag*)list_next(&page->list_hdr);
             continue;
         }
@@ -756,20 +1058,19 @@ static int bulk_element_del(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
 
     /* find bulkinfo entry by ns and key */
     ret = element_find(flash_env, ns_idx, key, &page, &entry_idx, page_start, ELEMENT_BULKINFO);
-    if (ret == NVDS_ERR(NVDS_E_NOT_FOUND)) {
-        return NVDS_ERR(NVDS_OK);
-    } else if (ret) {
+    if (ret == NVDS_ERR(NVDS_OK)) {
+        /* change bulkinfo entry state to ENTRY_UPDATED */
+        ret = entry_state_range_alter(flash_env, page, entry_idx, entry_idx, ENTRY_UPDATED);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        page->entry_cnt_used--;
+        index_del(flash_env, ns_idx, key, page, entry_idx);
+    } else if (ret != NVDS_ERR(NVDS_E_NOT_FOUND)) {
         return ret;
     }
 
-    /* change bulkinfo entry state to ENTRY_UPDATED */
-    ret = entry_state_range_alter(flash_env, page, entry_idx, entry_idx, ENTRY_UPDATED);
-    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
-    page->entry_cnt_used--;
-
     entry_idx = 0;
     page_start = NULL;
-    /* find all the remain bulk entry */
+    /* find all the remain bulk entry, also the ones without bulkinfo left by power lost */
     do {
         ret = element_find(flash_env, ns_idx, key, &page, &entry_idx, page_start, ELEMENT_BULK);
         if (ret == NVDS_ERR(NVDS_E_NOT_FOUND)) {
@@ -786,6 +1087,7 @@ static int bulk_element_del(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
         ret = entry_state_range_alter(flash_env, page, entry_idx, entry_idx + entry_cnt, ENTRY_UPDATED);
         NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
         page->entry_cnt_used -= (entry_cnt + 1);
+        index_del(flash_env, ns_idx, key, page, entry_idx);
 
         entry_idx += (entry_cnt + 1);
         page_start = page;
@@ -829,6 +1131,7 @@ static int data_element_del(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
     } else {
         return NVDS_ERR(NVDS_E_FAIL);
     }
+    index_del(flash_env, ns_idx, key, page, entry_idx);
 
 #ifdef NVDS_DEBUG
     page_print(flash_env, page);
@@ -1199,16 +1502,24 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
     uint16_t min_cnt_used = ENTRY_COUNT_PER_PAGE;
     union entry_info entry;
     uint8_t entry_idx;
+    uint8_t copy_cnt = 0;
     enum entry_state state;
+    uint8_t entry_map[ENTRY_COUNT_PER_PAGE];
 
     if (list_is_empty(&flash_env->nvds_page_free))
         return NULL;
 
+    /* entries which are not copied keep the marker, their index slots are dropped */
+    sys_memset(entry_map, ENTRY_MAP_NONE, sizeof(entry_map));
+
     if (list_cnt(&flash_env->nvds_page_free) == 1) {
         /* candidate page */
+        /* finish the page background gc is working on first */
+        erase_page = flash_env->gc_page;
+
         /* find max erase entry page */
         p = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
-        while (p) {
+        while (p && !erase_page) {
             if (p->entry_cnt_used < min_cnt_used) {
                 min_cnt_used = p->entry_cnt_used;
                 erase_page = p;
@@ -1270,100 +1581,479 @@ static struct page_env_tag * new_page_request(struct nvds_flash_env_tag *flash_e
         if (entry_write(flash_env, page, &entry))
             return NULL;
 
-        if (entry_state_alter(flash_env, page, page->next_free_idx - 1, ENTRY_USED))
-            return NULL;
+        entry_state_set(page->entry_states, page->next_free_idx - 1, ENTRY_USED);
+        entry_map[entry_idx] = page->next_free_idx - 1;
+        copy_cnt++;
     }
 
+    /* copies take effect together, duplicates left by power lost are removed when load */
+    if (copy_cnt && entry_states_table_write(flash_env, page->base_addr, page->entry_states))
+        return NULL;
+
+    /* index entries of erase page now point to the copies */
+    index_page_move(flash_env, erase_page, page, entry_map);
+
     /* initializ erase page */
     if (nvds_flash_erase(flash_env, erase_page->base_addr, SPI_FLASH_SEC_SIZE))
         return NULL;
 
     page_clear(flash_env, erase_page);
+    if (erase_page == flash_env->gc_page)
+        flash_env->gc_page = NULL;
+    flash_env->gc_stats.sync_cnt++;
+    flash_env->gc_stats.sync_moved += copy_cnt;
+    index_rebuild(flash_env);
 
     return page;
 }
 
-static int bulk_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
+/**
+ ****************************************************************************************
+ * @brief Background garbage collection, compact one page in bounded steps so that
+ *        new page request does not have to do it synchronously
+ ****************************************************************************************
+ */
+static struct page_env_tag *gc_victim_select(struct nvds_flash_env_tag *flash_env)
 {
-    struct page_env_tag *cur_page;
-    union entry_info entry;
-    uint32_t address;
-    uint32_t entry_cnt;
-    uint32_t length;
-    uint8_t entry_start;
-    uint32_t remain;
-    uint16_t frag_cnt = 0;
-    int ret;
-    uint16_t buf_offset = 0;
-    uint8_t entry_idx = 0;
-    struct page_env_tag *page_start = NULL;
-    struct page_env_tag *page;
-
-    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
-    /* Sanity check : page state should only is PAGE_UNINITIALIZED / PAGE_ACTIVE / PAGE_FULL */
-    if ((cur_page->header.state == PAGE_INVALID)
-        || (cur_page->header.state == PAGE_ERROR)
-        || (cur_page->header.state == PAGE_CANDIDATE)) {
-        //printf("NVDS ERR : illegal page is being writing...\n");
-        return NVDS_ERR(NVDS_E_FAIL);
+    struct page_env_tag *last = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    struct page_env_tag *p;
+    struct page_env_tag *victim = NULL;
+    uint16_t min_cnt_used = ENTRY_COUNT_PER_PAGE - NVDS_GC_RECLAIM_MIN + 1;
+
+    /* page with most reclaimable entries, the active page is never compacted */
+    p = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (p && (p != last)) {
+        if ((p->header.state == PAGE_FULL) && (p->entry_cnt_used < min_cnt_used)) {
+            min_cnt_used = p->entry_cnt_used;
+            victim = p;
+        }
+        p = (struct page_env_tag *)list_next(&p->list_hdr);
     }
 
-    buf_offset = 0;
-    remain = bufsize;
-    do {
-        if (page_room_get(cur_page) < 2 * ENTRY_SIZE) {
-            /* mark current page to full */
-            ret = page_state_alter(flash_env, cur_page, PAGE_FULL);
-            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    return victim;
+}
 
-            cur_page = new_page_request(flash_env, cur_page->header.seqno + 1);
-            if (!cur_page)
-                goto no_space_out;
+static bool gc_pending(struct nvds_flash_env_tag *flash_env)
+{
+    if (flash_env->gc_page)
+        return true;
 
-            if (page_room_get(cur_page) < 2 * ENTRY_SIZE)
-                goto no_space_out;
-        }
+    return ((list_cnt(&flash_env->nvds_page_free) < flash_env->gc_spare)
+            && (gc_victim_select(flash_env) != NULL));
+}
 
-        length = (page_room_get(cur_page) - ENTRY_SIZE) < remain ?
-            (page_room_get(cur_page) - ENTRY_SIZE) : remain;
-        entry_start = cur_page->next_free_idx;
-        entry_cnt = (length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+#if NVDS_GC_TASK_STACK_SIZE
+static os_sema_t nvds_gc_sema = NULL;
 
-        /* bulk frag entry */
-        sys_memset((void*)&entry, 0xFF, sizeof(union entry_info));
-        tag_set(ns_idx, ELEMENT_BULK, frag_cnt, &entry.tag);
-        entry.length = length;
-        sys_memcpy(entry.key, key, strlen(key));
-        entry.key[strlen(key)] = 0;
-        entry.varlen_info_t.datacrc32 = element_data_crc32_calc(buf, length);
-        entry.crc32 = element_header_crc32_calc(&entry);
-        ret = entry_write(flash_env, cur_page, &entry);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+static int gc_step(struct nvds_flash_env_tag *flash_env, uint32_t max_entries);
 
-        /* write frag data */
-        address = cur_page->base_addr + PAGE_ENTRY_OFFSET + cur_page->next_free_idx * ENTRY_SIZE;
-        ret = entry_data_write(flash_env, address, length, buf + buf_offset);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+/**
+ ****************************************************************************************
+ * @brief Background gc task, compacts pages at idle priority between writes
+ ****************************************************************************************
+ */
+static void gc_task(void *param)
+{
+    struct nvds_flash_env_tag *flash_env;
+    bool more;
 
-        cur_page->next_free_idx += entry_cnt;
-        cur_page->entry_cnt_used += entry_cnt;
+    for (;;) {
+        sys_sema_down(&nvds_gc_sema, 0);
 
-        /* modify element states */
-        ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start + entry_cnt, ENTRY_USED);
-        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        do {
+            more = false;
+            if (OS_OK != sys_mutex_get(&nvds_mutex))
+                break;
 
-        remain -= length;
-        buf_offset += length;
-        frag_cnt++;
+            flash_env = (struct nvds_flash_env_tag *)list_pick(&nvds_flash_list);
+            while (flash_env) {
+                if (gc_pending(flash_env)) {
+                    if (gc_step(flash_env, NVDS_GC_STEP_ENTRIES) == NVDS_ERR(NVDS_OK))
+                        more |= gc_pending(flash_env);
+                    else
+                        dbg_print(ERR, "nvds %s background gc fail\r\n", flash_env->label);
+                }
+                flash_env = (struct nvds_flash_env_tag *)list_next(&flash_env->list_hdr);
+            }
 
-#ifdef NVDS_DEBUG
-        page_print(flash_env, cur_page);
-#endif
-    } while (remain > 0);
+            /* release the lock between steps so that writers are not held for a whole page */
+            sys_mutex_put(&nvds_mutex);
+        } while (more);
+    }
+}
 
-    /* write bulkinfo */
-    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
-    /* Sanity check : page state should only is PAGE_UNINITIALIZED / PAGE_ACTIVE / PAGE_FULL */
+/**
+ ****************************************************************************************
+ * @brief Wake up background gc task if free pages went below spare count, called with
+ *        nvds lock held
+ ****************************************************************************************
+ */
+static void gc_kick(struct nvds_flash_env_tag *flash_env)
+{
+    if (!gc_pending(flash_env))
+        return;
+
+    if (!nvds_gc_sema) {
+        if (sys_sema_init_ext(&nvds_gc_sema, 1, 0) != OS_OK)
+            return;
+        if (sys_task_create_dynamic((const uint8_t *)"nvds_gc", NVDS_GC_TASK_STACK_SIZE,
+                                    (OS_TASK_PRIO_IDLE + TASK_PRIO_HIGHER(1)), gc_task, NULL) == NULL) {
+            sys_sema_free(&nvds_gc_sema);
+            nvds_gc_sema = NULL;
+            return;
+        }
+    }
+
+    sys_sema_up(&nvds_gc_sema);
+}
+#else
+#define gc_kick(flash_env)
+#endif
+
+static int gc_element_move(struct nvds_flash_env_tag *flash_env, struct page_env_tag *src,
+                            uint8_t entry_idx, uint32_t entry_cnt)
+{
+    struct page_env_tag *dst;
+    union entry_info entry;
+    char key[KEY_NAME_MAX_SIZE];
+    uint8_t dst_idx;
+    uint8_t ns = 0;
+    uint8_t idx;
+    int ret;
+
+    dst = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if (page_room_get(dst) < (entry_cnt * ENTRY_SIZE)) {
+        /* mark current page to full */
+        ret = page_state_alter(flash_env, dst, PAGE_FULL);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        /* request new page */
+        dst = new_page_request(flash_env, dst->header.seqno + 1);
+        if (!dst)
+            return NVDS_ERR(NVDS_E_NO_SPACE);
+
+        /* no spare page left, the page has been compacted synchronously */
+        if (flash_env->gc_page != src)
+            return NVDS_ERR(NVDS_OK);
+    }
+
+    /* copy element header and data */
+    dst_idx = dst->next_free_idx;
+    for (idx = 0; idx < entry_cnt; idx++) {
+        ret = entry_read(flash_env, src, entry_idx + idx, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        if (idx == 0) {
+            ns = tag_namespace_get(entry.tag);
+            sys_memcpy(key, entry.key, KEY_NAME_MAX_SIZE);
+        }
+
+        ret = entry_write(flash_env, dst, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        entry_state_set(dst->entry_states, dst_idx + idx, ENTRY_USED);
+    }
+
+    /* the copy takes effect first, then the original is retired */
+    ret = entry_states_table_write(flash_env, dst->base_addr, dst->entry_states);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    ret = entry_state_range_alter(flash_env, src, entry_idx, entry_idx + entry_cnt - 1, ENTRY_UPDATED);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    src->entry_cnt_used -= entry_cnt;
+
+    index_del(flash_env, ns, key, src, entry_idx);
+    index_add(flash_env, ns, key, dst, dst_idx);
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int gc_step(struct nvds_flash_env_tag *flash_env, uint32_t max_entries)
+{
+    struct page_env_tag *src = flash_env->gc_page;
+    union entry_info entry;
+    enum entry_state state;
+    enum element_type type;
+    uint32_t moved = 0;
+    uint32_t entry_cnt;
+    int ret;
+
+    if (!src) {
+        if (list_cnt(&flash_env->nvds_page_free) >= flash_env->gc_spare)
+            return NVDS_ERR(NVDS_OK);
+
+        src = gc_victim_select(flash_env);
+        if (!src)
+            return NVDS_ERR(NVDS_OK);
+
+        /* candidate state tells loading that its elements may be copied already */
+        ret = page_state_alter(flash_env, src, PAGE_CANDIDATE);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        flash_env->gc_page = src;
+        flash_env->gc_entry_idx = 0;
+    }
+
+    flash_env->gc_stats.bg_steps++;
+
+    /* move used elements, an element is never split */
+    while ((flash_env->gc_page == src) && (flash_env->gc_entry_idx < ENTRY_COUNT_PER_PAGE)) {
+        ret = entry_state_get(src->entry_states, flash_env->gc_entry_idx, &state);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        if (state == ENTRY_FREE) {
+            flash_env->gc_entry_idx = ENTRY_COUNT_PER_PAGE;
+            break;
+        }
+
+        ret = entry_read(flash_env, src, flash_env->gc_entry_idx, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        entry_cnt = 1;
+        type = tag_element_type_get(entry.tag);
+        if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+            entry_cnt += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+
+        if (state != ENTRY_USED) {
+            flash_env->gc_entry_idx += entry_cnt;
+            continue;
+        }
+
+        if (moved && ((moved + entry_cnt) > max_entries))
+            return NVDS_ERR(NVDS_OK);
+
+        ret = gc_element_move(flash_env, src, flash_env->gc_entry_idx, entry_cnt);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        if (flash_env->gc_page != src)
+            break;
+
+        flash_env->gc_entry_idx += entry_cnt;
+        flash_env->gc_stats.bg_moved += entry_cnt;
+        moved += entry_cnt;
+    }
+
+    /* page has been compacted synchronously by new page request */
+    if (flash_env->gc_page != src)
+        return NVDS_ERR(NVDS_OK);
+
+    /* erase takes a step of its own */
+    if (moved)
+        return NVDS_ERR(NVDS_OK);
+
+    ret = nvds_flash_erase(flash_env, src->base_addr, SPI_FLASH_SEC_SIZE);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    page_clear(flash_env, src);
+    list_extract(&flash_env->nvds_page_used, &src->list_hdr);
+    list_push_back(&flash_env->nvds_page_free, &src->list_hdr);
+    flash_env->gc_page = NULL;
+    flash_env->gc_stats.bg_erased++;
+    index_rebuild(flash_env);
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Remove elements of candidate page which have been copied to other page
+ *        before power lost, and let garbage collection go on with it
+ ****************************************************************************************
+ */
+static void gc_recover(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *cand;
+    struct page_env_tag *page;
+    union entry_info entry;
+    union entry_info copy;
+    enum entry_state state;
+    enum element_type type;
+    uint32_t entry_idx;
+    uint32_t entry_cnt;
+    uint32_t hdr_cnt, i;
+    bool dirty;
+    struct {
+        uint8_t idx;
+        uint32_t crc32;
+    } *hdr;
+
+    hdr = sys_malloc(ENTRY_COUNT_PER_PAGE * sizeof(*hdr));
+    if (!hdr)
+        return;
+
+    cand = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    for (; cand; cand = (struct page_env_tag *)list_next(&cand->list_hdr)) {
+        if (cand->header.state != PAGE_CANDIDATE)
+            continue;
+
+        /* collect used element headers of candidate page */
+        hdr_cnt = 0;
+        for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+            entry_state_get(cand->entry_states, entry_idx, &state);
+            if ((state == ENTRY_FREE) || entry_read(flash_env, cand, entry_idx, &entry))
+                break;
+
+            if (state == ENTRY_USED) {
+                hdr[hdr_cnt].idx = entry_idx;
+                hdr[hdr_cnt].crc32 = entry.crc32;
+                hdr_cnt++;
+            }
+
+            entry_idx++;
+            type = tag_element_type_get(entry.tag);
+            if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+                entry_idx += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+        }
+
+        /* an element with the same header used in other page is a copy */
+        dirty = false;
+        page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+        for (; page && hdr_cnt; page = (struct page_env_tag *)list_next(&page->list_hdr)) {
+            if ((page == cand) || !page_elements_valid(page))
+                continue;
+
+            for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+                entry_state_get(page->entry_states, entry_idx, &state);
+                if ((state == ENTRY_FREE) || entry_read(flash_env, page, entry_idx, &entry))
+                    break;
+
+                for (i = 0; (state == ENTRY_USED) && (i < hdr_cnt); i++) {
+                    if ((hdr[i].crc32 != entry.crc32)
+                        || entry_read(flash_env, cand, hdr[i].idx, &copy)
+                        || sys_memcmp(&copy, &entry, ENTRY_SIZE))
+                        continue;
+
+                    entry_cnt = 1;
+                    type = tag_element_type_get(copy.tag);
+                    if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+                        entry_cnt += (copy.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+                    entry_state_range_set(cand->entry_states, hdr[i].idx, hdr[i].idx + entry_cnt - 1, ENTRY_UPDATED);
+                    cand->entry_cnt_used -= entry_cnt;
+                    index_del(flash_env, tag_namespace_get(copy.tag), copy.key, cand, hdr[i].idx);
+                    dirty = true;
+
+                    hdr[i] = hdr[--hdr_cnt];
+                    break;
+                }
+
+                entry_idx++;
+                type = tag_element_type_get(entry.tag);
+                if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+                    entry_idx += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+            }
+        }
+
+        if (dirty)
+            entry_states_table_write(flash_env, cand->base_addr, cand->entry_states);
+
+        if (!flash_env->gc_page) {
+            flash_env->gc_page = cand;
+            flash_env->gc_entry_idx = 0;
+        }
+    }
+
+    sys_mfree(hdr);
+
+    /* compaction interrupted before erasing, either the candidate page or the page
+    taking the copies has no element left, erase it so there is free page to go on */
+    if (!list_is_empty(&flash_env->nvds_page_free))
+        return;
+
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    for (; page; page = (struct page_env_tag *)list_next(&page->list_hdr)) {
+        if (page->entry_cnt_used)
+            continue;
+
+        if (nvds_flash_erase(flash_env, page->base_addr, SPI_FLASH_SEC_SIZE))
+            return;
+
+        page_clear(flash_env, page);
+        list_extract(&flash_env->nvds_page_used, &page->list_hdr);
+        list_push_back(&flash_env->nvds_page_free, &page->list_hdr);
+        if (page == flash_env->gc_page)
+            flash_env->gc_page = NULL;
+        break;
+    }
+}
+
+static int bulk_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, const char* key, uint8_t *buf, uint32_t bufsize)
+{
+    struct page_env_tag *cur_page;
+    union entry_info entry;
+    uint32_t address;
+    uint32_t entry_cnt;
+    uint32_t length;
+    uint8_t entry_start;
+    uint32_t remain;
+    uint16_t frag_cnt = 0;
+    int ret;
+    uint16_t buf_offset = 0;
+    uint8_t entry_idx = 0;
+    struct page_env_tag *page_start = NULL;
+    struct page_env_tag *page;
+
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    /* Sanity check : page state should only is PAGE_UNINITIALIZED / PAGE_ACTIVE / PAGE_FULL */
+    if ((cur_page->header.state == PAGE_INVALID)
+        || (cur_page->header.state == PAGE_ERROR)
+        || (cur_page->header.state == PAGE_CANDIDATE)) {
+        //printf("NVDS ERR : illegal page is being writing...\n");
+        return NVDS_ERR(NVDS_E_FAIL);
+    }
+
+    buf_offset = 0;
+    remain = bufsize;
+    do {
+        if (page_room_get(cur_page) < 2 * ENTRY_SIZE) {
+            /* mark current page to full */
+            ret = page_state_alter(flash_env, cur_page, PAGE_FULL);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+            cur_page = new_page_request(flash_env, cur_page->header.seqno + 1);
+            if (!cur_page)
+                goto no_space_out;
+
+            if (page_room_get(cur_page) < 2 * ENTRY_SIZE)
+                goto no_space_out;
+        }
+
+        length = (page_room_get(cur_page) - ENTRY_SIZE) < remain ?
+            (page_room_get(cur_page) - ENTRY_SIZE) : remain;
+        entry_start = cur_page->next_free_idx;
+        entry_cnt = (length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+
+        /* bulk frag entry */
+        sys_memset((void*)&entry, 0xFF, sizeof(union entry_info));
+        tag_set(ns_idx, ELEMENT_BULK, frag_cnt, &entry.tag);
+        entry.length = length;
+        sys_memcpy(entry.key, key, strlen(key));
+        entry.key[strlen(key)] = 0;
+        entry.varlen_info_t.datacrc32 = element_data_crc32_calc(buf, length);
+        entry.crc32 = element_header_crc32_calc(&entry);
+        ret = entry_write(flash_env, cur_page, &entry);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        /* write frag data */
+        address = cur_page->base_addr + PAGE_ENTRY_OFFSET + cur_page->next_free_idx * ENTRY_SIZE;
+        ret = entry_data_write(flash_env, address, length, buf + buf_offset);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        cur_page->next_free_idx += entry_cnt;
+        cur_page->entry_cnt_used += entry_cnt;
+
+        /* modify element states */
+        ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start + entry_cnt, ENTRY_USED);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        index_add(flash_env, ns_idx, key, cur_page, entry_start);
+
+        remain -= length;
+        buf_offset += length;
+        frag_cnt++;
+
+#ifdef NVDS_DEBUG
+        page_print(flash_env, cur_page);
+#endif
+    } while (remain > 0);
+
+    /* write bulkinfo */
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    /* Sanity check : page state should only is PAGE_UNINITIALIZED / PAGE_ACTIVE / PAGE_FULL */
     if ((cur_page->header.state == PAGE_INVALID)
         || (cur_page->header.state == PAGE_ERROR)
         || (cur_page->header.state == PAGE_CANDIDATE)) {
@@ -1398,6 +2088,7 @@ static int bulk_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
 
     ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start, ENTRY_USED);
     NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    index_add(flash_env, ns_idx, key, cur_page, entry_start);
 
 #ifdef NVDS_DEBUG
     page_print(flash_env, cur_page);
@@ -1426,6 +2117,7 @@ no_space_out:
         ret = entry_state_range_alter(flash_env, page, entry_idx, entry_idx + entry_cnt, ENTRY_UPDATED);
         NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
         page->entry_cnt_used -= (entry_cnt + 1);
+        index_del(flash_env, ns_idx, key, page, entry_idx);
 
         entry_idx += (entry_cnt + 1);
         page_start = page;
@@ -1525,6 +2217,7 @@ static int data_element_put(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx
         ret = entry_state_range_alter(flash_env, cur_page, entry_start, entry_start, ENTRY_USED);
         NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
     }
+    index_add(flash_env, ns_idx, key, cur_page, entry_start);
 
 #ifdef NVDS_DEBUG
     page_print(flash_env, cur_page);
@@ -1609,58 +2302,528 @@ static int ns_index_by_namespace(struct nvds_flash_env_tag *flash_env, const cha
         }
     }
 
-    return NVDS_ERR(NVDS_OK);
-}
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int ns_add_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx)
+{
+    struct namespace_info *ns;
+
+    if (!flash_env || ns_idx > NAMESPACE_MAX_CNT)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    ns = (struct namespace_info *)list_pick(&flash_env->ns_list);
+    while (ns) {
+        if (ns->index == ns_idx) {
+            ns->used_cnt++;
+            break;
+        }
+
+        ns = (struct namespace_info*)list_next(&ns->list_hdr);
+    }
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int ns_del_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, uint8_t del_flag)
+{
+    struct namespace_info *ns;
+    int ret;
+
+    if (!flash_env || ns_idx > NAMESPACE_MAX_CNT)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    ns = (struct namespace_info *)list_pick(&flash_env->ns_list);
+    while (ns) {
+        if (ns->index == ns_idx) {
+            ns->used_cnt--;
+            if (ns->used_cnt == 0 && del_flag == 1) {
+                list_extract(&flash_env->ns_list, &ns->list_hdr);
+                ns_state_set(flash_env->ns_states, ns_idx, false);
+
+                /* delete namespace */
+                ret = data_element_del(flash_env, 0, ns->name);
+                NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+                sys_mfree(ns);
+            }
+            break;
+        }
+
+        ns = (struct namespace_info*)list_next(&ns->list_hdr);
+    }
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Transaction, stage several elements and make them valid with one states table write
+ ****************************************************************************************
+ */
+static uint16_t txn_op_entry_cnt(uint32_t length)
+{
+    /* delete marker or small element only take header entry */
+    if (length <= ELEMENT_SMALL_MAX_SIZE)
+        return 1;
+
+    return 1 + (length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+}
+
+static void txn_op_free_all(struct nvds_txn *txn)
+{
+    struct nvds_txn_op *op;
+
+    while (!list_is_empty(&txn->op_list)) {
+        op = (struct nvds_txn_op *)list_pop_front(&txn->op_list);
+        if (!op)
+            break;
+        sys_mfree(op);
+    }
+    txn->entry_cnt = 0;
+}
+
+static int txn_op_stage(struct nvds_txn *txn, const char *namespace, const char *key,
+                            uint8_t *data, uint32_t length)
+{
+    struct nvds_txn_op *op;
+    struct nvds_txn_op *old_op;
+
+    op = sys_malloc(sizeof(struct nvds_txn_op) + length);
+    if (!op)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+    sys_memset(op, 0, sizeof(struct nvds_txn_op));
+
+    op->ns_null = (namespace == NULL);
+    if (namespace)
+        sys_memcpy(op->ns, namespace, strlen(namespace));
+    sys_memcpy(op->key, key, strlen(key));
+    op->length = length;
+    if (length)
+        sys_memcpy(op->data, data, length);
+
+    /* later operation on the same key replaces the earlier one */
+    old_op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (old_op) {
+        if ((old_op->ns_null == op->ns_null) && !strcmp(old_op->ns, op->ns) && !strcmp(old_op->key, op->key))
+            break;
+        old_op = (struct nvds_txn_op *)list_next(&old_op->list_hdr);
+    }
+
+    if ((txn->entry_cnt + txn_op_entry_cnt(length)
+            - (old_op ? txn_op_entry_cnt(old_op->length) : 0)) > ENTRY_COUNT_PER_PAGE) {
+        sys_mfree(op);
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+    }
+
+    if (old_op) {
+        txn->entry_cnt -= txn_op_entry_cnt(old_op->length);
+        list_extract(&txn->op_list, &old_op->list_hdr);
+        sys_mfree(old_op);
+    }
+
+    txn->entry_cnt += txn_op_entry_cnt(length);
+    list_push_back(&txn->op_list, &op->list_hdr);
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int txn_old_element_find(struct nvds_flash_env_tag *flash_env, struct nvds_txn_op *op)
+{
+    struct page_env_tag *page;
+    union entry_info entry;
+    enum element_type type;
+    uint8_t entry_idx = 0;
+    int ret;
+
+    ret = element_find(flash_env, op->ns_idx, op->key, &page, &entry_idx, NULL, ELEMENT_ANY);
+    if (ret == NVDS_ERR(NVDS_E_NOT_FOUND))
+        return NVDS_ERR(NVDS_OK);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    ret = entry_read(flash_env, page, entry_idx, &entry);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+    type = tag_element_type_get(entry.tag);
+    op->old_page = page;
+    op->old_idx = entry_idx;
+    if ((type == ELEMENT_BULK) || (type == ELEMENT_BULKINFO))
+        op->old_bulk = true;
+    else if (type == ELEMENT_MIDDLE)
+        op->old_cnt = 1 + (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    else
+        op->old_cnt = 1;
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int txn_entries_build(struct nvds_flash_env_tag *flash_env, struct nvds_txn *txn,
+                                struct page_env_tag *page, uint8_t *buf, uint32_t *entry_cnt)
+{
+    struct nvds_txn_op *op;
+    union entry_info *entry;
+    uint32_t cnt = 0;
+    uint32_t data_cnt;
+    int length;
+    uint8_t *input;
+
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (op->skip) {
+            op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+            continue;
+        }
+
+        op->new_idx = page->next_free_idx + cnt;
+        entry = (union entry_info *)(buf + cnt * ENTRY_SIZE);
+        sys_memset(entry, 0xFF, ENTRY_SIZE);
+        tag_set(op->ns_idx, (op->length > ELEMENT_SMALL_MAX_SIZE) ? ELEMENT_MIDDLE : ELEMENT_SMALL,
+                TAG_FRAG_NO_TXN, &entry->tag);
+        entry->length = op->length;
+        sys_memcpy(entry->key, op->key, strlen(op->key));
+        entry->key[strlen(op->key)] = 0;
+        if (op->length > ELEMENT_SMALL_MAX_SIZE)
+            entry->varlen_info_t.datacrc32 = element_data_crc32_calc(op->data, op->length);
+        else if (op->length)
+            sys_memcpy(entry->value, op->data, op->length);
+        entry->crc32 = element_header_crc32_calc(entry);
+        cnt++;
+
+        /* middle element data follows its header */
+        if (op->length > ELEMENT_SMALL_MAX_SIZE) {
+            data_cnt = (op->length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+            sys_memset(buf + cnt * ENTRY_SIZE, 0xFF, data_cnt * ENTRY_SIZE);
+            sys_memcpy(buf + cnt * ENTRY_SIZE, op->data, op->length);
+            cnt += data_cnt;
+        }
+
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    /* encrypt all entries before write to flash if encrypted enabled */
+    if (flash_env->encrypted) {
+        length = cnt * ENTRY_SIZE;
+        input = buf;
+        while (length > 0) {
+            if (mbedtls_aes_crypt_ecb(&flash_env->crypt_env.ctx, MBEDTLS_AES_ENCRYPT, input, input))
+                return NVDS_ERR(NVDS_E_ENCR_FAIL);
+            input += AES_BLOCK_SZ;
+            length -= AES_BLOCK_SZ;
+        }
+    }
+
+    *entry_cnt = cnt;
+    return NVDS_ERR(NVDS_OK);
+}
+
+static int txn_commit(struct nvds_flash_env_tag *flash_env, struct nvds_txn *txn)
+{
+    struct page_env_tag *cur_page;
+    struct page_env_tag *page;
+    struct nvds_txn_op *op;
+    uint32_t states_backup[ENTRY_STATES_TABLE_SIZE];
+    uint32_t entry_cnt;
+    uint32_t address;
+    uint8_t *buf = NULL;
+    bool dirty;
+    uint8_t idx;
+    int ret;
+
+    /* namespace creation writes its own element, do it before reserving room */
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        ret = ns_index_by_namespace(flash_env, op->ns_null ? NULL : op->ns, (op->length != 0), &op->ns_idx);
+        if (ret == NVDS_ERR(NVDS_E_NOT_FOUND) && (op->length == 0))
+            op->skip = true;
+        else if (ret != NVDS_ERR(NVDS_OK))
+            return ret;
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    cur_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    /* Sanity check : page state should only is PAGE_UNINITIALIZED / PAGE_ACTIVE / PAGE_FULL */
+    if ((cur_page->header.state == PAGE_INVALID)
+        || (cur_page->header.state == PAGE_ERROR)
+        || (cur_page->header.state == PAGE_CANDIDATE)) {
+        return NVDS_ERR(NVDS_E_FAIL);
+    }
+
+    /* all staged entries must fit in one page, request new page before any element written */
+    if (page_room_get(cur_page) < (txn->entry_cnt * ENTRY_SIZE)) {
+        ret = page_state_alter(flash_env, cur_page, PAGE_FULL);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+
+        cur_page = new_page_request(flash_env, cur_page->header.seqno + 1);
+        if (!cur_page || (page_room_get(cur_page) < (txn->entry_cnt * ENTRY_SIZE)))
+            return NVDS_ERR(NVDS_E_NO_SPACE);
+    }
+
+    /* locate old elements, no page will be compacted from now on */
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (!op->skip) {
+            if (op->length && element_compare(flash_env, op->ns_idx, op->key, op->data, op->length)) {
+                op->skip = true;
+            } else {
+                ret = txn_old_element_find(flash_env, op);
+                NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+                if (!op->length && !op->old_page)
+                    op->skip = true;
+            }
+        }
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    /* write all entries with one flash write, they stay free state until commit */
+    buf = sys_malloc(txn->entry_cnt * ENTRY_SIZE);
+    if (!buf)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+
+    ret = txn_entries_build(flash_env, txn, cur_page, buf, &entry_cnt);
+    if ((ret == NVDS_ERR(NVDS_OK)) && entry_cnt) {
+        address = cur_page->base_addr + PAGE_ENTRY_OFFSET + cur_page->next_free_idx * ENTRY_SIZE;
+        ret = nvds_flash_write(flash_env, address, entry_cnt * ENTRY_SIZE, buf);
+    }
+    sys_mfree(buf);
+    NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    if (!entry_cnt)
+        return NVDS_ERR(NVDS_OK);
+
+    /* commit point, new entries and old elements in this page change state together */
+    sys_memcpy(states_backup, cur_page->entry_states, sizeof(states_backup));
+    for (idx = cur_page->next_free_idx; idx < cur_page->next_free_idx + entry_cnt; idx++)
+        entry_state_set(cur_page->entry_states, idx, ENTRY_USED);
+
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (!op->skip && (op->old_page == cur_page) && !op->old_bulk) {
+            for (idx = op->old_idx; idx < op->old_idx + op->old_cnt; idx++)
+                entry_state_set(cur_page->entry_states, idx, ENTRY_UPDATED);
+        }
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    ret = entry_states_table_write(flash_env, cur_page->base_addr, cur_page->entry_states);
+    if (ret != NVDS_ERR(NVDS_OK)) {
+        sys_memcpy(cur_page->entry_states, states_backup, sizeof(states_backup));
+        return ret;
+    }
+    cur_page->next_free_idx += entry_cnt;
+    cur_page->entry_cnt_used += entry_cnt;
+
+    /* retire old elements in other pages, one states table write per page */
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (page) {
+        dirty = false;
+        op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+        while (op) {
+            if (!op->skip && (op->old_page == page) && (page != cur_page) && !op->old_bulk) {
+                for (idx = op->old_idx; idx < op->old_idx + op->old_cnt; idx++)
+                    entry_state_set(page->entry_states, idx, ENTRY_UPDATED);
+                dirty = true;
+            }
+            op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+        }
+
+        if (dirty) {
+            ret = entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        }
+        page = (struct page_env_tag *)list_next(&page->list_hdr);
+    }
+
+    dirty = false;
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (op->skip) {
+            op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+            continue;
+        }
+
+        if (op->old_bulk) {
+            ret = bulk_element_del(flash_env, op->ns_idx, op->key);
+            NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+        } else if (op->old_page) {
+            op->old_page->entry_cnt_used -= op->old_cnt;
+            index_del(flash_env, op->ns_idx, op->key, op->old_page, op->old_idx);
+        }
+
+        if (op->length) {
+            index_add(flash_env, op->ns_idx, op->key, cur_page, op->new_idx);
+            if (!op->old_page)
+                ns_add_used_cnt(flash_env, op->ns_idx);
+        } else {
+            /* delete marker is no longer needed once old element is retired */
+            entry_state_set(cur_page->entry_states, op->new_idx, ENTRY_UPDATED);
+            cur_page->entry_cnt_used--;
+            dirty = true;
+        }
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+    if (dirty) {
+        ret = entry_states_table_write(flash_env, cur_page->base_addr, cur_page->entry_states);
+        NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+    }
+
+    /* namespace element may be deleted when its last key is deleted */
+    op = (struct nvds_txn_op *)list_pick(&txn->op_list);
+    while (op) {
+        if (!op->skip && !op->length)
+            ns_del_used_cnt(flash_env, op->ns_idx, 1);
+        op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+    }
+
+#ifdef NVDS_DEBUG
+    page_print(flash_env, cur_page);
+#endif
+
+    return NVDS_ERR(NVDS_OK);
+}
+
+/**
+ ****************************************************************************************
+ * @brief Finish transaction interrupted by power lost
+ *
+ * Only the last used page may hold a transaction whose old elements are not retired yet.
+ * Retire elements which are older than a transaction element with the same key, then the
+ * delete markers.
+ ****************************************************************************************
+ */
+static int txn_recover(struct nvds_flash_env_tag *flash_env)
+{
+    struct page_env_tag *last_page;
+    struct page_env_tag *page;
+    struct list txn_list;
+    struct nvds_txn_op *op;
+    union entry_info entry;
+    enum entry_state state;
+    enum element_type type;
+    uint8_t entry_idx;
+    uint8_t entry_cnt;
+    uint8_t ns;
+    uint8_t idx;
+    bool dirty;
+    int ret = NVDS_ERR(NVDS_OK);
+
+    last_page = (struct page_env_tag *)list_pick_last(&flash_env->nvds_page_used);
+    if (!last_page || ((last_page->header.state != PAGE_ACTIVE) && (last_page->header.state != PAGE_FULL)))
+        return NVDS_ERR(NVDS_OK);
 
-static int ns_add_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx)
-{
-    struct namespace_info *ns;
+    /* collect transaction elements of the last page */
+    list_init(&txn_list);
+    for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+        entry_state_get(last_page->entry_states, entry_idx, &state);
+        if (state == ENTRY_FREE)
+            break;
 
-    if (!flash_env || ns_idx > NAMESPACE_MAX_CNT)
-        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+        if (entry_read(flash_env, last_page, entry_idx, &entry)) {
+            ret = NVDS_ERR(NVDS_E_FLASH_IO_FAIL);
+            goto exit;
+        }
 
-    ns = (struct namespace_info *)list_pick(&flash_env->ns_list);
-    while (ns) {
-        if (ns->index == ns_idx) {
-            ns->used_cnt++;
-            break;
+        type = tag_element_type_get(entry.tag);
+        if ((state == ENTRY_USED) && (tag_fragno_get(entry.tag) == TAG_FRAG_NO_TXN)
+            && (entry.crc32 == element_header_crc32_calc(&entry))) {
+            op = sys_malloc(sizeof(struct nvds_txn_op));
+            if (!op) {
+                ret = NVDS_ERR(NVDS_E_NO_SPACE);
+                goto exit;
+            }
+            sys_memset(op, 0, sizeof(struct nvds_txn_op));
+            op->ns_idx = tag_namespace_get(entry.tag);
+            sys_memcpy(op->key, entry.key, KEY_NAME_MAX_SIZE - 1);
+            op->length = entry.length;
+            op->new_idx = entry_idx;
+            list_push_back(&txn_list, &op->list_hdr);
         }
 
-        ns = (struct namespace_info*)list_next(&ns->list_hdr);
+        entry_idx++;
+        if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+            entry_idx += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
     }
 
-    return NVDS_ERR(NVDS_OK);
-}
+    if (list_is_empty(&txn_list))
+        goto exit;
 
-static int ns_del_used_cnt(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx, uint8_t del_flag)
-{
-    struct namespace_info *ns;
-    int ret;
+    /* retire older elements, the last page is written at last */
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (page) {
+        if (!page_elements_valid(page)) {
+            page = (struct page_env_tag *)list_next(&page->list_hdr);
+            continue;
+        }
 
-    if (!flash_env || ns_idx > NAMESPACE_MAX_CNT)
-        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+        dirty = false;
+        for (entry_idx = 0; entry_idx < ENTRY_COUNT_PER_PAGE;) {
+            entry_state_get(page->entry_states, entry_idx, &state);
+            if (state == ENTRY_FREE)
+                break;
 
-    ns = (struct namespace_info *)list_pick(&flash_env->ns_list);
-    while (ns) {
-        if (ns->index == ns_idx) {
-            ns->used_cnt--;
-            if (ns->used_cnt == 0 && del_flag == 1) {
-                list_extract(&flash_env->ns_list, &ns->list_hdr);
-                ns_state_set(flash_env->ns_states, ns_idx, false);
+            if (entry_read(flash_env, page, entry_idx, &entry)) {
+                ret = NVDS_ERR(NVDS_E_FLASH_IO_FAIL);
+                goto exit;
+            }
 
-                /* delete namespace */
-                ret = data_element_del(flash_env, 0, ns->name);
-                NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
+            type = tag_element_type_get(entry.tag);
+            entry_cnt = 1;
+            if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+                entry_cnt += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
 
-                sys_mfree(ns);
+            if (state == ENTRY_USED) {
+                ns = tag_namespace_get(entry.tag);
+                op = (struct nvds_txn_op *)list_pick(&txn_list);
+                while (op) {
+                    if ((op->ns_idx == ns) && !strncmp(op->key, entry.key, KEY_NAME_MAX_SIZE)
+                        && ((page != last_page) || (entry_idx < op->new_idx)))
+                        break;
+                    op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+                }
+
+                if (op) {
+                    for (idx = entry_idx; idx < entry_idx + entry_cnt; idx++)
+                        entry_state_set(page->entry_states, idx, ENTRY_UPDATED);
+                    page->entry_cnt_used -= entry_cnt;
+                    index_del(flash_env, ns, op->key, page, entry_idx);
+                    dirty = true;
+                }
             }
-            break;
+
+            entry_idx += entry_cnt;
         }
 
-        ns = (struct namespace_info*)list_next(&ns->list_hdr);
+        /* delete markers are retired together with the last page */
+        if (page == last_page) {
+            op = (struct nvds_txn_op *)list_pick(&txn_list);
+            while (op) {
+                if (!op->length) {
+                    entry_state_set(page->entry_states, op->new_idx, ENTRY_UPDATED);
+                    page->entry_cnt_used--;
+                    index_del(flash_env, op->ns_idx, op->key, page, op->new_idx);
+                    dirty = true;
+                }
+                op = (struct nvds_txn_op *)list_next(&op->list_hdr);
+            }
+        }
+
+        if (dirty) {
+            ret = entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+            if (ret != NVDS_ERR(NVDS_OK))
+                goto exit;
+        }
+
+        page = (struct page_env_tag *)list_next(&page->list_hdr);
     }
 
-    return NVDS_ERR(NVDS_OK);
+exit:
+    while (!list_is_empty(&txn_list)) {
+        op = (struct nvds_txn_op *)list_pop_front(&txn_list);
+        if (!op)
+            break;
+        sys_mfree(op);
+    }
+
+    return ret;
 }
 
 static void page_header_read(struct nvds_flash_env_tag *flash_env, struct page_env_tag *page)
@@ -1752,6 +2915,7 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
         return NVDS_ERR(NVDS_E_INVAL_PARAM);
 
     sector_cnt = flash_env->length / SPI_FLASH_SEC_SIZE;
+    index_init(flash_env);
 
     /* walk page to create namespace list and element list */
     for (sector_idx = 0; sector_idx < sector_cnt; ++sector_idx) {
@@ -1788,7 +2952,22 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
             entry_state_get(page->entry_states, entry_idx, &state);
 
             if (state == ENTRY_FREE) {
-                /* check following whether if read empty */
+                /* element was written but its state not, e.g. power lost before commit,
+                skip it and its data to avoid programming over them again */
+                if (!entry_blank_check(flash_env, page, entry_idx)) {
+                    entry_cnt = 1;
+                    if (!entry_read(flash_env, page, entry_idx, &entry)
+                        && (entry.crc32 == element_header_crc32_calc(&entry))) {
+                        type = tag_element_type_get(entry.tag);
+                        if ((ELEMENT_MIDDLE == type) || (ELEMENT_BULK == type))
+                            entry_cnt += (entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+                    }
+
+                    for (; entry_cnt && (entry_idx < ENTRY_COUNT_PER_PAGE); entry_cnt--, entry_idx++)
+                        entry_state_set(page->entry_states, entry_idx, ENTRY_UPDATED);
+                    entry_states_table_write(flash_env, page->base_addr, page->entry_states);
+                    continue;
+                }
                 /* record next free entry idx */
                 page->next_free_idx = entry_idx;
                 break;
@@ -1810,6 +2989,8 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
                 /* check entry crc */
                 if (entry.crc32 != element_header_crc32_calc(&entry)) {
                     entry_state_alter(flash_env, page, entry_idx, ENTRY_UPDATED);
+                } else {
+                    index_add(flash_env, tag_namespace_get(entry.tag), entry.key, page, entry_idx);
                 }
 
                 ns = tag_namespace_get(entry.tag);
@@ -1844,6 +3025,9 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
         }
 
         if (is_err) {
+            /* index may point to this page, drop it and use flash scan until the next compaction */
+            index_deinit(flash_env);
+            flash_env->index_lost = true;
             list_push_back(&flash_env->nvds_page_free, &page->list_hdr);
         } else {
             list_insert(&flash_env->nvds_page_used, &page->list_hdr, cmp_sequence_no);
@@ -1851,6 +3035,10 @@ static int pages_load(struct nvds_flash_env_tag *flash_env)
         }
     }
 
+    /* drop copies left by interrupted compaction, then finish the last transaction */
+    gc_recover(flash_env);
+    txn_recover(flash_env);
+
     /* walk used page list to record namespace used count */
     page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
     while (page) {
@@ -1903,7 +3091,7 @@ static const char* page_state_string_get(uint16_t state)
     else if (state == PAGE_FULL)
         return "full";
     else if (state == PAGE_CANDIDATE)
-        return "";
+        return "candidate";
     else if (state == PAGE_ERROR)
         return "error";
     else if (state == PAGE_INVALID)
@@ -2082,6 +3270,19 @@ static void nvds_dump_from_list(struct nvds_flash_env_tag *flash_env)
     dbg_print(NOTICE, "address\t:0x%08X ~ 0x%08X\r\n", flash_env->base_addr, flash_env->base_addr + flash_env->length - 1);
     dbg_print(NOTICE, "used page\t:%d\r\n", list_cnt(&flash_env->nvds_page_used));
     dbg_print(NOTICE, "free page\t:%d\r\n", list_cnt(&flash_env->nvds_page_free));
+    if (flash_env->index)
+        dbg_print(NOTICE, "index slot\t:%d/%d\r\n", flash_env->index_cnt, flash_env->index_msk + 1);
+    else
+        dbg_print(NOTICE, "index slot\t:not available\r\n");
+
+    /* dump garbage collection statistics */
+    dbg_print(NOTICE, "======gc======\r\n");
+    dbg_print(NOTICE, "spare page\t:%d, compacting sector:%d\r\n", flash_env->gc_spare,
+        flash_env->gc_page ? (int)(flash_env->gc_page->base_addr / SPI_FLASH_SEC_SIZE) : -1);
+    dbg_print(NOTICE, "background\t:steps %d, moved entry %d, erased page %d\r\n",
+        flash_env->gc_stats.bg_steps, flash_env->gc_stats.bg_moved, flash_env->gc_stats.bg_erased);
+    dbg_print(NOTICE, "synchronous\t:count %d, moved entry %d\r\n",
+        flash_env->gc_stats.sync_cnt, flash_env->gc_stats.sync_moved);
 
     /* dump namespace list information */
     dbg_print(NOTICE, "======namespace======\r\n");
@@ -2309,6 +3510,10 @@ static int nvds_flash_env_init(struct nvds_flash_env_tag *flash_env, uint32_t st
 #else
     flash_env->encrypted = 0;
 #endif
+    /* at least one page keeps elements */
+    flash_env->gc_spare = NVDS_GC_SPARE_PAGES;
+    if (flash_env->gc_spare >= (size / SPI_FLASH_SEC_SIZE))
+        flash_env->gc_spare = (size / SPI_FLASH_SEC_SIZE) > 1 ? (size / SPI_FLASH_SEC_SIZE) - 1 : 1;
 
     /* Load nvds flash data */
     ret = pages_load(flash_env);
@@ -2362,7 +3567,7 @@ int nvds_del_keys_by_namespace(void *handle, const char *namespace)
     /* parsing used page list */
     page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
     while (page) {
-        if ((page->header.state != PAGE_ACTIVE) && (page->header.state != PAGE_FULL)) {
+        if (!page_elements_valid(page)) {
             page = (struct page_env_tag*)list_next(&page->list_hdr);
             continue;
         }
@@ -2391,6 +3596,7 @@ int nvds_del_keys_by_namespace(void *handle, const char *namespace)
                     NVDS_ERR_RET(ret == NVDS_ERR(NVDS_OK), ret);
                     page->entry_cnt_used -= (entry_cnt + 1);
                 }
+                index_del(flash_env, ns_idx, entry.key, page, entry_idx);
 
                 /* when there is no key in namespace, we can delete namespace */
                 ns->used_cnt--;
@@ -2441,7 +3647,7 @@ int nvds_find_keys_by_namespace(void *handle, const char *namespace, found_keys_
     /* parsing used page list */
     page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
     while (page) {
-        if ((page->header.state != PAGE_ACTIVE) && (page->header.state != PAGE_FULL)) {
+        if (!page_elements_valid(page)) {
             page = (struct page_env_tag*)list_next(&page->list_hdr);
             continue;
         }
@@ -2507,6 +3713,7 @@ void nvds_flash_deinit(void *handle)
             sys_mfree(p);
         }
 
+        index_deinit(flash_env);
         sys_mfree(flash_env);
     }
 }
@@ -2600,6 +3807,7 @@ int nvds_data_put(void *handle, const char *namespace, const char *key, uint8_t
     ret = data_element_put(flash_env, ns_idx, key, data, length);
     if (ret == NVDS_ERR(NVDS_OK))
         ns_add_used_cnt(flash_env, ns_idx);
+    gc_kick(flash_env);
 
 exit:
     sys_mutex_put(&nvds_mutex);
@@ -2660,6 +3868,138 @@ int nvds_data_del(void *handle, const char *namespace, const char *key)
     ret = data_element_del(flash_env, ns_idx, key);
     if (ret == NVDS_ERR(NVDS_OK))
         ns_del_used_cnt(flash_env, ns_idx, 1);
+    gc_kick(flash_env);
+
+exit:
+    sys_mutex_put(&nvds_mutex);
+    return ret;
+}
+
+static int element_iterate(struct nvds_flash_env_tag *flash_env, uint8_t ns_idx,
+                           nvds_iter_cb cb, void *arg)
+{
+    struct page_env_tag *page;
+    enum entry_state state;
+    union entry_info entry;
+    enum element_type type;
+    uint8_t entry_idx;
+    uint8_t data_idx;
+    uint8_t *buf;
+    uint8_t *bulk;
+    uint32_t length;
+    uint32_t copy;
+    uint32_t crc32;
+    char key[KEY_NAME_MAX_SIZE];
+    int stop = 0;
+    int ret = NVDS_ERR(NVDS_OK);
+
+    buf = sys_malloc(ELEMENT_MIDDLE_MAX_SIZE);
+    if (!buf)
+        return NVDS_ERR(NVDS_E_NO_SPACE);
+
+    /* parsing used page list, middle elements are read in the same walk */
+    page = (struct page_env_tag *)list_pick(&flash_env->nvds_page_used);
+    while (page && !stop) {
+        if (!page_elements_valid(page)) {
+            page = (struct page_env_tag*)list_next(&page->list_hdr);
+            continue;
+        }
+
+        for (entry_idx = 0; (entry_idx < ENTRY_COUNT_PER_PAGE) && !stop;) {
+            ret = entry_state_get(page->entry_states, entry_idx, &state);
+            if (ret != NVDS_ERR(NVDS_OK))
+                goto exit;
+
+            if (state == ENTRY_FREE)
+                break;
+
+            ret = entry_read(flash_env, page, entry_idx, &entry);
+            if (ret != NVDS_ERR(NVDS_OK))
+                goto exit;
+
+            type = tag_element_type_get(entry.tag);
+            entry_idx++;
+
+            if ((state != ENTRY_USED) || (tag_namespace_get(entry.tag) != ns_idx)) {
+                if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK))
+                    entry_idx += ((entry.length + ENTRY_SIZE - 1) / ENTRY_SIZE);
+                continue;
+            }
+
+            length = entry.length;
+            sys_memcpy(key, entry.key, KEY_NAME_MAX_SIZE);
+            key[KEY_NAME_MAX_SIZE - 1] = '\0';
+
+            if (type == ELEMENT_SMALL) {
+                sys_memcpy(buf, entry.value, length);
+                stop = cb(key, buf, length, arg);
+            } else if ((type == ELEMENT_MIDDLE) && (length <= ELEMENT_MIDDLE_MAX_SIZE)) {
+                crc32 = entry.varlen_info_t.datacrc32;
+                for (data_idx = 0, copy = 0; copy < length; data_idx++) {
+                    ret = entry_read(flash_env, page, entry_idx + data_idx, &entry);
+                    if (ret != NVDS_ERR(NVDS_OK))
+                        goto exit;
+                    sys_memcpy(buf + copy, entry.data,
+                               ((length - copy) < ENTRY_SIZE) ? (length - copy) : ENTRY_SIZE);
+                    copy += ENTRY_SIZE;
+                }
+                entry_idx += data_idx;
+
+                if (crc32 == element_data_crc32_calc(buf, length))
+                    stop = cb(key, buf, length, arg);
+            } else if (type == ELEMENT_BULKINFO) {
+                /* fragments can be in any page, gather them through the index */
+                length = entry.bulk_info_t.bulksize;
+                bulk = sys_malloc(length);
+                if (!bulk) {
+                    ret = NVDS_ERR(NVDS_E_NO_SPACE);
+                    goto exit;
+                }
+                ret = bulk_element_get(flash_env, ns_idx, key, bulk, &length);
+                if (ret == NVDS_ERR(NVDS_OK))
+                    stop = cb(key, bulk, length, arg);
+                sys_mfree(bulk);
+                /* an incomplete bulk element is skipped like a bad crc one */
+                if (ret == NVDS_ERR(NVDS_E_FLASH_IO_FAIL))
+                    goto exit;
+                ret = NVDS_ERR(NVDS_OK);
+            } else if ((type == ELEMENT_MIDDLE) || (type == ELEMENT_BULK)) {
+                /* bulk fragment data is passed with its bulkinfo element */
+                entry_idx += ((length + ENTRY_SIZE - 1) / ENTRY_SIZE);
+            }
+        }
+
+        page = (struct page_env_tag*)list_next(&page->list_hdr);
+    }
+
+exit:
+    sys_mfree(buf);
+    return ret;
+}
+
+int nvds_data_iterate(void *handle, const char *namespace, nvds_iter_cb cb, void *arg)
+{
+    struct nvds_flash_env_tag *flash_env;
+    uint8_t ns_idx;
+    int ret;
+
+    if (!cb)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    /* find ns idx by namespace */
+    ret = ns_index_by_namespace(flash_env, namespace, false, &ns_idx);
+    if (ret != NVDS_ERR(NVDS_OK))
+        goto exit;
+
+    ret = element_iterate(flash_env, ns_idx, cb, arg);
 
 exit:
     sys_mutex_put(&nvds_mutex);
@@ -2695,6 +4035,123 @@ exit:
     return ret;
 }
 
+void *nvds_txn_begin(void *handle)
+{
+    struct nvds_txn *txn;
+
+    txn = sys_malloc(sizeof(struct nvds_txn));
+    if (!txn)
+        return NULL;
+
+    if (handle)
+        txn->flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        txn->flash_env = &nvds_flash_env;
+    list_init(&txn->op_list);
+    txn->entry_cnt = 0;
+
+    return (void *)txn;
+}
+
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length)
+{
+    if (!txn || !key || !data || (length == 0) || (length > ELEMENT_MIDDLE_MAX_SIZE) ||
+        (strlen(key) > (KEY_NAME_MAX_SIZE - 1)) ||
+        (namespace && (strlen(namespace) > (KEY_NAME_MAX_SIZE - 1))))
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    return txn_op_stage((struct nvds_txn *)txn, namespace, key, data, length);
+}
+
+int nvds_txn_del(void *txn, const char *namespace, const char *key)
+{
+    if (!txn || !key || (strlen(key) > (KEY_NAME_MAX_SIZE - 1)) ||
+        (namespace && (strlen(namespace) > (KEY_NAME_MAX_SIZE - 1))))
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    return txn_op_stage((struct nvds_txn *)txn, namespace, key, NULL, 0);
+}
+
+int nvds_txn_commit(void *txn)
+{
+    struct nvds_txn *nvds_txn = (struct nvds_txn *)txn;
+    int ret;
+
+    if (!nvds_txn)
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex)) {
+        nvds_txn_abort(txn);
+        return NVDS_ERR(NVDS_E_FAIL);
+    }
+
+    ret = NVDS_ERR(NVDS_OK);
+    if (!list_is_empty(&nvds_txn->op_list)) {
+        ret = txn_commit(nvds_txn->flash_env, nvds_txn);
+        gc_kick(nvds_txn->flash_env);
+    }
+
+    sys_mutex_put(&nvds_mutex);
+
+    nvds_txn_abort(txn);
+    return ret;
+}
+
+void nvds_txn_abort(void *txn)
+{
+    if (!txn)
+        return;
+
+    txn_op_free_all((struct nvds_txn *)txn);
+    sys_mfree(txn);
+}
+
+int nvds_gc_spare_set(void *handle, uint8_t spare_pages)
+{
+    struct nvds_flash_env_tag *flash_env;
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    /* at least one page keeps elements */
+    if ((spare_pages == 0) || (spare_pages >= (flash_env->length / SPI_FLASH_SEC_SIZE))) {
+        sys_mutex_put(&nvds_mutex);
+        return NVDS_ERR(NVDS_E_INVAL_PARAM);
+    }
+
+    flash_env->gc_spare = spare_pages;
+    gc_kick(flash_env);
+
+    sys_mutex_put(&nvds_mutex);
+    return NVDS_ERR(NVDS_OK);
+}
+
+int nvds_gc_step(void *handle, uint32_t max_entries, uint8_t *more)
+{
+    struct nvds_flash_env_tag *flash_env;
+    int ret;
+
+    if (OS_OK != sys_mutex_get(&nvds_mutex))
+        return NVDS_ERR(NVDS_E_FAIL);
+
+    if (handle)
+        flash_env = (struct nvds_flash_env_tag *)handle;
+    else
+        flash_env = &nvds_flash_env;
+
+    ret = gc_step(flash_env, max_entries);
+    if (more)
+        *more = gc_pending(flash_env);
+
+    sys_mutex_put(&nvds_mutex);
+    return ret;
+}
+
 int nvds_clean(const char *nvds_label)
 {
     struct nvds_flash_env_tag *flash_env;
@@ -2732,6 +4189,7 @@ int nvds_clean(const char *nvds_label)
         goto exit;
 
     if (internal) {
+        index_deinit(&nvds_flash_env);
         memset(&nvds_flash_env, 0, sizeof(nvds_flash_env));
         nvds_flash_env_init(&nvds_flash_env, NVDS_FLASH_INTERNAL_ADDR, NVDS_FLASH_INTERNAL_SIZE, LABEL_INNER_NVDS_FLASH);
     } else {
@@ -2791,6 +4249,11 @@ int nvds_data_get(void *handle, const char *namespace, const char *key, uint8_t
     return NVDS_E_NOT_USE_FLASH;
 }
 
+int nvds_data_iterate(void *handle, const char *namespace, nvds_iter_cb cb, void *arg)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
 int nvds_data_del(void *handle, const char *namespace, const char *key)
 {
     return NVDS_E_NOT_USE_FLASH;
@@ -2801,6 +4264,42 @@ int nvds_data_find(void *handle, const char *namespace, const char *key)
     return NVDS_E_NOT_USE_FLASH;
 }
 
+void *nvds_txn_begin(void *handle)
+{
+    return NULL;
+}
+
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_txn_del(void *txn, const char *namespace, const char *key)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_txn_commit(void *txn)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+void nvds_txn_abort(void *txn)
+{
+}
+
+int nvds_gc_spare_set(void *handle, uint8_t spare_pages)
+{
+    return NVDS_E_NOT_USE_FLASH;
+}
+
+int nvds_gc_step(void *handle, uint32_t max_entries, uint8_t *more)
+{
+    if (more)
+        *more = 0;
+    return NVDS_E_NOT_USE_FLASH;
+}
+
 int nvds_clean(const char *nvds_label)
 {
     return NVDS_E_NOT_USE_FLASH;
@@ -81,6 +81,8 @@ enum nvds_ret {
 #define NVDS_NS_WIFI_INFO               "wifi_info"
 
 typedef void (*found_keys_cb) (const char *namespace, const char *key, uint16_t val_len);
+/* return non-zero to stop the iteration */
+typedef int (*nvds_iter_cb) (const char *key, const uint8_t *data, uint32_t length, void *arg);
 /*
  * FUNCTION DECLARATIONS
  ****************************************************************************************
@@ -234,6 +236,143 @@ int nvds_data_del(void *handle, const char *namespace, const char *key);
  */
 int nvds_data_find(void *handle, const char *namespace, const char *key);
 
+/**
+ ****************************************************************************************
+ * @brief      Get all elements of a namespace in one pass over the used pages
+ *
+ * Each element is read once and passed with its value to the callback, instead of one
+ * @ref nvds_data_get per key, each starting a new lookup. Elements with a bad data crc
+ * are skipped. The callback runs with the nvds lock held and must not call nvds APIs,
+ * data is only valid during the call.
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ * @param[in]  namespace    Namespace to walk, NULL is for default namespace.
+ * @param[in]  cb           Called for each element, return non-zero to stop
+ * @param[in]  arg          Argument passed to the callback
+ *
+ * @return  NVDS_OK                 All elements (or up to the callback stop) were passed
+ *          NVDS_E_FAIL             Generic nvds fail status
+ *          NVDS_E_INVAL_PARAM      Parameter is invalid
+ *          NVDS_E_FLASH_IO_FAIL    Flash api, such as flash read/write/erase operation fail
+ *          NVDS_E_NOT_FOUND        The given namespace is not found
+ *          NVDS_E_NO_SPACE         No memory for the read buffer
+ ****************************************************************************************
+ */
+int nvds_data_iterate(void *handle, const char *namespace, nvds_iter_cb cb, void *arg);
+
+/**
+ ****************************************************************************************
+ * @brief      Begin a transaction to put / delete several elements with a single commit
+ *
+ * Operations are staged in RAM by @ref nvds_txn_put and @ref nvds_txn_del, and written by
+ * @ref nvds_txn_commit into one page. New values become valid all together with one program
+ * of the page entry states table, so either all or none of them are kept after a power cut.
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL indicate internal nvds flash
+ *
+ * @return If successful, handle of the transaction will be returned, otherwise return NULL.
+ ****************************************************************************************
+ */
+void *nvds_txn_begin(void *handle);
+
+/**
+ ****************************************************************************************
+ * @brief      Stage element value with given key name and namespace in transaction
+ *
+ * Value is copied, bulk element (length larger than 256 bytes) is not supported.
+ * Later operation on the same key replaces the earlier one in the transaction.
+ *
+ * @param[in]  txn          Handle of the transaction
+ * @param[in]  namespace    Namespace of the element, NULL is for default namespace.
+ * @param[in]  key          Key name, shouldn't be empty.
+ * @param[in]  data         The value to set.
+ * @param[in]  length       Length of value to set, in bytes;
+ *
+ * @return  NVDS_OK                 Operation staged
+ *          NVDS_E_INVAL_PARAM      Parameter is invalid, such key, namespace has illegal length
+ *          NVDS_E_NO_SPACE         No memory to stage, or staged elements exceed one page
+ ****************************************************************************************
+ */
+int nvds_txn_put(void *txn, const char *namespace, const char *key, uint8_t *data, uint32_t length);
+
+/**
+ ****************************************************************************************
+ * @brief      Stage deletion of element with given key name and namespace in transaction
+ *
+ * @param[in]  txn          Handle of the transaction
+ * @param[in]  namespace    Namespace of the element, NULL is for default namespace.
+ * @param[in]  key          Key name, shouldn't be empty.
+ *
+ * @return  NVDS_OK                 Operation staged
+ *          NVDS_E_INVAL_PARAM      Parameter is invalid, such key, namespace has illegal length
+ *          NVDS_E_NO_SPACE         No memory to stage, or staged elements exceed one page
+ ****************************************************************************************
+ */
+int nvds_txn_del(void *txn, const char *namespace, const char *key);
+
+/**
+ ****************************************************************************************
+ * @brief      Commit all staged operations of transaction and release it
+ *
+ * @param[in]  txn          Handle of the transaction
+ *
+ * @return  NVDS_OK                 All operations are committed
+ *          NVDS_E_FAIL             Generic nvds fail status
+ *          NVDS_E_FLASH_IO_FAIL    Flash api, such as flash read/write/erase operation fail
+ *          NVDS_E_NO_SPACE         Staged elements can not fit in the available space,
+ *                                  nothing is committed
+ ****************************************************************************************
+ */
+int nvds_txn_commit(void *txn);
+
+/**
+ ****************************************************************************************
+ * @brief      Drop all staged operations of transaction and release it
+ *
+ * @param[in]  txn          Handle of the transaction
+ ****************************************************************************************
+ */
+void nvds_txn_abort(void *txn);
+
+/**
+ ****************************************************************************************
+ * @brief      Set the number of free pages background garbage collection keeps
+ *
+ * Default is NVDS_GC_SPARE_PAGES. With one spare page, pages are only compacted
+ * synchronously when the last free page is requested by a write. Pages are compacted
+ * by an idle priority task created on first need, unless NVDS_GC_TASK_STACK_SIZE is 0.
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL for internal nvds
+ * @param[in]  spare_pages  Free page count to keep, less than the page count of nvds
+ *
+ * @return  NVDS_OK                 Set ok
+ *          NVDS_E_FAIL             Generic nvds fail status
+ *          NVDS_E_INVAL_PARAM      Invalid spare page count
+ ****************************************************************************************
+ */
+int nvds_gc_spare_set(void *handle, uint8_t spare_pages);
+
+/**
+ ****************************************************************************************
+ * @brief      Run one step of background garbage collection
+ *
+ * Moves used elements of the page being compacted, at most max_entries entries per
+ * step but at least one element, and erases the page in a step of its own once it
+ * is empty. Only needed when NVDS_GC_TASK_STACK_SIZE is 0, the application then
+ * calls it from an idle or low priority task.
+ *
+ * @param[in]  handle       Handle of the nvds flash operation, NULL for internal nvds
+ * @param[in]  max_entries  Maximum entries to move in this step
+ * @param[out] more         Set to 1 if more steps are needed, can be NULL
+ *
+ * @return  NVDS_OK                 Step done
+ *          NVDS_E_FAIL             Generic nvds fail status
+ *          NVDS_E_FLASH_IO_FAIL    Flash api, such as flash read/write/erase operation fail
+ *          NVDS_E_NO_SPACE         No page to move elements to
+ ****************************************************************************************
+ */
+int nvds_gc_step(void *handle, uint32_t max_entries, uint8_t *more);
+
 /**
  ****************************************************************************************
  * @brief      Erase nvds flash by label
@@ -74,6 +74,8 @@ OF SUCH DAMAGE.
 // Max entry count of one page
 // Page header and entry states table will take 32*2 bytes
 #define ENTRY_COUNT_PER_PAGE            ((SPI_FLASH_SEC_SIZE / ENTRY_SIZE) - 2)
+// Entry not copied by page compaction
+#define ENTRY_MAP_NONE                  0xFF
 // Entry states table
 #define ENTRY_STATES_TABLE_SIZE         (ENTRY_SIZE / sizeof(uint32_t))
 
@@ -113,6 +115,9 @@ OF SUCH DAMAGE.
 // Mask of the frag no field
 #define TAG_FRAG_NO_MSK                 (0x1F << TAG_FRAG_NO_OFT)
 #define TAG_FRAG_NO_DEFAULT             0x1F
+// Small / middle element written by transaction, it supersedes older element with same key.
+// Small element with zero length written by transaction is a delete marker.
+#define TAG_FRAG_NO_TXN                 0x1E
 
 // namespace definition
 #define NAMESPACE_DEFINE_IDX            0
@@ -129,6 +134,38 @@ OF SUCH DAMAGE.
 #define AES_KEY_SZ                      16
 #define AES_BLOCK_SZ                    AES_KEY_SZ
 
+// Element index in RAM, maps (namespace, key) to element header entry location.
+// Initial number of index slots, must be power of 2, each slot takes 8 bytes. 0 to disable index.
+// The slots are doubled when 3/4 are used, up to 65536. If memory is short the index is dropped,
+// lookups scan the flash and the index is rebuilt after the next page compaction.
+#ifndef NVDS_INDEX_SLOT_NUM
+#define NVDS_INDEX_SLOT_NUM             256
+#endif
+#if (NVDS_INDEX_SLOT_NUM & (NVDS_INDEX_SLOT_NUM - 1)) || (NVDS_INDEX_SLOT_NUM > 0x10000)
+    #error "NVDS_INDEX_SLOT_NUM should be power of 2 and not larger than 65536!"
+#endif
+
+// Garbage collection
+// Free pages background gc keeps by default, 1 means pages are only compacted
+// synchronously when the last free page is requested
+#ifndef NVDS_GC_SPARE_PAGES
+#define NVDS_GC_SPARE_PAGES             2
+#endif
+// Stack size of the task running background gc at idle priority, 0 leaves calling
+// nvds_gc_step() to the application
+#ifndef NVDS_GC_TASK_STACK_SIZE
+#define NVDS_GC_TASK_STACK_SIZE         512
+#endif
+// Max entries background gc task moves before releasing nvds lock
+#ifndef NVDS_GC_STEP_ENTRIES
+#define NVDS_GC_STEP_ENTRIES            8
+#endif
+// Background gc only compacts page with at least this count of reclaimable entries,
+// pages with less are left to synchronous compaction to limit flash wear
+#ifndef NVDS_GC_RECLAIM_MIN
+#define NVDS_GC_RECLAIM_MIN             (ENTRY_COUNT_PER_PAGE / 4)
+#endif
+
 // #define NVDS_DEBUG
 
 #define NVDS_ERR_RET(cond, ret)         \
@@ -239,6 +276,18 @@ struct entry_hash
     uint32_t crc32;
 };
 
+struct nvds_index_slot
+{
+    // page of the element header entry, NULL indicate slot is empty
+    struct page_env_tag *page;
+    // low 16 bits of (namespace, key) hash
+    uint16_t hash;
+    // namespace index
+    uint8_t ns;
+    // element header entry index in page
+    uint8_t entry_idx;
+};
+
 struct page_env_tag
 {
     struct list_hdr list_hdr;
@@ -267,6 +316,54 @@ struct nvds_crypt_env {
     uint8_t key[AES_KEY_SZ];
 };
 
+struct nvds_txn_op {
+    struct list_hdr list_hdr;
+    // namespace name, valid when ns_null is false
+    char ns[KEY_NAME_MAX_SIZE];
+    bool ns_null;
+    // key name
+    char key[KEY_NAME_MAX_SIZE];
+    // value length, 0 indicate delete
+    uint32_t length;
+    // namespace index, resolved when commit
+    uint8_t ns_idx;
+    // nothing to write, same value stored or key to delete not found
+    bool skip;
+    // old element is bulk element
+    bool old_bulk;
+    // old element header entry index and entry count
+    uint8_t old_idx;
+    uint8_t old_cnt;
+    // page of old element, NULL indicate no old element
+    struct page_env_tag *old_page;
+    // new header entry index in commit page
+    uint8_t new_idx;
+    // value to put
+    uint8_t data[];
+};
+
+struct nvds_txn {
+    // nvds flash the transaction operates on
+    struct nvds_flash_env_tag *flash_env;
+    // staged operation list
+    struct list op_list;
+    // entry count needed by staged operations
+    uint16_t entry_cnt;
+};
+
+struct nvds_gc_stats {
+    // background gc steps run
+    uint32_t bg_steps;
+    // entries moved by background gc
+    uint32_t bg_moved;
+    // pages erased by background gc
+    uint32_t bg_erased;
+    // synchronous compactions done when requesting new page
+    uint32_t sync_cnt;
+    // entries moved by synchronous compactions
+    uint32_t sync_moved;
+};
+
 struct nvds_flash_env_tag {
     struct list_hdr list_hdr;
     // label for one nvda flash storage, zero-ter
@@ -288,6 +385,24 @@ struct nvds_flash_env_tag {
     struct list nvds_page_free;
     // used page list
     struct list nvds_page_used;
+
+    // element index table, NULL indicate index is not available
+    struct nvds_index_slot *index;
+    // used index slot count
+    uint16_t index_cnt;
+    // index slot count minus 1
+    uint16_t index_msk;
+    // index dropped for lack of memory, rebuilt after the next page compaction
+    bool index_lost;
+
+    // page being compacted by background gc, NULL indicate none
+    struct page_env_tag *gc_page;
+    // next entry of gc page to move
+    uint32_t gc_entry_idx;
+    // free page count background gc keeps
+    uint8_t gc_spare;
+    // gc statistics
+    struct nvds_gc_stats gc_stats;
 };
 
 #endif /* _NVDS_TYPE_H_ */
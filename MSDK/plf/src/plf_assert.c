@@ -71,6 +71,9 @@ void plf_assert_err(const char *condition, const char * file, int line)
 
     co_printf("ASSERT ERROR: in %s at line %d\r\n", file, line);
 
+    // Output the logs still queued by a deferred co_printf
+    co_printf_flush();
+
     // Let time for the message transfer
     for (i = 0; i<2000;i++){plf_asrt_block = 1;};
 
@@ -85,6 +88,9 @@ void plf_assert_param(int param0, int param1, const char * file, int line)
 
     co_printf("ASSERT ERROR: param0 0x%08x param1 0x%08x, in %s at line %d\r\n", param0, param1, file, line);
 
+    // Output the logs still queued by a deferred co_printf
+    co_printf_flush();
+
     // Let time for the message transfer
     for (i = 0; i<2000;i++){plf_asrt_block = 1;};
 
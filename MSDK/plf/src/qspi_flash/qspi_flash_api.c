@@ -33,13 +33,26 @@ OF SUCH DAMAGE.
 */
 
 #include <stdio.h>
+#include "app_cfg.h"
 #include "gd32vw55x.h"
 #include "qspi_flash_api.h"
 #include "wrapper_os.h"
 #include "ll.h"
 
 #define QSPI_FLASH_TEST                     0
+/* Quad I/O fast read (0xEB) and quad page program, needs IO2/IO3 wired to the flash,
+   the QE bit is only handled for the 2M flash */
+#ifndef QSPI_QUAD_EN
 #define QSPI_QUAD_EN                        0
+#endif
+
+/* Completion of the status polling and of the DMA is signaled by interrupts, the
+   handlers are installed in gd32vw55x_it.c when the external flash is in use */
+#ifdef USE_QSPI_FLASH
+#define QSPI_IRQ_EN                         1
+#else
+#define QSPI_IRQ_EN                         0
+#endif
 
 #if (QSPI_FLASH_MEM == 16)
 #define QSPI_FLASH_TOTAL_SIZE               (0x1000000)
@@ -50,12 +63,36 @@ OF SUCH DAMAGE.
 #endif
 
 #define QSPI_FLASH_SECTOR_SIZE              0x1000
+#define QSPI_FLASH_BLOCK32_SIZE             0x8000
+#define QSPI_FLASH_BLOCK64_SIZE             0x10000
 
 #define QSPI_MEMORY_MAP_BASE_ADDR           0x90000000
 
 
 #define QSPI_POLLING_CYCLES                 0x10
 
+/* DMA channel copying from the memory mapped window, memory to memory mode so the
+   channel needs no request mapping */
+#define QSPI_DMA_CH                         DMA_CH4
+#define QSPI_DMA_IRQn                       DMA_Channel4_IRQn
+/* Reads shorter than this are copied by the CPU, setting up the DMA costs more than it saves */
+#define QSPI_DMA_THRESHOLD                  64
+/* Largest number of items moved by one DMA transfer, the channel counter is 16 bits wide */
+#define QSPI_DMA_MAX_NUM                    0xFFFF
+/* Only the SRAM can be written by the DMA, other buffers go through the CPU */
+#define QSPI_DMA_ADDR_VALID(addr)           (((uint32_t)(addr) >= SRAM_BASE) && \
+                                             ((uint32_t)(addr) < (SRAM_BASE + 0x00050000U)))
+
+/* Worst case durations, in ms, before an operation is aborted */
+#define QSPI_PROGRAM_TIMEOUT                100
+#define QSPI_ERASE_TIMEOUT                  3000
+#define QSPI_DMA_TIMEOUT                    100
+
+/* Depth of the asynchronous request queue and its worker task */
+#define QSPI_REQ_QUEUE_SIZE                 8
+#define QSPI_TASK_STACK_SIZE                512
+#define QSPI_TASK_PRIO                      OS_TASK_PRIORITY(1)
+
 #define WRITE_STATUS_REG                    (0x01)
 #define WRITE_ENABLE_CMD                    (0x06)
 #define PAGE_PROG_CMD                       (0x02)
@@ -64,6 +101,8 @@ OF SUCH DAMAGE.
 #define QUAD_READ_CMD                       (0xEB)
 
 #define SECTOR_ERASE_CMD                    (0x20)
+#define BLOCK32_ERASE_CMD                   (0x52)
+#define BLOCK64_ERASE_CMD                   (0xD8)
 #define READ_STATUS_REG1_CMD                (0x05)
 #define READ_STATUS_REG2_CMD                (0x35)
 #define CHIP_ERASE_CMD                      (0xC7)
@@ -96,6 +135,30 @@ uint8_t rx_buffer[BUF_SIZE];
 uint8_t rx_buffer_sector[4096];
 #endif
 
+enum {
+    QSPI_REQ_READ,
+    QSPI_REQ_WRITE,
+    QSPI_REQ_ERASE
+};
+
+typedef struct {
+    uint8_t type;
+    uint32_t offset;
+    uint8_t *data;
+    int len;
+    qspi_flash_cb_t cb;
+    void *arg;
+} qspi_flash_req_t;
+
+static struct {
+    os_mutex_t lock;                /* serializes the users of the controller */
+    os_sema_t done;                 /* given by the QSPI and DMA interrupts */
+    os_queue_t req_queue;           /* pending asynchronous requests */
+    void *task;                     /* worker serving req_queue */
+    volatile int status;            /* result of the last interrupt driven wait */
+    uint8_t os_ready;
+} qspi_ctx;
+
 static qspi_command_struct qspi_cmd;
 static qspi_polling_struct polling_cmd;
 
@@ -159,6 +222,96 @@ static void qspi_polling_match_not_wip(void)
     qspi_polling_config(&qspi_cmd, &polling_cmd);
 }
 
+#if QSPI_IRQ_EN
+/*!
+    \brief      drop a completion signaled after its waiter gave up
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void qspi_done_drain(void)
+{
+    if (sys_sema_get_count(&qspi_ctx.done) > 0) {
+        sys_sema_down(&qspi_ctx.done, 0);
+    }
+}
+#endif
+
+/*!
+    \brief      wait for the end of a program or erase operation
+    \param[in]  timeout_ms: longest wait before the status polling is aborted, 0 means forever
+    \param[out] none
+    \retval     0 on success, -1 on timeout or transfer error
+*/
+static int qspi_wait_not_wip(uint32_t timeout_ms)
+{
+#if QSPI_IRQ_EN
+    if (qspi_ctx.os_ready) {
+        /* sleep until the controller reads a status with WIP cleared */
+        qspi_ctx.status = 0;
+        qspi_flag_clear(QSPI_FLAG_RPMF | QSPI_FLAG_TERR);
+        qspi_interrupt_enable(QSPI_INT_RPMF | QSPI_INT_TERR);
+        qspi_polling_match_not_wip();
+
+        if (sys_sema_down(&qspi_ctx.done, timeout_ms) != OS_OK) {
+            qspi_interrupt_disable(QSPI_INT_RPMF | QSPI_INT_TERR);
+            qspi_transmission_abort();
+            while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+            }
+            qspi_done_drain();
+            return -1;
+        }
+        /* the polling stops on match, BUSY is released right after */
+        while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+        }
+        return qspi_ctx.status;
+    }
+#endif
+    qspi_polling_match_not_wip();
+    /* wait for the BUSY flag to be reset */
+    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+    }
+    return 0;
+}
+
+/*!
+    \brief      wait for the end of the DMA transfer started on QSPI_DMA_CH
+    \param[in]  none
+    \param[out] none
+    \retval     0 on success, -1 on timeout or transfer error
+*/
+static int qspi_dma_wait(void)
+{
+    int ret = 0;
+
+#if QSPI_IRQ_EN
+    if (qspi_ctx.os_ready) {
+        if (sys_sema_down(&qspi_ctx.done, QSPI_DMA_TIMEOUT) != OS_OK) {
+            dma_interrupt_disable(QSPI_DMA_CH, DMA_INT_FTF | DMA_INT_TAE);
+            dma_channel_disable(QSPI_DMA_CH);
+            qspi_done_drain();
+            ret = -1;
+        } else {
+            ret = qspi_ctx.status;
+        }
+        goto exit;
+    }
+#endif
+    while (RESET == dma_flag_get(QSPI_DMA_CH, DMA_FLAG_FTF)) {
+        if (RESET != dma_flag_get(QSPI_DMA_CH, DMA_FLAG_TAE)) {
+            dma_channel_disable(QSPI_DMA_CH);
+            ret = -1;
+            break;
+        }
+    }
+
+#if QSPI_IRQ_EN
+exit:
+#endif
+    dma_flag_clear(QSPI_DMA_CH, DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_TAE | DMA_FLAG_FEE);
+    return ret;
+}
+
 static void qspi_polling_match_qe(bool enable)
 {
     polling_cmd.match            = enable ? STATUS_REG_QE_VAL : 0x00;
@@ -179,6 +332,24 @@ static void qspi_flash_quad_enable(void)
 #if (QSPI_FLASH_MEM == 2)
     // FIX TODO status register may need to read value first
     uint8_t write_status[2] ={0x00,0x02};
+    uint8_t status2 = 0;
+
+    /* QE is non-volatile, do not rewrite the status register at every boot */
+    qspi_cmd.instruction      = READ_STATUS_REG2_CMD;
+    qspi_cmd.instruction_mode = QSPI_INSTRUCTION_1_LINE;
+    qspi_cmd.addr_mode        = QSPI_ADDR_NONE;
+    qspi_cmd.altebytes_mode   = QSPI_ALTE_BYTES_NONE;
+    qspi_cmd.data_mode        = QSPI_DATA_1_LINE;
+    qspi_cmd.data_length      = 1;
+    qspi_cmd.dummycycles      = 0;
+    qspi_cmd.sioo_mode        = QSPI_SIOO_INST_EVERY_CMD;
+    qspi_command_config(&qspi_cmd);
+    qspi_data_receive(&status2);
+    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+    }
+    if ((status2 & STATUS_REG_QE_MSK) == STATUS_REG_QE_VAL) {
+        return;
+    }
 
     /* QSPI write enable */
     qspi_write_enable();
@@ -460,13 +631,18 @@ static void qspi_memory_map_read(void)
 
 /*!
     \brief      read spi flash
-    \param[in]  none
-    \param[out] none
+    \param[in]  offset: flash offset
+    \param[in]  len: number of bytes to read
+    \param[out] data: pointer to the read data
     \retval     none
 */
 static void qspi_flash_memory_read(uint32_t offset, uint8_t *data, uint32_t len)
 {
+#if QSPI_QUAD_EN
+    qspi_send_command(QUAD_READ_CMD, offset, 4, QSPI_INSTRUCTION_1_LINE, QSPI_ADDR_4_LINES, QSPI_ADDR_24_BITS, QSPI_DATA_4_LINES, QSPI_ALTE_BYTES_4_LINES, QSPI_ALTE_BYTES_8_BITS, len);
+#else
     qspi_send_command(READ_CMD, offset, 0, QSPI_INSTRUCTION_1_LINE, QSPI_ADDR_1_LINE, QSPI_ADDR_24_BITS, QSPI_DATA_1_LINE, QSPI_ALTE_BYTES_NONE, QSPI_ALTE_BYTES_8_BITS, len);
+#endif
     // QSPI_DTLEN = (uint32_t)(len - 1);
     qspi_data_receive((uint8_t *)data);
     while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
@@ -474,12 +650,70 @@ static void qspi_flash_memory_read(uint32_t offset, uint8_t *data, uint32_t len)
 }
 
 /*!
-    \brief      qspi flash sector erase
-    \param[in]  none
+    \brief      copy from the memory mapped window with the DMA
+    \param[in]  src: address in the memory mapped window
+    \param[in]  len: number of bytes to copy
+    \param[out] data: SRAM destination
+    \retval     0 on success, -1 on error
+*/
+static int qspi_flash_dma_read(uint32_t src, uint8_t *data, uint32_t len)
+{
+    dma_multi_data_parameter_struct dma_init_parameter;
+    /* word transfers when both ends allow it, the window is read at the quad I/O rate */
+    uint32_t width = (((src | (uint32_t)data | len) & 0x3) == 0) ? 4 : 1;
+    uint32_t num;
+
+    while (len > 0) {
+        num = len / width;
+        if (num > QSPI_DMA_MAX_NUM) {
+            num = QSPI_DMA_MAX_NUM;
+        }
+
+        dma_deinit(QSPI_DMA_CH);
+        dma_multi_data_para_struct_init(&dma_init_parameter);
+        dma_init_parameter.periph_addr = src;
+        dma_init_parameter.periph_width = (width == 4) ? DMA_PERIPH_WIDTH_32BIT : DMA_PERIPH_WIDTH_8BIT;
+        dma_init_parameter.periph_inc = DMA_PERIPH_INCREASE_ENABLE;
+        dma_init_parameter.memory0_addr = (uint32_t)data;
+        dma_init_parameter.memory_width = (width == 4) ? DMA_MEMORY_WIDTH_32BIT : DMA_MEMORY_WIDTH_8BIT;
+        dma_init_parameter.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+        dma_init_parameter.memory_burst_width = DMA_MEMORY_BURST_SINGLE;
+        dma_init_parameter.periph_burst_width = DMA_PERIPH_BURST_SINGLE;
+        dma_init_parameter.critical_value = DMA_FIFO_4_WORD;
+        dma_init_parameter.circular_mode = DMA_CIRCULAR_MODE_DISABLE;
+        dma_init_parameter.direction = DMA_MEMORY_TO_MEMORY;
+        dma_init_parameter.number = num;
+        dma_init_parameter.priority = DMA_PRIORITY_HIGH;
+        dma_multi_data_mode_init(QSPI_DMA_CH, &dma_init_parameter);
+
+#if QSPI_IRQ_EN
+        if (qspi_ctx.os_ready) {
+            qspi_ctx.status = 0;
+            dma_interrupt_enable(QSPI_DMA_CH, DMA_INT_FTF | DMA_INT_TAE);
+        }
+#endif
+        dma_channel_enable(QSPI_DMA_CH);
+        if (qspi_dma_wait()) {
+            return -1;
+        }
+
+        num *= width;
+        src += num;
+        data += num;
+        len -= num;
+    }
+
+    return 0;
+}
+
+/*!
+    \brief      qspi flash sector or block erase
+    \param[in]  cmd: SECTOR_ERASE_CMD, BLOCK32_ERASE_CMD or BLOCK64_ERASE_CMD
+    \param[in]  offset: start of the erased area, aligned on its size
     \param[out] none
-    \retval     none
+    \retval     0 on success, -1 on error
 */
-static void qspi_flash_sector_erase(uint32_t offset)
+static int qspi_flash_block_erase(uint32_t cmd, uint32_t offset)
 {
     /* QSPI write enable */
     qspi_write_enable();
@@ -490,24 +724,22 @@ static void qspi_flash_sector_erase(uint32_t offset)
     /* wait for the BUSY flag to be reset */
     while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
     }
-    qspi_send_command(SECTOR_ERASE_CMD, offset, 0, QSPI_INSTRUCTION_1_LINE, QSPI_ADDR_1_LINE,
+    qspi_send_command(cmd, offset, 0, QSPI_INSTRUCTION_1_LINE, QSPI_ADDR_1_LINE,
                         QSPI_ADDR_24_BITS, QSPI_DATA_NONE, QSPI_ALTE_BYTES_NONE, QSPI_ALTE_BYTES_8_BITS, 0);
-    qspi_polling_match_not_wip();
-    /* wait for the BUSY flag to be reset */
-    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
-    }
+
+    return qspi_wait_not_wip(QSPI_ERASE_TIMEOUT);
 }
 
 /*!
     \brief      qspi flash program
-    \param[in]  none
+    \param[in]  offset: flash offset
+    \param[in]  data: pointer to the data, must not cross a page boundary
+    \param[in]  len: number of bytes to program
     \param[out] none
-    \retval     none
+    \retval     0 on success, -1 on error
 */
-static void qspi_flash_program(uint32_t offset, uint8_t *data, int len)
+static int qspi_flash_program(uint32_t offset, uint8_t *data, int len)
 {
-    uint16_t num_of_page = 0, num_of_single = 0, addr = 0, count = 0, temp = 0;
-
     /* QSPI write enable */
     qspi_write_enable();
     while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
@@ -533,10 +765,8 @@ static void qspi_flash_program(uint32_t offset, uint8_t *data, int len)
     }
     /* clear the TC flag */
     qspi_flag_clear(QSPI_FLAG_TC);
-    qspi_polling_match_not_wip();
-    /* wait for the BUSY flag to be reset */
-    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
-    }
+
+    return qspi_wait_not_wip(QSPI_PROGRAM_TIMEOUT);
 }
 
 static uint32_t qspi_flash_total_size(void)
@@ -553,80 +783,176 @@ static int qspi_flash_is_valid_offset(uint32_t offset)
     return 0;
 }
 
-
-int qspi_flash_erase(uint32_t offset, int len)
+/*!
+    \brief      take the controller, the lock exists once the OS objects are created
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void qspi_flash_lock(void)
 {
-    uint16_t i, num_of_sector;
-    if (!qspi_flash_is_valid_offset(offset)
-        || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
-        return -1;
+    if (qspi_ctx.lock) {
+        sys_mutex_get(&qspi_ctx.lock);
     }
+}
 
-    //printf("qspi_flash_erase offset 0x%x, len %d \r\n", offset, len);
-    num_of_sector = (len / QSPI_FLASH_SECTOR_SIZE);
-    if ((len % QSPI_FLASH_SECTOR_SIZE) != 0)
-        num_of_sector++;
+/*!
+    \brief      release the controller
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+static void qspi_flash_unlock(void)
+{
+    if (qspi_ctx.lock) {
+        sys_mutex_put(&qspi_ctx.lock);
+    }
+}
 
-    for (i = 0; i < num_of_sector; i++) {
-        qspi_flash_sector_erase(offset + i * QSPI_FLASH_SECTOR_SIZE);
+/*!
+    \brief      erase the sectors covering a range, with the largest erase each step allows
+    \param[in]  offset: start of the range
+    \param[in]  len: length of the range in bytes
+    \param[out] none
+    \retval     0 on success, -1 on error
+*/
+static int qspi_flash_erase_range(uint32_t offset, int len)
+{
+    uint32_t addr = offset & ~(QSPI_FLASH_SECTOR_SIZE - 1);
+    uint32_t end = offset + len;
+    uint32_t remain;
+
+    while (addr < end) {
+        remain = end - addr;
+        /* 64K and 32K erases take about the time of two to four sector erases */
+        if (((addr & (QSPI_FLASH_BLOCK64_SIZE - 1)) == 0) && (remain >= QSPI_FLASH_BLOCK64_SIZE)) {
+            if (qspi_flash_block_erase(BLOCK64_ERASE_CMD, addr)) {
+                return -1;
+            }
+            addr += QSPI_FLASH_BLOCK64_SIZE;
+        } else if (((addr & (QSPI_FLASH_BLOCK32_SIZE - 1)) == 0) && (remain >= QSPI_FLASH_BLOCK32_SIZE)) {
+            if (qspi_flash_block_erase(BLOCK32_ERASE_CMD, addr)) {
+                return -1;
+            }
+            addr += QSPI_FLASH_BLOCK32_SIZE;
+        } else {
+            if (qspi_flash_block_erase(SECTOR_ERASE_CMD, addr)) {
+                return -1;
+            }
+            addr += QSPI_FLASH_SECTOR_SIZE;
+        }
     }
-    //printf("qspi_flash_erase offset 0x%x, len %d end\r\n", offset, len);
 
     return 0;
 }
 
-int qspi_flash_write(uint32_t offset, uint8_t *data, int len)
+/*!
+    \brief      program a range, split on the flash page boundaries
+    \param[in]  offset: start of the range
+    \param[in]  data: pointer to the data
+    \param[in]  len: length of the range in bytes
+    \param[out] none
+    \retval     0 on success, -1 on error
+*/
+static int qspi_flash_write_range(uint32_t offset, uint8_t *data, int len)
 {
-    if (!qspi_flash_is_valid_offset(offset) || data == NULL
-        || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
-        return -1;
+    int size;
+
+    while (len > 0) {
+        /* a page program wraps around inside the page, never cross its end */
+        size = SPI_FLASH_PAGE_SIZE - (offset & (SPI_FLASH_PAGE_SIZE - 1));
+        if (size > len) {
+            size = len;
+        }
+        if (qspi_flash_program(offset, data, size)) {
+            return -1;
+        }
+        offset += size;
+        data += size;
+        len -= size;
     }
-    // printf("qspi_flash_write offset 0x%x, len %d \r\n", offset, len);
 
-    uint16_t num_of_page = len / SPI_FLASH_PAGE_SIZE;
-    uint8_t num_of_single = len % SPI_FLASH_PAGE_SIZE;
+    return 0;
+}
+
+/*!
+    \brief      read a range through the memory mapped window
+    \param[in]  offset: start of the range
+    \param[in]  len: length of the range in bytes
+    \param[out] data: pointer to the read data
+    \retval     0 on success, -1 on error
+*/
+static int qspi_flash_read_range(uint32_t offset, uint8_t *data, int len)
+{
+    int ret = 0;
+
+    qspi_memory_map_read();
 
-    while(num_of_page) {
-        qspi_flash_program(offset, data, SPI_FLASH_PAGE_SIZE);
-        offset += SPI_FLASH_PAGE_SIZE;
-        data += SPI_FLASH_PAGE_SIZE;
-        num_of_page--;
+    if ((len >= QSPI_DMA_THRESHOLD) && QSPI_DMA_ADDR_VALID(data)) {
+        ret = qspi_flash_dma_read(QSPI_MEMORY_MAP_BASE_ADDR + offset, data, len);
+    } else {
+        sys_memcpy(data, (void *)(QSPI_MEMORY_MAP_BASE_ADDR + offset), len);
     }
 
-    if (num_of_single) {
-        qspi_flash_program(offset, data, num_of_single);
+    /* wait for the BUSY flag to be reset */
+    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
     }
 
-    //printf("qspi_flash_write offset 0x%x, len %d end\r\n", offset, len);
-    return 0;
+    return ret;
 }
 
+int qspi_flash_erase(uint32_t offset, int len)
+{
+    int ret;
+
+    if (!qspi_flash_is_valid_offset(offset)
+        || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
+        return -1;
+    }
 
-int qspi_flash_read(uint32_t offset, uint8_t *data, int len)
+    qspi_flash_lock();
+    ret = qspi_flash_erase_range(offset, len);
+    qspi_flash_unlock();
+
+    return ret;
+}
+
+int qspi_flash_write(uint32_t offset, uint8_t *data, int len)
 {
-    int i;
+    int ret;
+
     if (!qspi_flash_is_valid_offset(offset) || data == NULL
         || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
         return -1;
     }
 
-    //printf("qspi_flash_read offset 0x%x, len %d \r\n", offset, len);
-    qspi_memory_map_read();
+    qspi_flash_lock();
+    ret = qspi_flash_write_range(offset, data, len);
+    qspi_flash_unlock();
 
-    for(i = 0; i < len; i++) {
-        data[i] = *(uint8_t *)(QSPI_MEMORY_MAP_BASE_ADDR + offset + i);
-    }
+    return ret;
+}
 
-    /* wait for the BUSY flag to be reset */
-    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+int qspi_flash_read(uint32_t offset, uint8_t *data, int len)
+{
+    int ret;
+
+    if (!qspi_flash_is_valid_offset(offset) || data == NULL
+        || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
+        return -1;
     }
 
-    //printf("qspi_flash_read offset 0x%x, len %d end\r\n", offset, len);
-    return 0;
+    qspi_flash_lock();
+    ret = qspi_flash_read_range(offset, data, len);
+    qspi_flash_unlock();
+
+    return ret;
 }
 
 void qspi_flash_chip_erase(void)
 {
+    qspi_flash_lock();
+
     /* QSPI write enable */
     qspi_write_enable();
     while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
@@ -644,20 +970,219 @@ void qspi_flash_chip_erase(void)
     while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
     }
 
-    qspi_polling_match_not_wip();
-    /* wait for the BUSY flag to be reset */
-    while(RESET != qspi_flag_get(QSPI_FLAG_BUSY)) {
+    /* a chip erase lasts several seconds, wait without timeout */
+    qspi_wait_not_wip(0);
+
+    qspi_flash_unlock();
+}
+
+/*!
+    \brief      serve the asynchronous requests
+    \param[in]  param: not used
+    \param[out] none
+    \retval     none
+*/
+static void qspi_flash_task(void *param)
+{
+    qspi_flash_req_t req;
+    int ret;
+
+    (void)param;
+
+    for (;;) {
+        if (sys_queue_read(&qspi_ctx.req_queue, &req, -1, false)) {
+            continue;
+        }
+
+        qspi_flash_lock();
+        switch (req.type) {
+        case QSPI_REQ_READ:
+            ret = qspi_flash_read_range(req.offset, req.data, req.len);
+            break;
+        case QSPI_REQ_WRITE:
+            ret = qspi_flash_write_range(req.offset, req.data, req.len);
+            break;
+        case QSPI_REQ_ERASE:
+            ret = qspi_flash_erase_range(req.offset, req.len);
+            break;
+        default:
+            ret = -1;
+            break;
+        }
+        qspi_flash_unlock();
+
+        if (req.cb) {
+            req.cb(ret, req.arg);
+        }
+    }
+}
+
+/*!
+    \brief      queue a request for the worker task
+    \param[in]  type: QSPI_REQ_READ, QSPI_REQ_WRITE or QSPI_REQ_ERASE
+    \param[in]  offset: flash offset
+    \param[in]  data: data buffer, NULL for an erase
+    \param[in]  len: length in bytes
+    \param[in]  cb: completion callback, may be NULL
+    \param[in]  arg: argument given to the callback
+    \param[out] none
+    \retval     0 if the request is queued, -1 otherwise
+*/
+static int qspi_flash_req_post(uint8_t type, uint32_t offset, uint8_t *data, int len,
+                               qspi_flash_cb_t cb, void *arg)
+{
+    qspi_flash_req_t req;
+
+    if (!qspi_flash_is_valid_offset(offset) || (type != QSPI_REQ_ERASE && data == NULL)
+        || len <= 0 || !qspi_flash_is_valid_offset(offset + len - 1)) {
+        return -1;
+    }
+    if (!qspi_ctx.os_ready) {
+        return -1;
+    }
+
+    /* the worker is only started for the first asynchronous user */
+    if (qspi_ctx.task == NULL) {
+        qspi_flash_lock();
+        if (qspi_ctx.task == NULL) {
+            qspi_ctx.task = sys_task_create_dynamic((const uint8_t *)"qspi flash", QSPI_TASK_STACK_SIZE,
+                                                    QSPI_TASK_PRIO, qspi_flash_task, NULL);
+        }
+        qspi_flash_unlock();
+        if (qspi_ctx.task == NULL) {
+            return -1;
+        }
+    }
+
+    req.type = type;
+    req.offset = offset;
+    req.data = data;
+    req.len = len;
+    req.cb = cb;
+    req.arg = arg;
+
+    /* never block the caller, a full queue is reported instead */
+    if (sys_queue_write(&qspi_ctx.req_queue, &req, 0, false)) {
+        return -1;
     }
+
+    return 0;
+}
+
+/*!
+    \brief      queue an erase of the sectors covering a range
+    \param[in]  offset: start of the range
+    \param[in]  len: length of the range in bytes
+    \param[in]  cb: called from the worker task with 0 or -1 once done, may be NULL
+    \param[in]  arg: argument given to cb
+    \param[out] none
+    \retval     0 if the request is queued, -1 otherwise
+*/
+int qspi_flash_erase_async(uint32_t offset, int len, qspi_flash_cb_t cb, void *arg)
+{
+    return qspi_flash_req_post(QSPI_REQ_ERASE, offset, NULL, len, cb, arg);
 }
 
+/*!
+    \brief      queue a write, data must stay valid until cb is called
+    \param[in]  offset: flash offset
+    \param[in]  data: pointer to the data
+    \param[in]  len: length in bytes
+    \param[in]  cb: called from the worker task with 0 or -1 once done, may be NULL
+    \param[in]  arg: argument given to cb
+    \param[out] none
+    \retval     0 if the request is queued, -1 otherwise
+*/
+int qspi_flash_write_async(uint32_t offset, uint8_t *data, int len, qspi_flash_cb_t cb, void *arg)
+{
+    return qspi_flash_req_post(QSPI_REQ_WRITE, offset, data, len, cb, arg);
+}
+
+/*!
+    \brief      queue a read, data is filled when cb is called
+    \param[in]  offset: flash offset
+    \param[in]  len: length in bytes
+    \param[in]  cb: called from the worker task with 0 or -1 once done, may be NULL
+    \param[in]  arg: argument given to cb
+    \param[out] data: pointer to the read data
+    \retval     0 if the request is queued, -1 otherwise
+*/
+int qspi_flash_read_async(uint32_t offset, uint8_t *data, int len, qspi_flash_cb_t cb, void *arg)
+{
+    return qspi_flash_req_post(QSPI_REQ_READ, offset, data, len, cb, arg);
+}
+
+/*!
+    \brief      QSPI interrupt, end of the status polling
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void qspi_flash_irq_hdl(void)
+{
+    if (RESET != qspi_flag_get(QSPI_FLAG_TERR)) {
+        qspi_ctx.status = -1;
+    }
+    qspi_interrupt_disable(QSPI_INT_RPMF | QSPI_INT_TERR);
+    qspi_flag_clear(QSPI_FLAG_RPMF | QSPI_FLAG_TERR);
+
+    sys_sema_up_from_isr(&qspi_ctx.done);
+}
+
+/*!
+    \brief      DMA interrupt, end of a read from the memory mapped window
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void qspi_flash_dma_irq_hdl(void)
+{
+    if (RESET != dma_flag_get(QSPI_DMA_CH, DMA_FLAG_TAE)) {
+        qspi_ctx.status = -1;
+        dma_channel_disable(QSPI_DMA_CH);
+    }
+    dma_interrupt_disable(QSPI_DMA_CH, DMA_INT_FTF | DMA_INT_TAE);
+    dma_flag_clear(QSPI_DMA_CH, DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_TAE | DMA_FLAG_FEE);
+
+    sys_sema_up_from_isr(&qspi_ctx.done);
+}
 
 void qspi_flash_api_init(void)
 {
     rcu_periph_clock_enable(RCU_GPIOA);
     rcu_periph_clock_enable(RCU_GPIOB);
     rcu_periph_clock_enable(RCU_QSPI);
+    rcu_periph_clock_enable(RCU_DMA);
 
+    qspi_flash_lock();
     qspi_flash_init();
+    qspi_flash_unlock();
+
+#if QSPI_IRQ_EN
+    /* called again on each mount, the OS objects are only created once */
+    if (!qspi_ctx.os_ready) {
+        if (sys_mutex_init(&qspi_ctx.lock) != OS_OK) {
+            return;
+        }
+        if (sys_sema_init(&qspi_ctx.done, 0) != OS_OK) {
+            goto err_sema;
+        }
+        if (sys_queue_init(&qspi_ctx.req_queue, QSPI_REQ_QUEUE_SIZE, sizeof(qspi_flash_req_t)) != OS_OK) {
+            goto err_queue;
+        }
+
+        eclic_irq_enable(QSPI_IRQn, 8, 0);
+        eclic_irq_enable(QSPI_DMA_IRQn, 8, 0);
+        qspi_ctx.os_ready = 1;
+    }
+    return;
+
+err_queue:
+    sys_sema_free(&qspi_ctx.done);
+err_sema:
+    sys_mutex_free(&qspi_ctx.lock);
+    qspi_ctx.lock = NULL;
+#endif
 }
 
 #if QSPI_FLASH_TEST
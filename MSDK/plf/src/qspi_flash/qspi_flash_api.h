@@ -35,10 +35,21 @@ OF SUCH DAMAGE.
 #ifndef _QSPI_FLASH_API_H_
 #define _QSPI_FLASH_API_H_
 
+/* completion of an asynchronous request, result is 0 on success and -1 on error */
+typedef void (*qspi_flash_cb_t)(int result, void *arg);
+
 void qspi_flash_api_init(void);
 int qspi_flash_erase(uint32_t offset, int len);
 int qspi_flash_write(uint32_t offset, uint8_t *data, int len);
 int qspi_flash_read(uint32_t offset, uint8_t *data, int len);
 void qspi_flash_chip_erase(void);
 
+/* queue a request to the QSPI worker task, the callback runs in that task */
+int qspi_flash_erase_async(uint32_t offset, int len, qspi_flash_cb_t cb, void *arg);
+int qspi_flash_write_async(uint32_t offset, uint8_t *data, int len, qspi_flash_cb_t cb, void *arg);
+int qspi_flash_read_async(uint32_t offset, uint8_t *data, int len, qspi_flash_cb_t cb, void *arg);
+
+void qspi_flash_irq_hdl(void);
+void qspi_flash_dma_irq_hdl(void);
+
 #endif
@@ -41,10 +41,25 @@ OF SUCH DAMAGE.
 #include "rom_export.h"
 #include "ll.h"
 #include "app_cfg.h"
+#include "systime.h"
+
+/* Erases are done one page at a time with the interrupts masked, the pending
+   interrupts and the higher priority tasks run between two pages */
+#define RAW_FLASH_ERASE_STEP        FLASH_PAGE_SIZE
+/* Size of the continuous program and of the reads with FMC_OFVR cleared done in one masked window */
+#define RAW_FLASH_PROGRAM_STEP      256
+#define RAW_FLASH_READ_STEP         1024
 
 // Flash erase callback list
 static struct list raw_erase_cb_list;
 
+// Longest and last time spent with the interrupts masked by a flash operation
+static struct
+{
+    uint32_t max_us;
+    uint32_t last_us;
+} raw_flash_masked;
+
 typedef struct
 {
     struct list_hdr hdr;
@@ -146,6 +161,67 @@ void raw_flash_offset_mapping(uint32_t of_spage, uint32_t of_epage, uint32_t of_
     fmc_lock();
 }
 
+/*!
+    \brief      record the time spent with the interrupts masked
+    \param[in]  start: time the interrupts were masked, in us
+    \param[out] none
+    \retval     none
+*/
+static void raw_flash_masked_record(uint64_t start)
+{
+    uint32_t duration = (uint32_t)(get_sys_local_time_us() - start);
+
+    raw_flash_masked.last_us = duration;
+    if (duration > raw_flash_masked.max_us) {
+        raw_flash_masked.max_us = duration;
+    }
+}
+
+/*!
+    \brief      get the interrupt latency added by the flash operations
+    \param[in]  none
+    \param[out] max_us: longest time the interrupts were masked, in us, may be NULL
+    \param[out] last_us: time of the last masked window, in us, may be NULL
+    \retval     none
+*/
+void raw_flash_irq_latency_get(uint32_t *max_us, uint32_t *last_us)
+{
+    if (max_us) {
+        *max_us = raw_flash_masked.max_us;
+    }
+    if (last_us) {
+        *last_us = raw_flash_masked.last_us;
+    }
+}
+
+/*!
+    \brief      restart the interrupt latency measurement
+    \param[in]  none
+    \param[out] none
+    \retval     none
+*/
+void raw_flash_irq_latency_reset(void)
+{
+    raw_flash_masked.max_us = 0;
+    raw_flash_masked.last_us = 0;
+}
+
+/*!
+    \brief      check if a range overlaps the offset mapping region
+    \param[in]  offset: flash offset
+    \param[in]  len: length of the range
+    \param[out] none
+    \retval     1 if some reads of the range are moved by FMC_OFVR, 0 otherwise
+*/
+static int raw_flash_in_offset_region(uint32_t offset, int len)
+{
+    uint32_t of_spage = FMC_OFRG & FMC_OFRG_OF_SPAGE;
+    uint32_t of_epage = (FMC_OFRG & FMC_OFRG_OF_EPAGE) >> 16;
+
+    return ((offset / FLASH_PAGE_SIZE) <= of_epage)
+            && (((offset + len - 1) / FLASH_PAGE_SIZE) >= of_spage);
+}
+
 /*!
     \brief      read flash
     \param[in]  offset: flash offset
@@ -155,7 +231,9 @@ void raw_flash_offset_mapping(uint32_t of_spage, uint32_t of_epage, uint32_t of_
 */
 int raw_flash_read(uint32_t offset, void *data, int len)
 {
-    int ret;
+    int ret = 0;
+    int size;
+    uint64_t start;
     uint32_t fmc_ofvr_temp = FMC_OFVR;
 
     if (!raw_flash_is_valid_offset(offset) || data == NULL
@@ -163,7 +241,14 @@ int raw_flash_read(uint32_t offset, void *data, int len)
         return -1;
     }
 
-    if (fmc_ofvr_temp > 0) {
+    if (fmc_ofvr_temp == 0 || !raw_flash_in_offset_region(offset, len)) {
+        return rom_flash_read(offset, data, len);
+    }
+
+    while (len > 0 && ret == 0) {
+        size = (len > RAW_FLASH_READ_STEP) ? RAW_FLASH_READ_STEP : len;
+        start = get_sys_local_time_us();
+
         // disable all irqs here, cause it will change the FMC_OFVR value
         __disable_irq();
 
@@ -174,7 +259,7 @@ int raw_flash_read(uint32_t offset, void *data, int len)
         ob_lock();
         fmc_lock();
 
-        ret = rom_flash_read(offset, data, len);
+        ret = rom_flash_read(offset, data, size);
 
         // recovery FMC_OFVR value
         fmc_unlock();
@@ -184,57 +269,46 @@ int raw_flash_read(uint32_t offset, void *data, int len)
         fmc_lock();
 
         __enable_irq();
-    } else {
-        ret = rom_flash_read(offset, data, len);
+
+        raw_flash_masked_record(start);
+        offset += size;
+        data = (uint8_t *)data + size;
+        len -= size;
     }
 
     return ret;
 }
 
 #ifdef CONFIG_FLASH_NOT_BLOCK_UART_RX
-static uint32_t* redirect_vector_sram(uint8_t enable)
+#define RAW_FLASH_VECTOR_SIZE       0x1d0
+
+/* SRAM copy of the vector table used while the flash is busy, made once, mtvt needs a 512 bytes alignment */
+static uint32_t raw_flash_vector[RAW_FLASH_VECTOR_SIZE / 4] __attribute__((aligned(0x200)));
+static uint8_t raw_flash_vector_ready;
+
+static void redirect_vector_sram(uint8_t enable)
 {
     extern uint32_t _vetor_base[];
     extern void redirect_vector_table(uint32_t vector_new);
-    uint32_t *vector_new = NULL;
-    uint32_t vector_new_1;
 
     if (enable) {
-        vector_new = (uint32_t *)sys_malloc(0x1d0 + 0x200);
-        if (vector_new == NULL) {
-            return NULL;
+        if (!raw_flash_vector_ready) {
+            sys_memcpy((void *)raw_flash_vector, (void *)_vetor_base, RAW_FLASH_VECTOR_SIZE);
+            raw_flash_vector_ready = 1;
         }
-        vector_new_1 = ((uint32_t)vector_new + 0x200) & (~(0x200 - 1));
-        sys_memcpy((void *)vector_new_1, (void *)_vetor_base, 0x1d0);
 
         __disable_irq();
-        redirect_vector_table((uint32_t)vector_new_1);
+        redirect_vector_table((uint32_t)raw_flash_vector);
         __enable_irq();
-        return vector_new;
     } else {
         __disable_irq();
         redirect_vector_table((uint32_t)_vetor_base);
         __enable_irq();
-        return NULL;
     }
 }
 
-static void redirect_vector_free(uint32_t *vector_addr)
-{
-    if (vector_addr)
-        sys_mfree(vector_addr);
-}
-
-#define VECTOR_SRAM_ENTER()                         \
-    uint32_t *vector_addr = NULL;                   \
-    vector_addr = redirect_vector_sram(1);          \
-    if (vector_addr == NULL) {                      \
-        return -1;                                  \
-    }
-
-#define VECTOR_SRAM_RESTORE()                       \
-    redirect_vector_sram(0);                        \
-    redirect_vector_free(vector_addr);
+#define VECTOR_SRAM_ENTER()         redirect_vector_sram(1)
+#define VECTOR_SRAM_RESTORE()       redirect_vector_sram(0)
 #else
 #define VECTOR_SRAM_ENTER()
 #define VECTOR_SRAM_RESTORE()
@@ -331,7 +405,9 @@ void raw_flash_erase_handler_unregister(raw_flash_erase_handler_t callback)
 */
 int raw_flash_erase(uint32_t offset, int len)
 {
-    int ret;
+    int ret = 0;
+    uint32_t addr, end;
+    uint64_t start;
 
     if (!raw_flash_is_valid_offset(offset)
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
@@ -345,9 +421,21 @@ int raw_flash_erase(uint32_t offset, int len)
     /* redirect vector table to sram */
     VECTOR_SRAM_ENTER();
 
-    GLOBAL_INT_DISABLE();
-    ret = rom_flash_erase(offset, len);
-    GLOBAL_INT_RESTORE();
+    /* the FMC has no erase suspend, bound the masked window to one page instead */
+    addr = offset & ~(FLASH_PAGE_SIZE - 1);
+    end = offset + len;
+    while (addr < end) {
+        start = get_sys_local_time_us();
+        GLOBAL_INT_DISABLE();
+        ret = rom_flash_erase(addr, RAW_FLASH_ERASE_STEP);
+        GLOBAL_INT_RESTORE();
+        raw_flash_masked_record(start);
+
+        if (ret) {
+            break;
+        }
+        addr += RAW_FLASH_ERASE_STEP;
+    }
 
     /* restore vector table */
     VECTOR_SRAM_RESTORE();
@@ -370,6 +458,8 @@ int raw_flash_erase(uint32_t offset, int len)
 int raw_flash_write_fast(uint32_t offset, const void *data, int len)
 {
     int ret = 0;
+    int pos, size;
+    uint64_t start;
 
     if (!raw_flash_is_valid_offset(offset) || data == NULL
         || len <= 0 || !raw_flash_is_valid_offset(offset + len - 1)) {
@@ -398,9 +488,17 @@ int raw_flash_write_fast(uint32_t offset, const void *data, int len)
     fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR);
 
     /* prevent interrupt handler from reading flash, it will disrupt the flash continuous programming pipeline */
-    GLOBAL_INT_DISABLE();
-    ret = fmc_continuous_program(FLASH_BASE + offset + r, (uint32_t *)(data + r), len - r - rr);
-    GLOBAL_INT_RESTORE();
+    for (pos = r; pos < len - rr && ret == 0; pos += size) {
+        size = len - rr - pos;
+        if (size > RAW_FLASH_PROGRAM_STEP) {
+            size = RAW_FLASH_PROGRAM_STEP;
+        }
+        start = get_sys_local_time_us();
+        GLOBAL_INT_DISABLE();
+        ret = fmc_continuous_program(FLASH_BASE + offset + pos, (uint32_t *)(data + pos), size);
+        GLOBAL_INT_RESTORE();
+        raw_flash_masked_record(start);
+    }
 
     /* lock the flash program erase controller */
     fmc_lock();
@@ -60,5 +60,7 @@ int raw_flash_erase(uint32_t offset, int len);
 int raw_flash_erase_handler_register(raw_flash_erase_handler_t callback);
 void raw_flash_erase_handler_unregister(raw_flash_erase_handler_t callback);
 int raw_flash_write_fast(uint32_t offset, const void *data, int len);
+void raw_flash_irq_latency_get(uint32_t *max_us, uint32_t *last_us);
+void raw_flash_irq_latency_reset(void);
 
 #endif
@@ -18,7 +18,9 @@ D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/bignum_m
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/bignum_mod_raw.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/block_cipher.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/camellia.c \
+D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/cau_alt.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/ccm.c \
+D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/ccm_alt.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/chacha20.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/chachapoly.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/cipher.c \
@@ -40,6 +42,7 @@ D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/entropy.
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/entropy_poll.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/error.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/gcm.c \
+D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/gcm_alt.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/hkdf.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/hmac_drbg.c \
 D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/lmots.c \
@@ -131,7 +134,9 @@ C_DEPS += \
 ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.d \
 ./mbedtls/mbedtls-3.6.2/block_cipher.d \
 ./mbedtls/mbedtls-3.6.2/camellia.d \
+./mbedtls/mbedtls-3.6.2/cau_alt.d \
 ./mbedtls/mbedtls-3.6.2/ccm.d \
+./mbedtls/mbedtls-3.6.2/ccm_alt.d \
 ./mbedtls/mbedtls-3.6.2/chacha20.d \
 ./mbedtls/mbedtls-3.6.2/chachapoly.d \
 ./mbedtls/mbedtls-3.6.2/cipher.d \
@@ -153,6 +158,7 @@ C_DEPS += \
 ./mbedtls/mbedtls-3.6.2/entropy_poll.d \
 ./mbedtls/mbedtls-3.6.2/error.d \
 ./mbedtls/mbedtls-3.6.2/gcm.d \
+./mbedtls/mbedtls-3.6.2/gcm_alt.d \
 ./mbedtls/mbedtls-3.6.2/hkdf.d \
 ./mbedtls/mbedtls-3.6.2/hmac_drbg.d \
 ./mbedtls/mbedtls-3.6.2/lmots.d \
@@ -244,7 +250,9 @@ OBJS += \
 ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.o \
 ./mbedtls/mbedtls-3.6.2/block_cipher.o \
 ./mbedtls/mbedtls-3.6.2/camellia.o \
+./mbedtls/mbedtls-3.6.2/cau_alt.o \
 ./mbedtls/mbedtls-3.6.2/ccm.o \
+./mbedtls/mbedtls-3.6.2/ccm_alt.o \
 ./mbedtls/mbedtls-3.6.2/chacha20.o \
 ./mbedtls/mbedtls-3.6.2/chachapoly.o \
 ./mbedtls/mbedtls-3.6.2/cipher.o \
@@ -266,6 +274,7 @@ OBJS += \
 ./mbedtls/mbedtls-3.6.2/entropy_poll.o \
 ./mbedtls/mbedtls-3.6.2/error.o \
 ./mbedtls/mbedtls-3.6.2/gcm.o \
+./mbedtls/mbedtls-3.6.2/gcm_alt.o \
 ./mbedtls/mbedtls-3.6.2/hkdf.o \
 ./mbedtls/mbedtls-3.6.2/hmac_drbg.o \
 ./mbedtls/mbedtls-3.6.2/lmots.o \
@@ -442,6 +451,13 @@ mbedtls/mbedtls-3.6.2/camellia.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbed
 	@echo 'Finished building: $<'
 	@echo ' '
 
+mbedtls/mbedtls-3.6.2/cau_alt.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/cau_alt.c mbedtls/mbedtls-3.6.2/subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: GD RISC-V MCU C Compiler'
+	riscv-nuclei-elf-gcc -march=rv32imafcbp -mcmodel=medlow -msmall-data-limit=8 -msave-restore -mabi=ilp32f -Os -fmessage-length=0 -fsigned-char -ffunction-sections -fdata-sections -fno-common -fno-unroll-loops -Werror -Wunused -Wuninitialized -Wall -Wno-format -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable  -g -std=c99 -DCFG_RTOS -DPLATFORM_OS_FREERTOS -I"..\..\..\..\lwip\iperf3" -I"..\..\..\..\lwip\iperf" -I"..\..\..\..\macsw\export" -I"..\..\..\..\macsw\import" -I"..\..\..\..\plf\riscv\arch" -I"..\..\..\..\plf\riscv\arch\boot" -I"..\..\..\..\plf\riscv\arch\lib" -I"..\..\..\..\plf\riscv\arch\ll" -I"..\..\..\..\plf\riscv\arch\compiler" -I"..\..\..\..\plf\src" -I"..\..\..\..\plf\src\reg" -I"..\..\..\..\plf\src\raw_flash" -I"..\..\..\..\plf\src\qspi_flash" -I"..\..\..\..\plf\src\dma" -I"..\..\..\..\plf\src\time" -I"..\..\..\..\plf\src\trng" -I"..\..\..\..\plf\src\uart" -I"..\..\..\..\plf\src\spi" -I"..\..\..\..\plf\src\spi_i2s" -I"..\..\..\..\plf\src\nvds" -I"..\..\..\..\plf\src\rf" -I"..\..\..\..\plf\riscv\gd32vw55x" -I"..\..\..\..\plf\riscv\NMSIS\Core\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include\dsp" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral\Include" -I"..\..\..\..\rtos\rtos_wrapper" -I"..\..\..\..\rtos\FreeRTOS\Source\include" -I"..\..\..\..\rtos\FreeRTOS\Source\portable\riscv32" -I"..\..\..\..\rtos\FreeRTOS\config" -I"..\..\..\..\lwip\lwip-2.2.0\src\include" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\compat\posix" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip\apps" -I"..\..\..\..\lwip\lwip-2.2.0\port" -I"..\..\..\..\lwip\libcoap\include" -I"..\..\..\..\lwip\libcoap\port" -I"..\..\..\..\FatFS\port" -I"..\..\..\..\FatFS\src" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\include" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\library" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\tests\include\spe" -I"..\..\..\..\..\ROM-EXPORT\bootloader" -I"..\..\..\..\..\ROM-EXPORT\halcomm" -I"..\..\..\..\..\ROM-EXPORT\symbol" -I"..\..\..\..\..\config" -I"..\..\..\..\app" -I"..\..\..\..\app\mqtt_app" -I"..\..\..\..\wifi_manager" -I"..\..\..\..\wifi_manager\wpas" -I"..\..\..\..\blesw\src\export" -I"..\..\..\..\ble\app" -I"..\..\..\..\ble\profile" -I"..\..\..\..\ble\profile\datatrans" -I"..\..\..\..\ble\profile\dis" -I"..\..\..\..\ble\profile\sample" -I"..\..\..\..\ble\profile\throughput" -I"..\..\..\..\ble\profile\bas" -I"..\..\..\..\ble\profile\ota" -I"..\..\..\..\util\include" -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -Wa,-adhlns=$@.lst   -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 mbedtls/mbedtls-3.6.2/ccm.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/ccm.c mbedtls/mbedtls-3.6.2/subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: GD RISC-V MCU C Compiler'
@@ -449,6 +465,13 @@ mbedtls/mbedtls-3.6.2/ccm.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/m
 	@echo 'Finished building: $<'
 	@echo ' '
 
+mbedtls/mbedtls-3.6.2/ccm_alt.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/ccm_alt.c mbedtls/mbedtls-3.6.2/subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: GD RISC-V MCU C Compiler'
+	riscv-nuclei-elf-gcc -march=rv32imafcbp -mcmodel=medlow -msmall-data-limit=8 -msave-restore -mabi=ilp32f -Os -fmessage-length=0 -fsigned-char -ffunction-sections -fdata-sections -fno-common -fno-unroll-loops -Werror -Wunused -Wuninitialized -Wall -Wno-format -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable  -g -std=c99 -DCFG_RTOS -DPLATFORM_OS_FREERTOS -I"..\..\..\..\lwip\iperf3" -I"..\..\..\..\lwip\iperf" -I"..\..\..\..\macsw\export" -I"..\..\..\..\macsw\import" -I"..\..\..\..\plf\riscv\arch" -I"..\..\..\..\plf\riscv\arch\boot" -I"..\..\..\..\plf\riscv\arch\lib" -I"..\..\..\..\plf\riscv\arch\ll" -I"..\..\..\..\plf\riscv\arch\compiler" -I"..\..\..\..\plf\src" -I"..\..\..\..\plf\src\reg" -I"..\..\..\..\plf\src\raw_flash" -I"..\..\..\..\plf\src\qspi_flash" -I"..\..\..\..\plf\src\dma" -I"..\..\..\..\plf\src\time" -I"..\..\..\..\plf\src\trng" -I"..\..\..\..\plf\src\uart" -I"..\..\..\..\plf\src\spi" -I"..\..\..\..\plf\src\spi_i2s" -I"..\..\..\..\plf\src\nvds" -I"..\..\..\..\plf\src\rf" -I"..\..\..\..\plf\riscv\gd32vw55x" -I"..\..\..\..\plf\riscv\NMSIS\Core\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include\dsp" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral\Include" -I"..\..\..\..\rtos\rtos_wrapper" -I"..\..\..\..\rtos\FreeRTOS\Source\include" -I"..\..\..\..\rtos\FreeRTOS\Source\portable\riscv32" -I"..\..\..\..\rtos\FreeRTOS\config" -I"..\..\..\..\lwip\lwip-2.2.0\src\include" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\compat\posix" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip\apps" -I"..\..\..\..\lwip\lwip-2.2.0\port" -I"..\..\..\..\lwip\libcoap\include" -I"..\..\..\..\lwip\libcoap\port" -I"..\..\..\..\FatFS\port" -I"..\..\..\..\FatFS\src" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\include" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\library" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\tests\include\spe" -I"..\..\..\..\..\ROM-EXPORT\bootloader" -I"..\..\..\..\..\ROM-EXPORT\halcomm" -I"..\..\..\..\..\ROM-EXPORT\symbol" -I"..\..\..\..\..\config" -I"..\..\..\..\app" -I"..\..\..\..\app\mqtt_app" -I"..\..\..\..\wifi_manager" -I"..\..\..\..\wifi_manager\wpas" -I"..\..\..\..\blesw\src\export" -I"..\..\..\..\ble\app" -I"..\..\..\..\ble\profile" -I"..\..\..\..\ble\profile\datatrans" -I"..\..\..\..\ble\profile\dis" -I"..\..\..\..\ble\profile\sample" -I"..\..\..\..\ble\profile\throughput" -I"..\..\..\..\ble\profile\bas" -I"..\..\..\..\ble\profile\ota" -I"..\..\..\..\util\include" -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -Wa,-adhlns=$@.lst   -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 mbedtls/mbedtls-3.6.2/chacha20.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/chacha20.c mbedtls/mbedtls-3.6.2/subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: GD RISC-V MCU C Compiler'
@@ -596,6 +619,13 @@ mbedtls/mbedtls-3.6.2/gcm.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/m
 	@echo 'Finished building: $<'
 	@echo ' '
 
+mbedtls/mbedtls-3.6.2/gcm_alt.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/gcm_alt.c mbedtls/mbedtls-3.6.2/subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: GD RISC-V MCU C Compiler'
+	riscv-nuclei-elf-gcc -march=rv32imafcbp -mcmodel=medlow -msmall-data-limit=8 -msave-restore -mabi=ilp32f -Os -fmessage-length=0 -fsigned-char -ffunction-sections -fdata-sections -fno-common -fno-unroll-loops -Werror -Wunused -Wuninitialized -Wall -Wno-format -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable  -g -std=c99 -DCFG_RTOS -DPLATFORM_OS_FREERTOS -I"..\..\..\..\lwip\iperf3" -I"..\..\..\..\lwip\iperf" -I"..\..\..\..\macsw\export" -I"..\..\..\..\macsw\import" -I"..\..\..\..\plf\riscv\arch" -I"..\..\..\..\plf\riscv\arch\boot" -I"..\..\..\..\plf\riscv\arch\lib" -I"..\..\..\..\plf\riscv\arch\ll" -I"..\..\..\..\plf\riscv\arch\compiler" -I"..\..\..\..\plf\src" -I"..\..\..\..\plf\src\reg" -I"..\..\..\..\plf\src\raw_flash" -I"..\..\..\..\plf\src\qspi_flash" -I"..\..\..\..\plf\src\dma" -I"..\..\..\..\plf\src\time" -I"..\..\..\..\plf\src\trng" -I"..\..\..\..\plf\src\uart" -I"..\..\..\..\plf\src\spi" -I"..\..\..\..\plf\src\spi_i2s" -I"..\..\..\..\plf\src\nvds" -I"..\..\..\..\plf\src\rf" -I"..\..\..\..\plf\riscv\gd32vw55x" -I"..\..\..\..\plf\riscv\NMSIS\Core\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include" -I"..\..\..\..\plf\riscv\NMSIS\DSP\Include\dsp" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral" -I"..\..\..\..\plf\GD32VW55x_standard_peripheral\Include" -I"..\..\..\..\rtos\rtos_wrapper" -I"..\..\..\..\rtos\FreeRTOS\Source\include" -I"..\..\..\..\rtos\FreeRTOS\Source\portable\riscv32" -I"..\..\..\..\rtos\FreeRTOS\config" -I"..\..\..\..\lwip\lwip-2.2.0\src\include" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\compat\posix" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip" -I"..\..\..\..\lwip\lwip-2.2.0\src\include\lwip\apps" -I"..\..\..\..\lwip\lwip-2.2.0\port" -I"..\..\..\..\lwip\libcoap\include" -I"..\..\..\..\lwip\libcoap\port" -I"..\..\..\..\FatFS\port" -I"..\..\..\..\FatFS\src" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\include" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\library" -I"..\..\..\..\mbedtls\mbedtls-3.6.2\tests\include\spe" -I"..\..\..\..\..\ROM-EXPORT\bootloader" -I"..\..\..\..\..\ROM-EXPORT\halcomm" -I"..\..\..\..\..\ROM-EXPORT\symbol" -I"..\..\..\..\..\config" -I"..\..\..\..\app" -I"..\..\..\..\app\mqtt_app" -I"..\..\..\..\wifi_manager" -I"..\..\..\..\wifi_manager\wpas" -I"..\..\..\..\blesw\src\export" -I"..\..\..\..\ble\app" -I"..\..\..\..\ble\profile" -I"..\..\..\..\ble\profile\datatrans" -I"..\..\..\..\ble\profile\dis" -I"..\..\..\..\ble\profile\sample" -I"..\..\..\..\ble\profile\throughput" -I"..\..\..\..\ble\profile\bas" -I"..\..\..\..\ble\profile\ota" -I"..\..\..\..\util\include" -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -Wa,-adhlns=$@.lst   -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 mbedtls/mbedtls-3.6.2/hkdf.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK/mbedtls/mbedtls-3.6.2/library/hkdf.c mbedtls/mbedtls-3.6.2/subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: GD RISC-V MCU C Compiler'
@@ -1125,7 +1155,7 @@ mbedtls/mbedtls-3.6.2/x509write_csr.o: D:/work/WIFI_GD32VW/Github_GD32VW55x/MSDK
 clean: clean-mbedtls-2f-mbedtls-2d-3-2e-6-2e-2
 
 clean-mbedtls-2f-mbedtls-2d-3-2e-6-2e-2:
-	-$(RM) ./mbedtls/mbedtls-3.6.2/aes.d ./mbedtls/mbedtls-3.6.2/aes.o ./mbedtls/mbedtls-3.6.2/aes_alt.d ./mbedtls/mbedtls-3.6.2/aes_alt.o ./mbedtls/mbedtls-3.6.2/aesce.d ./mbedtls/mbedtls-3.6.2/aesce.o ./mbedtls/mbedtls-3.6.2/aesni.d ./mbedtls/mbedtls-3.6.2/aesni.o ./mbedtls/mbedtls-3.6.2/aria.d ./mbedtls/mbedtls-3.6.2/aria.o ./mbedtls/mbedtls-3.6.2/asn1parse.d ./mbedtls/mbedtls-3.6.2/asn1parse.o ./mbedtls/mbedtls-3.6.2/asn1write.d ./mbedtls/mbedtls-3.6.2/asn1write.o ./mbedtls/mbedtls-3.6.2/base64.d ./mbedtls/mbedtls-3.6.2/base64.o ./mbedtls/mbedtls-3.6.2/bignum.d ./mbedtls/mbedtls-3.6.2/bignum.o ./mbedtls/mbedtls-3.6.2/bignum_core.d ./mbedtls/mbedtls-3.6.2/bignum_core.o ./mbedtls/mbedtls-3.6.2/bignum_mod.d ./mbedtls/mbedtls-3.6.2/bignum_mod.o ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.d ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.o ./mbedtls/mbedtls-3.6.2/block_cipher.d ./mbedtls/mbedtls-3.6.2/block_cipher.o ./mbedtls/mbedtls-3.6.2/camellia.d ./mbedtls/mbedtls-3.6.2/camellia.o ./mbedtls/mbedtls-3.6.2/ccm.d ./mbedtls/mbedtls-3.6.2/ccm.o ./mbedtls/mbedtls-3.6.2/chacha20.d ./mbedtls/mbedtls-3.6.2/chacha20.o ./mbedtls/mbedtls-3.6.2/chachapoly.d ./mbedtls/mbedtls-3.6.2/chachapoly.o ./mbedtls/mbedtls-3.6.2/cipher.d ./mbedtls/mbedtls-3.6.2/cipher.o ./mbedtls/mbedtls-3.6.2/cipher_wrap.d ./mbedtls/mbedtls-3.6.2/cipher_wrap.o ./mbedtls/mbedtls-3.6.2/cmac.d ./mbedtls/mbedtls-3.6.2/cmac.o ./mbedtls/mbedtls-3.6.2/constant_time.d ./mbedtls/mbedtls-3.6.2/constant_time.o ./mbedtls/mbedtls-3.6.2/ctr_drbg.d ./mbedtls/mbedtls-3.6.2/ctr_drbg.o ./mbedtls/mbedtls-3.6.2/debug.d ./mbedtls/mbedtls-3.6.2/debug.o ./mbedtls/mbedtls-3.6.2/des.d ./mbedtls/mbedtls-3.6.2/des.o ./mbedtls/mbedtls-3.6.2/des_alt.d ./mbedtls/mbedtls-3.6.2/des_alt.o ./mbedtls/mbedtls-3.6.2/dhm.d ./mbedtls/mbedtls-3.6.2/dhm.o ./mbedtls/mbedtls-3.6.2/ecdh.d ./mbedtls/mbedtls-3.6.2/ecdh.o ./mbedtls/mbedtls-3.6.2/ecdsa.d ./mbedtls/mbedtls-3.6.2/ecdsa.o ./mbedtls/mbedtls-3.6.2/ecjpake.d ./mbedtls/mbedtls-3.6.2/ecjpake.o ./mbedtls/mbedtls-3.6.2/ecp.d ./mbedtls/mbedtls-3.6.2/ecp.o ./mbedtls/mbedtls-3.6.2/ecp_curves.d ./mbedtls/mbedtls-3.6.2/ecp_curves.o ./mbedtls/mbedtls-3.6.2/ecp_curves_new.d ./mbedtls/mbedtls-3.6.2/ecp_curves_new.o ./mbedtls/mbedtls-3.6.2/entropy.d ./mbedtls/mbedtls-3.6.2/entropy.o ./mbedtls/mbedtls-3.6.2/entropy_poll.d ./mbedtls/mbedtls-3.6.2/entropy_poll.o ./mbedtls/mbedtls-3.6.2/error.d ./mbedtls/mbedtls-3.6.2/error.o ./mbedtls/mbedtls-3.6.2/gcm.d ./mbedtls/mbedtls-3.6.2/gcm.o ./mbedtls/mbedtls-3.6.2/hkdf.d ./mbedtls/mbedtls-3.6.2/hkdf.o ./mbedtls/mbedtls-3.6.2/hmac_drbg.d ./mbedtls/mbedtls-3.6.2/hmac_drbg.o ./mbedtls/mbedtls-3.6.2/lmots.d ./mbedtls/mbedtls-3.6.2/lmots.o ./mbedtls/mbedtls-3.6.2/lms.d ./mbedtls/mbedtls-3.6.2/lms.o ./mbedtls/mbedtls-3.6.2/md.d ./mbedtls/mbedtls-3.6.2/md.o ./mbedtls/mbedtls-3.6.2/md5.d ./mbedtls/mbedtls-3.6.2/md5.o ./mbedtls/mbedtls-3.6.2/memory_buffer_alloc.d ./mbedtls/mbedtls-3.6.2/memory_buffer_alloc.o ./mbedtls/mbedtls-3.6.2/mps_reader.d ./mbedtls/mbedtls-3.6.2/mps_reader.o ./mbedtls/mbedtls-3.6.2/mps_trace.d ./mbedtls/mbedtls-3.6.2/mps_trace.o ./mbedtls/mbedtls-3.6.2/net_sockets.d ./mbedtls/mbedtls-3.6.2/net_sockets.o ./mbedtls/mbedtls-3.6.2/nist_kw.d ./mbedtls/mbedtls-3.6.2/nist_kw.o ./mbedtls/mbedtls-3.6.2/oid.d ./mbedtls/mbedtls-3.6.2/oid.o ./mbedtls/mbedtls-3.6.2/padlock.d ./mbedtls/mbedtls-3.6.2/padlock.o ./mbedtls/mbedtls-3.6.2/pem.d ./mbedtls/mbedtls-3.6.2/pem.o ./mbedtls/mbedtls-3.6.2/pk.d ./mbedtls/mbedtls-3.6.2/pk.o ./mbedtls/mbedtls-3.6.2/pk_ecc.d ./mbedtls/mbedtls-3.6.2/pk_ecc.o ./mbedtls/mbedtls-3.6.2/pk_wrap.d ./mbedtls/mbedtls-3.6.2/pk_wrap.o ./mbedtls/mbedtls-3.6.2/pkcs12.d ./mbedtls/mbedtls-3.6.2/pkcs12.o ./mbedtls/mbedtls-3.6.2/pkcs5.d ./mbedtls/mbedtls-3.6.2/pkcs5.o ./mbedtls/mbedtls-3.6.2/pkcs7.d ./mbedtls/mbedtls-3.6.2/pkcs7.o ./mbedtls/mbedtls-3.6.2/pkparse.d ./mbedtls/mbedtls-3.6.2/pkparse.o ./mbedtls/mbedtls-3.6.2/pkwrite.d ./mbedtls/mbedtls-3.6.2/pkwrite.o ./mbedtls/mbedtls-3.6.2/platform.d ./mbedtls/mbedtls-3.6.2/platform.o ./mbedtls/mbedtls-3.6.2/platform_util.d ./mbedtls/mbedtls-3.6.2/platform_util.o ./mbedtls/mbedtls-3.6.2/poly1305.d ./mbedtls/mbedtls-3.6.2/poly1305.o ./mbedtls/mbedtls-3.6.2/psa_crypto.d ./mbedtls/mbedtls-3.6.2/psa_crypto.o ./mbedtls/mbedtls-3.6.2/psa_crypto_aead.d ./mbedtls/mbedtls-3.6.2/psa_crypto_aead.o ./mbedtls/mbedtls-3.6.2/psa_crypto_cipher.d ./mbedtls/mbedtls-3.6.2/psa_crypto_cipher.o ./mbedtls/mbedtls-3.6.2/psa_crypto_client.d ./mbedtls/mbedtls-3.6.2/psa_crypto_client.o ./mbedtls/mbedtls-3.6.2/psa_crypto_driver_wrappers_no_static.d ./mbedtls/mbedtls-3.6.2/psa_crypto_driver_wrappers_no_static.o ./mbedtls/mbedtls-3.6.2/psa_crypto_ecp.d ./mbedtls/mbedtls-3.6.2/psa_crypto_ecp.o ./mbedtls/mbedtls-3.6.2/psa_crypto_ffdh.d ./mbedtls/mbedtls-3.6.2/psa_crypto_ffdh.o ./mbedtls/mbedtls-3.6.2/psa_crypto_hash.d ./mbedtls/mbedtls-3.6.2/psa_crypto_hash.o ./mbedtls/mbedtls-3.6.2/psa_crypto_mac.d ./mbedtls/mbedtls-3.6.2/psa_crypto_mac.o ./mbedtls/mbedtls-3.6.2/psa_crypto_pake.d ./mbedtls/mbedtls-3.6.2/psa_crypto_pake.o ./mbedtls/mbedtls-3.6.2/psa_crypto_rsa.d ./mbedtls/mbedtls-3.6.2/psa_crypto_rsa.o ./mbedtls/mbedtls-3.6.2/psa_crypto_se.d ./mbedtls/mbedtls-3.6.2/psa_crypto_se.o ./mbedtls/mbedtls-3.6.2/psa_crypto_slot_management.d ./mbedtls/mbedtls-3.6.2/psa_crypto_slot_management.o ./mbedtls/mbedtls-3.6.2/psa_crypto_storage.d ./mbedtls/mbedtls-3.6.2/psa_crypto_storage.o ./mbedtls/mbedtls-3.6.2/psa_its_file.d ./mbedtls/mbedtls-3.6.2/psa_its_file.o ./mbedtls/mbedtls-3.6.2/psa_util.d ./mbedtls/mbedtls-3.6.2/psa_util.o ./mbedtls/mbedtls-3.6.2/ripemd160.d ./mbedtls/mbedtls-3.6.2/ripemd160.o ./mbedtls/mbedtls-3.6.2/rsa.d ./mbedtls/mbedtls-3.6.2/rsa.o ./mbedtls/mbedtls-3.6.2/rsa_alt_helpers.d ./mbedtls/mbedtls-3.6.2/rsa_alt_helpers.o ./mbedtls/mbedtls-3.6.2/sha1.d ./mbedtls/mbedtls-3.6.2/sha1.o ./mbedtls/mbedtls-3.6.2/sha256.d ./mbedtls/mbedtls-3.6.2/sha256.o ./mbedtls/mbedtls-3.6.2/sha256_alt.d ./mbedtls/mbedtls-3.6.2/sha256_alt.o ./mbedtls/mbedtls-3.6.2/sha3.d
+	-$(RM) ./mbedtls/mbedtls-3.6.2/aes.d ./mbedtls/mbedtls-3.6.2/aes.o ./mbedtls/mbedtls-3.6.2/aes_alt.d ./mbedtls/mbedtls-3.6.2/aes_alt.o ./mbedtls/mbedtls-3.6.2/aesce.d ./mbedtls/mbedtls-3.6.2/aesce.o ./mbedtls/mbedtls-3.6.2/aesni.d ./mbedtls/mbedtls-3.6.2/aesni.o ./mbedtls/mbedtls-3.6.2/aria.d ./mbedtls/mbedtls-3.6.2/aria.o ./mbedtls/mbedtls-3.6.2/asn1parse.d ./mbedtls/mbedtls-3.6.2/asn1parse.o ./mbedtls/mbedtls-3.6.2/asn1write.d ./mbedtls/mbedtls-3.6.2/asn1write.o ./mbedtls/mbedtls-3.6.2/base64.d ./mbedtls/mbedtls-3.6.2/base64.o ./mbedtls/mbedtls-3.6.2/bignum.d ./mbedtls/mbedtls-3.6.2/bignum.o ./mbedtls/mbedtls-3.6.2/bignum_core.d ./mbedtls/mbedtls-3.6.2/bignum_core.o ./mbedtls/mbedtls-3.6.2/bignum_mod.d ./mbedtls/mbedtls-3.6.2/bignum_mod.o ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.d ./mbedtls/mbedtls-3.6.2/bignum_mod_raw.o ./mbedtls/mbedtls-3.6.2/block_cipher.d ./mbedtls/mbedtls-3.6.2/block_cipher.o ./mbedtls/mbedtls-3.6.2/camellia.d ./mbedtls/mbedtls-3.6.2/camellia.o ./mbedtls/mbedtls-3.6.2/cau_alt.d ./mbedtls/mbedtls-3.6.2/cau_alt.o ./mbedtls/mbedtls-3.6.2/ccm.d ./mbedtls/mbedtls-3.6.2/ccm.o ./mbedtls/mbedtls-3.6.2/ccm_alt.d ./mbedtls/mbedtls-3.6.2/ccm_alt.o ./mbedtls/mbedtls-3.6.2/chacha20.d ./mbedtls/mbedtls-3.6.2/chacha20.o ./mbedtls/mbedtls-3.6.2/chachapoly.d ./mbedtls/mbedtls-3.6.2/chachapoly.o ./mbedtls/mbedtls-3.6.2/cipher.d ./mbedtls/mbedtls-3.6.2/cipher.o ./mbedtls/mbedtls-3.6.2/cipher_wrap.d ./mbedtls/mbedtls-3.6.2/cipher_wrap.o ./mbedtls/mbedtls-3.6.2/cmac.d ./mbedtls/mbedtls-3.6.2/cmac.o ./mbedtls/mbedtls-3.6.2/constant_time.d ./mbedtls/mbedtls-3.6.2/constant_time.o ./mbedtls/mbedtls-3.6.2/ctr_drbg.d ./mbedtls/mbedtls-3.6.2/ctr_drbg.o ./mbedtls/mbedtls-3.6.2/debug.d ./mbedtls/mbedtls-3.6.2/debug.o ./mbedtls/mbedtls-3.6.2/des.d ./mbedtls/mbedtls-3.6.2/des.o ./mbedtls/mbedtls-3.6.2/des_alt.d ./mbedtls/mbedtls-3.6.2/des_alt.o ./mbedtls/mbedtls-3.6.2/dhm.d ./mbedtls/mbedtls-3.6.2/dhm.o ./mbedtls/mbedtls-3.6.2/ecdh.d ./mbedtls/mbedtls-3.6.2/ecdh.o ./mbedtls/mbedtls-3.6.2/ecdsa.d ./mbedtls/mbedtls-3.6.2/ecdsa.o ./mbedtls/mbedtls-3.6.2/ecjpake.d ./mbedtls/mbedtls-3.6.2/ecjpake.o ./mbedtls/mbedtls-3.6.2/ecp.d ./mbedtls/mbedtls-3.6.2/ecp.o ./mbedtls/mbedtls-3.6.2/ecp_curves.d ./mbedtls/mbedtls-3.6.2/ecp_curves.o ./mbedtls/mbedtls-3.6.2/ecp_curves_new.d ./mbedtls/mbedtls-3.6.2/ecp_curves_new.o ./mbedtls/mbedtls-3.6.2/entropy.d ./mbedtls/mbedtls-3.6.2/entropy.o ./mbedtls/mbedtls-3.6.2/entropy_poll.d ./mbedtls/mbedtls-3.6.2/entropy_poll.o ./mbedtls/mbedtls-3.6.2/error.d ./mbedtls/mbedtls-3.6.2/error.o ./mbedtls/mbedtls-3.6.2/gcm.d ./mbedtls/mbedtls-3.6.2/gcm.o ./mbedtls/mbedtls-3.6.2/gcm_alt.d ./mbedtls/mbedtls-3.6.2/gcm_alt.o ./mbedtls/mbedtls-3.6.2/hkdf.d ./mbedtls/mbedtls-3.6.2/hkdf.o ./mbedtls/mbedtls-3.6.2/hmac_drbg.d ./mbedtls/mbedtls-3.6.2/hmac_drbg.o ./mbedtls/mbedtls-3.6.2/lmots.d ./mbedtls/mbedtls-3.6.2/lmots.o ./mbedtls/mbedtls-3.6.2/lms.d ./mbedtls/mbedtls-3.6.2/lms.o ./mbedtls/mbedtls-3.6.2/md.d ./mbedtls/mbedtls-3.6.2/md.o ./mbedtls/mbedtls-3.6.2/md5.d ./mbedtls/mbedtls-3.6.2/md5.o ./mbedtls/mbedtls-3.6.2/memory_buffer_alloc.d ./mbedtls/mbedtls-3.6.2/memory_buffer_alloc.o ./mbedtls/mbedtls-3.6.2/mps_reader.d ./mbedtls/mbedtls-3.6.2/mps_reader.o ./mbedtls/mbedtls-3.6.2/mps_trace.d ./mbedtls/mbedtls-3.6.2/mps_trace.o ./mbedtls/mbedtls-3.6.2/net_sockets.d ./mbedtls/mbedtls-3.6.2/net_sockets.o ./mbedtls/mbedtls-3.6.2/nist_kw.d ./mbedtls/mbedtls-3.6.2/nist_kw.o ./mbedtls/mbedtls-3.6.2/oid.d ./mbedtls/mbedtls-3.6.2/oid.o ./mbedtls/mbedtls-3.6.2/padlock.d ./mbedtls/mbedtls-3.6.2/padlock.o ./mbedtls/mbedtls-3.6.2/pem.d ./mbedtls/mbedtls-3.6.2/pem.o ./mbedtls/mbedtls-3.6.2/pk.d ./mbedtls/mbedtls-3.6.2/pk.o ./mbedtls/mbedtls-3.6.2/pk_ecc.d ./mbedtls/mbedtls-3.6.2/pk_ecc.o ./mbedtls/mbedtls-3.6.2/pk_wrap.d ./mbedtls/mbedtls-3.6.2/pk_wrap.o ./mbedtls/mbedtls-3.6.2/pkcs12.d ./mbedtls/mbedtls-3.6.2/pkcs12.o ./mbedtls/mbedtls-3.6.2/pkcs5.d ./mbedtls/mbedtls-3.6.2/pkcs5.o ./mbedtls/mbedtls-3.6.2/pkcs7.d ./mbedtls/mbedtls-3.6.2/pkcs7.o ./mbedtls/mbedtls-3.6.2/pkparse.d ./mbedtls/mbedtls-3.6.2/pkparse.o ./mbedtls/mbedtls-3.6.2/pkwrite.d ./mbedtls/mbedtls-3.6.2/pkwrite.o ./mbedtls/mbedtls-3.6.2/platform.d ./mbedtls/mbedtls-3.6.2/platform.o ./mbedtls/mbedtls-3.6.2/platform_util.d ./mbedtls/mbedtls-3.6.2/platform_util.o ./mbedtls/mbedtls-3.6.2/poly1305.d ./mbedtls/mbedtls-3.6.2/poly1305.o ./mbedtls/mbedtls-3.6.2/psa_crypto.d ./mbedtls/mbedtls-3.6.2/psa_crypto.o ./mbedtls/mbedtls-3.6.2/psa_crypto_aead.d ./mbedtls/mbedtls-3.6.2/psa_crypto_aead.o ./mbedtls/mbedtls-3.6.2/psa_crypto_cipher.d ./mbedtls/mbedtls-3.6.2/psa_crypto_cipher.o ./mbedtls/mbedtls-3.6.2/psa_crypto_client.d ./mbedtls/mbedtls-3.6.2/psa_crypto_client.o ./mbedtls/mbedtls-3.6.2/psa_crypto_driver_wrappers_no_static.d ./mbedtls/mbedtls-3.6.2/psa_crypto_driver_wrappers_no_static.o ./mbedtls/mbedtls-3.6.2/psa_crypto_ecp.d ./mbedtls/mbedtls-3.6.2/psa_crypto_ecp.o ./mbedtls/mbedtls-3.6.2/psa_crypto_ffdh.d ./mbedtls/mbedtls-3.6.2/psa_crypto_ffdh.o ./mbedtls/mbedtls-3.6.2/psa_crypto_hash.d ./mbedtls/mbedtls-3.6.2/psa_crypto_hash.o ./mbedtls/mbedtls-3.6.2/psa_crypto_mac.d ./mbedtls/mbedtls-3.6.2/psa_crypto_mac.o ./mbedtls/mbedtls-3.6.2/psa_crypto_pake.d ./mbedtls/mbedtls-3.6.2/psa_crypto_pake.o ./mbedtls/mbedtls-3.6.2/psa_crypto_rsa.d ./mbedtls/mbedtls-3.6.2/psa_crypto_rsa.o ./mbedtls/mbedtls-3.6.2/psa_crypto_se.d ./mbedtls/mbedtls-3.6.2/psa_crypto_se.o ./mbedtls/mbedtls-3.6.2/psa_crypto_slot_management.d ./mbedtls/mbedtls-3.6.2/psa_crypto_slot_management.o ./mbedtls/mbedtls-3.6.2/psa_crypto_storage.d ./mbedtls/mbedtls-3.6.2/psa_crypto_storage.o ./mbedtls/mbedtls-3.6.2/psa_its_file.d ./mbedtls/mbedtls-3.6.2/psa_its_file.o ./mbedtls/mbedtls-3.6.2/psa_util.d ./mbedtls/mbedtls-3.6.2/psa_util.o ./mbedtls/mbedtls-3.6.2/ripemd160.d ./mbedtls/mbedtls-3.6.2/ripemd160.o ./mbedtls/mbedtls-3.6.2/rsa.d ./mbedtls/mbedtls-3.6.2/rsa.o ./mbedtls/mbedtls-3.6.2/rsa_alt_helpers.d ./mbedtls/mbedtls-3.6.2/rsa_alt_helpers.o ./mbedtls/mbedtls-3.6.2/sha1.d ./mbedtls/mbedtls-3.6.2/sha1.o ./mbedtls/mbedtls-3.6.2/sha256.d ./mbedtls/mbedtls-3.6.2/sha256.o ./mbedtls/mbedtls-3.6.2/sha256_alt.d ./mbedtls/mbedtls-3.6.2/sha256_alt.o ./mbedtls/mbedtls-3.6.2/sha3.d
 	-$(RM) ./mbedtls/mbedtls-3.6.2/sha3.o ./mbedtls/mbedtls-3.6.2/sha512.d ./mbedtls/mbedtls-3.6.2/sha512.o ./mbedtls/mbedtls-3.6.2/ssl_cache.d ./mbedtls/mbedtls-3.6.2/ssl_cache.o ./mbedtls/mbedtls-3.6.2/ssl_ciphersuites.d ./mbedtls/mbedtls-3.6.2/ssl_ciphersuites.o ./mbedtls/mbedtls-3.6.2/ssl_client.d ./mbedtls/mbedtls-3.6.2/ssl_client.o ./mbedtls/mbedtls-3.6.2/ssl_cookie.d ./mbedtls/mbedtls-3.6.2/ssl_cookie.o ./mbedtls/mbedtls-3.6.2/ssl_debug_helpers_generated.d ./mbedtls/mbedtls-3.6.2/ssl_debug_helpers_generated.o ./mbedtls/mbedtls-3.6.2/ssl_msg.d ./mbedtls/mbedtls-3.6.2/ssl_msg.o ./mbedtls/mbedtls-3.6.2/ssl_ticket.d ./mbedtls/mbedtls-3.6.2/ssl_ticket.o ./mbedtls/mbedtls-3.6.2/ssl_tls.d ./mbedtls/mbedtls-3.6.2/ssl_tls.o ./mbedtls/mbedtls-3.6.2/ssl_tls12_client.d ./mbedtls/mbedtls-3.6.2/ssl_tls12_client.o ./mbedtls/mbedtls-3.6.2/ssl_tls12_server.d ./mbedtls/mbedtls-3.6.2/ssl_tls12_server.o ./mbedtls/mbedtls-3.6.2/ssl_tls13_client.d ./mbedtls/mbedtls-3.6.2/ssl_tls13_client.o ./mbedtls/mbedtls-3.6.2/ssl_tls13_generic.d ./mbedtls/mbedtls-3.6.2/ssl_tls13_generic.o ./mbedtls/mbedtls-3.6.2/ssl_tls13_keys.d ./mbedtls/mbedtls-3.6.2/ssl_tls13_keys.o ./mbedtls/mbedtls-3.6.2/ssl_tls13_server.d ./mbedtls/mbedtls-3.6.2/ssl_tls13_server.o ./mbedtls/mbedtls-3.6.2/threading.d ./mbedtls/mbedtls-3.6.2/threading.o ./mbedtls/mbedtls-3.6.2/timing.d ./mbedtls/mbedtls-3.6.2/timing.o ./mbedtls/mbedtls-3.6.2/version.d ./mbedtls/mbedtls-3.6.2/version.o ./mbedtls/mbedtls-3.6.2/version_features.d ./mbedtls/mbedtls-3.6.2/version_features.o ./mbedtls/mbedtls-3.6.2/x509.d ./mbedtls/mbedtls-3.6.2/x509.o ./mbedtls/mbedtls-3.6.2/x509_create.d ./mbedtls/mbedtls-3.6.2/x509_create.o ./mbedtls/mbedtls-3.6.2/x509_crl.d ./mbedtls/mbedtls-3.6.2/x509_crl.o ./mbedtls/mbedtls-3.6.2/x509_crt.d ./mbedtls/mbedtls-3.6.2/x509_crt.o ./mbedtls/mbedtls-3.6.2/x509_csr.d ./mbedtls/mbedtls-3.6.2/x509_csr.o ./mbedtls/mbedtls-3.6.2/x509write.d ./mbedtls/mbedtls-3.6.2/x509write.o ./mbedtls/mbedtls-3.6.2/x509write_crt.d ./mbedtls/mbedtls-3.6.2/x509write_crt.o ./mbedtls/mbedtls-3.6.2/x509write_csr.d ./mbedtls/mbedtls-3.6.2/x509write_csr.o
 
 .PHONY: clean-mbedtls-2f-mbedtls-2d-3-2e-6-2e-2
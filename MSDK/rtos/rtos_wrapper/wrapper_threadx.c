@@ -757,18 +757,97 @@ void sys_memcpy(void *des, const void *src, uint32_t n)
 */
 void sys_memmove(void *des, const void *src, uint32_t n)
 {
-    char *tmp = (char *)des;
-    char *s = (char *)src;
+    uint8_t *d = (uint8_t *)des;
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t *dw;
+    const uint32_t *sw;
+    uint32_t w0, w1, sh;
 
-    if (s < tmp && tmp < s + n) {
-        tmp += n;
-        s += n;
+    if (d == s || n == 0)
+        return;
+
+    /*
+     * The destination is always word aligned before the word loop. When the
+     * source has a different alignment, aligned source words are merged with
+     * shifts (little endian) so no unaligned access is issued.
+     */
+    if (d < s || d >= s + n) {
+        if (n >= 8) {
+            while (((uint32_t)d & 0x03) != 0) {
+                *d++ = *s++;
+                n--;
+            }
+
+            dw = (uint32_t *)d;
+            sh = ((uint32_t)s & 0x03) << 3;
+            if (sh == 0) {
+                sw = (const uint32_t *)s;
+                for (; n >= 16; n -= 16) {
+                    dw[0] = sw[0];
+                    dw[1] = sw[1];
+                    dw[2] = sw[2];
+                    dw[3] = sw[3];
+                    dw += 4;
+                    sw += 4;
+                }
+                for (; n >= 4; n -= 4)
+                    *dw++ = *sw++;
+                s = (const uint8_t *)sw;
+            } else {
+                sw = (const uint32_t *)((uint32_t)s & ~0x03);
+                w0 = *sw++;
+                for (; n >= 4; n -= 4) {
+                    w1 = *sw++;
+                    *dw++ = (w0 >> sh) | (w1 << (32 - sh));
+                    w0 = w1;
+                    s += 4;
+                }
+            }
+            d = (uint8_t *)dw;
+        }
 
         while (n--)
-            *(--tmp) = *(--s);
+            *d++ = *s++;
     } else {
+        d += n;
+        s += n;
+
+        if (n >= 8) {
+            while (((uint32_t)d & 0x03) != 0) {
+                *(--d) = *(--s);
+                n--;
+            }
+
+            dw = (uint32_t *)d;
+            sh = ((uint32_t)s & 0x03) << 3;
+            if (sh == 0) {
+                sw = (const uint32_t *)s;
+                for (; n >= 16; n -= 16) {
+                    dw -= 4;
+                    sw -= 4;
+                    dw[3] = sw[3];
+                    dw[2] = sw[2];
+                    dw[1] = sw[1];
+                    dw[0] = sw[0];
+                }
+                for (; n >= 4; n -= 4)
+                    *(--dw) = *(--sw);
+                s = (const uint8_t *)sw;
+            } else {
+                sw = (const uint32_t *)((uint32_t)s & ~0x03);
+                w1 = *sw;
+                for (; n >= 4; n -= 4) {
+                    w0 = *(--sw);
+                    *(--dw) = (w0 >> sh) | (w1 << (32 - sh));
+                    w1 = w0;
+                    s -= 4;
+                }
+            }
+            d = (uint8_t *)dw;
+        }
+
         while (n--)
-            *tmp++ = *s++;
+            *(--d) = *(--s);
     }
 }
 
@@ -821,15 +900,58 @@ void sys_memset(void *s, uint8_t c, uint32_t count)
 */
 int32_t sys_memcmp(const void *buf1, const void *buf2, uint32_t count)
 {
-    if(!count)
-        return 0;
+    const uint8_t *p1 = (const uint8_t *)buf1;
+    const uint8_t *p2 = (const uint8_t *)buf2;
+    const uint32_t *w1, *w2;
+    uint32_t w0, wn, sh;
+
+    if (count >= 8) {
+        while (((uint32_t)p1 & 0x03) != 0) {
+            if (*p1 != *p2)
+                return (*p1 - *p2);
+            p1++;
+            p2++;
+            count--;
+        }
+
+        /* Skip equal words, the byte loop below locates the first difference */
+        w1 = (const uint32_t *)p1;
+        sh = ((uint32_t)p2 & 0x03) << 3;
+        if (sh == 0) {
+            w2 = (const uint32_t *)p2;
+            for (; count >= 16; count -= 16) {
+                if (w1[0] != w2[0] || w1[1] != w2[1] ||
+                    w1[2] != w2[2] || w1[3] != w2[3])
+                    break;
+                w1 += 4;
+                w2 += 4;
+            }
+            for (; count >= 4 && *w1 == *w2; count -= 4) {
+                w1++;
+                w2++;
+            }
+            p2 = (const uint8_t *)w2;
+        } else {
+            w2 = (const uint32_t *)((uint32_t)p2 & ~0x03);
+            w0 = *w2++;
+            for (; count >= 4; count -= 4) {
+                wn = *w2++;
+                if (*w1 != ((w0 >> sh) | (wn << (32 - sh))))
+                    break;
+                w0 = wn;
+                w1++;
+                p2 += 4;
+            }
+        }
+        p1 = (const uint8_t *)w1;
+    }
 
-    while (--count && *((char *)buf1) == *((char *)buf2)) {
-        buf1 = (char *)buf1 + 1;
-        buf2 = (char *)buf2 + 1;
+    for (; count > 0; count--, p1++, p2++) {
+        if (*p1 != *p2)
+            return (*p1 - *p2);
     }
 
-    return (*((uint8_t *)buf1) - *((uint8_t *)buf2));
+    return 0;
 }
 
 /***************** OS API wrappers *****************/
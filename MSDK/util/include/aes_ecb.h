@@ -43,6 +43,33 @@ OF SUCH DAMAGE.
 #define AES_ROUNDS          10  // 12, 14
 #define AES_ROUND_KEY_SIZE  176 // AES-128 has 10 rounds, and there is a AddRoundKey before first round. (10+1)x16=176.
 
+#ifndef CFG_V6
+#include "mbedtls/aes.h"
+#endif
+
+/* Blocks run on the table based software engine when the AES is not done by the CAU */
+#if defined(CFG_V6) || !defined(MBEDTLS_AES_ALT)
+#define AES_ECB_SOFT
+#endif
+
+/* Blocks handed to the CAU in one go by aes_ecb_encrypt_blocks()/aes_ecb_decrypt_blocks() */
+#define AES_ECB_CAU_BATCH   8
+
+/**
+ * @detail: AES-128 key prepared once by aes_ecb_ctx_init() and used for any
+ *          number of blocks. As for aes_ecb_encrypt_128(), keys and blocks are
+ *          in little endian byte order.
+ */
+typedef struct aes_ecb_ctx
+{
+#ifdef AES_ECB_SOFT
+    uint32_t erk[AES_ROUND_KEY_SIZE / 4];   // encryption round keys
+    uint32_t drk[AES_ROUND_KEY_SIZE / 4];   // decryption round keys, equivalent inverse cipher
+#else
+    uint8_t key[AES_BLOCK_SIZE];            // key in the byte order of the CAU
+#endif
+} aes_ecb_ctx_t;
+
 /**
  * @detail:            Encryption. The length of plain and cipher should be one block (16 bytes).
  *                      The plaintext and ciphertext may point to the same memory
@@ -63,4 +90,37 @@ bool aes_ecb_decrypt_128(const uint8_t *keys, const uint8_t *ciphertext, uint8_t
 
 void aes_key_reverse_128(const uint8_t *input, uint8_t *output);
 
+/**
+ * @detail:            Prepare a key for aes_ecb_encrypt_blocks() and aes_ecb_decrypt_blocks().
+ * @par[out]ctx:       keyed context
+ * @par[in]keys:       128-bit key
+ */
+void aes_ecb_ctx_init(aes_ecb_ctx_t *ctx, const uint8_t *keys);
+
+/**
+ * @detail:            Clear the key material of a context.
+ * @par[in]ctx:        keyed context
+ */
+void aes_ecb_ctx_free(aes_ecb_ctx_t *ctx);
+
+/**
+ * @detail:            Encrypt a number of consecutive blocks with the key of ctx.
+ *                      The input and output may point to the same memory
+ * @par[in]ctx:         keyed context
+ * @par[in]input:       plain text, blocks x 16 bytes
+ * @par[out]output:     cipher text, blocks x 16 bytes
+ * @par[in]blocks:      number of blocks
+ */
+bool aes_ecb_encrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks);
+
+/**
+ * @detail:            Decrypt a number of consecutive blocks with the key of ctx.
+ *                      The input and output may point to the same memory
+ * @par[in]ctx:         keyed context
+ * @par[in]input:       cipher text, blocks x 16 bytes
+ * @par[out]output:     plain text, blocks x 16 bytes
+ * @par[in]blocks:      number of blocks
+ */
+bool aes_ecb_decrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks);
+
 #endif /* AES_ECB_H */
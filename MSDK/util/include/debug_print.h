@@ -55,6 +55,7 @@ OF SUCH DAMAGE.
 #define IP_ARG(a)           ((a) & 0xFF), (((a) >> 8) & 0xFF), (((a) >> 16) & 0xFF), ((a) >> 24)
 
 int co_printf(const char *format, ...);
+void co_printf_flush(void);
 int co_snprintf(char *out, int space, const char *format, ...);
 int print_buffer(unsigned long addr, void *data, unsigned long width, unsigned long count, unsigned long linelen);
 int print(char **out, const char *format, va_list args, int space);
@@ -533,6 +533,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
 void trace_console(uint16_t length, uint8_t *p_buf);
 uint16_t trace_count(void);
+uint32_t trace_drop_count(uint8_t type);
 uint16_t trace_print(uint16_t max_bytes);
 
 void trace_dma_print(void);
@@ -34,71 +34,101 @@ OF SUCH DAMAGE.
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "aes_ecb.h"
 
-#ifndef CFG_V6
-#include "mbedtls/aes.h"
+#ifndef AES_ECB_SOFT
+#include "gd32vw55x_cau.h"
 
-bool aes_ecb_encrypt_128(const uint8_t *keys, const uint8_t *plaintext, uint8_t *ciphertext)
+void aes_ecb_ctx_init(aes_ecb_ctx_t *ctx, const uint8_t *keys)
 {
-    mbedtls_aes_context aes_ctx;
-    uint8_t keys_rev[AES_BLOCK_SIZE], plaintext_rev[AES_BLOCK_SIZE];
-    uint8_t ciphertext_rev[AES_BLOCK_SIZE];
-
-    mbedtls_aes_init(&aes_ctx);
-    aes_key_reverse_128(keys, keys_rev);
-    aes_key_reverse_128(plaintext, plaintext_rev);
+    aes_key_reverse_128(keys, ctx->key);
+}
 
-    if ((mbedtls_aes_setkey_enc(&aes_ctx, (unsigned char *)keys_rev, 128)) != 0)
+/*
+ * Run the blocks through the CAU, the key is loaded once per AES_ECB_CAU_BATCH blocks
+ */
+static bool aes_ecb_cau(const aes_ecb_ctx_t *ctx, uint32_t alg_dir,
+                        const uint8_t *input, uint8_t *output, uint32_t blocks)
+{
+    uint32_t buf[AES_ECB_CAU_BATCH * AES_BLOCK_SIZE / 4];
+    uint8_t *data = (uint8_t *)buf;
+    cau_parameter_struct cau_aes_parameter;
+    ErrStatus ret;
+    uint32_t n, i;
+
+    cau_aes_parameter.alg_dir = alg_dir;
+    cau_aes_parameter.key = (uint8_t *)ctx->key;
+    cau_aes_parameter.key_size = 128;
+    cau_aes_parameter.input = data;
+
+    while (blocks > 0)
     {
-        return false;
-    }
+        n = (blocks > AES_ECB_CAU_BATCH) ? AES_ECB_CAU_BATCH : blocks;
 
-    if ((mbedtls_aes_crypt_ecb(&aes_ctx, MBEDTLS_AES_ENCRYPT,
-                               plaintext_rev, ciphertext_rev)) != 0)
-    {
-        return false;
+        for (i = 0; i < n; i++)
+        {
+            aes_key_reverse_128(input + i * AES_BLOCK_SIZE, data + i * AES_BLOCK_SIZE);
+        }
+
+        cau_aes_parameter.in_length = n * AES_BLOCK_SIZE;
+        CAU_LOCK();
+        ret = cau_aes_ecb(&cau_aes_parameter, data);
+        CAU_UNLOCK();
+        if (ret != SUCCESS)
+        {
+            return false;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            aes_key_reverse_128(data + i * AES_BLOCK_SIZE, output + i * AES_BLOCK_SIZE);
+        }
+
+        input += n * AES_BLOCK_SIZE;
+        output += n * AES_BLOCK_SIZE;
+        blocks -= n;
     }
 
-    aes_key_reverse_128(ciphertext_rev, ciphertext);
     return true;
 }
 
-bool aes_ecb_decrypt_128(const uint8_t *keys, const uint8_t *ciphertext, uint8_t *plaintext)
+bool aes_ecb_encrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks)
 {
-    mbedtls_aes_context aes_ctx;
-    uint8_t keys_rev[AES_BLOCK_SIZE], plaintext_rev[AES_BLOCK_SIZE];
-    uint8_t ciphertext_rev[AES_BLOCK_SIZE];
+    return aes_ecb_cau(ctx, CAU_ENCRYPT, input, output, blocks);
+}
 
-    mbedtls_aes_init(&aes_ctx);
-    aes_key_reverse_128(keys, keys_rev);
-    aes_key_reverse_128(ciphertext, ciphertext_rev);
+bool aes_ecb_decrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks)
+{
+    return aes_ecb_cau(ctx, CAU_DECRYPT, input, output, blocks);
+}
 
-    if ((mbedtls_aes_setkey_enc(&aes_ctx, (unsigned char *)keys_rev, 128)) != 0)
-    {
-        return false;
-    }
+bool aes_ecb_encrypt_128(const uint8_t *keys, const uint8_t *plaintext, uint8_t *ciphertext)
+{
+    aes_ecb_ctx_t ctx;
 
-    if ((mbedtls_aes_crypt_ecb(&aes_ctx, MBEDTLS_AES_DECRYPT,
-                               ciphertext_rev, plaintext_rev)) != 0)
-    {
-        return false;
-    }
+    aes_ecb_ctx_init(&ctx, keys);
+    return aes_ecb_cau(&ctx, CAU_ENCRYPT, plaintext, ciphertext, 1);
+}
 
-    aes_key_reverse_128(plaintext_rev, plaintext);
-    return true;
+bool aes_ecb_decrypt_128(const uint8_t *keys, const uint8_t *ciphertext, uint8_t *plaintext)
+{
+    aes_ecb_ctx_t ctx;
+
+    aes_ecb_ctx_init(&ctx, keys);
+    return aes_ecb_cau(&ctx, CAU_DECRYPT, ciphertext, plaintext, 1);
 }
 #else
 /*
  * round constants
  */
-static uint8_t RC[] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+static const uint8_t RC[] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
 
 /*
  * Sbox
  */
-static uint8_t SBOX[256] =
+static const uint8_t SBOX[256] =
 {
     0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
     0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
@@ -121,7 +151,7 @@ static uint8_t SBOX[256] =
 /*
  * Inverse Sboxs
  */
-static uint8_t INV_SBOX[256] =
+static const uint8_t INV_SBOX[256] =
 {
     0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
     0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
@@ -141,283 +171,300 @@ static uint8_t INV_SBOX[256] =
     0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
 };
 
-/**
- * Multiply two numbers in the GF(2^8) finite field defined
- * by the polynomial x^8 + x^4 + x^3 + x + 1 = 0
- * We do use mul2(int8_t a) but not mul(uint8_t a, uint8_t b)
- * just in order to get a higher speed.
+/*
+ * Forward table: SubBytes and MixColumns of one column, the other
+ * three tables are byte rotations of this one
  */
-static inline uint8_t mul2(uint8_t a)
+static const uint32_t TE0[256] =
 {
-    return (a & 0x80) ? ((a << 1) ^ 0x1b) : (a << 1);
-}
+    0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU, 0xfff2f20dU, 0xd66b6bbdU, 0xde6f6fb1U, 0x91c5c554U,
+    0x60303050U, 0x02010103U, 0xce6767a9U, 0x562b2b7dU, 0xe7fefe19U, 0xb5d7d762U, 0x4dababe6U, 0xec76769aU,
+    0x8fcaca45U, 0x1f82829dU, 0x89c9c940U, 0xfa7d7d87U, 0xeffafa15U, 0xb25959ebU, 0x8e4747c9U, 0xfbf0f00bU,
+    0x41adadecU, 0xb3d4d467U, 0x5fa2a2fdU, 0x45afafeaU, 0x239c9cbfU, 0x53a4a4f7U, 0xe4727296U, 0x9bc0c05bU,
+    0x75b7b7c2U, 0xe1fdfd1cU, 0x3d9393aeU, 0x4c26266aU, 0x6c36365aU, 0x7e3f3f41U, 0xf5f7f702U, 0x83cccc4fU,
+    0x6834345cU, 0x51a5a5f4U, 0xd1e5e534U, 0xf9f1f108U, 0xe2717193U, 0xabd8d873U, 0x62313153U, 0x2a15153fU,
+    0x0804040cU, 0x95c7c752U, 0x46232365U, 0x9dc3c35eU, 0x30181828U, 0x379696a1U, 0x0a05050fU, 0x2f9a9ab5U,
+    0x0e070709U, 0x24121236U, 0x1b80809bU, 0xdfe2e23dU, 0xcdebeb26U, 0x4e272769U, 0x7fb2b2cdU, 0xea75759fU,
+    0x1209091bU, 0x1d83839eU, 0x582c2c74U, 0x341a1a2eU, 0x361b1b2dU, 0xdc6e6eb2U, 0xb45a5aeeU, 0x5ba0a0fbU,
+    0xa45252f6U, 0x763b3b4dU, 0xb7d6d661U, 0x7db3b3ceU, 0x5229297bU, 0xdde3e33eU, 0x5e2f2f71U, 0x13848497U,
+    0xa65353f5U, 0xb9d1d168U, 0x00000000U, 0xc1eded2cU, 0x40202060U, 0xe3fcfc1fU, 0x79b1b1c8U, 0xb65b5bedU,
+    0xd46a6abeU, 0x8dcbcb46U, 0x67bebed9U, 0x7239394bU, 0x944a4adeU, 0x984c4cd4U, 0xb05858e8U, 0x85cfcf4aU,
+    0xbbd0d06bU, 0xc5efef2aU, 0x4faaaae5U, 0xedfbfb16U, 0x864343c5U, 0x9a4d4dd7U, 0x66333355U, 0x11858594U,
+    0x8a4545cfU, 0xe9f9f910U, 0x04020206U, 0xfe7f7f81U, 0xa05050f0U, 0x783c3c44U, 0x259f9fbaU, 0x4ba8a8e3U,
+    0xa25151f3U, 0x5da3a3feU, 0x804040c0U, 0x058f8f8aU, 0x3f9292adU, 0x219d9dbcU, 0x70383848U, 0xf1f5f504U,
+    0x63bcbcdfU, 0x77b6b6c1U, 0xafdada75U, 0x42212163U, 0x20101030U, 0xe5ffff1aU, 0xfdf3f30eU, 0xbfd2d26dU,
+    0x81cdcd4cU, 0x180c0c14U, 0x26131335U, 0xc3ecec2fU, 0xbe5f5fe1U, 0x359797a2U, 0x884444ccU, 0x2e171739U,
+    0x93c4c457U, 0x55a7a7f2U, 0xfc7e7e82U, 0x7a3d3d47U, 0xc86464acU, 0xba5d5de7U, 0x3219192bU, 0xe6737395U,
+    0xc06060a0U, 0x19818198U, 0x9e4f4fd1U, 0xa3dcdc7fU, 0x44222266U, 0x542a2a7eU, 0x3b9090abU, 0x0b888883U,
+    0x8c4646caU, 0xc7eeee29U, 0x6bb8b8d3U, 0x2814143cU, 0xa7dede79U, 0xbc5e5ee2U, 0x160b0b1dU, 0xaddbdb76U,
+    0xdbe0e03bU, 0x64323256U, 0x743a3a4eU, 0x140a0a1eU, 0x924949dbU, 0x0c06060aU, 0x4824246cU, 0xb85c5ce4U,
+    0x9fc2c25dU, 0xbdd3d36eU, 0x43acacefU, 0xc46262a6U, 0x399191a8U, 0x319595a4U, 0xd3e4e437U, 0xf279798bU,
+    0xd5e7e732U, 0x8bc8c843U, 0x6e373759U, 0xda6d6db7U, 0x018d8d8cU, 0xb1d5d564U, 0x9c4e4ed2U, 0x49a9a9e0U,
+    0xd86c6cb4U, 0xac5656faU, 0xf3f4f407U, 0xcfeaea25U, 0xca6565afU, 0xf47a7a8eU, 0x47aeaee9U, 0x10080818U,
+    0x6fbabad5U, 0xf0787888U, 0x4a25256fU, 0x5c2e2e72U, 0x381c1c24U, 0x57a6a6f1U, 0x73b4b4c7U, 0x97c6c651U,
+    0xcbe8e823U, 0xa1dddd7cU, 0xe874749cU, 0x3e1f1f21U, 0x964b4bddU, 0x61bdbddcU, 0x0d8b8b86U, 0x0f8a8a85U,
+    0xe0707090U, 0x7c3e3e42U, 0x71b5b5c4U, 0xcc6666aaU, 0x904848d8U, 0x06030305U, 0xf7f6f601U, 0x1c0e0e12U,
+    0xc26161a3U, 0x6a35355fU, 0xae5757f9U, 0x69b9b9d0U, 0x17868691U, 0x99c1c158U, 0x3a1d1d27U, 0x279e9eb9U,
+    0xd9e1e138U, 0xebf8f813U, 0x2b9898b3U, 0x22111133U, 0xd26969bbU, 0xa9d9d970U, 0x078e8e89U, 0x339494a7U,
+    0x2d9b9bb6U, 0x3c1e1e22U, 0x15878792U, 0xc9e9e920U, 0x87cece49U, 0xaa5555ffU, 0x50282878U, 0xa5dfdf7aU,
+    0x038c8c8fU, 0x59a1a1f8U, 0x09898980U, 0x1a0d0d17U, 0x65bfbfdaU, 0xd7e6e631U, 0x844242c6U, 0xd06868b8U,
+    0x824141c3U, 0x299999b0U, 0x5a2d2d77U, 0x1e0f0f11U, 0x7bb0b0cbU, 0xa85454fcU, 0x6dbbbbd6U, 0x2c16163aU
+};
 
-/**
- * @purpose:    ShiftRows
- * @descrption:
- *  Row0: s0  s4  s8  s12   <<< 0 byte
- *  Row1: s1  s5  s9  s13   <<< 1 byte
- *  Row2: s2  s6  s10 s14   <<< 2 bytes
- *  Row3: s3  s7  s11 s15   <<< 3 bytes
+/*
+ * Reverse table: InvSubBytes and InvMixColumns of one column
  */
-static void shift_rows(uint8_t *state)
+static const uint32_t TD0[256] =
 {
-    uint8_t temp;
-    // row1
-    temp        = *(state + 1);
-    *(state + 1)  = *(state + 5);
-    *(state + 5)  = *(state + 9);
-    *(state + 9)  = *(state + 13);
-    *(state + 13) = temp;
-    // row2
-    temp        = *(state + 2);
-    *(state + 2)  = *(state + 10);
-    *(state + 10) = temp;
-    temp        = *(state + 6);
-    *(state + 6)  = *(state + 14);
-    *(state + 14) = temp;
-    // row3
-    temp        = *(state + 15);
-    *(state + 15) = *(state + 11);
-    *(state + 11) = *(state + 7);
-    *(state + 7)  = *(state + 3);
-    *(state + 3)  = temp;
-}
+    0x51f4a750U, 0x7e416553U, 0x1a17a4c3U, 0x3a275e96U, 0x3bab6bcbU, 0x1f9d45f1U, 0xacfa58abU, 0x4be30393U,
+    0x2030fa55U, 0xad766df6U, 0x88cc7691U, 0xf5024c25U, 0x4fe5d7fcU, 0xc52acbd7U, 0x26354480U, 0xb562a38fU,
+    0xdeb15a49U, 0x25ba1b67U, 0x45ea0e98U, 0x5dfec0e1U, 0xc32f7502U, 0x814cf012U, 0x8d4697a3U, 0x6bd3f9c6U,
+    0x038f5fe7U, 0x15929c95U, 0xbf6d7aebU, 0x955259daU, 0xd4be832dU, 0x587421d3U, 0x49e06929U, 0x8ec9c844U,
+    0x75c2896aU, 0xf48e7978U, 0x99583e6bU, 0x27b971ddU, 0xbee14fb6U, 0xf088ad17U, 0xc920ac66U, 0x7dce3ab4U,
+    0x63df4a18U, 0xe51a3182U, 0x97513360U, 0x62537f45U, 0xb16477e0U, 0xbb6bae84U, 0xfe81a01cU, 0xf9082b94U,
+    0x70486858U, 0x8f45fd19U, 0x94de6c87U, 0x527bf8b7U, 0xab73d323U, 0x724b02e2U, 0xe31f8f57U, 0x6655ab2aU,
+    0xb2eb2807U, 0x2fb5c203U, 0x86c57b9aU, 0xd33708a5U, 0x302887f2U, 0x23bfa5b2U, 0x02036abaU, 0xed16825cU,
+    0x8acf1c2bU, 0xa779b492U, 0xf307f2f0U, 0x4e69e2a1U, 0x65daf4cdU, 0x0605bed5U, 0xd134621fU, 0xc4a6fe8aU,
+    0x342e539dU, 0xa2f355a0U, 0x058ae132U, 0xa4f6eb75U, 0x0b83ec39U, 0x4060efaaU, 0x5e719f06U, 0xbd6e1051U,
+    0x3e218af9U, 0x96dd063dU, 0xdd3e05aeU, 0x4de6bd46U, 0x91548db5U, 0x71c45d05U, 0x0406d46fU, 0x605015ffU,
+    0x1998fb24U, 0xd6bde997U, 0x894043ccU, 0x67d99e77U, 0xb0e842bdU, 0x07898b88U, 0xe7195b38U, 0x79c8eedbU,
+    0xa17c0a47U, 0x7c420fe9U, 0xf8841ec9U, 0x00000000U, 0x09808683U, 0x322bed48U, 0x1e1170acU, 0x6c5a724eU,
+    0xfd0efffbU, 0x0f853856U, 0x3daed51eU, 0x362d3927U, 0x0a0fd964U, 0x685ca621U, 0x9b5b54d1U, 0x24362e3aU,
+    0x0c0a67b1U, 0x9357e70fU, 0xb4ee96d2U, 0x1b9b919eU, 0x80c0c54fU, 0x61dc20a2U, 0x5a774b69U, 0x1c121a16U,
+    0xe293ba0aU, 0xc0a02ae5U, 0x3c22e043U, 0x121b171dU, 0x0e090d0bU, 0xf28bc7adU, 0x2db6a8b9U, 0x141ea9c8U,
+    0x57f11985U, 0xaf75074cU, 0xee99ddbbU, 0xa37f60fdU, 0xf701269fU, 0x5c72f5bcU, 0x44663bc5U, 0x5bfb7e34U,
+    0x8b432976U, 0xcb23c6dcU, 0xb6edfc68U, 0xb8e4f163U, 0xd731dccaU, 0x42638510U, 0x13972240U, 0x84c61120U,
+    0x854a247dU, 0xd2bb3df8U, 0xaef93211U, 0xc729a16dU, 0x1d9e2f4bU, 0xdcb230f3U, 0x0d8652ecU, 0x77c1e3d0U,
+    0x2bb3166cU, 0xa970b999U, 0x119448faU, 0x47e96422U, 0xa8fc8cc4U, 0xa0f03f1aU, 0x567d2cd8U, 0x223390efU,
+    0x87494ec7U, 0xd938d1c1U, 0x8ccaa2feU, 0x98d40b36U, 0xa6f581cfU, 0xa57ade28U, 0xdab78e26U, 0x3fadbfa4U,
+    0x2c3a9de4U, 0x5078920dU, 0x6a5fcc9bU, 0x547e4662U, 0xf68d13c2U, 0x90d8b8e8U, 0x2e39f75eU, 0x82c3aff5U,
+    0x9f5d80beU, 0x69d0937cU, 0x6fd52da9U, 0xcf2512b3U, 0xc8ac993bU, 0x10187da7U, 0xe89c636eU, 0xdb3bbb7bU,
+    0xcd267809U, 0x6e5918f4U, 0xec9ab701U, 0x834f9aa8U, 0xe6956e65U, 0xaaffe67eU, 0x21bccf08U, 0xef15e8e6U,
+    0xbae79bd9U, 0x4a6f36ceU, 0xea9f09d4U, 0x29b07cd6U, 0x31a4b2afU, 0x2a3f2331U, 0xc6a59430U, 0x35a266c0U,
+    0x744ebc37U, 0xfc82caa6U, 0xe090d0b0U, 0x33a7d815U, 0xf104984aU, 0x41ecdaf7U, 0x7fcd500eU, 0x1791f62fU,
+    0x764dd68dU, 0x43efb04dU, 0xccaa4d54U, 0xe49604dfU, 0x9ed1b5e3U, 0x4c6a881bU, 0xc12c1fb8U, 0x4665517fU,
+    0x9d5eea04U, 0x018c355dU, 0xfa877473U, 0xfb0b412eU, 0xb3671d5aU, 0x92dbd252U, 0xe9105633U, 0x6dd64713U,
+    0x9ad7618cU, 0x37a10c7aU, 0x59f8148eU, 0xeb133c89U, 0xcea927eeU, 0xb761c935U, 0xe11ce5edU, 0x7a47b13cU,
+    0x9cd2df59U, 0x55f2733fU, 0x1814ce79U, 0x73c737bfU, 0x53f7cdeaU, 0x5ffdaa5bU, 0xdf3d6f14U, 0x7844db86U,
+    0xcaaff381U, 0xb968c43eU, 0x3824342cU, 0xc2a3405fU, 0x161dc372U, 0xbce2250cU, 0x283c498bU, 0xff0d9541U,
+    0x39a80171U, 0x080cb3deU, 0xd8b4e49cU, 0x6456c190U, 0x7bcb8461U, 0xd532b670U, 0x486c5c74U, 0xd0b85742U
+};
+
+#define ROR8(x)     (((x) >> 8) | ((x) << 24))
+#define ROR16(x)    (((x) >> 16) | ((x) << 16))
+#define ROR24(x)    (((x) >> 24) | ((x) << 8))
 
-/**
- * @purpose:    Inverse ShiftRows
- * @description
- *  Row0: s0  s4  s8  s12   >>> 0 byte
- *  Row1: s1  s5  s9  s13   >>> 1 byte
- *  Row2: s2  s6  s10 s14   >>> 2 bytes
- *  Row3: s3  s7  s11 s15   >>> 3 bytes
+/*
+ * Blocks and keys are little endian, i.e. the last byte is the first byte of
+ * the AES state: word n of the state is the little endian word at 12 - 4n.
  */
-static void inv_shift_rows(uint8_t *state)
+static inline uint32_t get_word(const uint8_t *p, int n)
 {
-    uint8_t temp;
-    // row1
-    temp        = *(state + 13);
-    *(state + 13) = *(state + 9);
-    *(state + 9)  = *(state + 5);
-    *(state + 5)  = *(state + 1);
-    *(state + 1)  = temp;
-    // row2
-    temp        = *(state + 14);
-    *(state + 14) = *(state + 6);
-    *(state + 6)  = temp;
-    temp        = *(state + 10);
-    *(state + 10) = *(state + 2);
-    *(state + 2)  = temp;
-    // row3
-    temp        = *(state + 3);
-    *(state + 3)  = *(state + 7);
-    *(state + 7)  = *(state + 11);
-    *(state + 11) = *(state + 15);
-    *(state + 15) = temp;
+    p += 12 - 4 * n;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-static void aes_key_schedule_128(const uint8_t *key, uint8_t *roundkeys)
+static inline void put_word(uint8_t *p, int n, uint32_t v)
 {
+    p += 12 - 4 * n;
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
 
-    uint8_t temp[4];
-    uint8_t *last4bytes; // point to the last 4 bytes of one round
-    uint8_t *lastround;
+static void aes_key_schedule_128(const uint8_t *key, uint32_t *erk)
+{
+    uint32_t t;
     uint8_t i;
 
-    for (i = 0; i < 16; ++i)
+    for (i = 0; i < 4; ++i)
     {
-        *roundkeys++ = *key++;
+        erk[i] = get_word(key, i);
     }
 
-    last4bytes = roundkeys - 4;
-    for (i = 0; i < AES_ROUNDS; ++i)
+    for (i = 0; i < AES_ROUNDS; ++i, erk += 4)
     {
-        // k0-k3 for next round
-        temp[3] = SBOX[*last4bytes++];
-        temp[0] = SBOX[*last4bytes++];
-        temp[1] = SBOX[*last4bytes++];
-        temp[2] = SBOX[*last4bytes++];
-        temp[0] ^= RC[i];
-        lastround = roundkeys - 16;
-        *roundkeys++ = temp[0] ^ *lastround++;
-        *roundkeys++ = temp[1] ^ *lastround++;
-        *roundkeys++ = temp[2] ^ *lastround++;
-        *roundkeys++ = temp[3] ^ *lastround++;
-        // k4-k7 for next round
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        // k8-k11 for next round
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        // k12-k15 for next round
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
-        *roundkeys++ = *last4bytes++ ^ *lastround++;
+        // SubWord(RotWord(w3)) ^ Rcon
+        t = erk[3];
+        t = ((uint32_t)SBOX[(t >> 16) & 0xff] << 24) ^ ((uint32_t)SBOX[(t >> 8) & 0xff] << 16) ^
+            ((uint32_t)SBOX[t & 0xff] << 8) ^ (uint32_t)SBOX[t >> 24] ^ ((uint32_t)RC[i] << 24);
+        erk[4] = erk[0] ^ t;
+        erk[5] = erk[1] ^ erk[4];
+        erk[6] = erk[2] ^ erk[5];
+        erk[7] = erk[3] ^ erk[6];
     }
 }
 
-bool aes_ecb_encrypt_128(const uint8_t *keys, const uint8_t *plaintext, uint8_t *ciphertext)
+/*
+ * Round keys of the equivalent inverse cipher: encryption round keys in
+ * reverse order, InvMixColumns applied to all but the first and last.
+ */
+static void aes_key_schedule_dec_128(const uint32_t *erk, uint32_t *drk)
 {
-
-    uint8_t tmp[16], keys_rev[AES_BLOCK_SIZE], plaintext_rev[AES_BLOCK_SIZE], t;
+    uint32_t w;
     uint8_t i, j;
-    uint8_t roundarray[AES_ROUND_KEY_SIZE] = {0};
-    uint8_t *roundkeys = roundarray;
 
-    aes_key_reverse_128(keys, keys_rev);
-    aes_key_reverse_128(plaintext, plaintext_rev);
-
-    aes_key_schedule_128(keys_rev, roundkeys);
-    // first AddRoundKey
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+    erk += AES_ROUNDS * 4;
+    for (j = 0; j < 4; ++j)
     {
-        *(ciphertext + i) = *(plaintext_rev + i) ^ *roundkeys++;
+        *drk++ = erk[j];
     }
 
-    // 9 rounds
-    for (j = 1; j < AES_ROUNDS; ++j)
+    for (i = 1; i < AES_ROUNDS; ++i)
     {
-
-        // SubBytes
-        for (i = 0; i < AES_BLOCK_SIZE; ++i)
-        {
-            *(tmp + i) = SBOX[*(ciphertext + i)];
-        }
-        shift_rows(tmp);
-        /*
-         * MixColumns
-         * [02 03 01 01]   [s0  s4  s8  s12]
-         * [01 02 03 01] . [s1  s5  s9  s13]
-         * [01 01 02 03]   [s2  s6  s10 s14]
-         * [03 01 01 02]   [s3  s7  s11 s15]
-         */
-        for (i = 0; i < AES_BLOCK_SIZE; i += 4)
+        erk -= 4;
+        for (j = 0; j < 4; ++j)
         {
-            t = tmp[i] ^ tmp[i + 1] ^ tmp[i + 2] ^ tmp[i + 3];
-            ciphertext[i]   = mul2(tmp[i]   ^ tmp[i + 1]) ^ tmp[i]   ^ t;
-            ciphertext[i + 1] = mul2(tmp[i + 1] ^ tmp[i + 2]) ^ tmp[i + 1] ^ t;
-            ciphertext[i + 2] = mul2(tmp[i + 2] ^ tmp[i + 3]) ^ tmp[i + 2] ^ t;
-            ciphertext[i + 3] = mul2(tmp[i + 3] ^ tmp[i]) ^ tmp[i + 3] ^ t;
+            w = erk[j];
+            *drk++ = TD0[SBOX[w >> 24]] ^ ROR8(TD0[SBOX[(w >> 16) & 0xff]]) ^
+                     ROR16(TD0[SBOX[(w >> 8) & 0xff]]) ^ ROR24(TD0[SBOX[w & 0xff]]);
         }
-
-        // AddRoundKey
-        for (i = 0; i < AES_BLOCK_SIZE; ++i)
-        {
-            *(ciphertext + i) ^= *roundkeys++;
-        }
-
-    }
-
-    // last round
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
-    {
-        *(ciphertext + i) = SBOX[*(ciphertext + i)];
-    }
-    shift_rows(ciphertext);
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
-    {
-        *(ciphertext + i) ^= *roundkeys++;
     }
 
-    for (i = 0; i < (AES_BLOCK_SIZE / 2); ++i)
+    erk -= 4;
+    for (j = 0; j < 4; ++j)
     {
-        ciphertext[i] = ciphertext[AES_BLOCK_SIZE - 1 - i];
+        *drk++ = erk[j];
     }
-    return true;
 }
 
-bool aes_ecb_decrypt_128(const uint8_t *keys, const uint8_t *ciphertext, uint8_t *plaintext)
+static void aes_ecb_encrypt_block(const uint32_t *rk, const uint8_t *input, uint8_t *output)
 {
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    uint8_t r;
 
-    uint8_t tmp[16], keys_rev[AES_BLOCK_SIZE], ciphertext_rev[AES_BLOCK_SIZE];
-    uint8_t t, u, v;
-    uint8_t i, j;
-    uint8_t roundarray[AES_ROUND_KEY_SIZE] = {0};
-    uint8_t *roundkeys = roundarray;
-
-    aes_key_reverse_128(keys, keys_rev);
-    aes_key_reverse_128(ciphertext, ciphertext_rev);
-
-    aes_key_schedule_128(keys, roundkeys);
-    roundkeys += 160;
+    s0 = get_word(input, 0) ^ rk[0];
+    s1 = get_word(input, 1) ^ rk[1];
+    s2 = get_word(input, 2) ^ rk[2];
+    s3 = get_word(input, 3) ^ rk[3];
 
-    // first round
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
-    {
-        *(plaintext + i) = *(ciphertext + i) ^ *(roundkeys + i);
-    }
-    roundkeys -= 16;
-    inv_shift_rows(plaintext);
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+    // SubBytes, ShiftRows, MixColumns and AddRoundKey, one table lookup per byte
+    for (r = 1; r < AES_ROUNDS; ++r)
     {
-        *(plaintext + i) = INV_SBOX[*(plaintext + i)];
+        rk += 4;
+        t0 = TE0[s0 >> 24] ^ ROR8(TE0[(s1 >> 16) & 0xff]) ^ ROR16(TE0[(s2 >> 8) & 0xff]) ^ ROR24(TE0[s3 & 0xff]) ^ rk[0];
+        t1 = TE0[s1 >> 24] ^ ROR8(TE0[(s2 >> 16) & 0xff]) ^ ROR16(TE0[(s3 >> 8) & 0xff]) ^ ROR24(TE0[s0 & 0xff]) ^ rk[1];
+        t2 = TE0[s2 >> 24] ^ ROR8(TE0[(s3 >> 16) & 0xff]) ^ ROR16(TE0[(s0 >> 8) & 0xff]) ^ ROR24(TE0[s1 & 0xff]) ^ rk[2];
+        t3 = TE0[s3 >> 24] ^ ROR8(TE0[(s0 >> 16) & 0xff]) ^ ROR16(TE0[(s1 >> 8) & 0xff]) ^ ROR24(TE0[s2 & 0xff]) ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
     }
 
-    for (j = 1; j < AES_ROUNDS; ++j)
-    {
-
-        // Inverse AddRoundKey
-        for (i = 0; i < AES_BLOCK_SIZE; ++i)
-        {
-            *(tmp + i) = *(plaintext + i) ^ *(roundkeys + i);
-        }
+    // last round, no MixColumns
+    rk += 4;
+    t0 = ((uint32_t)SBOX[s0 >> 24] << 24) ^ ((uint32_t)SBOX[(s1 >> 16) & 0xff] << 16) ^
+         ((uint32_t)SBOX[(s2 >> 8) & 0xff] << 8) ^ (uint32_t)SBOX[s3 & 0xff] ^ rk[0];
+    t1 = ((uint32_t)SBOX[s1 >> 24] << 24) ^ ((uint32_t)SBOX[(s2 >> 16) & 0xff] << 16) ^
+         ((uint32_t)SBOX[(s3 >> 8) & 0xff] << 8) ^ (uint32_t)SBOX[s0 & 0xff] ^ rk[1];
+    t2 = ((uint32_t)SBOX[s2 >> 24] << 24) ^ ((uint32_t)SBOX[(s3 >> 16) & 0xff] << 16) ^
+         ((uint32_t)SBOX[(s0 >> 8) & 0xff] << 8) ^ (uint32_t)SBOX[s1 & 0xff] ^ rk[2];
+    t3 = ((uint32_t)SBOX[s3 >> 24] << 24) ^ ((uint32_t)SBOX[(s0 >> 16) & 0xff] << 16) ^
+         ((uint32_t)SBOX[(s1 >> 8) & 0xff] << 8) ^ (uint32_t)SBOX[s2 & 0xff] ^ rk[3];
+
+    put_word(output, 0, t0);
+    put_word(output, 1, t1);
+    put_word(output, 2, t2);
+    put_word(output, 3, t3);
+}
 
-        /*
-         * Inverse MixColumns
-         * [0e 0b 0d 09]   [s0  s4  s8  s12]
-         * [09 0e 0b 0d] . [s1  s5  s9  s13]
-         * [0d 09 0e 0b]   [s2  s6  s10 s14]
-         * [0b 0d 09 0e]   [s3  s7  s11 s15]
-         */
-        for (i = 0; i < AES_BLOCK_SIZE; i += 4)
-        {
-            t = tmp[i] ^ tmp[i + 1] ^ tmp[i + 2] ^ tmp[i + 3];
-            plaintext[i]   = t ^ tmp[i]   ^ mul2(tmp[i]   ^ tmp[i + 1]);
-            plaintext[i + 1] = t ^ tmp[i + 1] ^ mul2(tmp[i + 1] ^ tmp[i + 2]);
-            plaintext[i + 2] = t ^ tmp[i + 2] ^ mul2(tmp[i + 2] ^ tmp[i + 3]);
-            plaintext[i + 3] = t ^ tmp[i + 3] ^ mul2(tmp[i + 3] ^ tmp[i]);
-            u = mul2(mul2(tmp[i]   ^ tmp[i + 2]));
-            v = mul2(mul2(tmp[i + 1] ^ tmp[i + 3]));
-            t = mul2(u ^ v);
-            plaintext[i]   ^= t ^ u;
-            plaintext[i + 1] ^= t ^ v;
-            plaintext[i + 2] ^= t ^ u;
-            plaintext[i + 3] ^= t ^ v;
-        }
+static void aes_ecb_decrypt_block(const uint32_t *rk, const uint8_t *input, uint8_t *output)
+{
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    uint8_t r;
 
-        // Inverse ShiftRows
-        inv_shift_rows(plaintext);
+    s0 = get_word(input, 0) ^ rk[0];
+    s1 = get_word(input, 1) ^ rk[1];
+    s2 = get_word(input, 2) ^ rk[2];
+    s3 = get_word(input, 3) ^ rk[3];
 
-        // Inverse SubBytes
-        for (i = 0; i < AES_BLOCK_SIZE; ++i)
-        {
-            *(plaintext + i) = INV_SBOX[*(plaintext + i)];
-        }
+    // InvSubBytes, InvShiftRows, InvMixColumns and AddRoundKey, one table lookup per byte
+    for (r = 1; r < AES_ROUNDS; ++r)
+    {
+        rk += 4;
+        t0 = TD0[s0 >> 24] ^ ROR8(TD0[(s3 >> 16) & 0xff]) ^ ROR16(TD0[(s2 >> 8) & 0xff]) ^ ROR24(TD0[s1 & 0xff]) ^ rk[0];
+        t1 = TD0[s1 >> 24] ^ ROR8(TD0[(s0 >> 16) & 0xff]) ^ ROR16(TD0[(s3 >> 8) & 0xff]) ^ ROR24(TD0[s2 & 0xff]) ^ rk[1];
+        t2 = TD0[s2 >> 24] ^ ROR8(TD0[(s1 >> 16) & 0xff]) ^ ROR16(TD0[(s0 >> 8) & 0xff]) ^ ROR24(TD0[s3 & 0xff]) ^ rk[2];
+        t3 = TD0[s3 >> 24] ^ ROR8(TD0[(s2 >> 16) & 0xff]) ^ ROR16(TD0[(s1 >> 8) & 0xff]) ^ ROR24(TD0[s0 & 0xff]) ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
 
-        roundkeys -= 16;
+    // last round, no InvMixColumns
+    rk += 4;
+    t0 = ((uint32_t)INV_SBOX[s0 >> 24] << 24) ^ ((uint32_t)INV_SBOX[(s3 >> 16) & 0xff] << 16) ^
+         ((uint32_t)INV_SBOX[(s2 >> 8) & 0xff] << 8) ^ (uint32_t)INV_SBOX[s1 & 0xff] ^ rk[0];
+    t1 = ((uint32_t)INV_SBOX[s1 >> 24] << 24) ^ ((uint32_t)INV_SBOX[(s0 >> 16) & 0xff] << 16) ^
+         ((uint32_t)INV_SBOX[(s3 >> 8) & 0xff] << 8) ^ (uint32_t)INV_SBOX[s2 & 0xff] ^ rk[1];
+    t2 = ((uint32_t)INV_SBOX[s2 >> 24] << 24) ^ ((uint32_t)INV_SBOX[(s1 >> 16) & 0xff] << 16) ^
+         ((uint32_t)INV_SBOX[(s0 >> 8) & 0xff] << 8) ^ (uint32_t)INV_SBOX[s3 & 0xff] ^ rk[2];
+    t3 = ((uint32_t)INV_SBOX[s3 >> 24] << 24) ^ ((uint32_t)INV_SBOX[(s2 >> 16) & 0xff] << 16) ^
+         ((uint32_t)INV_SBOX[(s1 >> 8) & 0xff] << 8) ^ (uint32_t)INV_SBOX[s0 & 0xff] ^ rk[3];
+
+    put_word(output, 0, t0);
+    put_word(output, 1, t1);
+    put_word(output, 2, t2);
+    put_word(output, 3, t3);
+}
 
-    }
+void aes_ecb_ctx_init(aes_ecb_ctx_t *ctx, const uint8_t *keys)
+{
+    aes_key_schedule_128(keys, ctx->erk);
+    aes_key_schedule_dec_128(ctx->erk, ctx->drk);
+}
 
-    // last AddRoundKey
-    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+bool aes_ecb_encrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks)
+{
+    for (; blocks > 0; blocks--, input += AES_BLOCK_SIZE, output += AES_BLOCK_SIZE)
     {
-        *(plaintext + i) ^= *(roundkeys + i);
+        aes_ecb_encrypt_block(ctx->erk, input, output);
     }
+    return true;
+}
 
-    for (i = 0; i < (AES_BLOCK_SIZE / 2); ++i)
+bool aes_ecb_decrypt_blocks(const aes_ecb_ctx_t *ctx, const uint8_t *input, uint8_t *output, uint32_t blocks)
+{
+    for (; blocks > 0; blocks--, input += AES_BLOCK_SIZE, output += AES_BLOCK_SIZE)
     {
-        plaintext[i] = plaintext[AES_BLOCK_SIZE - 1 - i];
+        aes_ecb_decrypt_block(ctx->drk, input, output);
     }
+    return true;
+}
+
+bool aes_ecb_encrypt_128(const uint8_t *keys, const uint8_t *plaintext, uint8_t *ciphertext)
+{
+    uint32_t erk[AES_ROUND_KEY_SIZE / 4];
 
+    aes_key_schedule_128(keys, erk);
+    aes_ecb_encrypt_block(erk, plaintext, ciphertext);
+    return true;
+}
+
+bool aes_ecb_decrypt_128(const uint8_t *keys, const uint8_t *ciphertext, uint8_t *plaintext)
+{
+    aes_ecb_ctx_t ctx;
+
+    aes_ecb_ctx_init(&ctx, keys);
+    aes_ecb_decrypt_block(ctx.drk, ciphertext, plaintext);
     return true;
 }
 #endif
 
+void aes_ecb_ctx_free(aes_ecb_ctx_t *ctx)
+{
+    volatile uint8_t *p = (volatile uint8_t *)ctx;
+    uint32_t n = sizeof(aes_ecb_ctx_t);
+
+    while (n--)
+    {
+        *p++ = 0;
+    }
+}
+
 void aes_key_reverse_128(const uint8_t *input, uint8_t *output)
 {
     int i;
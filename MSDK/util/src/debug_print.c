@@ -35,6 +35,7 @@ OF SUCH DAMAGE.
 #include <stdarg.h>
 #include <string.h>
 #include <stdint.h>
+#include "gd32vw55x.h"
 #include "debug_print.h"
 #include "wrapper_os.h"
 #include "trace_ext.h"
@@ -46,6 +47,16 @@ OF SUCH DAMAGE.
 #define FLAG_SHORT_SUPPORTED
 
 //#define CONFIG_PRINT_IN_SEQUENCE
+//#define CONFIG_PRINT_DEFERRED
+//#define CONFIG_PRINT_DEFERRED_RAW
+
+#if defined(CONFIG_PRINT_IN_SEQUENCE) && defined(CONFIG_PRINT_DEFERRED)
+#error "CONFIG_PRINT_IN_SEQUENCE and CONFIG_PRINT_DEFERRED are exclusive"
+#endif
+
+#if defined(CONFIG_PRINT_DEFERRED_RAW) && (!defined(CONFIG_PRINT_DEFERRED) || !defined(LOG_UART))
+#error "CONFIG_PRINT_DEFERRED_RAW requires CONFIG_PRINT_DEFERRED and LOG_UART"
+#endif
 
 // States values
 enum
@@ -117,6 +128,45 @@ static int print_task_init = 0;
 static int w_point = 0, r_point = 0, used_len = 0;
 #endif
 
+#ifdef CONFIG_PRINT_DEFERRED
+/*
+ * co_printf() only records the format string address and the raw 32-bit
+ * arguments in dlog_buf, formatting is done later by the print task. With
+ * CONFIG_PRINT_DEFERRED_RAW the records are sent to LOG_UART unformatted and
+ * decoded on the host against the ELF file (scripts/dlogtool/dlog_decode.py).
+ *
+ * Record: | hdr | format | argv[argc] | copies of the %s, %pM and %pI data |
+ * hdr:    magic[31:24] argc[23:16] record length in words[15:0]
+ * A record is never split, the end of the buffer is skipped with a pad record.
+ */
+#define DLOG_BUF_WORDS          2048        // must be a power of 2
+#define DLOG_ARGS_MAX           16
+#define DLOG_STR_MAX            64          // %s strings are truncated to this length
+#define DLOG_LINE_LEN           256
+
+#define DLOG_MAGIC_LOG          0xA5
+#define DLOG_MAGIC_PAD          0x5A
+
+#define DLOG_HDR(magic, argc, words) (((uint32_t)(magic) << 24) | ((uint32_t)(argc) << 16) | (uint32_t)(words))
+#define DLOG_HDR_MAGIC(hdr)     ((hdr) >> 24)
+#define DLOG_HDR_ARGC(hdr)      (((hdr) >> 16) & 0xFF)
+#define DLOG_HDR_WORDS(hdr)     ((hdr) & 0xFFFF)
+
+static uint32_t dlog_buf[DLOG_BUF_WORDS];
+static volatile uint32_t dlog_wr = 0, dlog_rd = 0;   // free running word indexes
+static uint32_t dlog_drop = 0;
+static os_sema_t dlog_sema;
+static int dlog_task_init = 0;
+#endif
+
+// Source of the arguments consumed by print_fmt()
+struct print_args
+{
+    va_list *ap;            // variadic arguments, NULL to use argv
+    const uint32_t *argv;   // arguments captured by the deferred print
+    uint32_t argc;
+};
+
 static void printchar(char **str, int c, int *space)
 {
     if (!str) {
@@ -230,7 +280,19 @@ static int printi(char **out, int i, int b, int sg, int wdt, int pad_data_format
     return pc + prints (out, s, wdt, pad_data_format, space);
 }
 
-int print(char **out, const char *format, va_list args, int space)
+static int print_arg(struct print_args *pa)
+{
+    if (pa->ap)
+        return va_arg(*pa->ap, int);
+
+    if (pa->argc == 0)
+        return 0;
+
+    pa->argc--;
+    return (int)*pa->argv++;
+}
+
+static int print_fmt(char **out, const char *format, struct print_args *pa, int space)
 {
     register int width, pad_data_format;
     register int pc = 0;
@@ -271,13 +333,13 @@ int print(char **out, const char *format, va_list args, int space)
             }
 
             if (*format == 's') {
-                register char *s = (char *)va_arg(args, int);
+                register char *s = (char *)print_arg(pa);
                 pc += prints(out, s ? s : "(null)", width, pad_data_format, &space);
                 continue;
             }
 
             if (*format == 'd') {
-                pc += printi(out, va_arg(args, int), 10, 1, width, pad_data_format, 'a', &space);
+                pc += printi(out, print_arg(pa), 10, 1, width, pad_data_format, 'a', &space);
                 continue;
             }
 
@@ -288,7 +350,7 @@ int print(char **out, const char *format, va_list args, int space)
                 case 'M':
                     width = 2;
                     pad_data_format |= PAD_WITH_ZERO;
-                    addr = (unsigned char *)va_arg(args, int);
+                    addr = (unsigned char *)print_arg(pa);
                     for (i = 0; i < 5; i++) {
                         pc += printi(out, addr[i], 16, 1, width, pad_data_format, 'a', &space);
                         printchar(out, ':', &space);
@@ -297,7 +359,7 @@ int print(char **out, const char *format, va_list args, int space)
                     pc += printi(out, addr[i], 16, 1, width, pad_data_format, 'a', &space);
                     continue;
                 case 'I':
-                    addr = (unsigned char *)va_arg(args, int);
+                    addr = (unsigned char *)print_arg(pa);
                     for (i = 0; i < 3; i++) {
                         pc += printi(out, addr[i], 10, 1, width, pad_data_format, 'a', &space);
                         printchar(out, '.', &space);
@@ -307,18 +369,18 @@ int print(char **out, const char *format, va_list args, int space)
                     continue;
                 default:
                     format--;
-                    pc += printi(out, va_arg(args, int), 16, 0, width, pad_data_format, 'a', &space);
+                    pc += printi(out, print_arg(pa), 16, 0, width, pad_data_format, 'a', &space);
                     continue;
                 }
             }
 
             if ((*format == 'x')) {
-                pc += printi(out, va_arg(args, int), 16, 0, width, pad_data_format, 'a', &space);
+                pc += printi(out, print_arg(pa), 16, 0, width, pad_data_format, 'a', &space);
                 continue;
             }
 
             if (*format == 'X') {
-                pc += printi(out, va_arg(args, int), 16, 0, width, pad_data_format, 'A', &space);
+                pc += printi(out, print_arg(pa), 16, 0, width, pad_data_format, 'A', &space);
                 continue;
             }
 
@@ -327,13 +389,13 @@ int print(char **out, const char *format, va_list args, int space)
             }
 
             if (*format == 'u') {
-                pc += printi(out, va_arg(args, int), 10, 0, width, pad_data_format, 'a', &space);
+                pc += printi(out, print_arg(pa), 10, 0, width, pad_data_format, 'a', &space);
                 continue;
             }
 
             if (*format == 'c') {
                 /* char are converted to int then pushed on the stack */
-                scr[0] = (char)va_arg(args, int);
+                scr[0] = (char)print_arg(pa);
                 scr[1] = '\0';
                 pc += prints (out, scr, width, pad_data_format, &space);
                 continue;
@@ -352,6 +414,22 @@ out:
     return pc;
 }
 
+int print(char **out, const char *format, va_list args, int space)
+{
+    struct print_args pa;
+    va_list ap;
+    int pc;
+
+    va_copy(ap, args);
+    pa.ap = &ap;
+    pa.argv = NULL;
+    pa.argc = 0;
+    pc = print_fmt(out, format, &pa, space);
+    va_end(ap);
+
+    return pc;
+}
+
 #ifdef CONFIG_PRINT_IN_SEQUENCE
 static void print_task_handle(void *argv)
 {
@@ -370,10 +448,212 @@ static void print_task_handle(void *argv)
 }
 #endif
 
+#ifdef CONFIG_PRINT_DEFERRED
+static void dlog_output(const uint32_t *rec, uint32_t hdr)
+{
+#ifdef CONFIG_PRINT_DEFERRED_RAW
+    log_uart_put_data((const uint8_t *)rec, DLOG_HDR_WORDS(hdr) << 2);
+#else
+    const char *format = rec[1] ? (const char *)rec[1] : "<%u logs dropped>\r\n";
+    struct print_args pa;
+#ifndef LOG_UART
+    char out[DLOG_LINE_LEN], *pout = &out[0];
+#endif
+
+    pa.ap = NULL;
+    pa.argv = &rec[2];
+    pa.argc = DLOG_HDR_ARGC(hdr);
+#ifndef LOG_UART
+    print_fmt(&pout, format, &pa, DLOG_LINE_LEN);
+    trace_console(pout - out, (uint8_t *)out);
+#else
+    print_fmt(0, format, &pa, 0);
+#endif
+#endif
+}
+
+static void dlog_drain(void)
+{
+    uint32_t *rec, hdr;
+    uint32_t drop_rec[3];
+
+    while (dlog_rd != dlog_wr) {
+        rec = &dlog_buf[dlog_rd & (DLOG_BUF_WORDS - 1)];
+        hdr = __atomic_load_n(rec, __ATOMIC_ACQUIRE);
+        if (hdr == 0) {
+            /* Reserved but not committed yet, its writer signals again. */
+            break;
+        }
+
+        if (DLOG_HDR_MAGIC(hdr) == DLOG_MAGIC_LOG)
+            dlog_output(rec, hdr);
+
+        __atomic_store_n(&dlog_rd, dlog_rd + DLOG_HDR_WORDS(hdr), __ATOMIC_RELEASE);
+    }
+
+    if (dlog_drop) {
+        sys_enter_critical();
+        drop_rec[2] = dlog_drop;
+        dlog_drop = 0;
+        sys_exit_critical();
+        /* A record with a NULL format reports the number of dropped logs. */
+        drop_rec[0] = DLOG_HDR(DLOG_MAGIC_LOG, 1, 3);
+        drop_rec[1] = 0;
+        dlog_output(drop_rec, drop_rec[0]);
+    }
+}
+
+static void dlog_task_handle(void *argv)
+{
+    do {
+        sys_sema_down(&dlog_sema, 0);
+        dlog_drain();
+    } while(1);
+}
+
+/*
+ * Walk the format with the grammar of print_fmt() and copy the arguments into
+ * a ring record. Pointed data (%s, %pM, %pI) is copied inline since it may not
+ * be valid any more when the record is formatted.
+ */
+static int dlog_capture(const char *format, va_list args)
+{
+    uint32_t argv[DLOG_ARGS_MAX];
+    uint8_t copy_len[DLOG_ARGS_MAX];
+    uint8_t is_str[DLOG_ARGS_MAX];
+    uint32_t argc = 0, blob = 0, words, need, pos, tail, i;
+    uint32_t *rec;
+    uint8_t *data;
+    const char *f, *s;
+
+    for (f = format; *f != 0 && argc < DLOG_ARGS_MAX; ++f) {
+        if (*f != '%')
+            continue;
+
+        if (*++f == '\0')
+            break;
+        if (*f == '%')
+            continue;
+        if (*f == '-')
+            ++f;
+        while (*f >= '0' && *f <= '9')
+            ++f;
+
+        if (*f == 'z') {
+            /* print_fmt() only accepts 'u' and 'c' after 'z' */
+            ++f;
+            if (*f != 'u' && *f != 'c') {
+                if (*f == '\0')
+                    break;
+                continue;
+            }
+        }
+
+        if (*f == '\0')
+            break;
+
+        copy_len[argc] = 0;
+        is_str[argc] = 0;
+        switch (*f) {
+        case 's':
+            argv[argc] = va_arg(args, int);
+            if (argv[argc]) {
+                s = (const char *)argv[argc];
+                for (i = 0; (i < DLOG_STR_MAX) && s[i]; i++);
+                copy_len[argc] = i + 1;
+                is_str[argc] = 1;
+            }
+            break;
+        case 'p':
+            argv[argc] = va_arg(args, int);
+            if ((f[1] == 'M') || (f[1] == 'I')) {
+                ++f;
+                if (argv[argc])
+                    copy_len[argc] = (*f == 'M') ? 6 : 4;
+            }
+            break;
+        case 'd':
+        case 'x':
+        case 'X':
+        case 'u':
+        case 'c':
+            argv[argc] = va_arg(args, int);
+            break;
+        default:
+            continue;
+        }
+        blob += copy_len[argc];
+        argc++;
+    }
+
+    words = 2 + argc + ((blob + 3) >> 2);
+
+    sys_enter_critical();
+    pos = dlog_wr & (DLOG_BUF_WORDS - 1);
+    tail = DLOG_BUF_WORDS - pos;
+    need = (tail < words) ? (tail + words) : words;
+    if ((dlog_wr + need - dlog_rd) > DLOG_BUF_WORDS) {
+        /* The print task is late, drop the new log and report it later. */
+        dlog_drop++;
+        sys_exit_critical();
+        return 0;
+    }
+    if (tail < words) {
+        dlog_buf[pos] = DLOG_HDR(DLOG_MAGIC_PAD, 0, tail);
+        pos = 0;
+    }
+    dlog_buf[pos] = 0;
+    dlog_wr += need;
+    sys_exit_critical();
+
+    rec = &dlog_buf[pos];
+    rec[1] = (uint32_t)format;
+    data = (uint8_t *)&rec[2 + argc];
+    for (i = 0; i < argc; i++) {
+        if (copy_len[i]) {
+            sys_memcpy(data, (const void *)argv[i], copy_len[i] - is_str[i]);
+            if (is_str[i])
+                data[copy_len[i] - 1] = '\0';
+            argv[i] = (uint32_t)data;
+            data += copy_len[i];
+        }
+        rec[2 + i] = argv[i];
+    }
+    __atomic_store_n(&rec[0], DLOG_HDR(DLOG_MAGIC_LOG, argc, words), __ATOMIC_RELEASE);
+
+    /* co_printf() is also called from interrupt handlers */
+    if (__RV_CSR_READ(CSR_MSUBM) & MSUBM_TYP)
+        sys_sema_up_from_isr(&dlog_sema);
+    else
+        sys_sema_up(&dlog_sema);
+
+    return 0;
+}
+#endif
 
 int co_printf(const char *format, ...)
 {
-#if (!defined(CONFIG_PRINT_IN_SEQUENCE) | !defined(LOG_UART))
+#if defined(CONFIG_PRINT_DEFERRED)
+    int ret;
+    va_list args;
+
+    if (dlog_task_init == 0) {
+        sys_enter_critical();
+        if (dlog_task_init == 0) {
+            sys_sema_init(&dlog_sema, 0);
+            sys_task_create_dynamic((const uint8_t *)"Print", 512,
+                 (OS_TASK_PRIO_IDLE + TASK_PRIO_HIGHER(1)), dlog_task_handle, NULL);
+            dlog_task_init = 1;
+        }
+        sys_exit_critical();
+    }
+
+    va_start(args, format);
+    ret = dlog_capture(format, args);
+    va_end(args);
+
+    return ret;
+#elif (!defined(CONFIG_PRINT_IN_SEQUENCE) | !defined(LOG_UART))
     int ret;
 #ifndef LOG_UART
     char out[1024], *pout = &out[0];
@@ -440,6 +720,14 @@ int co_printf(const char *format, ...)
 #endif    // CONFIG_PRINT_IN_SEQUENCE end
 }
 
+void co_printf_flush(void)
+{
+#ifdef CONFIG_PRINT_DEFERRED
+    if (dlog_task_init)
+        dlog_drain();
+#endif
+}
+
 int co_snprintf(char *out, int space, const char *format, ...)
 {
     int ret = 0;
@@ -110,7 +110,6 @@ OF SUCH DAMAGE.
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
 #include "wrapper_os.h"
 #define TRACE_PRIORITY_MAX    2
-static os_task_t priority_adjust_task_handle = NULL;
 static os_task_t trace_task_handle = NULL;
 #endif
 
@@ -181,24 +180,41 @@ extern uint32_t _etrace[];
 static uint8_t *trace_start = (uint8_t *)_trace;
 static uint32_t TRACE_SIZE_MAX = 0x4000;
 
+/*
+ * Producers reserve and commit with a single compare-and-swap on ring_state, so
+ * they never mask interrupts. The write head, the commit frontier and the number
+ * of producers still copying their record are packed in one word; the frontier
+ * moves up to the head when the last producer in flight commits. The reader only
+ * sends bytes between trace_start and the commit frontier.
+ */
+#define TRACE_RING_POS_BITS             14
+#define TRACE_RING_POS_MASK             ((1UL << TRACE_RING_POS_BITS) - 1)
+#define TRACE_RING_WRITERS_MAX          0x0F
+#define TRACE_RING_HEAD(state)          ((state) & TRACE_RING_POS_MASK)
+#define TRACE_RING_COMMIT(state)        (((state) >> TRACE_RING_POS_BITS) & TRACE_RING_POS_MASK)
+#define TRACE_RING_WRITERS(state)       ((state) >> (2 * TRACE_RING_POS_BITS))
+#define TRACE_RING_STATE(head, commit, writers) \
+    ((head) | ((commit) << TRACE_RING_POS_BITS) | ((uint32_t)(writers) << (2 * TRACE_RING_POS_BITS)))
+
 struct trace_env_tag {
-    // Index (in 16bits word) of the first trace within the trace buffer
+    // Index (in bytes) of the first trace not yet sent within the trace buffer
     volatile uint32_t trace_start;
-    // Index (in 16bits word) of the last trace within the trace buffer
-    volatile uint32_t trace_end;
-    //sequence number
-    volatile uint8_t seqno;
-    volatile uint8_t btsnoop_seqno;
-    volatile uint8_t wifi_seqno;
+    // Write head, commit frontier and producers in flight, see TRACE_RING_STATE
+    volatile uint32_t ring_state;
+    //sequence number, only the low byte goes in the log header
+    volatile uint32_t seqno;
+    volatile uint32_t btsnoop_seqno;
+    volatile uint32_t wifi_seqno;
+    // Number of records dropped because the buffer was full, per trace type
+    volatile uint32_t drop_cnt[TRACE_TYPE_CONSOLE + 1];
 
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     volatile uint8_t trace_priority;
     volatile bool task_sleep;
 #endif
 
-#ifdef TRACE_UART_DMA
-    volatile uint16_t dma_send_bytes;
-#endif
+    // Bytes handed to the uart from trace_start, trace_start is not evicted meanwhile
+    volatile uint16_t read_bytes;
 };
 static struct trace_env_tag trace_env;
 
@@ -208,6 +224,8 @@ static uint8_t ble_trace_mask[(MODULE_NUM + 1)/2] = {0};
  * FUNCTION DEFINITIONS
  ******************************************************************************
  */
+static uint32_t trace_room_left(uint32_t head);
+
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
 static void task_notify_with_isr_check(os_task_t task_handler)
 {
@@ -222,29 +240,6 @@ static void task_notify_with_isr_check(os_task_t task_handler)
     }
 }
 
-static void priority_adjust_task(void *argv)
-{
-    uint32_t room_left;
-
-    priority_adjust_task_handle = (os_task_t)xTaskGetCurrentTaskHandle();
-    for (;;)
-    {
-        room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
-        if(room_left < sched_low_level && trace_env.trace_priority == 0)
-        {
-            trace_env.trace_priority = TRACE_PRIORITY_MAX;
-            sys_priority_set(trace_task_handle, OS_TASK_PRIORITY(TRACE_PRIORITY_MAX));
-        }
-        else if(room_left > sched_up_level && trace_env.trace_priority != 0)
-        {
-            trace_env.trace_priority = 0;
-            sys_priority_set(trace_task_handle, OS_TASK_PRIORITY(0));
-        }
-        /* wait for notification */
-        sys_task_wait_notification(-1);
-    }
-}
-
 static void trace_print_task(void *argv)
 {
     uint32_t room_left;
@@ -254,10 +249,11 @@ static void trace_print_task(void *argv)
         if(trace_count() != 0)
         {
             trace_print(300);
-            room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
+            room_left = trace_room_left(TRACE_RING_HEAD(trace_env.ring_state));
             if(trace_env.trace_priority != 0 && room_left > sched_up_level)
             {
-                sys_task_notify((void *)priority_adjust_task_handle, false);
+                trace_env.trace_priority = 0;
+                sys_priority_set(trace_task_handle, OS_TASK_PRIORITY(0));
             }
         }
         else
@@ -270,59 +266,153 @@ static void trace_print_task(void *argv)
 }
 #endif
 
-static uint32_t free_space_check_hdl()
+static uint32_t trace_room_left(uint32_t head)
+{
+    return (trace_env.trace_start + TRACE_SIZE_MAX - (head + 1)) % TRACE_SIZE_MAX;
+}
+
+static void free_space_check_hdl(uint32_t room_left)
 {
-    uint32_t room_left = (trace_env.trace_start + TRACE_SIZE_MAX - (trace_env.trace_end + 1)) % TRACE_SIZE_MAX;
 #if (defined(CFG_GD_TRACE_DYNAMIC_PRI_SCH))
-    if(trace_env.trace_priority == 0 && room_left < sched_low_level)
+    // Producer raises the print task itself, priority can not be changed in interrupt
+    if(trace_env.trace_priority == 0 && room_left < sched_low_level && __get_CONTROL() == 0)
     {
-        task_notify_with_isr_check(priority_adjust_task_handle);
+        trace_env.trace_priority = TRACE_PRIORITY_MAX;
+        sys_priority_set(trace_task_handle, OS_TASK_PRIORITY(TRACE_PRIORITY_MAX));
     }
 #endif
-    return room_left;
+}
+
+static uint8_t trace_seqno_next(volatile uint32_t *seqno)
+{
+    return (uint8_t)__atomic_fetch_add(seqno, 1, __ATOMIC_RELAXED);
 }
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
-static void trace_buf_Align()
+static void trace_buf_Align(uint32_t *wr)
 {
-    trace_env.trace_end = (((trace_env.trace_end + 3) & 0xFFFFFFFFC)) % TRACE_SIZE_MAX;
+    *wr = (((*wr + 3) & 0xFFFFFFFC)) % TRACE_SIZE_MAX;
 }
 #endif
 
-static void trace_buf_write(uint8_t *buf, uint16_t len)
+static void trace_buf_write(uint32_t *wr, uint8_t *buf, uint16_t len)
 {
-    if (trace_env.trace_end + len <= TRACE_SIZE_MAX)
+    if (*wr + len <= TRACE_SIZE_MAX)
     {
-        memcpy(trace_start + trace_env.trace_end, buf, len);
-        trace_env.trace_end += len;
+        memcpy(trace_start + *wr, buf, len);
+        *wr += len;
     }
     else
     {
-        uint16_t tlen = TRACE_SIZE_MAX - trace_env.trace_end;
+        uint16_t tlen = TRACE_SIZE_MAX - *wr;
 
-        memcpy(trace_start + trace_env.trace_end, buf, tlen);
+        memcpy(trace_start + *wr, buf, tlen);
         memcpy(trace_start, buf + tlen, len - tlen);
-        trace_env.trace_end = len - tlen;
+        *wr = len - tlen;
     }
 
-    trace_env.trace_end %= TRACE_SIZE_MAX;
+    *wr %= TRACE_SIZE_MAX;
 }
 
-
+/* Loop mode only: evict committed records the reader has not started to send */
 static bool free_used_space(uint32_t need_bytes)
 {
-    do {
-        uint32_t data_len;
-        uint8_t *p_start = trace_start + trace_env.trace_start;
-        //FIX TODO we may remove continue payload and checksum
-        data_len = p_start[2] | (p_start[3] << 8);
-        data_len &= PAYLOAD_LEN_MASK;
-        data_len += LOG_HEADER_BYTES;      //add header
-        need_bytes = data_len < need_bytes ? (need_bytes - data_len) : 0;
-        trace_env.trace_start = (data_len + trace_env.trace_start) % TRACE_SIZE_MAX;
-    }while(need_bytes > 0);
+    uint32_t data_len;
+    uint32_t start, commit;
+    bool ret = false;
+
+    GLOBAL_INT_DISABLE();
+    if (trace_env.read_bytes == 0)
+    {
+        start = trace_env.trace_start;
+        commit = TRACE_RING_COMMIT(trace_env.ring_state);
+        while (need_bytes > 0 && start != commit)
+        {
+            //FIX TODO we may remove continue payload and checksum
+            data_len = trace_start[(start + 2) % TRACE_SIZE_MAX] |
+                       (trace_start[(start + 3) % TRACE_SIZE_MAX] << 8);
+            data_len &= PAYLOAD_LEN_MASK;
+            data_len += LOG_HEADER_BYTES;      //add header
+#if (TRACE_ADDR_NO_ALIGN == 0)
+            data_len = (data_len + 3) & 0xFFFFFFFC;     //records are padded like trace_buf_reserve() does
+#endif
+            need_bytes = data_len < need_bytes ? (need_bytes - data_len) : 0;
+            start = (data_len + start) % TRACE_SIZE_MAX;
+        }
+
+        if (need_bytes == 0)
+        {
+            trace_env.trace_start = start;
+            ret = true;
+        }
+    }
+    GLOBAL_INT_RESTORE();
+
+    return ret;
+}
 
+/* Reserve len bytes at the write head, safe from tasks and interrupt handlers */
+static bool trace_buf_reserve(uint8_t type, uint32_t len, uint32_t *wr)
+{
+    uint32_t old_state, new_state;
+    uint32_t head, room_left;
+
+#if (TRACE_ADDR_NO_ALIGN == 0)
+    len = (len + 3) & 0xFFFFFFFC;
+#endif
+
+    old_state = __atomic_load_n(&trace_env.ring_state, __ATOMIC_ACQUIRE);
+    for (;;)
+    {
+        head = TRACE_RING_HEAD(old_state);
+        room_left = trace_room_left(head);
+        if (room_left < len)
+        {
+            if (!trace_loop || !free_used_space(len - room_left))
+            {
+                goto drop;
+            }
+            old_state = __atomic_load_n(&trace_env.ring_state, __ATOMIC_ACQUIRE);
+            continue;
+        }
+
+        if (TRACE_RING_WRITERS(old_state) == TRACE_RING_WRITERS_MAX)
+        {
+            goto drop;
+        }
+
+        new_state = TRACE_RING_STATE((head + len) % TRACE_SIZE_MAX, TRACE_RING_COMMIT(old_state),
+                                     TRACE_RING_WRITERS(old_state) + 1);
+        if (__atomic_compare_exchange_n(&trace_env.ring_state, &old_state, new_state,
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+    }
+
+    free_space_check_hdl(room_left - len);
+    *wr = head;
     return true;
+
+drop:
+    __atomic_fetch_add(&trace_env.drop_cnt[type], 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+/* Publish the record, the last producer in flight moves the commit frontier */
+static void trace_buf_commit(void)
+{
+    uint32_t old_state, new_state;
+    uint32_t writers;
+
+    old_state = __atomic_load_n(&trace_env.ring_state, __ATOMIC_ACQUIRE);
+    do {
+        writers = TRACE_RING_WRITERS(old_state) - 1;
+        new_state = TRACE_RING_STATE(TRACE_RING_HEAD(old_state),
+                                     writers ? TRACE_RING_COMMIT(old_state) : TRACE_RING_HEAD(old_state),
+                                     writers);
+    } while (!__atomic_compare_exchange_n(&trace_env.ring_state, &old_state, new_state,
+                                          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
 }
 
 void trace_console(uint16_t len, uint8_t *p_buf)
@@ -333,10 +423,7 @@ void trace_console(uint16_t len, uint8_t *p_buf)
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
+    uint32_t wr;
 
     if(!trace_initialized || len == 0 || p_buf == NULL)
     {
@@ -351,34 +438,10 @@ void trace_console(uint16_t len, uint8_t *p_buf)
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
-
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_CONSOLE, total_bytes, &wr))
     {
-        if(!trace_loop)
-        {
-            goto end;     //drop the current log
-        }
-
-        if(!free_used_space(total_bytes - room_left))
-        {
-            goto end;
-        }
-    }
-#else
-    if(room_left < temp_total_bytes)
-    {
-        goto end;     //drop the current log
+        return;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -407,12 +470,12 @@ void trace_console(uint16_t len, uint8_t *p_buf)
 
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - LOG_HEADER_BYTES;
-    trace_buf_write(header, LOG_HEADER_BYTES);
+    trace_buf_write(&wr, header, LOG_HEADER_BYTES);
 
     //first payload segment
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, total_bytes);
+        trace_buf_write(&wr, p_buf, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -422,7 +485,7 @@ void trace_console(uint16_t len, uint8_t *p_buf)
     }
     else
     {
-        trace_buf_write(p_buf, left_bytes);
+        trace_buf_write(&wr, p_buf, left_bytes);
         p_buf += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -456,24 +519,24 @@ void trace_console(uint16_t len, uint8_t *p_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(p_buf, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, p_buf, length);
         p_buf += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_ext_init(bool force, bool loop)
@@ -484,6 +547,11 @@ void trace_ext_init(bool force, bool loop)
         return;
 
     TRACE_SIZE_MAX = (uint8_t *)_etrace - trace_start;
+    // Ring positions are packed in TRACE_RING_POS_BITS
+    if(TRACE_SIZE_MAX > TRACE_RING_POS_MASK + 1)
+    {
+        TRACE_SIZE_MAX = TRACE_RING_POS_MASK + 1;
+    }
 
     // If trace size too small, just return
     if(TRACE_SIZE_MAX < (TOTAL_TRACE_HEADER_BYTES + 10))
@@ -501,24 +569,17 @@ void trace_ext_init(bool force, bool loop)
     if (trace_task_handle == NULL)
         return;
 
-    if (sys_task_create_dynamic((const uint8_t *)"priority adjust task", 256, configMAX_PRIORITIES, priority_adjust_task, NULL) == NULL)
-    {
-        sys_task_delete(trace_task_handle);
-        return;
-    }
-
     trace_env.trace_priority = 0;
     trace_env.task_sleep = false;
 #endif
 
-#ifdef TRACE_UART_DMA
-    trace_env.dma_send_bytes = 0;
-#endif
+    trace_env.read_bytes = 0;
 
     memset(trace_start, 0, TRACE_SIZE_MAX);
 
     trace_env.trace_start = 0;
-    trace_env.trace_end = 0;
+    trace_env.ring_state = 0;
+    memset((void *)trace_env.drop_cnt, 0, sizeof(trace_env.drop_cnt));
 
     trace_loop = loop;
     trace_initialized = true;
@@ -559,10 +620,8 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
+    uint32_t wr;
+    uint8_t seq;
 
     if(!trace_initialized || module >= MODULE_NUM || trace_level >= LEVEL_NUM)
     {
@@ -597,32 +656,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BLE, total_bytes, &wr))
     {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
+        trace_seqno_next(&trace_env.seqno);
+        return;     //drop the current log
     }
-#else
-    if(room_left < temp_total_bytes)
-    {
-        trace_env.seqno++;
-        goto end;     //drop the current log
-    }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -636,7 +676,8 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     type |= TRACE_TYPE_NEW;
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    seq = trace_seqno_next(&trace_env.seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -689,13 +730,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -704,7 +745,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -712,7 +753,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -740,24 +781,24 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         header[6] = 0xFF;
         header[7] = 0xFF;
 #endif
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
@@ -768,13 +809,11 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
+    uint32_t wr;
+    uint8_t seq;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
 
     if(!trace_initialized)
     {
@@ -794,32 +833,13 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
-#else
-    if(room_left < temp_total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BLE, total_bytes, &wr))
     {
-        trace_env.seqno++;
-        goto end;     //drop the current log
+        trace_seqno_next(&trace_env.seqno);
+        return;     //drop the current log
     }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -831,7 +851,8 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    seq = trace_seqno_next(&trace_env.seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -884,7 +905,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -904,14 +925,14 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -920,7 +941,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -928,7 +949,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -957,24 +978,24 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
@@ -986,13 +1007,11 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
+    uint32_t wr;
+    uint8_t seq;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
 
     if(!trace_initialized)
     {
@@ -1012,34 +1031,14 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();   //need to change
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_WIFI, total_bytes, &wr))
     {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.wifi_seqno++;
-            goto end;     //drop the current log
-        }
+        trace_seqno_next(&trace_env.wifi_seqno);
+        return;     //drop the current log
     }
 
-#else
-    if(room_left < temp_total_bytes)
-    {
-        trace_env.wifi_seqno++;
-        goto end;     //drop the current log
-    }
-#endif
-
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1050,7 +1049,8 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.wifi_seqno++;
+    seq = trace_seqno_next(&trace_env.wifi_seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1096,7 +1096,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES - 2;
     total_bytes -= TRACE_HEADER_BYTES - 2;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1117,14 +1117,14 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -1133,7 +1133,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1141,7 +1141,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.wifi_seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1170,24 +1170,24 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 #else
@@ -1202,10 +1202,8 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-    uint32_t room_left;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
+    uint32_t wr;
+    uint8_t seq;
 
     if(!trace_initialized || module >= MODULE_NUM || trace_level >= LEVEL_NUM)
     {
@@ -1240,32 +1238,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
-    }
-#else
-    if(room_left < temp_total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BLE, total_bytes, &wr))
     {
-        trace_env.seqno++;
-        goto end;     //drop the current log
+        trace_seqno_next(&trace_env.seqno);
+        return;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1276,7 +1255,8 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    seq = trace_seqno_next(&trace_env.seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1321,13 +1301,13 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -1336,7 +1316,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1344,7 +1324,7 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1373,24 +1353,24 @@ void trace_ble_log(uint32_t id, uint16_t nb_param, uint16_t *param, uint8_t type
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 
@@ -1401,13 +1381,11 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
+    uint32_t wr;
+    uint8_t seq;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
 
     if(!trace_initialized)
     {
@@ -1427,32 +1405,13 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BLE, total_bytes, &wr))
     {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.seqno++;
-            goto end;     //drop the current log
-        }
+        trace_seqno_next(&trace_env.seqno);
+        return;     //drop the current log
     }
-#else
-    if(room_left < temp_total_bytes)
-    {
-        trace_env.seqno++;
-        goto end;     //drop the current log
-    }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1463,7 +1422,8 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.seqno++;
+    seq = trace_seqno_next(&trace_env.seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1508,7 +1468,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1529,14 +1489,14 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -1545,7 +1505,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1553,7 +1513,7 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1582,24 +1542,24 @@ void trace_ble(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
@@ -1609,14 +1569,12 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     uint8_t header[TOTAL_TRACE_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
+    uint32_t wr;
+    uint8_t seq;
     uint8_t block_num;
     uint16_t left_bytes;
     uint32_t total_bytes;
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
 
     if(!trace_initialized)
     {
@@ -1636,32 +1594,13 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();   //need to change
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.wifi_seqno++;
-            goto end;     //drop the current log
-        }
-    }
-#else
-    if(room_left < temp_total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_WIFI, total_bytes, &wr))
     {
-        trace_env.wifi_seqno++;
-        goto end;     //drop the current log
+        trace_seqno_next(&trace_env.wifi_seqno);
+        return;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -1672,7 +1611,8 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
 
     /*log header 5 bytes*/
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.wifi_seqno++;
+    seq = trace_seqno_next(&trace_env.wifi_seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1717,7 +1657,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //reuse left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - TRACE_HEADER_BYTES;
     total_bytes -= TRACE_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_TRACE_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_TRACE_HEADER_BYTES);
 
     if (trace_buf)
     {
@@ -1737,14 +1677,14 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         #endif
         total_bytes -= 2;
         left_bytes -= 2;
-        trace_buf_write(header, 2);
+        trace_buf_write(&wr, header, 2);
     }
 
     //first payload segment
     ptr = (uint8_t *)param;
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(ptr, total_bytes);
+        trace_buf_write(&wr, ptr, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         goto end;
 #else
@@ -1753,7 +1693,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     }
     else
     {
-        trace_buf_write(ptr, left_bytes);
+        trace_buf_write(&wr, ptr, left_bytes);
         ptr += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1761,7 +1701,7 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
     //continue segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.wifi_seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1790,24 +1730,24 @@ void trace_wifi(uint32_t id, uint16_t nb_param, uint16_t *param, bool trace_buf)
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(ptr, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, ptr, length);
         ptr += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 #endif
 
@@ -1817,10 +1757,8 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     uint8_t header[TOTAL_BTSNOOP_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
+    uint32_t wr;
+    uint8_t seq;
 
     uint8_t block_num = (len + BTSNOOP_HEADER_BYTES) / MAX_PAYLOAD_LEN;      //1-hci_type, 4-timestamp, 3-reserv
     uint16_t left_bytes = (len + BTSNOOP_HEADER_BYTES) % MAX_PAYLOAD_LEN;    //1-hci_type, 4-timestamp, 3-reserv
@@ -1836,32 +1774,13 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BTSNOOP, total_bytes, &wr))
     {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.btsnoop_seqno++;
-            goto end;     //drop the current log
-        }
+        trace_seqno_next(&trace_env.btsnoop_seqno);
+        return;     //drop the current log
     }
-#else
-    if(room_left < temp_total_bytes)
-    {
-        trace_env.btsnoop_seqno++;
-        goto end;     //drop the current log
-    }
-#endif
 
     //reuse total_bytes to payload total length
     //remove sync header
@@ -1872,7 +1791,8 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     }
 
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.btsnoop_seqno++;
+    seq = trace_seqno_next(&trace_env.btsnoop_seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -1911,12 +1831,12 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     //set left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - BTSNOOP_HEADER_BYTES;
     total_bytes -= BTSNOOP_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_BTSNOOP_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_BTSNOOP_HEADER_BYTES);
 
     //first payload segment, it may complete packet or start packet
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, total_bytes);
+        trace_buf_write(&wr, p_buf, total_bytes);
 #if TRACE_ADDR_NO_ALIGN
         //complete packet go end
         goto end;
@@ -1926,7 +1846,7 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     }
     else
     {
-        trace_buf_write(p_buf, left_bytes);
+        trace_buf_write(&wr, p_buf, left_bytes);
         p_buf += left_bytes;
         total_bytes -= left_bytes;
     }
@@ -1934,7 +1854,7 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.btsnoop_seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -1962,24 +1882,24 @@ void trace_btsnoop(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
-        trace_buf_write(p_buf, length);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, p_buf, length);
         p_buf += length;
     }while(total_bytes > 0);
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
 }
 
 void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint8_t hci_type, uint8_t *p_payload, uint16_t payload_len)
@@ -1988,10 +1908,8 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     uint8_t header[TOTAL_BTSNOOP_HEADER_BYTES] = {0};
     uint16_t length;
     uint8_t flag = 0;
-    uint32_t room_left;
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    uint32_t temp_total_bytes = 0;
-#endif
+    uint32_t wr;
+    uint8_t seq;
 
     uint8_t block_num = (len + payload_len + BTSNOOP_HEADER_BYTES) / MAX_PAYLOAD_LEN;    //1-hci_type, 4-timestamp, 3-reserv
     uint16_t left_bytes = (len + payload_len + BTSNOOP_HEADER_BYTES) % MAX_PAYLOAD_LEN;  //1-hci_type, 4-timestamp, 3-reserv
@@ -2007,32 +1925,13 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
         total_bytes += (LOG_HEADER_BYTES + left_bytes);
     }
 
-#if (TRACE_ADDR_NO_ALIGN == 0)
-    temp_total_bytes = (total_bytes + 3) & 0xFFFFFFFC;
-#endif
-
-    /* Needed to be able to trace within IT handler */
-    GLOBAL_INT_DISABLE();
     ts = get_sys_local_time_us();
 
-    room_left = free_space_check_hdl();
-
-#if TRACE_ADDR_NO_ALIGN
-    if(room_left < total_bytes)
-    {
-        if(!trace_loop || !free_used_space(total_bytes - room_left))
-        {
-            trace_env.btsnoop_seqno++;
-            goto end;     //drop the current log
-        }
-    }
-#else
-    if(room_left < temp_total_bytes)
+    if(!trace_buf_reserve(TRACE_TYPE_BTSNOOP, total_bytes, &wr))
     {
-        trace_env.btsnoop_seqno++;
-        goto end;     //drop the current log
+        trace_seqno_next(&trace_env.btsnoop_seqno);
+        return;     //drop the current log
     }
-#endif
     //reuse total_bytes to payload total length
     //remove sync header
     total_bytes -= LOG_HEADER_BYTES * block_num;
@@ -2042,7 +1941,8 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     }
 
     header[0] = TRACE_SYNC_WORD;
-    header[1] = trace_env.btsnoop_seqno++;
+    seq = trace_seqno_next(&trace_env.btsnoop_seqno);
+    header[1] = seq;
     length = block_num > 0 ? MAX_PAYLOAD_LEN : left_bytes;
     flag = block_num > 0 ? START_FLAG: COMPLT_FLAG;
     header[2] = length & 0xFF;
@@ -2082,15 +1982,15 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     //set left_bytes to first packet left bytes
     left_bytes = MAX_PAYLOAD_LEN - BTSNOOP_HEADER_BYTES;
     total_bytes -= BTSNOOP_HEADER_BYTES;
-    trace_buf_write(header, TOTAL_BTSNOOP_HEADER_BYTES);
+    trace_buf_write(&wr, header, TOTAL_BTSNOOP_HEADER_BYTES);
 
     //first payload segment, it may complete packet or start packet
     if(total_bytes <= left_bytes)
     {
-        trace_buf_write(p_buf, len);
+        trace_buf_write(&wr, p_buf, len);
         if(p_payload != NULL)
         {
-            trace_buf_write(p_payload, payload_len);
+            trace_buf_write(&wr, p_payload, payload_len);
         }
 #if TRACE_ADDR_NO_ALIGN
         //complete packet go end
@@ -2103,14 +2003,14 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     {
         if(len > left_bytes)
         {
-            trace_buf_write(p_buf, left_bytes);
+            trace_buf_write(&wr, p_buf, left_bytes);
             len -= left_bytes;
             p_buf += left_bytes;
         }
         else
         {
-            trace_buf_write(p_buf, len);
-            trace_buf_write(p_payload, left_bytes- len);
+            trace_buf_write(&wr, p_buf, len);
+            trace_buf_write(&wr, p_payload, left_bytes- len);
             payload_len -= (left_bytes - len);
             p_payload += (left_bytes - len);
             len = 0;
@@ -2121,7 +2021,7 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
     //continue/end segment
     header[0] = TRACE_SYNC_WORD;
     do {
-        header[1] = trace_env.btsnoop_seqno - 1;
+        header[1] = seq;
         //end segment
         if(total_bytes <= MAX_PAYLOAD_LEN)
         {
@@ -2149,16 +2049,16 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
         header[7] = 0xFF;
 #endif
 
-        trace_buf_write(header, LOG_HEADER_BYTES);
+        trace_buf_write(&wr, header, LOG_HEADER_BYTES);
         if(total_bytes == 0)
         {
             if(len > 0)
             {
-                trace_buf_write(p_buf, len);
+                trace_buf_write(&wr, p_buf, len);
             }
             if(payload_len > 0)
             {
-                trace_buf_write(p_payload, payload_len);
+                trace_buf_write(&wr, p_payload, payload_len);
             }
         }
         else
@@ -2167,14 +2067,14 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
             {
                 if(len > length)
                 {
-                    trace_buf_write(p_buf, length);
+                    trace_buf_write(&wr, p_buf, length);
                     p_buf += length;
                     len -= length;
                     length = 0;
                 }
                 else
                 {
-                    trace_buf_write(p_buf, len);
+                    trace_buf_write(&wr, p_buf, len);
                     len = 0;
                     length -= len;
                 }
@@ -2184,13 +2084,13 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
             {
                 if(payload_len > length)
                 {
-                    trace_buf_write(p_payload, length);
+                    trace_buf_write(&wr, p_payload, length);
                     payload_len -= length;
                     p_payload += length;
                 }
                 else
                 {
-                    trace_buf_write(p_payload, payload_len);
+                    trace_buf_write(&wr, p_payload, payload_len);
                     payload_len = 0;
                 }
             }
@@ -2199,123 +2099,133 @@ void trace_btsnoop_payload(uint8_t *p_buf, uint16_t len, uint8_t direction, uint
 
 #if (TRACE_ADDR_NO_ALIGN == 0)
 align_buffer:
-    trace_buf_Align();
-#endif
-
+    trace_buf_Align(&wr);
+#else
 end:
+#endif
+    trace_buf_commit();
 #ifdef CFG_GD_TRACE_DYNAMIC_PRI_SCH
     if(trace_env.task_sleep)
     {
         task_notify_with_isr_check(trace_task_handle);
     }
 #endif
-    GLOBAL_INT_RESTORE();
+}
+
+static uint32_t trace_committed_bytes(void)
+{
+    uint32_t commit = TRACE_RING_COMMIT(__atomic_load_n(&trace_env.ring_state, __ATOMIC_ACQUIRE));
+
+    return (commit + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
 }
 
 uint16_t trace_count()
 {
-    return trace_initialized ? (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX : 0;
+    return trace_initialized ? trace_committed_bytes() : 0;
+}
+
+uint32_t trace_drop_count(uint8_t type)
+{
+    if(!trace_initialized || type > TRACE_TYPE_CONSOLE)
+    {
+        return 0;
+    }
+
+    return trace_env.drop_cnt[type];
 }
 
 uint16_t trace_print(uint16_t max_bytes)
 {
     uint16_t send_bytes = 0;
+    uint32_t start;
 
     if(!trace_initialized || trace_count() == 0)
     {
         return send_bytes;
     }
 
-    send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-
+    // Claim the span so that loop mode does not evict it while it is sent
+    GLOBAL_INT_DISABLE();
+    send_bytes = trace_committed_bytes();
     if(send_bytes > max_bytes)
     {
         send_bytes = max_bytes;
     }
+    trace_env.read_bytes = send_bytes;
+    start = trace_env.trace_start;
+    GLOBAL_INT_RESTORE();
 
     if(send_bytes > 0)
     {
-        if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
+        if (start + send_bytes <= TRACE_SIZE_MAX)
         {
-            uart_transfer_trace_data(trace_start + trace_env.trace_start, send_bytes);
-            trace_env.trace_start += send_bytes;
+            uart_transfer_trace_data(trace_start + start, send_bytes);
         }
         else
         {
-            uint16_t tlen = TRACE_SIZE_MAX - trace_env.trace_start;
+            uint16_t tlen = TRACE_SIZE_MAX - start;
 
-            uart_transfer_trace_data(trace_start + trace_env.trace_start, tlen);
+            uart_transfer_trace_data(trace_start + start, tlen);
             uart_transfer_trace_data(trace_start, send_bytes - tlen);
-            trace_env.trace_start = send_bytes - tlen;
         }
 
-        trace_env.trace_start %= TRACE_SIZE_MAX;
+        __atomic_store_n(&trace_env.trace_start, (start + send_bytes) % TRACE_SIZE_MAX, __ATOMIC_RELEASE);
+        trace_env.read_bytes = 0;
     }
     return send_bytes;
 }
 
+#ifdef TRACE_UART_DMA
+/* Send the committed span from trace_start up to the buffer end, called with interrupts disabled */
+static void trace_dma_start(void)
+{
+    uint32_t send_bytes = trace_committed_bytes();
+
+    if (trace_env.trace_start + send_bytes > TRACE_SIZE_MAX)
+    {
+        send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
+    }
+
+    trace_env.read_bytes = send_bytes;
+    if(send_bytes > 0)
+    {
+        trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), send_bytes);
+    }
+}
+#endif
+
 void trace_dma_print()
 {
 #ifdef TRACE_UART_DMA
-    uint16_t send_bytes = 0;
-    if(!trace_initialized || trace_count() == 0)
+    if(!trace_initialized || trace_env.read_bytes != 0 || trace_count() == 0)
     {
         return;
     }
 
     // DMA is not sending bytes, arrange dma transfer
-    if(trace_env.dma_send_bytes == 0)
+    GLOBAL_INT_DISABLE();
+    if(trace_env.read_bytes == 0)
     {
-        send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-        if(send_bytes > 0)
-        {
-            if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
-            {
-                trace_env.dma_send_bytes = send_bytes;
-            }
-            else
-            {
-                trace_env.dma_send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
-            }
-
-            trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), trace_env.dma_send_bytes);
-        }
+        trace_dma_start();
     }
-
+    GLOBAL_INT_RESTORE();
 #endif
 }
 
 #ifdef TRACE_UART_DMA
 void trace_dma_transfer_cmplt()
 {
-    uint16_t send_bytes = 0;
-
     if(!trace_initialized)
     {
         return;
     }
 
     GLOBAL_INT_DISABLE();
-    trace_env.trace_start = (trace_env.trace_start + trace_env.dma_send_bytes) % TRACE_SIZE_MAX;
+    __atomic_store_n(&trace_env.trace_start, (trace_env.trace_start + trace_env.read_bytes) % TRACE_SIZE_MAX,
+                     __ATOMIC_RELEASE);
 
     // Check left bytes need to transfer
-    send_bytes = (trace_env.trace_end + TRACE_SIZE_MAX - trace_env.trace_start) % TRACE_SIZE_MAX;
-    if(send_bytes > 0)
-    {
-        if (trace_env.trace_start + send_bytes <= TRACE_SIZE_MAX)
-        {
-            trace_env.dma_send_bytes = send_bytes;
-        }
-        else
-        {
-            trace_env.dma_send_bytes = TRACE_SIZE_MAX - trace_env.trace_start;
-        }
-
-        trace_uart_dma_transfer((uint32_t)(trace_start + trace_env.trace_start), trace_env.dma_send_bytes);
-    }
-    else
-        trace_env.dma_send_bytes = 0;
-
+    trace_dma_start();
     GLOBAL_INT_RESTORE();
 }
 #endif
@@ -2336,6 +2246,11 @@ uint16_t trace_count()
     return 0;
 }
 
+uint32_t trace_drop_count(uint8_t type)
+{
+    return 0;
+}
+
 uint16_t trace_print(uint16_t max_bytes)
 {
     return 0;
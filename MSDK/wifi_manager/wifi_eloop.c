@@ -51,10 +51,26 @@ OF SUCH DAMAGE.
 #include "dlist.h"
 #include "wifi_eloop.h"
 #include "wifi_management.h"
+#include "wlan_config.h"
 
 /*============================ MACROS ========================================*/
+/* Timeouts preallocated in the pool: the station/softap pollers plus the
+   per client timers of wpas (EAPOL, SA query, PMKSA cache, rekey) */
+#ifndef ELOOP_TIMEOUT_MAX
+#define ELOOP_TIMEOUT_MAX              (16 + 4 * CFG_STA_NUM)
+#endif
+
+/* Timeouts registered once the pool is empty are allocated from the heap */
+#define ELOOP_TIMEOUT_IDX_NONE         0xFFFF
 
 /*============================ MACRO FUNCTIONS ===============================*/
+#define ELOOP_TIMEOUT_POOLED(t)        (((t) >= &eloop.pool[0]) && ((t) < &eloop.pool[ELOOP_TIMEOUT_MAX]))
+/* Timeout id layout: low 16 bits of seq in bits [31:16], pool slot in bits [15:0],
+   ELOOP_TIMEOUT_IDX_NONE as slot for a timeout allocated from the heap */
+#define ELOOP_TIMEOUT_ID(slot, seq)    ((((seq) & 0xFFFF) << 16) | ((slot) & 0xFFFF))
+#define ELOOP_TIMEOUT_ID_SLOT(id)      ((id) & 0xFFFF)
+#define ELOOP_TIMEOUT_ID_SEQ(id)       (((id) >> 16) & 0xFFFF)
+
 /*============================ TYPES =========================================*/
 struct eloop_event {
     void *eloop_data;
@@ -64,17 +80,27 @@ struct eloop_event {
 };
 
 struct eloop_timeout {
-    struct list_head list;
     uint32_t time;
+    uint32_t seq;
     void *eloop_data;
     void *user_data;
     eloop_timeout_handler handler;
+    uint16_t heap_idx;          /* position in eloop.heap, ELOOP_TIMEOUT_IDX_NONE if free */
+    uint16_t next_free;         /* next free slot when on the free list */
 };
 
 struct eloop_data {
     size_t event_count;
     struct eloop_event *events;
-    struct list_head timeout;
+    /* timeouts are pooled and kept in a binary min-heap ordered by (time, seq) */
+    struct eloop_timeout pool[ELOOP_TIMEOUT_MAX];
+    struct eloop_timeout *heap_pool[ELOOP_TIMEOUT_MAX];
+    struct eloop_timeout **heap;    /* heap_pool, or an allocated array once the pool overflowed */
+    uint16_t heap_size;
+    uint16_t heap_cnt;
+    uint16_t free_head;
+    uint32_t seq;
+    os_mutex_t lock;
     int terminate;
 };
 
@@ -91,13 +117,24 @@ static struct eloop_event eloop_predefined_events[] = {
     \brief      initialize global event loop data(This function must be called before any other eloop_* function.)
     \param[in]  none
     \param[out] none
-    \retval     0 on success
+    \retval     0 on success, -1 on failure
 */
 int wifi_eloop_init(void)
 {
+    int i;
+
     sys_memset(&eloop, 0, sizeof(eloop));
 
-    INIT_DLIST_HEAD(&eloop.timeout);
+    for (i = 0; i < ELOOP_TIMEOUT_MAX; i++) {
+        eloop.pool[i].heap_idx = ELOOP_TIMEOUT_IDX_NONE;
+        eloop.pool[i].next_free = (i + 1 < ELOOP_TIMEOUT_MAX) ? (i + 1) : ELOOP_TIMEOUT_IDX_NONE;
+    }
+    eloop.free_head = 0;
+    eloop.heap = eloop.heap_pool;
+    eloop.heap_size = ELOOP_TIMEOUT_MAX;
+
+    if (sys_mutex_init(&eloop.lock))
+        return -1;
 
     return 0;
 }
@@ -242,60 +279,250 @@ static void eloop_event_dispatch(eloop_message_t message)
 }
 
 /*!
-    \brief      register timeout
+    \brief      check whether timeout a expires before timeout b
+    \param[in]  a: pointer to the first timeout
+    \param[in]  b: pointer to the second timeout
+    \param[out] none
+    \retval     1 if a is before b, 0 otherwise
+*/
+static int eloop_timeout_before(struct eloop_timeout *a, struct eloop_timeout *b)
+{
+    if (a->time != b->time)
+        return SYS_TIME_BEFORE(a->time, b->time);
+    /* same expiry: keep registration order */
+    return SYS_TIME_BEFORE(a->seq, b->seq);
+}
+
+/*!
+    \brief      place a timeout at a heap position
+    \param[in]  idx: heap position
+    \param[in]  timeout: pointer to the timeout
+    \param[out] none
+    \retval     none
+*/
+static void eloop_heap_set(uint16_t idx, struct eloop_timeout *timeout)
+{
+    eloop.heap[idx] = timeout;
+    timeout->heap_idx = idx;
+}
+
+/*!
+    \brief      move a timeout towards the root of the heap
+    \param[in]  idx: heap position of the timeout
+    \param[out] none
+    \retval     none
+*/
+static void eloop_heap_up(uint16_t idx)
+{
+    struct eloop_timeout *timeout = eloop.heap[idx];
+    uint16_t parent;
+
+    while (idx > 0) {
+        parent = (idx - 1) >> 1;
+        if (!eloop_timeout_before(timeout, eloop.heap[parent]))
+            break;
+        eloop_heap_set(idx, eloop.heap[parent]);
+        idx = parent;
+    }
+    eloop_heap_set(idx, timeout);
+}
+
+/*!
+    \brief      move a timeout towards the leaves of the heap
+    \param[in]  idx: heap position of the timeout
+    \param[out] none
+    \retval     none
+*/
+static void eloop_heap_down(uint16_t idx)
+{
+    struct eloop_timeout *timeout = eloop.heap[idx];
+    uint16_t child;
+
+    while ((child = (idx << 1) + 1) < eloop.heap_cnt) {
+        if (child + 1 < eloop.heap_cnt &&
+                eloop_timeout_before(eloop.heap[child + 1], eloop.heap[child]))
+            child++;
+        if (!eloop_timeout_before(eloop.heap[child], timeout))
+            break;
+        eloop_heap_set(idx, eloop.heap[child]);
+        idx = child;
+    }
+    eloop_heap_set(idx, timeout);
+}
+
+/*!
+    \brief      remove eloop timeout from the heap and release it to the pool, called with eloop.lock held
+    \param[in]  timeout: pointer to the eloop_timeout struction need to remove
+    \param[out] none
+    \retval     none
+*/
+static void eloop_timeout_remove(struct eloop_timeout *timeout)
+{
+    uint16_t idx = timeout->heap_idx;
+
+    eloop.heap_cnt--;
+    if (idx != eloop.heap_cnt) {
+        eloop_heap_set(idx, eloop.heap[eloop.heap_cnt]);
+        if (idx > 0 && eloop_timeout_before(eloop.heap[idx], eloop.heap[(idx - 1) >> 1]))
+            eloop_heap_up(idx);
+        else
+            eloop_heap_down(idx);
+    }
+    eloop.heap[eloop.heap_cnt] = NULL;
+
+    if (!ELOOP_TIMEOUT_POOLED(timeout)) {
+        sys_mfree(timeout);
+        return;
+    }
+
+    timeout->heap_idx = ELOOP_TIMEOUT_IDX_NONE;
+    timeout->next_free = eloop.free_head;
+    eloop.free_head = timeout - eloop.pool;
+}
+
+/*!
+    \brief      make room for one more timeout in the heap, called with eloop.lock held
+    \param[in]  none
+    \param[out] none
+    \retval     0 on success, -1 on failure
+*/
+static int eloop_heap_reserve(void)
+{
+    struct eloop_timeout **heap;
+    uint16_t size;
+
+    if (eloop.heap_cnt < eloop.heap_size)
+        return 0;
+
+    if (eloop.heap_size >= ELOOP_TIMEOUT_IDX_NONE / 2)
+        return -1;
+
+    size = eloop.heap_size * 2;
+    heap = sys_malloc(size * sizeof(struct eloop_timeout *));
+    if (heap == NULL)
+        return -1;
+
+    sys_memcpy(heap, eloop.heap, eloop.heap_cnt * sizeof(struct eloop_timeout *));
+    if (eloop.heap != eloop.heap_pool)
+        sys_mfree(eloop.heap);
+    eloop.heap = heap;
+    eloop.heap_size = size;
+
+    return 0;
+}
+
+/*!
+    \brief      register timeout and return its id
     \param[in]  msecs: number of milliseconds to the timeout
     \param[in]  handler: callback function to be called when timeout occurs
     \param[in]  eloop_data: callback context data (eloop_ctx)
     \param[in]  user_data: callback context data (sock_ctx)
-    \param[out] none
+    \param[out] id: id of the registered timeout, may be NULL
     \retval     0 on success, -1 on failure
 */
-int eloop_timeout_register(unsigned int msecs,
+int eloop_timeout_register_id(unsigned int msecs,
                eloop_timeout_handler handler,
-               void *eloop_data, void *user_data)
+               void *eloop_data, void *user_data,
+               eloop_timeout_id_t *id)
 {
-    struct eloop_timeout *timeout, *tmp;
-    SYS_SR_ALLOC();
+    struct eloop_timeout *timeout;
+    uint16_t slot;
 
-    if (eloop.terminate)
+    if (eloop.terminate || (eloop.lock == NULL))
         return -1;
 
-    timeout = sys_zalloc(sizeof(*timeout));
-    if (timeout == NULL)
+    sys_mutex_get(&eloop.lock);
+    if (eloop_heap_reserve()) {
+        sys_mutex_put(&eloop.lock);
+        wifi_sm_printf(WIFI_SM_ERROR, "ELOOP: no room for timeout, handler=%p", handler);
         return -1;
+    }
+
+    slot = eloop.free_head;
+    if (slot != ELOOP_TIMEOUT_IDX_NONE) {
+        timeout = &eloop.pool[slot];
+        eloop.free_head = timeout->next_free;
+    } else {
+        /* wpas ignores the return value, a lost timeout would stall a handshake */
+        timeout = sys_zalloc(sizeof(struct eloop_timeout));
+        if (timeout == NULL) {
+            sys_mutex_put(&eloop.lock);
+            wifi_sm_printf(WIFI_SM_ERROR, "ELOOP: no free timeout, handler=%p", handler);
+            return -1;
+        }
+    }
 
     timeout->time = sys_current_time_get();
     timeout->time += msecs;
+    timeout->seq = eloop.seq++;
     timeout->eloop_data = eloop_data;
     timeout->user_data = user_data;
     timeout->handler = handler;
 
-    sys_enter_critical();
-    /* Maintain timeouts in order of increasing time */
-    list_for_each_entry(tmp, &eloop.timeout, struct eloop_timeout, list) {
-        if (timeout->time < tmp->time) {
-            list_add(&timeout->list, tmp->list.prev);
-            goto exit;
-        }
-    }
-    list_add_tail(&timeout->list, &eloop.timeout);
+    eloop.heap[eloop.heap_cnt] = timeout;
+    eloop_heap_up(eloop.heap_cnt++);
 
-exit:
-    sys_exit_critical();
+    if (id)
+        *id = ELOOP_TIMEOUT_ID(slot, timeout->seq);
+    sys_mutex_put(&eloop.lock);
 
     return 0;
 }
 
 /*!
-    \brief      remove eloop timeout
-    \param[in]  timeout: pointer to the eloop_timeout struction need to remove
+    \brief      register timeout
+    \param[in]  msecs: number of milliseconds to the timeout
+    \param[in]  handler: callback function to be called when timeout occurs
+    \param[in]  eloop_data: callback context data (eloop_ctx)
+    \param[in]  user_data: callback context data (sock_ctx)
     \param[out] none
-    \retval     none
+    \retval     0 on success, -1 on failure
 */
-static void eloop_timeout_remove(struct eloop_timeout *timeout)
+int eloop_timeout_register(unsigned int msecs,
+               eloop_timeout_handler handler,
+               void *eloop_data, void *user_data)
 {
-    list_del(&timeout->list);
-    sys_mfree(timeout);
+    return eloop_timeout_register_id(msecs, handler, eloop_data, user_data, NULL);
+}
+
+/*!
+    \brief      cancel the timeout identified by id
+    \param[in]  id: id returned by eloop_timeout_register_id()
+    \param[out] none
+    \retval     1 if the timeout was cancelled, 0 if it already expired or was cancelled, -1 on failure
+*/
+int eloop_timeout_cancel_id(eloop_timeout_id_t id)
+{
+    struct eloop_timeout *timeout = NULL;
+    uint16_t slot = ELOOP_TIMEOUT_ID_SLOT(id);
+    int i, removed = 0;
+
+    if (eloop.terminate || (eloop.lock == NULL))
+        return -1;
+
+    sys_mutex_get(&eloop.lock);
+    if (slot < ELOOP_TIMEOUT_MAX) {
+        /* pooled timeout, a released or reused slot has another seq */
+        if (eloop.pool[slot].heap_idx != ELOOP_TIMEOUT_IDX_NONE &&
+                (eloop.pool[slot].seq & 0xFFFF) == ELOOP_TIMEOUT_ID_SEQ(id))
+            timeout = &eloop.pool[slot];
+    } else if (slot == ELOOP_TIMEOUT_IDX_NONE) {
+        /* only timeouts registered after the pool ran out need a search */
+        for (i = 0; i < eloop.heap_cnt; i++) {
+            if (!ELOOP_TIMEOUT_POOLED(eloop.heap[i]) &&
+                    (eloop.heap[i]->seq & 0xFFFF) == ELOOP_TIMEOUT_ID_SEQ(id)) {
+                timeout = eloop.heap[i];
+                break;
+            }
+        }
+    }
+    if (timeout) {
+        eloop_timeout_remove(timeout);
+        removed = 1;
+    }
+    sys_mutex_put(&eloop.lock);
+
+    return removed;
 }
 
 /*!
@@ -309,16 +536,19 @@ static void eloop_timeout_remove(struct eloop_timeout *timeout)
 int eloop_timeout_cancel(eloop_timeout_handler handler,
              void *eloop_data, void *user_data)
 {
-    struct eloop_timeout *timeout, *prev;
+    struct eloop_timeout *timeout;
     int removed = 0;
-    SYS_SR_ALLOC();
+    int i;
 
-    if (eloop.terminate)
+    if (eloop.terminate || (eloop.lock == NULL))
         return -1;
 
-    sys_enter_critical();
-    list_for_each_entry_safe(timeout, prev, &eloop.timeout,
-                struct eloop_timeout, list) {
+    sys_mutex_get(&eloop.lock);
+    /* walk backwards so entries refilled from the tail are already visited */
+    for (i = eloop.heap_cnt - 1; i >= 0; i--) {
+        if (i >= eloop.heap_cnt)
+            continue;
+        timeout = eloop.heap[i];
         if (timeout->handler == handler &&
                 (timeout->eloop_data == eloop_data ||
                     eloop_data == ELOOP_ALL_CTX) &&
@@ -326,9 +556,11 @@ int eloop_timeout_cancel(eloop_timeout_handler handler,
                     user_data == ELOOP_ALL_CTX)) {
             eloop_timeout_remove(timeout);
             removed++;
+            /* slot i was refilled from the heap tail, examine it again */
+            i++;
         }
     }
-    sys_exit_critical();
+    sys_mutex_put(&eloop.lock);
 
     return removed;
 }
@@ -336,17 +568,20 @@ int eloop_timeout_cancel(eloop_timeout_handler handler,
 //FOR test
 int eloop_timeout_all_cancel(void)
 {
-    struct eloop_timeout *timeout, *prev;
-    SYS_SR_ALLOC();
-    sys_enter_critical();
-    list_for_each_entry_safe(timeout, prev, &eloop.timeout,
-                struct eloop_timeout, list) {
+    struct eloop_timeout *timeout;
+
+    if (eloop.lock == NULL)
+        return 0;
+
+    sys_mutex_get(&eloop.lock);
+    while (eloop.heap_cnt) {
+        timeout = eloop.heap[eloop.heap_cnt - 1];
         printf("===============>remove timeout: "
                "eloop_data=%p user_data=%p handler=%p\r\n",
                timeout->eloop_data, timeout->user_data, timeout->handler);
         eloop_timeout_remove(timeout);
     }
-    sys_exit_critical();
+    sys_mutex_put(&eloop.lock);
     return 0;
 }
 
@@ -362,20 +597,25 @@ int eloop_timeout_is_registered(eloop_timeout_handler handler,
                 void *eloop_data, void *user_data)
 {
     struct eloop_timeout *tmp;
-    SYS_SR_ALLOC();
+    int i, found = 0;
+
+    /* the lock is freed by wifi_eloop_destroy(), nothing is registered then */
+    if (eloop.lock == NULL)
+        return 0;
 
-    sys_enter_critical();
-    list_for_each_entry(tmp, &eloop.timeout, struct eloop_timeout, list) {
+    sys_mutex_get(&eloop.lock);
+    for (i = 0; i < eloop.heap_cnt; i++) {
+        tmp = eloop.heap[i];
         if (tmp->handler == handler &&
                 tmp->eloop_data == eloop_data &&
                 tmp->user_data == user_data) {
-            sys_exit_critical();
-            return 1;
+            found = 1;
+            break;
         }
     }
-    sys_exit_critical();
+    sys_mutex_put(&eloop.lock);
 
-    return 0;
+    return found;
 }
 
 /*!
@@ -388,11 +628,10 @@ static void eloop_timeout_handle()
 {
     struct eloop_timeout *timeout;
     uint32_t now;
-    SYS_SR_ALLOC();
 
-    sys_enter_critical();
-    timeout = list_first_entry(&eloop.timeout, struct eloop_timeout, list);
-    if (timeout) {
+    sys_mutex_get(&eloop.lock);
+    if (eloop.heap_cnt) {
+        timeout = eloop.heap[0];
         now = sys_current_time_get();
         if (SYS_TIME_AFTER_EQ(now, timeout->time)) {
             void *eloop_data = timeout->eloop_data;
@@ -400,12 +639,12 @@ static void eloop_timeout_handle()
             eloop_timeout_handler handler =
                 timeout->handler;
             eloop_timeout_remove(timeout);
-            sys_exit_critical();
+            sys_mutex_put(&eloop.lock);
             handler(eloop_data, user_data);
             return;
         }
     }
-    sys_exit_critical();
+    sys_mutex_put(&eloop.lock);
 }
 
 /*!
@@ -419,26 +658,25 @@ void wifi_eloop_run(void)
     uint32_t now;
     uint32_t remain;
     eloop_message_t message;
-    struct eloop_timeout *timeout;
-    SYS_SR_ALLOC();
+    int pending;
 
     while (!eloop.terminate) {
         remain = 0;
 
-        sys_enter_critical();
-        timeout = list_first_entry(&eloop.timeout, struct eloop_timeout, list);
-        if (timeout) {
+        sys_mutex_get(&eloop.lock);
+        pending = eloop.heap_cnt;
+        if (pending) {
             now = sys_current_time_get();
-            if (SYS_TIME_BEFORE(now, timeout->time)) {
-                remain = timeout->time - now;
+            if (SYS_TIME_BEFORE(now, eloop.heap[0]->time)) {
+                remain = eloop.heap[0]->time - now;
             }
         }
-        sys_exit_critical();
+        sys_mutex_put(&eloop.lock);
 
-        if (timeout && remain == 0) {
+        if (pending && remain == 0) {
             sys_yield();
         } else {
-            if (sys_task_wait(timeout ? remain : 0, &message) == OS_OK) {
+            if (sys_task_wait(pending ? remain : 0, &message) == OS_OK) {
                 eloop_event_dispatch(message);
             }
         }
@@ -466,12 +704,10 @@ void wifi_eloop_terminate(void)
 */
 void wifi_eloop_destroy(void)
 {
-    struct eloop_timeout *timeout, *prev;
+    struct eloop_timeout *timeout;
     eloop_message_t message;
     uint32_t now __MAYBE_UNUSED;
 
-    SYS_SR_ALLOC();
-
     /* terminated by eloop_terminate, all events have been rejected since then */
     //sys_task_msg_flush(&wifi_mgmt_task_tcb);
     while (sys_task_msg_num(wifi_mgmt_task_tcb, 0)) {
@@ -482,16 +718,23 @@ void wifi_eloop_destroy(void)
     }
 
     now = sys_current_time_get();
-    sys_enter_critical();
-    list_for_each_entry_safe(timeout, prev, &eloop.timeout,
-                struct eloop_timeout, list) {
+    sys_mutex_get(&eloop.lock);
+    while (eloop.heap_cnt) {
+        timeout = eloop.heap[eloop.heap_cnt - 1];
         wifi_sm_printf(WIFI_SM_INFO, "ELOOP: remaining timeout: %u "
                "eloop_data=%p user_data=%p handler=%p",
                timeout->time - now, timeout->eloop_data, timeout->user_data,
                timeout->handler);
         eloop_timeout_remove(timeout);
     }
-    sys_exit_critical();
+    if (eloop.heap != eloop.heap_pool) {
+        sys_mfree(eloop.heap);
+        eloop.heap = eloop.heap_pool;
+        eloop.heap_size = ELOOP_TIMEOUT_MAX;
+    }
+    sys_mutex_put(&eloop.lock);
+    /* leaves eloop.lock NULL, which the other functions check */
+    sys_mutex_free(&eloop.lock);
 
     if (eloop.events)
         sys_mfree(eloop.events);
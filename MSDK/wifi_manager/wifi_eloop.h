@@ -117,6 +117,14 @@ typedef void (*eloop_event_handler)(void *eloop_data, void *user_ctx);
  */
 typedef void (*eloop_timeout_handler)(void *eloop_data, void *user_ctx);
 
+/**
+ * eloop_timeout_id_t - Identifier of a registered timeout
+ *
+ * Returned by eloop_timeout_register_id(). An id becomes stale once its
+ * timeout expired or was cancelled, cancelling a stale id is a no-op.
+ */
+typedef uint32_t eloop_timeout_id_t;
+
 /**
  * eloop_init() - Initialize global event loop data
  * Returns: 0 on success
@@ -195,6 +203,31 @@ int eloop_timeout_register(unsigned int msecs,
                eloop_timeout_handler handler,
                void *eloop_data, void *user_data);
 
+/**
+ * eloop_timeout_register_id - Register timeout and return its id
+ * @msecs: Number of milliseconds to the timeout
+ * @handler: Callback function to be called when timeout occurs
+ * @eloop_data: Callback context data (eloop_ctx)
+ * @user_data: Callback context data (sock_ctx)
+ * @id: Buffer for the id of the timeout, may be NULL
+ * Returns: 0 on success, -1 on failure
+ *
+ * Same as eloop_timeout_register() but also returns an id that can be passed
+ * to eloop_timeout_cancel_id() to cancel this timeout without a search.
+ */
+int eloop_timeout_register_id(unsigned int msecs,
+               eloop_timeout_handler handler,
+               void *eloop_data, void *user_data,
+               eloop_timeout_id_t *id);
+
+/**
+ * eloop_timeout_cancel_id - Cancel a timeout by id
+ * @id: Id returned by eloop_timeout_register_id()
+ * Returns: 1 if the timeout was cancelled, 0 if it already expired or was
+ * cancelled, -1 on failure
+ */
+int eloop_timeout_cancel_id(eloop_timeout_id_t id);
+
 /**
  * eloop_timeout_cancel - Cancel timeouts
  * @handler: Matching callback function
@@ -0,0 +1,236 @@
+#! /usr/bin/env python3
+#
+# Deferred co_printf log decoder
+#
+#     Copyright (c) 2024, GigaDevice Semiconductor Inc.
+#
+#     Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#     1. Redistributions of source code must retain the above copyright notice, this
+#        list of conditions and the following disclaimer.
+#     2. Redistributions in binary form must reproduce the above copyright notice,
+#        this list of conditions and the following disclaimer in the documentation
+#        and/or other materials provided with the distribution.
+#     3. Neither the name of the copyright holder nor the names of its contributors
+#        may be used to endorse or promote products derived from this software without
+#        specific prior written permission.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+# INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+# OF SUCH DAMAGE.
+
+"""
+Decode the records sent on the log UART when debug_print.c is built with
+CONFIG_PRINT_DEFERRED and CONFIG_PRINT_DEFERRED_RAW.
+
+Each record is a sequence of little endian 32-bit words:
+    hdr     magic 0xA5 [31:24], argc [23:16], record length in words [15:0]
+    format  address of the format string in the firmware ELF
+    argv    argc raw arguments
+    data    inline copies of the %s strings and of the %pM / %pI bytes
+A NULL format reports the number of logs dropped by the firmware.
+
+Usage: dlog_decode.py <firmware.elf> <capture.bin | ->
+"""
+
+import sys, struct, argparse
+
+DLOG_MAGIC_LOG = 0xA5
+DLOG_ARGS_MAX = 16
+
+
+class ElfImage:
+    """Read only view of the loadable sections of an ELF file."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % path)
+        is64 = self.data[4] == 2
+        end = '<' if self.data[5] == 1 else '>'
+        if is64:
+            shoff, = struct.unpack_from(end + 'Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(end + 'HH', self.data, 0x3A)
+            shdr = end + 'IIQQQQIIQQ'
+        else:
+            shoff, = struct.unpack_from(end + 'I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(end + 'HH', self.data, 0x2E)
+            shdr = end + 'IIIIIIIIII'
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, sh_flags, sh_addr, sh_offset, sh_size,
+             _, _, _, _) = struct.unpack_from(shdr, self.data, shoff + i * shentsize)
+            # SHT_PROGBITS sections with SHF_ALLOC
+            if sh_type == 1 and (sh_flags & 0x2) and sh_size:
+                self.sections.append((sh_addr, sh_size, sh_offset))
+
+    def string(self, addr):
+        for (sh_addr, sh_size, sh_offset) in self.sections:
+            if sh_addr <= addr < sh_addr + sh_size:
+                start = sh_offset + addr - sh_addr
+                stop = self.data.find(b'\0', start, sh_offset + sh_size)
+                if stop < 0:
+                    stop = sh_offset + sh_size
+                return self.data[start:stop].decode('latin-1')
+        return None
+
+
+def pad(s, width, flags):
+    """Pad like prints() in debug_print.c"""
+    if len(s) >= width:
+        return s
+    if 'right' in flags:
+        return s + ' ' * (width - len(s))
+    return ('0' if 'zero' in flags else ' ') * (width - len(s)) + s
+
+
+def number(value, base, signed, width, flags, upper=False):
+    """Convert like printi() in debug_print.c"""
+    value &= 0xFFFFFFFF
+    neg = signed and base == 10 and value & 0x80000000
+    if neg:
+        value = 0x100000000 - value
+    digits = '0123456789ABCDEF' if upper else '0123456789abcdef'
+    s = ''
+    while value:
+        s = digits[value % base] + s
+        value //= base
+    s = s or '0'
+    if neg:
+        if width and 'zero' in flags:
+            return '-' + pad(s, width - 1, flags)
+        s = '-' + s
+    return pad(s, width, flags)
+
+
+def format_record(fmt, argv, data):
+    """Replay the grammar of print_fmt() in debug_print.c"""
+    out = []
+    args = iter(argv)
+    i = 0
+
+    def next_arg():
+        return next(args, 0)
+
+    def next_data(n):
+        nonlocal data
+        if n < 0:
+            n = data.find(b'\0')
+            n = len(data) if n < 0 else n
+            s, data = data[:n], data[n + 1:]
+        else:
+            s, data = data[:n], data[n:]
+        return s
+
+    while i < len(fmt):
+        c = fmt[i]
+        if c != '%':
+            out.append(c)
+            i += 1
+            continue
+        i += 1
+        if i >= len(fmt):
+            break
+        if fmt[i] == '%':
+            out.append('%')
+            i += 1
+            continue
+        flags = set()
+        width = 0
+        if fmt[i] == '-':
+            flags.add('right')
+            i += 1
+        while i < len(fmt) and fmt[i] == '0':
+            flags.add('zero')
+            i += 1
+        while i < len(fmt) and fmt[i].isdigit():
+            width = width * 10 + int(fmt[i])
+            i += 1
+        if i >= len(fmt):
+            break
+        c = fmt[i]
+        i += 1
+        if c == 's':
+            out.append(pad(next_data(-1).decode('latin-1') if next_arg() else '(null)', width, flags))
+        elif c == 'd':
+            out.append(number(next_arg(), 10, True, width, flags))
+        elif c == 'p':
+            arg = next_arg()
+            kind = fmt[i] if i < len(fmt) else ''
+            if kind == 'M':
+                i += 1
+                b = next_data(6) if arg else bytes(6)
+                out.append(':'.join(number(x, 16, True, 2, flags | {'zero'}) for x in b))
+            elif kind == 'I':
+                i += 1
+                b = next_data(4) if arg else bytes(4)
+                out.append('.'.join(number(x, 10, True, width, flags) for x in b))
+            else:
+                out.append(number(arg, 16, False, width, flags))
+        elif c in 'xX':
+            out.append(number(next_arg(), 16, False, width, flags, c == 'X'))
+        else:
+            if c == 'z':
+                c = fmt[i] if i < len(fmt) else ''
+                i += 1
+            if c == 'u':
+                out.append(number(next_arg(), 10, False, width, flags))
+            elif c == 'c':
+                out.append(pad(chr(next_arg() & 0xFF), width, flags))
+    return ''.join(out)
+
+
+def decode(elf, stream, output):
+    buf = b''
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        buf += chunk
+        pos = 0
+        while len(buf) - pos >= 8:
+            hdr, fmt_addr = struct.unpack_from('<II', buf, pos)
+            words = hdr & 0xFFFF
+            argc = (hdr >> 16) & 0xFF
+            fmt = elf.string(fmt_addr) if fmt_addr else '<%u logs dropped>\r\n'
+            if (hdr >> 24) != DLOG_MAGIC_LOG or argc > DLOG_ARGS_MAX or \
+               words < 2 + argc or fmt is None:
+                # Not a record boundary (or output not coming from the
+                # deferred print), resynchronize on the next byte.
+                pos += 1
+                continue
+            if len(buf) - pos < words * 4:
+                break
+            argv = struct.unpack_from('<%dI' % argc, buf, pos + 8)
+            data = buf[pos + 8 + argc * 4:pos + words * 4]
+            output.write(format_record(fmt, argv, data))
+            pos += words * 4
+        buf = buf[pos:]
+    output.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode deferred co_printf records')
+    parser.add_argument('elf', help='firmware ELF file the records come from')
+    parser.add_argument('capture', help='raw log UART capture, - for stdin')
+    args = parser.parse_args()
+
+    elf = ElfImage(args.elf)
+    if args.capture == '-':
+        decode(elf, sys.stdin.buffer, sys.stdout)
+    else:
+        with open(args.capture, 'rb') as f:
+            decode(elf, f, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,165 @@
+#! /usr/bin/env python3
+#
+# Host tests and benchmarks of SDK modules
+#
+#     Copyright (c) 2024, GigaDevice Semiconductor Inc.
+#
+#     Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#     1. Redistributions of source code must retain the above copyright notice, this
+#        list of conditions and the following disclaimer.
+#     2. Redistributions in binary form must reproduce the above copyright notice,
+#        this list of conditions and the following disclaimer in the documentation
+#        and/or other materials provided with the distribution.
+#     3. Neither the name of the copyright holder nor the names of its contributors
+#        may be used to endorse or promote products derived from this software without
+#        specific prior written permission.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+# INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+# OF SUCH DAMAGE.
+
+"""
+Build the host tests and benchmarks of SDK modules with gcc and run them.
+
+The code under test is taken from the SDK sources at build time. Functions
+are cut out of their source file by name, so a test always runs the code of
+the tree it is in. Each test is a C file of this directory which includes the
+extracted code as "<test>_extract.inc" and stubs what the code needs from the
+RTOS and the drivers.
+
+Usage: hosttest.py [-k] [test ...]      run all tests when none is given
+       hosttest.py -l                   list the tests
+
+The timings are host timings, they compare the implementations with each
+other and do not predict the cycle counts on the RISC-V core.
+"""
+
+import os, re, sys, shutil, argparse, tempfile, subprocess
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, '..', '..'))
+
+# name: (C file, [(SDK source, [function names]) ...], extra gcc flags, description)
+TESTS = {
+    'memops': ('memops_bench.c',
+               [('MSDK/rtos/rtos_wrapper/wrapper_freertos.c', ['sys_memmove', 'sys_memcmp'])],
+               ['-O2'],
+               'sys_memmove/sys_memcmp against libc and the byte loops, 4 B to 4 KB'),
+    'mesh_slab': ('mesh_slab_test.c',
+                  [('MSDK/ble/mesh/port/mesh_kernel.c', ['k_mem_slab_alloc', 'k_mem_slab_free',
+                    'k_mem_slab_num_free_get', 'k_mem_slab_num_used_get', 'k_mem_slab_max_used_get'])],
+                  ['-I', 'MSDK/ble/mesh/port', '-I', 'MSDK/ble/mesh'],
+                  'mesh slab allocator: exhaustion, double free, ABA and tag wrap, corruption'),
+    'mesh_cache': ('mesh_cache_bench.c',
+                   [('MSDK/ble/mesh/src/rpl.h', ['struct bt_mesh_rpl {...};']),
+                    ('MSDK/ble/mesh/src/rpl.c', ['static struct bt_mesh_rpl replay_list...static uint16_t rpl_free_hint;',
+                     'rpl_idx', 'rpl_hash', 'rpl_step', 'rpl_dist', 'bt_mesh_rpl_find', 'rpl_index_add',
+                     'rpl_index_del', 'rpl_index_rebuild', 'rpl_free_slot']),
+                    ('MSDK/ble/mesh/src/net.c', ['#define NET_CACHE_INDEXED...};',
+                     '#if NET_CACHE_INDEXED\n/* Multiplicative...#endif /* NET_CACHE_INDEXED */',
+                     'net_cache_rewind', 'msg_cache_key'])],
+                   ['-O2', '-Wno-unused-function', '-Wno-unused-variable'],
+                   'mesh message cache scan/index and RPL index over a 1000-node trace'),
+    'wl_flash': ('wl_flash_sim.c', [], ['-O2'],
+                 'FatFS wear levelling on a simulated flash: cost per write, wear, resets'),
+}
+
+
+def extract(path, names):
+    """Return the definitions of the functions called names in the C file path.
+
+    A name 'first...last' takes the lines from the first line starting with
+    first to the next line starting with last, both included, for code that
+    is not a function (definitions, a block under #if).
+    """
+    with open(os.path.join(ROOT, path)) as f:
+        src = f.read()
+    out = []
+    for name in names:
+        if '...' in name:
+            first, last = name.split('...')
+            m = re.search(r'^%s' % re.escape(first), src, re.M)
+            e = m and re.compile(r'^%s.*$' % re.escape(last), re.M).search(src, m.end())
+            if not e:
+                raise ValueError('%s: no lines %s' % (path, name))
+            out.append('#line %d "%s"\n' % (src.count('\n', 0, m.start()) + 1, path))
+            out.append(src[m.start():e.end()] + '\n\n')
+            continue
+        m = re.search(r'^[A-Za-z_][^;{}()\n]*\b%s\s*\([^;{]*\)\s*\{' % re.escape(name), src, re.M)
+        if not m:
+            raise ValueError('%s: no definition of %s' % (path, name))
+        depth, i = 0, m.end() - 1
+        while True:
+            if src[i] == '{':
+                depth += 1
+            elif src[i] == '}':
+                depth -= 1
+                if depth == 0:
+                    break
+            i += 1
+        out.append('#line %d "%s"\n' % (src.count('\n', 0, m.start()) + 1, path))
+        out.append(src[m.start():i + 1] + '\n\n')
+    return ''.join(out)
+
+
+def run(name, workdir):
+    cfile, sources, cflags, _ = TESTS[name]
+    # include directories are given from the top of the tree
+    cflags = [os.path.join(ROOT, f) if p == '-I' else f for (p, f) in zip([None] + cflags, cflags)]
+    inc = os.path.join(workdir, name + '_extract.inc')
+    with open(inc, 'w') as f:
+        for (path, names) in sources:
+            f.write(extract(path, names))
+    exe = os.path.join(workdir, name)
+    cmd = ['gcc', '-std=gnu99', '-Wall', '-g'] + cflags + ['-I', workdir, '-I', ROOT,
+           '-o', exe, os.path.join(HERE, cfile)]
+    if subprocess.call(cmd) != 0:
+        print('%s: build failed' % name)
+        return False
+    print('== %s' % name)
+    sys.stdout.flush()
+    ok = subprocess.call([exe], cwd=workdir) == 0
+    print('== %s: %s' % (name, 'ok' if ok else 'FAILED'))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build and run the host tests of SDK modules')
+    parser.add_argument('tests', nargs='*', help='tests to run, all by default')
+    parser.add_argument('-l', '--list', action='store_true', help='list the tests')
+    parser.add_argument('-k', '--keep', action='store_true', help='keep the build directory')
+    args = parser.parse_args()
+
+    if args.list:
+        for name in sorted(TESTS):
+            print('%-12s %s' % (name, TESTS[name][3]))
+        return 0
+
+    names = args.tests or sorted(TESTS)
+    for name in names:
+        if name not in TESTS:
+            parser.error('unknown test %s' % name)
+
+    workdir = tempfile.mkdtemp(prefix='hosttest_')
+    failed = [name for name in names if not run(name, workdir)]
+    if args.keep:
+        print('build directory: %s' % workdir)
+    else:
+        shutil.rmtree(workdir)
+    if failed:
+        print('failed: %s' % ' '.join(failed))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
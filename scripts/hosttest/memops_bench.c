@@ -0,0 +1,182 @@
+/*!
+    \file    memops_bench.c
+    \brief   Host check and benchmark of sys_memmove() and sys_memcmp()
+
+    \version 2024-10-16, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* sys_memmove() and sys_memcmp() of wrapper_freertos.c */
+#include "memops_extract.inc"
+
+/* byte loops the wrapper used before */
+static void byte_memmove(void *des, const void *src, uint32_t n)
+{
+    char *tmp = (char *)des;
+    char *s = (char *)src;
+
+    if (s < tmp && tmp < s + n) {
+        tmp += n;
+        s += n;
+
+        while (n--)
+            *(--tmp) = *(--s);
+    } else {
+        while (n--)
+            *tmp++ = *s++;
+    }
+}
+
+static int32_t byte_memcmp(const void *buf1, const void *buf2, uint32_t count)
+{
+    if (!count)
+        return 0;
+
+    while (--count && *((char *)buf1) == *((char *)buf2)) {
+        buf1 = (char *)buf1 + 1;
+        buf2 = (char *)buf2 + 1;
+    }
+
+    return (*((uint8_t *)buf1) - *((uint8_t *)buf2));
+}
+
+static int sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+static uint8_t buf_a[8192 + 64], buf_b[8192 + 64], buf_ref[8192 + 64];
+
+/* every size up to 300 bytes at every source and destination offset, both overlaps */
+static int check(void)
+{
+    int i, n, so, doff, o1, o2, k, e, g;
+
+    srand(3);
+    for (i = 0; i < 300000; i++) {
+        n = rand() % 300;
+        so = rand() % 64;
+        doff = rand() % 64;
+        for (k = 0; k < 400; k++)
+            buf_a[k] = rand();
+        memcpy(buf_ref, buf_a, 400);
+        memmove(buf_ref + doff, buf_ref + so, n);
+        sys_memmove(buf_a + doff, buf_a + so, n);
+        if (memcmp(buf_a, buf_ref, 400)) {
+            printf("sys_memmove: wrong result, n %d src +%d dst +%d\n", n, so, doff);
+            return -1;
+        }
+
+        o1 = rand() % 8;
+        o2 = rand() % 8;
+        n = rand() % 200;
+        for (k = 0; k < n + 8; k++)
+            buf_a[o1 + k] = buf_b[o2 + k] = (rand() & 3) ? 0x5A : rand();
+        if (n && (rand() & 1))
+            buf_b[o2 + rand() % n] = rand();
+        e = memcmp(buf_a + o1, buf_b + o2, n);
+        g = sys_memcmp(buf_a + o1, buf_b + o2, n);
+        if (sign(e) != sign(g) || g != byte_memcmp(buf_a + o1, buf_b + o2, n)) {
+            printf("sys_memcmp: wrong result %d, libc %d, n %d\n", g, e, n);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double ns_per_call(void (*mv)(void *, const void *, uint32_t),
+                          int32_t (*cmp)(const void *, const void *, uint32_t),
+                          uint32_t n, int src_off, int dst_off, long reps)
+{
+    volatile int32_t sink = 0;
+    clock_t t0 = clock();
+    long r;
+
+    for (r = 0; r < reps; r++) {
+        if (mv)
+            mv(buf_a + dst_off, buf_a + src_off, n);
+        else
+            sink += cmp(buf_a + dst_off, buf_b + src_off, n);
+        __asm__ volatile("" : : "r"(buf_a), "r"(buf_b) : "memory");
+    }
+    (void)sink;
+
+    return (double)(clock() - t0) * 1e9 / CLOCKS_PER_SEC / reps;
+}
+
+static void libc_memmove(void *d, const void *s, uint32_t n)
+{
+    memmove(d, s, n);
+}
+
+static int32_t libc_memcmp(const void *a, const void *b, uint32_t n)
+{
+    return memcmp(a, b, n);
+}
+
+int main(void)
+{
+    static const uint32_t sizes[] = {4, 16, 64, 256, 1024, 4096};
+    uint32_t i, n;
+    int mis;
+    long reps;
+
+    if (check())
+        return 1;
+    printf("sys_memmove/sys_memcmp match libc on 300000 random cases\n\n");
+
+    printf("ns per call          |       memmove (dst +8)      |       memcmp\n");
+    printf("size   src/dst       |   bytes    words     libc   |   bytes    words     libc\n");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        n = sizes[i];
+        reps = 40000000L / n + 1000;
+        memset(buf_a, 0x5A, sizeof(buf_a));
+        memset(buf_b, 0x5A, sizeof(buf_b));
+        for (mis = 0; mis < 2; mis++) {
+            /* aligned: source at +0 / compare at same offsets; misaligned: source at +3 / +1 vs +2 */
+            printf("%5u  %-12s  | %7.1f  %7.1f  %7.1f   | %7.1f  %7.1f  %7.1f\n", n,
+                   mis ? "misaligned" : "aligned",
+                   ns_per_call(byte_memmove, NULL, n, mis ? 3 : 0, 8, reps),
+                   ns_per_call(sys_memmove, NULL, n, mis ? 3 : 0, 8, reps),
+                   ns_per_call(libc_memmove, NULL, n, mis ? 3 : 0, 8, reps),
+                   ns_per_call(NULL, byte_memcmp, n, mis ? 2 : 0, mis ? 1 : 0, reps),
+                   ns_per_call(NULL, sys_memcmp, n, mis ? 2 : 0, mis ? 1 : 0, reps),
+                   ns_per_call(NULL, libc_memcmp, n, mis ? 2 : 0, mis ? 1 : 0, reps));
+        }
+    }
+
+    return 0;
+}
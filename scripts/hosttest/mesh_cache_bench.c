@@ -0,0 +1,258 @@
+/*!
+    \file    mesh_cache_bench.c
+    \brief   Host benchmark of the mesh message cache and replay protection list
+
+    \version 2024-10-16, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ARRAY_SIZE(a)           (sizeof(a) / sizeof((a)[0]))
+#define BIT_MASK(n)             ((1UL << (n)) - 1UL)
+#define ATOMIC_BITMAP_SIZE(n)   (((n) + 31) / 32)
+
+typedef long atomic_t;
+
+#define NODES       1000
+#define NODE_PDUS   200
+#define MAX_PDUS    (NODES * NODE_PDUS * 3)
+
+struct trace_pdu {
+    uint16_t src;
+    uint32_t seq;
+    uint32_t time;
+};
+
+struct cache_impl {
+    int size;
+    int indexed;
+    uint32_t (*msg_cache_run)(const struct trace_pdu *pdu, int n);
+    uint32_t (*rpl_run)(const struct trace_pdu *pdu, int n, int indexed);
+    void (*rpl_fill)(void);
+    void (*rpl_rebuild)(void);
+};
+
+#define CACHE_SIZE 16
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 32
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 64
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 128
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 256
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 512
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+#define CACHE_SIZE 1024
+#define CACHE_INDEXED 0
+#include "mesh_cache_bench.h"
+#define CACHE_INDEXED 1
+#include "mesh_cache_bench.h"
+#undef CACHE_SIZE
+
+/* scan and index copy of each size */
+static const struct cache_impl *const impls[][2] = {
+    {&impl_16_0, &impl_16_1},
+    {&impl_32_0, &impl_32_1},
+    {&impl_64_0, &impl_64_1},
+    {&impl_128_0, &impl_128_1},
+    {&impl_256_0, &impl_256_1},
+    {&impl_512_0, &impl_512_1},
+    {&impl_1024_0, &impl_1024_1},
+};
+
+static struct trace_pdu trace[MAX_PDUS];
+
+static int by_time(const void *a, const void *b)
+{
+    const struct trace_pdu *x = a, *y = b;
+
+    return (x->time > y->time) - (x->time < y->time);
+}
+
+/*
+ * nodes sources sending NODE_PDUS PDUs each, in random order. Every PDU is
+ * received over one to three paths, the relayed copies up to 64 PDUs later.
+ */
+static int make_trace(int nodes)
+{
+    static uint32_t seq[NODES + 1];
+    int i, k, copies, n = 0;
+
+    srand(7);
+    memset(seq, 0, sizeof(seq));
+    for (i = 0; i < nodes * NODE_PDUS; i++) {
+        uint16_t src = 1 + rand() % nodes;
+
+        seq[src] += 1 + rand() % 2;
+        copies = 1 + rand() % 3;
+        for (k = 0; k < copies; k++) {
+            trace[n].src = src;
+            trace[n].seq = seq[src];
+            trace[n].time = (uint32_t)i * 8 + (k ? 1 + rand() % 512 : 0);
+            n++;
+        }
+    }
+    qsort(trace, n, sizeof(trace[0]), by_time);
+
+    return n;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best of five runs, in ns per PDU */
+static double time_msg_cache(const struct cache_impl *impl, int n, uint32_t *hits)
+{
+    double t, best = 0;
+    int r;
+
+    for (r = 0; r < 5; r++) {
+        t = now_ns();
+        *hits = impl->msg_cache_run(trace, n);
+        t = (now_ns() - t) / n;
+        if (!r || t < best)
+            best = t;
+    }
+
+    return best;
+}
+
+static double time_rpl(const struct cache_impl *impl, int n, int indexed, uint32_t *replays)
+{
+    double t, best = 0;
+    int r;
+
+    for (r = 0; r < 5; r++) {
+        t = now_ns();
+        *replays = impl->rpl_run(trace, n, indexed);
+        t = (now_ns() - t) / n;
+        if (!r || t < best)
+            best = t;
+    }
+
+    return best;
+}
+
+static double time_rebuild(const struct cache_impl *impl)
+{
+    double t;
+    int r, reps = 2000000 / impl->size;
+
+    impl->rpl_fill();
+    t = now_ns();
+    for (r = 0; r < reps; r++) {
+        impl->rpl_rebuild();
+        __asm__ volatile("" : : : "memory");
+    }
+
+    return (now_ns() - t) / reps;
+}
+
+int main(void)
+{
+    const struct cache_impl *scan, *index;
+    uint32_t hits[2], replays[2];
+    double t[2], rebuild;
+    int failed = 0, i, n, nodes;
+
+    n = make_trace(NODES);
+    printf("message cache, %d nodes, %d PDUs received, one lookup per PDU and an insert on a miss\n",
+           NODES, n);
+    printf("entries    hits    scan ns/PDU  index ns/PDU\n");
+    for (i = 0; i < ARRAY_SIZE(impls); i++) {
+        scan = impls[i][0];
+        index = impls[i][1];
+        t[0] = time_msg_cache(scan, n, &hits[0]);
+        t[1] = time_msg_cache(index, n, &hits[1]);
+        printf("%7d  %5.1f %%  %11.1f  %12.1f\n", scan->size, 100.0 * hits[0] / n, t[0], t[1]);
+        if (hits[0] != hits[1]) {
+            printf("  scan and index disagree: %u and %u hits\n", hits[0], hits[1]);
+            failed = 1;
+        }
+    }
+
+    printf("\nreplay protection list, one check and update per PDU, rebuild of a full list\n");
+    printf("entries  nodes  scan ns/PDU  index ns/PDU  rebuild us  rebuild in PDUs saved\n");
+    for (i = 0; i < ARRAY_SIZE(impls); i++) {
+        index = impls[i][1];
+        nodes = index->size < NODES ? index->size : NODES;
+        n = make_trace(nodes);
+        t[0] = time_rpl(index, n, 0, &replays[0]);
+        t[1] = time_rpl(index, n, 1, &replays[1]);
+        rebuild = time_rebuild(index);
+        printf("%7d  %5d  %11.1f  %12.1f  %10.2f  ", index->size, nodes, t[0], t[1], rebuild / 1000);
+        if (t[0] > t[1])
+            printf("%21.0f\n", rebuild / (t[0] - t[1]));
+        else
+            printf("%21s\n", "never");
+        if (replays[0] != replays[1]) {
+            printf("  scan and index disagree: %u and %u replays\n", replays[0], replays[1]);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
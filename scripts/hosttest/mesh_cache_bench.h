@@ -0,0 +1,194 @@
+/*!
+    \file    mesh_cache_bench.h
+    \brief   One copy of the mesh message cache and RPL code for mesh_cache_bench.c
+
+    \version 2024-10-16, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+/*
+ * Included once per configuration, with before the include:
+ *   CACHE_SIZE     CONFIG_BT_MESH_MSG_CACHE_SIZE and CONFIG_BT_MESH_CRPL
+ *   CACHE_INDEXED  1 to index the message cache, 0 to scan it
+ * Every name of the copy gets the suffix _<CACHE_SIZE>_<CACHE_INDEXED>.
+ */
+
+#define CACHE_CAT(x, n, i)      x##_##n##_##i
+#define CACHE_CAT_(x, n, i)     CACHE_CAT(x, n, i)
+#define CACHE_NAME(x)           CACHE_CAT_(x, CACHE_SIZE, CACHE_INDEXED)
+
+#define CONFIG_BT_MESH_MSG_CACHE_SIZE   CACHE_SIZE
+#define CONFIG_BT_MESH_CRPL             CACHE_SIZE
+#define NET_CACHE_IDX_MIN               (CACHE_INDEXED ? 0 : CACHE_SIZE + 1)
+
+#define net_cache               CACHE_NAME(net_cache)
+#define net_cache_hash          CACHE_NAME(net_cache_hash)
+#define net_cache_step          CACHE_NAME(net_cache_step)
+#define net_cache_dist          CACHE_NAME(net_cache_dist)
+#define net_cache_find          CACHE_NAME(net_cache_find)
+#define net_cache_unlink        CACHE_NAME(net_cache_unlink)
+#define net_cache_add           CACHE_NAME(net_cache_add)
+#define net_cache_rewind        CACHE_NAME(net_cache_rewind)
+#define msg_cache_key           CACHE_NAME(msg_cache_key)
+#define bt_mesh_rpl             CACHE_NAME(bt_mesh_rpl)
+#define replay_list             CACHE_NAME(replay_list)
+#define store                   CACHE_NAME(store)
+#define rpl_index               CACHE_NAME(rpl_index)
+#define rpl_free_hint           CACHE_NAME(rpl_free_hint)
+#define rpl_idx                 CACHE_NAME(rpl_idx)
+#define rpl_hash                CACHE_NAME(rpl_hash)
+#define rpl_step                CACHE_NAME(rpl_step)
+#define rpl_dist                CACHE_NAME(rpl_dist)
+#define bt_mesh_rpl_find        CACHE_NAME(bt_mesh_rpl_find)
+#define rpl_index_add           CACHE_NAME(rpl_index_add)
+#define rpl_index_del           CACHE_NAME(rpl_index_del)
+#define rpl_index_rebuild       CACHE_NAME(rpl_index_rebuild)
+#define rpl_free_slot           CACHE_NAME(rpl_free_slot)
+
+/* the cache code of net.c and the RPL index of rpl.c */
+#include "mesh_cache_extract.inc"
+
+static struct net_cache CACHE_NAME(cache);
+
+/* One lookup per received PDU, the key is added on a miss as net_decode() does */
+static uint32_t CACHE_NAME(msg_cache_run)(const struct trace_pdu *pdu, int n)
+{
+    struct net_cache *cache = &CACHE_NAME(cache);
+    uint32_t hits = 0;
+    int i;
+
+    memset(cache, 0, sizeof(*cache));
+    for (i = 0; i < n; i++) {
+        if (net_cache_find(cache, msg_cache_key(pdu[i].src, pdu[i].seq)))
+            hits++;
+        else
+            net_cache_add(cache, msg_cache_key(pdu[i].src, pdu[i].seq));
+    }
+
+    return hits;
+}
+
+/* First slot of the source or first free slot, the scan rpl.c did before the index */
+static struct bt_mesh_rpl *CACHE_NAME(rpl_scan)(uint16_t src)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
+        if (!replay_list[i].src || replay_list[i].src == src)
+            return &replay_list[i];
+    }
+
+    return NULL;
+}
+
+/* Replay check and update of each PDU as bt_mesh_rpl_check(), returns the replays */
+static uint32_t CACHE_NAME(rpl_run)(const struct trace_pdu *pdu, int n, int indexed)
+{
+    struct bt_mesh_rpl *rpl;
+    uint32_t replays = 0;
+    int i;
+
+    memset(replay_list, 0, sizeof(replay_list));
+    rpl_index_rebuild();
+    for (i = 0; i < n; i++) {
+        if (indexed) {
+            rpl = bt_mesh_rpl_find(pdu[i].src);
+            if (!rpl) {
+                rpl = rpl_free_slot();
+                if (rpl) {
+                    rpl->src = pdu[i].src;
+                    rpl_index_add(rpl);
+                }
+            }
+        } else {
+            rpl = CACHE_NAME(rpl_scan)(pdu[i].src);
+            if (rpl)
+                rpl->src = pdu[i].src;
+        }
+
+        if (!rpl || (rpl->seq && rpl->seq >= pdu[i].seq))
+            replays++;
+        else
+            rpl->seq = pdu[i].seq;
+    }
+
+    return replays;
+}
+
+/* A full list, as after an IV Index update or a reload from flash */
+static void CACHE_NAME(rpl_fill)(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
+        replay_list[i].src = i + 1;
+        replay_list[i].seq = 1;
+    }
+}
+
+static const struct cache_impl CACHE_NAME(impl) = {
+    CACHE_SIZE, CACHE_INDEXED,
+    CACHE_NAME(msg_cache_run),
+    CACHE_NAME(rpl_run),
+    CACHE_NAME(rpl_fill),
+    rpl_index_rebuild,
+};
+
+#undef net_cache
+#undef net_cache_hash
+#undef net_cache_step
+#undef net_cache_dist
+#undef net_cache_find
+#undef net_cache_unlink
+#undef net_cache_add
+#undef net_cache_rewind
+#undef msg_cache_key
+#undef bt_mesh_rpl
+#undef replay_list
+#undef store
+#undef rpl_index
+#undef rpl_free_hint
+#undef rpl_idx
+#undef rpl_hash
+#undef rpl_step
+#undef rpl_dist
+#undef bt_mesh_rpl_find
+#undef rpl_index_add
+#undef rpl_index_del
+#undef rpl_index_rebuild
+#undef rpl_free_slot
+
+#undef CONFIG_BT_MESH_MSG_CACHE_SIZE
+#undef CONFIG_BT_MESH_CRPL
+#undef NET_CACHE_IDX_MIN
+#undef NET_CACHE_INDEXED
+#undef NET_CACHE_IDX_SIZE
+#undef NET_CACHE_IDX_FREE
+#undef RPL_IDX_SIZE
+#undef CACHE_INDEXED
@@ -0,0 +1,275 @@
+/*!
+    \file    mesh_slab_test.c
+    \brief   Host test of the mesh memory slab allocator
+
+    \version 2024-10-16, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "mesh_kernel.h"
+#include "sys/mesh_atomic.h"
+
+static int log_errors;
+
+#define LOG_ERR(fmt, ...)                                   \
+    do {                                                    \
+        log_errors++;                                       \
+        printf("    log: " fmt "\n", ##__VA_ARGS__);        \
+    } while (0)
+
+/* Run once just before the next CAS of the slab, as an interrupt would */
+static void (*cas_hook)(void);
+
+static bool hooked_cas(atomic_t *target, atomic_val_t old_value, atomic_val_t new_value)
+{
+    void (*hook)(void) = cas_hook;
+
+    if (hook != NULL) {
+        cas_hook = NULL;
+        hook();
+    }
+    return (atomic_cas)(target, old_value, new_value);
+}
+
+#define atomic_cas(t, o, n) hooked_cas(t, o, n)
+
+/* k_mem_slab_alloc() and k_mem_slab_free() of mesh_kernel.c */
+#include "mesh_slab_extract.inc"
+
+#define NUM_BLOCKS  8
+
+K_MEM_SLAB_DEFINE_STATIC(slab, 13, NUM_BLOCKS, 4);
+
+static int failures;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("    %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static const k_timeout_t no_wait;
+
+static int block_idx(void *mem)
+{
+    return (int)(((char *)mem - slab.buffer) / slab.block_size);
+}
+
+static void *alloc_one(void)
+{
+    void *mem = NULL;
+
+    if (k_mem_slab_alloc(&slab, &mem, no_wait) != 0)
+        return NULL;
+    return mem;
+}
+
+/* Allocate every block, check they are distinct blocks of the buffer */
+static int alloc_all(void *mem[NUM_BLOCKS + 1])
+{
+    int seen[NUM_BLOCKS] = {0};
+    int n = 0, i;
+
+    while (n <= NUM_BLOCKS && (mem[n] = alloc_one()) != NULL) {
+        i = block_idx(mem[n]);
+        CHECK(((char *)mem[n] - slab.buffer) % slab.block_size == 0);
+        CHECK(i >= 0 && i < NUM_BLOCKS);
+        if (i >= 0 && i < NUM_BLOCKS) {
+            CHECK(!seen[i]);
+            seen[i] = 1;
+        }
+        memset(mem[n], 0xA5, slab.block_size);
+        n++;
+    }
+    return n;
+}
+
+static void free_all(void *mem[], int n)
+{
+    while (n > 0)
+        k_mem_slab_free(&slab, mem[--n]);
+}
+
+static void test_exhaustion(void)
+{
+    void *mem[NUM_BLOCKS + 1];
+
+    printf("  exhaustion\n");
+    CHECK(slab.block_size == 16);
+    CHECK(alloc_all(mem) == NUM_BLOCKS);
+    CHECK(alloc_one() == NULL);
+    CHECK(k_mem_slab_num_free_get(&slab) == 0);
+    free_all(mem, NUM_BLOCKS);
+    CHECK(k_mem_slab_num_used_get(&slab) == 0);
+
+    /* The second round comes from the free list */
+    CHECK(alloc_all(mem) == NUM_BLOCKS);
+    CHECK(k_mem_slab_max_used_get(&slab) == NUM_BLOCKS);
+    free_all(mem, NUM_BLOCKS);
+    CHECK(log_errors == 0);
+}
+
+static void test_bad_free(void)
+{
+    void *mem[NUM_BLOCKS + 1];
+    void *a;
+    char outside[16];
+
+    printf("  double free and foreign pointers\n");
+    a = alloc_one();
+    k_mem_slab_free(&slab, a);
+    k_mem_slab_free(&slab, a);
+    CHECK(log_errors == 1);
+    CHECK(k_mem_slab_num_used_get(&slab) == 0);
+
+    k_mem_slab_free(&slab, (char *)a + 4);
+    k_mem_slab_free(&slab, outside);
+    k_mem_slab_free(&slab, slab.buffer + NUM_BLOCKS * slab.block_size);
+    CHECK(log_errors == 4);
+
+    /* The block freed twice is handed out once */
+    CHECK(alloc_all(mem) == NUM_BLOCKS);
+    free_all(mem, NUM_BLOCKS);
+    log_errors = 0;
+}
+
+static void *irq_mem[2];
+
+/* Between the load of the head block A and the CAS: take A and B, give A back */
+static void irq_pop_two_push_one(void)
+{
+    irq_mem[0] = alloc_one();
+    irq_mem[1] = alloc_one();
+    k_mem_slab_free(&slab, irq_mem[0]);
+}
+
+/*
+ * Free list A -> B -> C. The interrupted allocation read A and its link B;
+ * without the tag its CAS would succeed, make B the head and B would be
+ * handed out a second time.
+ */
+static void test_aba(void)
+{
+    void *mem[NUM_BLOCKS + 1];
+    void *a, *b, *c, *x, *y;
+
+    a = alloc_one();
+    b = alloc_one();
+    c = alloc_one();
+    k_mem_slab_free(&slab, c);
+    k_mem_slab_free(&slab, b);
+    k_mem_slab_free(&slab, a);
+
+    cas_hook = irq_pop_two_push_one;
+    x = alloc_one();
+    CHECK(irq_mem[0] == a && irq_mem[1] == b);
+    CHECK(x == a);
+    y = alloc_one();
+    CHECK(y == c);
+    CHECK(k_mem_slab_num_used_get(&slab) == 3);
+
+    k_mem_slab_free(&slab, x);
+    k_mem_slab_free(&slab, y);
+    k_mem_slab_free(&slab, irq_mem[1]);
+    CHECK(alloc_all(mem) == NUM_BLOCKS);
+    free_all(mem, NUM_BLOCKS);
+    CHECK(log_errors == 0);
+}
+
+static void test_tag(void)
+{
+    void *a;
+    uint32_t tag = (uint32_t)atomic_get(&slab.free_list) >> 16;
+    long i;
+
+    printf("  tag, before and after a wrap of the 16-bit tag\n");
+    test_aba();
+
+    for (i = 0; i < 0x10000 + 123; i++) {
+        a = alloc_one();
+        CHECK(a != NULL);
+        k_mem_slab_free(&slab, a);
+    }
+    CHECK(((uint32_t)atomic_get(&slab.free_list) >> 16) != tag);
+    test_aba();
+}
+
+static void test_corruption(void)
+{
+    void *mem[NUM_BLOCKS + 1];
+    void *a, *b;
+    uint32_t link;
+
+    printf("  corrupted free blocks\n");
+
+    /* Link word out of range: reported, nothing outside the slab handed out */
+    a = alloc_one();
+    k_mem_slab_free(&slab, a);
+    link = *(uint32_t *)a;
+    *(uint32_t *)a = 0x12345678;
+    CHECK(alloc_one() == NULL);
+    CHECK(log_errors == 1);
+
+    /* Repair the list for the next case */
+    *(uint32_t *)a = link;
+    CHECK(alloc_one() == a);
+
+    /* Link word to an allocated block: that block is not handed out again */
+    b = alloc_one();
+    CHECK(b != NULL);
+    k_mem_slab_free(&slab, a);
+    *(uint32_t *)a = block_idx(b);
+    CHECK(alloc_one() == a);
+    CHECK(alloc_one() == NULL);
+    CHECK(log_errors == 2);
+
+    /* The other blocks are still carved, b stays with its owner */
+    k_mem_slab_free(&slab, a);
+    k_mem_slab_free(&slab, b);
+    CHECK(alloc_all(mem) == NUM_BLOCKS);
+    free_all(mem, NUM_BLOCKS);
+    CHECK(log_errors == 2);
+    log_errors = 0;
+}
+
+int main(void)
+{
+    test_exhaustion();
+    test_bad_free();
+    test_tag();
+    test_corruption();
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures != 0;
+}
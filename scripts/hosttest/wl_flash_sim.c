@@ -0,0 +1,398 @@
+/*!
+    \file    wl_flash_sim.c
+    \brief   Host flash simulator of the FatFS wear levelling layer
+
+    \version 2024-10-16, V1.0.0, firmware for GD32VW55x
+*/
+
+/*
+    Copyright (c) 2024, GigaDevice Semiconductor Inc.
+
+    Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software without
+       specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* internal flash area of the default configuration, 45 ms erase, 2.7 us/byte program, 0.06 us/byte read */
+#define AREA_SIZE       0xC0000
+#define SECTOR_SIZE     0x1000
+#define PAGES           (AREA_SIZE / SECTOR_SIZE)
+#define T_ERASE         45e-3
+#define T_PROG_BYTE     2.7e-6
+#define T_READ_BYTE     0.06e-6
+#define WRITES          20000
+#define FILL_PERCENT    80
+
+#define FATFS_WL_LEGACY 1
+
+typedef void *os_mutex_t;
+#define OS_OK           0
+
+static int verbose;
+#define app_print(...)  do { if (verbose) printf(__VA_ARGS__); } while (0)
+#define sys_malloc      malloc
+#define sys_zalloc(n)   calloc(n, 1)
+#define sys_mfree       free
+#define sys_memset      memset
+
+static int sys_mutex_init(os_mutex_t *m)
+{
+    *m = (void *)1;
+    return OS_OK;
+}
+
+static void sys_mutex_free(os_mutex_t *m)
+{
+    *m = NULL;
+}
+
+static void sys_mutex_get(os_mutex_t *m)
+{
+}
+
+static void sys_mutex_put(os_mutex_t *m)
+{
+}
+
+/*
+ * Flash model. A reset is simulated by a longjmp before the flash operation
+ * number cut_at: a program then leaves its first half programmed, an erase
+ * leaves a page that reads blank but is weak, bits programmed on a weak page
+ * are not reliable. Programming a bit from 0 to 1 is counted as an error too.
+ */
+static uint8_t flash[AREA_SIZE];
+static uint8_t weak[PAGES];
+static long erases[PAGES];
+static long n_erase, n_prog_bytes, n_read_bytes;
+static long n_overwrite, n_weak_prog;
+static long cut_at = -1, ops;
+static jmp_buf cut_jmp;
+
+static int cut_now(void)
+{
+    return (cut_at >= 0) && (ops++ == cut_at);
+}
+
+static int raw_flash_erase(uint32_t offset, int len)
+{
+    int p;
+
+    if ((offset % SECTOR_SIZE) || (len % SECTOR_SIZE) || (offset + len > AREA_SIZE)) {
+        printf("bad erase 0x%x 0x%x\n", offset, len);
+        exit(1);
+    }
+    for (p = offset / SECTOR_SIZE; p < (int)((offset + len) / SECTOR_SIZE); p++) {
+        memset(flash + p * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+        if (cut_now()) {
+            weak[p] = 1;
+            longjmp(cut_jmp, 1);
+        }
+        weak[p] = 0;
+        erases[p]++;
+        n_erase++;
+    }
+    return 0;
+}
+
+static int raw_flash_write(uint32_t offset, const void *data, int len)
+{
+    const uint8_t *s = data;
+    int i, cut = cut_now();
+
+    if (offset + len > AREA_SIZE) {
+        printf("bad write 0x%x 0x%x\n", offset, len);
+        exit(1);
+    }
+    for (i = 0; i < (cut ? len / 2 : len); i++) {
+        if ((flash[offset + i] & s[i]) != s[i])
+            n_overwrite++;
+        if (weak[(offset + i) / SECTOR_SIZE] && (s[i] != 0xFF))
+            n_weak_prog++;
+        flash[offset + i] &= s[i];
+    }
+    if (cut)
+        longjmp(cut_jmp, 1);
+    n_prog_bytes += len;
+    return 0;
+}
+
+static int raw_flash_read(uint32_t offset, void *data, int len)
+{
+    memcpy(data, flash + offset, len);
+    n_read_bytes += len;
+    return 0;
+}
+
+static uint32_t crc_value;
+
+static void crc_data_register_reset(void)
+{
+    crc_value = 0xFFFFFFFF;
+}
+
+static uint32_t crc_block_data_calculate(uint32_t *data, uint32_t n)
+{
+    uint32_t i;
+    int k;
+
+    for (i = 0; i < n; i++) {
+        crc_value ^= data[i];
+        for (k = 0; k < 32; k++)
+            crc_value = (crc_value & 0x80000000) ? (crc_value << 1) ^ 0x04C11DB7 : (crc_value << 1);
+    }
+    return crc_value;
+}
+
+#include "MSDK/FatFS/port/wear_levelling_flash.h"
+#include "MSDK/FatFS/port/wear_levelling_flash.c"
+
+static uint32_t ver[PAGES];
+static uint8_t buf[SECTOR_SIZE];
+static int failures;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("  %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void fill(uint32_t lba, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < SECTOR_SIZE / 4; i++)
+        ((uint32_t *)buf)[i] = lba * 0x10001u ^ v ^ i;
+}
+
+static int matches(uint32_t lba, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < SECTOR_SIZE / 4; i++) {
+        if (((uint32_t *)buf)[i] != (v ? lba * 0x10001u ^ v ^ i : 0xFFFFFFFF))
+            return 0;
+    }
+    return 1;
+}
+
+/* config of fatfs_volume_mount(), then wl_flash_config() */
+static int mount(wl_flash_t *w, uint32_t format)
+{
+    memset(w, 0, sizeof(*w));
+    w->cfg.start_addr = 0;
+    w->cfg.full_mem_size = AREA_SIZE;
+    w->cfg.sector_size = SECTOR_SIZE;
+    w->cfg.version = 0x00000002;
+    w->cfg.temp_buff_size = SECTOR_SIZE;
+    w->cfg.format = format;
+    return wl_flash_config(w);
+}
+
+static int remount(wl_flash_t *w)
+{
+    wl_flash_release(w);
+    return mount(w, 0);
+}
+
+/*
+ * Compare every sector with its version, 0 is a sector never written. The
+ * sector being written when a reset cut the write may hold either version.
+ */
+static int verify(wl_flash_t *w, int inflight, uint32_t newv)
+{
+    uint32_t lba;
+    int bad = 0;
+
+    for (lba = 0; lba < w->log_cnt; lba++) {
+        if (wl_flash_read(w, lba, buf, 1)) {
+            bad++;
+            continue;
+        }
+        if (matches(lba, ver[lba]))
+            continue;
+        if (((int)lba == inflight) && matches(lba, newv)) {
+            ver[lba] = newv;
+            continue;
+        }
+        bad++;
+    }
+    return bad;
+}
+
+static void reset_counters(void)
+{
+    n_erase = n_prog_bytes = n_read_bytes = 0;
+}
+
+static double iops(long erase_cnt, int writes)
+{
+    return writes / (erase_cnt * T_ERASE + n_prog_bytes * T_PROG_BYTE + n_read_bytes * T_READ_BYTE);
+}
+
+/* fill the volume and time random sector writes, gc_every > 0 runs a gc step as an idle task would */
+static void random_writes(wl_flash_t *w, const char *name, int gc_every)
+{
+    uint32_t used = w->log_cnt * FILL_PERCENT / 100, lba;
+    long gc_erase = 0, before, min = -1, max = 0;
+    uint8_t more;
+    int i;
+
+    for (lba = 0; lba < used; lba++) {
+        if (ver[lba] == 0) {
+            ver[lba] = 1;
+            fill(lba, 1);
+            CHECK(wl_flash_write(w, lba, buf, 1) == 0);
+        }
+    }
+
+    memset(erases, 0, sizeof(erases));
+    reset_counters();
+    for (i = 0; i < WRITES; i++) {
+        lba = rand() % used;
+        fill(lba, ++ver[lba]);
+        CHECK(wl_flash_write(w, lba, buf, 1) == 0);
+        if (gc_every && ((i % gc_every) == gc_every - 1)) {
+            before = n_erase;
+            CHECK(wl_flash_gc_step(w, 4, &more) == 0);
+            gc_erase += n_erase - before;
+        }
+    }
+    for (i = 0; i < PAGES - 4; i++) {
+        if ((min < 0) || (erases[i] < min))
+            min = erases[i];
+        if (erases[i] > max)
+            max = erases[i];
+    }
+
+    printf("%-22s %6.3f  %6.3f  %6.2f  %6.1f   %ld..%ld\n", name, (double)(n_erase - gc_erase) / WRITES,
+           (double)gc_erase / WRITES, n_prog_bytes / 1024.0 / WRITES, iops(n_erase - gc_erase, WRITES), min, max);
+}
+
+/* state of a volume as initialized by the previous layer, two copies ahead of the config sector */
+static void old_volume_create(void)
+{
+    wl_state_old_t state;
+    uint32_t state_size = SECTOR_SIZE, addr;
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(&state, 0, sizeof(state));
+    state.block_size = SECTOR_SIZE;
+    state.version = WL_OLD_VERSION;
+    state.max_pos = 1 + (AREA_SIZE / SECTOR_SIZE - 2 - 1 - 1);
+    crc_data_register_reset();
+    state.crc = crc_block_data_calculate((uint32_t *)&state, (sizeof(state) - 4) / 4);
+    addr = AREA_SIZE - SECTOR_SIZE - 2 * state_size;
+    memcpy(flash + addr, &state, sizeof(state));
+    memcpy(flash + addr + state_size, &state, sizeof(state));
+}
+
+static void power_cuts(wl_flash_t *w, int cuts)
+{
+    uint32_t used = w->log_cnt * FILL_PERCENT / 100, lba, newv;
+    int bad = 0, c;
+    uint8_t more;
+
+    for (c = 0; c < cuts; c++) {
+        lba = rand() % used;
+        newv = ver[lba] + 1;
+        fill(lba, newv);
+        ops = 0;
+        cut_at = rand() % 12;
+        if (!setjmp(cut_jmp)) {
+            if (rand() % 3 == 0)
+                wl_flash_gc_step(w, 2, &more);
+            fill(lba, newv);
+            wl_flash_write(w, lba, buf, 1);
+            ver[lba] = newv;
+            cut_at = -1;
+            lba = -1;
+        }
+        cut_at = -1;
+        if (remount(w)) {
+            printf("  mount failed after a reset\n");
+            failures++;
+            return;
+        }
+        bad += verify(w, (int)lba, newv);
+    }
+
+    printf("%d resets during writes, gc steps and checkpoints: %d bad sectors\n", cuts, bad);
+    CHECK(bad == 0);
+}
+
+int main(int argc, char **argv)
+{
+    wl_flash_t w;
+    uint32_t lba;
+    int cuts = (argc > 1) ? atoi(argv[1]) : 2000;
+
+    srand(1);
+    printf("%d random 4 KB writes on a volume %d%% full, estimated from the flash timings\n", WRITES, FILL_PERCENT);
+    printf("                       erases/write    KB prog  IOPS    page erases\n");
+    printf("                       write   gc      /write           min..max\n");
+
+    /* a volume of the previous layout is mounted and used in that layout, its data kept */
+    old_volume_create();
+    CHECK(mount(&w, 0) == 0);
+    CHECK(w.legacy && (w.log_cnt == AREA_SIZE / SECTOR_SIZE - 4));
+    random_writes(&w, "previous layout", 0);
+    CHECK(remount(&w) == 0);
+    CHECK(w.legacy);
+    CHECK(verify(&w, -1, 0) == 0);
+
+    /* "fatfs format" moves it to the sector map */
+    wl_flash_release(&w);
+    CHECK(mount(&w, 1) == 0);
+    CHECK(!w.legacy);
+    memset(ver, 0, sizeof(ver));
+    CHECK(verify(&w, -1, 0) == 0);
+
+    random_writes(&w, "sector map", 0);
+    random_writes(&w, "sector map, idle gc", 4);
+    CHECK(remount(&w) == 0);
+    CHECK(!w.legacy);
+    CHECK(verify(&w, -1, 0) == 0);
+
+    CHECK(wl_flash_trim(&w, 0, 9) == 0);
+    for (lba = 0; lba < 10; lba++)
+        ver[lba] = 0;
+    CHECK(remount(&w) == 0);
+    CHECK(verify(&w, -1, 0) == 0);
+
+    printf("\n");
+    power_cuts(&w, cuts);
+    printf("programs over programmed bits %ld, programs on a page of a cut erase %ld\n", n_overwrite, n_weak_prog);
+    CHECK(n_overwrite == 0);
+    CHECK(n_weak_prog == 0);
+
+    wl_flash_release(&w);
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures != 0;
+}